@@ -0,0 +1,136 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Fixed pool of worker threads
+  * @file   WorkerPool.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <exception>
+
+#include "common/thread/WorkerPool.hpp"
+
+namespace common {
+namespace thread {
+
+struct WorkerPool::Batch {
+    const Task* task;
+    /// # of tasks which did not finish yet
+    unsigned pending;
+    std::exception_ptr error;
+    std::mutex lock;
+    std::condition_variable finished;
+};
+
+WorkerPool::WorkerPool(unsigned numThreads) : _stopping(false) {
+    for (unsigned i = 0; i < numThreads; i++) {
+        _threads.push_back(std::thread(&WorkerPool::_work, this));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _jobAdded.notify_all();
+    for (std::thread& thread : _threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(unsigned numTasks, const Task& task) {
+    if (numTasks == 0) return;
+
+    Batch batch;
+    batch.task = &task;
+    batch.pending = numTasks;
+
+    if (numTasks > 1) {
+        std::lock_guard<std::mutex> guard(_lock);
+        for (unsigned i = 1; i < numTasks; i++) {
+            _jobs.push_back({&batch, i});
+        }
+    }
+    _jobAdded.notify_all();
+
+    _runJob({&batch, 0});
+
+    // without threads, the calling thread runs the queued jobs itself
+    while (_threads.empty()) {
+        Job job;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (_jobs.empty()) break;
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+        _runJob(job);
+    }
+
+    std::unique_lock<std::mutex> guard(batch.lock);
+    while (batch.pending > 0) {
+        batch.finished.wait(guard);
+    }
+    if (batch.error != nullptr) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void WorkerPool::_work() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            while (_jobs.empty() && !_stopping) {
+                _jobAdded.wait(guard);
+            }
+            if (_jobs.empty()) return;
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+        _runJob(job);
+    }
+}
+
+void WorkerPool::_runJob(const Job& job) {
+    Batch* batch = job.batch;
+    std::exception_ptr error;
+
+    try {
+        (*batch->task)(job.taskId);
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> guard(batch->lock);
+    if (error != nullptr && batch->error == nullptr) {
+        batch->error = error;
+    }
+    batch->pending--;
+    if (batch->pending == 0) {
+        batch->finished.notify_all();
+    }
+}
+
+}  // namespace thread
+}  // namespace common
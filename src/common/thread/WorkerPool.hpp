@@ -0,0 +1,85 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _COMMON_THREAD_WORKERPOOL_HPP
+#define _COMMON_THREAD_WORKERPOOL_HPP
+
+/**
+  * @brief  Fixed pool of worker threads
+  * @file   WorkerPool.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+
+namespace common {
+namespace thread {
+
+/**
+ * @brief Pool of threads running the tasks of blocking batches. Batches of
+ * several callers may run concurrently and share the threads.
+ */
+class WorkerPool {
+ public:
+    typedef std::function<void(unsigned)> Task;
+
+    explicit WorkerPool(unsigned numThreads);
+    ~WorkerPool();
+
+    /// @return number of threads of the pool
+    unsigned size() const { return _threads.size(); }
+
+    /**
+     * @brief Run task(0), ..., task(numTasks - 1) and wait for all of them.
+     * Task 0 runs on the calling thread, the others on the pool. If tasks
+     * throw, the first exception is rethrown once all tasks finished.
+     */
+    void run(unsigned numTasks, const Task& task);
+
+ private:
+    struct Batch;
+    struct Job {
+        Batch* batch;
+        unsigned taskId;
+    };
+
+    void _work();
+    static void _runJob(const Job& job);
+
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    std::mutex _lock;
+    std::condition_variable _jobAdded;
+    bool _stopping;
+
+    DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace thread
+}  // namespace common
+
+#endif  // _COMMON_THREAD_WORKERPOOL_HPP
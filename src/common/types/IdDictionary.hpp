@@ -59,6 +59,7 @@ class IdDictionary {
         const Key& get(ValueId valueId) const {
             return _keys.at(valueId - VALUEID_START);
         }
+        size_t size() const { return _keys.size(); }
         friend class IdDictionary;
     };
 
@@ -0,0 +1,83 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _COMMON_UTILS_THREADARENA_HPP
+#define _COMMON_UTILS_THREADARENA_HPP
+
+/**
+  * @brief  Per-thread reusable scratch state
+  * @file   ThreadArena.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <memory>
+
+#include "common/utils/compiler_defs.h"
+
+namespace common {
+namespace utils {
+
+/**
+ * @brief Lease of a per-thread instance of T. The instance outlives the
+ * lease, so buffers in T keep their capacity for the next lease on the same
+ * thread. A nested lease on a thread whose instance is taken gets a private
+ * instance instead. A lease must be released on the thread that took it.
+ */
+template <class T>
+class ThreadArena {
+    T* _value;
+    std::unique_ptr<T> _private;
+
+    static T& _local() {
+        static thread_local T value;
+        return value;
+    }
+    static bool& _localTaken() {
+        static thread_local bool taken = false;
+        return taken;
+    }
+
+ public:
+    ThreadArena() {
+        if (_localTaken()) {
+            _private.reset(new T());
+            _value = _private.get();
+        } else {
+            _localTaken() = true;
+            _value = &_local();
+        }
+    }
+    ~ThreadArena() {
+        if (_private == nullptr) _localTaken() = false;
+    }
+
+    T* operator->() { return _value; }
+    const T* operator->() const { return _value; }
+    T& operator*() { return *_value; }
+    const T& operator*() const { return *_value; }
+
+ private:
+    DISALLOW_COPY_AND_ASSIGN(ThreadArena);
+};
+
+}  // namespace utils
+}  // namespace common
+
+#endif  // _COMMON_UTILS_THREADARENA_HPP
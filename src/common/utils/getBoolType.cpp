@@ -44,7 +44,8 @@ BoolType getBoolType(string str) {
     int i;
     const pair<string, BoolType> values[] = {
         make_pair("yes", BOOL_YES),  make_pair("1", BOOL_YES),
-        make_pair("no", BOOL_NO),    make_pair("0", BOOL_NO),
+        make_pair("true", BOOL_YES), make_pair("no", BOOL_NO),
+        make_pair("0", BOOL_NO),     make_pair("false", BOOL_NO),
         make_pair("", BOOL_DEFAULT),  // Flag to end array
     };
 
@@ -44,7 +44,8 @@ enum BoolType {
 
 /**
   * @brief Method to parse a char array and get the boolean value.
-  * @param str is a char array containing a bool value ("1", "0", "yes", etc)
+  * @param str is a char array containing a bool value ("1", "0", "yes", "true",
+  * etc)
   * @return a BoolType value corresponding to the input.
   */
 BoolType getBoolType(std::string);
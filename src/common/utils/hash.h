@@ -0,0 +1,94 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Non-cryptographic hashing utilities
+ * @file    hash.h
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#ifndef __COMMON_UTILS_HASH_H
+#define __COMMON_UTILS_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/utils/compiler_defs.h"
+
+/*--------------------------------------------------------------------------*/
+/* Constants                                                                */
+/*--------------------------------------------------------------------------*/
+
+#define HASH_FNV1A_32_INIT  0x811c9dc5U
+#define HASH_FNV1A_32_PRIME 0x01000193U
+#define HASH_FNV1A_64_INIT  0xcbf29ce484222325ULL
+#define HASH_FNV1A_64_PRIME 0x00000100000001b3ULL
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+BEGIN_DECLS
+
+/**
+ * Continue a 32 bit FNV-1a hash with the given bytes
+ */
+static inline uint32_t hash_fnv1a_32_update(uint32_t hash, const void* data,
+                                            size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= HASH_FNV1A_32_PRIME;
+    }
+
+    return hash;
+}
+
+static inline uint32_t hash_fnv1a_32(const void* data, size_t size) {
+    return hash_fnv1a_32_update(HASH_FNV1A_32_INIT, data, size);
+}
+
+/**
+ * Continue a 64 bit FNV-1a hash with the given bytes
+ */
+static inline uint64_t hash_fnv1a_64_update(uint64_t hash, const void* data,
+                                            size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= HASH_FNV1A_64_PRIME;
+    }
+
+    return hash;
+}
+
+static inline uint64_t hash_fnv1a_64(const void* data, size_t size) {
+    return hash_fnv1a_64_update(HASH_FNV1A_64_INIT, data, size);
+}
+
+END_DECLS
+
+#endif  // ! __COMMON_UTILS_HASH_H
@@ -73,25 +73,17 @@ using mws::index::IndexLoader;
 using mws::index::LoadingOptions;
 #include "mws/index/IndexWriter.hpp"
 using mws::index::HarvesterConfiguration;
-#include "mws/index/IndexAccessor.hpp"
-using mws::index::IndexAccessor;
 #include "mws/index/ExpressionEncoder.hpp"
 using mws::index::HarvestEncoder;
 using mws::index::ExpressionEncoder;
 #include "mws/types/CmmlToken.hpp"
 using mws::types::CmmlToken;
 using mws::types::TokenCallback;
-#include "mws/types/MwsAnswset.hpp"
-using mws::MwsAnswset;
-#include "mws/types/Query.hpp"
-using mws::types::Query;
 #include "mws/dbc/LevFormulaDb.hpp"
 using mws::dbc::FormulaDb;
 using mws::dbc::LevFormulaDb;
 #include "mws/dbc/CrawlDb.hpp"
 using mws::dbc::CrawlId;
-#include "mws/query/SearchContext.hpp"
-using mws::query::SearchContext;
 #include "mws/types/FormulaPath.hpp"
 using mws::types::FormulaId;
 
@@ -128,8 +120,8 @@ struct ParseResult {
  * @return a vector, where every element is a ParseResult associated with a doc
  */
 static vector<ParseResult*> parseMwsHarvestFromFd(
-    const ExpressionEncoder::Config& encodingConfig,
-    IndexAccessor::Index* index, MeaningDictionary* meaningDictionary, int fd);
+    const ExpressionEncoder::Config& encodingConfig, const IndexLoader* index,
+    MeaningDictionary* meaningDictionary, int fd);
 
 struct DataItems {
     string id;
@@ -275,8 +267,7 @@ int main(int argc, char* argv[]) {
                 }
 
                 vector<ParseResult*> parseResults = parseMwsHarvestFromFd(
-                    config.encoding, data.getIndexHandle(),
-                    data.getMeaningDictionary(), fd);
+                    config.encoding, &data, data.getMeaningDictionary(), fd);
                 for (const ParseResult* parseResult : parseResults) {
                     writeParseResultToFile(*parseResult, output);
                     delete parseResult;
@@ -319,29 +310,26 @@ class HarvestParser : public HarvestProcessor {
                           const uint32_t& crawlId);
     CrawlId processData(const string& data);
     vector<ParseResult*> getParseResults();
-    HarvestParser(IndexAccessor::Index* index,
+    HarvestParser(const IndexLoader* index,
                   MeaningDictionary* meaningictionary,
                   ExpressionEncoder::Config indexingOptions);
 
  private:
-    IndexAccessor::Index* _index;
+    const IndexLoader* _index;
     MeaningDictionary* _meaningDictionary;
     ExpressionEncoder::Config _indexingOptions;
     CrawlId _idCounter;
-    Query::Options _queryOptions;
     /* each CrawlId uniquely identifies a document */
     map<CrawlId, ParseResult*> documents;
 };
 
-HarvestParser::HarvestParser(IndexAccessor::Index* index,
+HarvestParser::HarvestParser(const IndexLoader* index,
                              MeaningDictionary* meaningDictionary,
                              ExpressionEncoder::Config indexingOptions)
     : _index(index),
       _meaningDictionary(meaningDictionary),
       _indexingOptions(std::move(indexingOptions)),
-      _idCounter(0) {
-    _queryOptions.includeHits = false;
-}
+      _idCounter(0) {}
 
 vector<ParseResult*> HarvestParser::getParseResults() {
     vector<ParseResult*> results;
@@ -371,22 +359,20 @@ int HarvestParser::processExpression(const CmmlToken* expression,
             PRINT_WARN("Skipping a formula (could not encode)\n");
             return;
         }
-        MwsAnswset* result;
-        SearchContext ctxt(encodedFormula, _queryOptions);
-        result = ctxt.getResult<IndexAccessor>(_index,
-                                               /* dbQueryManager = */ nullptr,
-                                               /* offset = */ 0,
-                                               /* size = */ 1,
-                                               /* maxTotal = */ 1);
-        numSubExpressions += result->total;
+        // harvest vars are indexed as they are, so match them literally
+        const leaf_t* leaf = _index->lookupFormula(encodedFormula);
+        if (leaf == nullptr) {
+            PRINT_WARN("Skipping a formula (not in the index)\n");
+            return;
+        }
+        numSubExpressions++;
         auto hit = new Hit();
-        FormulaId fmId = *(result->ids.begin());
+        FormulaId fmId = leaf->formula_id;
         hit->uri = exprUri;
         hit->xpath = subexpression->getXpath();
 
         ParseResult* doc = documents[crawlId];
         (doc->idMappings[fmId]).push_back(hit);
-        delete result;
     });
 
     return numSubExpressions;
@@ -400,8 +386,8 @@ CrawlId HarvestParser::processData(const string& data) {
 }
 
 static vector<ParseResult*> parseMwsHarvestFromFd(
-    const ExpressionEncoder::Config& encodingConfig,
-    IndexAccessor::Index* index, MeaningDictionary* meaningDictionary, int fd) {
+    const ExpressionEncoder::Config& encodingConfig, const IndexLoader* index,
+    MeaningDictionary* meaningDictionary, int fd) {
 
     HarvestParser harvestParser(index, meaningDictionary, encodingConfig);
     processHarvestFromFd(fd, &harvestParser);
@@ -29,12 +29,16 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdlib.h>
 
+#include <memory>
+using std::unique_ptr;
 #include <stack>
 using std::stack;
 #include <string>
 using std::string;
 #include <stdexcept>
 using std::exception;
+#include <vector>
+using std::vector;
 
 #include "mws/analytics/analytics.hpp"
 #include "common/utils/FlagParser.hpp"
@@ -103,11 +107,45 @@ void analyze(IndexLoader* indexLoader) {
     analyze_end();
 }
 
+/**
+ * @brief Analyze sampleSize expressions spread evenly over the formula ids,
+ * decoded from the formula store instead of traversing the index
+ */
+void analyzeSample(IndexLoader* indexLoader, uint64_t sampleSize) {
+    const index_handle_t* index = indexLoader->getIndexHandle();
+    const inode_t* root = IndexAccessor::getRootNode(index);
+    if (analyze_begin(index, root) == ANALYTICS_STOP) return;
+
+    const ExpressionDecoder decoder(*indexLoader->getMeaningDictionary());
+    const uint64_t numIds = indexLoader->getNumFormulaIds();
+    const uint64_t step = (sampleSize < numIds) ? numIds / sampleSize : 1;
+
+    for (uint64_t id = 0; id < numIds; id += step) {
+        encoded_formula_t formula = indexLoader->getFormula(id);
+        if (formula.size == 0) continue;
+
+        const vector<encoded_token_t> tokens(formula.data,
+                                             formula.data + formula.size);
+        const leaf_t* leaf = indexLoader->lookupFormula(tokens);
+        unique_ptr<CmmlToken> expression(
+            decoder.decode(formula.data, formula.size));
+        assert(leaf != nullptr && expression != nullptr);
+
+        if (analyze_expression(expression.get(), leaf->num_hits) ==
+            ANALYTICS_STOP) {
+            break;
+        }
+    }
+
+    analyze_end();
+}
+
 }  // namespace analytics
 }  // namespace mws
 
 int main(int argc, char* argv[]) {
     FlagParser::addFlag('I', "index-path", FLAG_REQ, ARG_REQ);
+    FlagParser::addFlag('n', "sample-size", FLAG_OPT, ARG_REQ);
 
     if ((FlagParser::parse(argc, argv)) != 0) {
         fprintf(stderr, "%s", FlagParser::getUsage().c_str());
@@ -120,7 +158,18 @@ int main(int argc, char* argv[]) {
         LoadingOptions loadingOptions;
         loadingOptions.includeHits = false;
         IndexLoader data(indexPath, loadingOptions);
-        mws::analytics::analyze(&data);
+        if (FlagParser::hasArg('n')) {
+            const uint64_t sampleSize =
+                strtoull(FlagParser::getArg('n').c_str(), nullptr, 10);
+            if (sampleSize == 0 || !data.hasFormulaStore()) {
+                PRINT_WARN("Sampling needs a positive sample size and an "
+                           "index with a formula store\n");
+                return EXIT_FAILURE;
+            }
+            mws::analytics::analyzeSample(&data, sampleSize);
+        } else {
+            mws::analytics::analyze(&data);
+        }
     }
     catch (exception& e) {
         PRINT_WARN("%s\n", e.what());
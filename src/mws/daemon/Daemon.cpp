@@ -44,6 +44,8 @@ using std::runtime_error;
 using common::utils::formattedString;
 #include "mws/types/Query.hpp"
 using mws::types::Query;
+#include "mws/types/QueryProfile.hpp"
+using mws::types::QueryProfile;
 #include "mws/xmlparser/readMwsQuery.hpp"
 using mws::xmlparser::readMwsQuery;
 using mws::xmlparser::QueryMode;
@@ -156,6 +158,15 @@ static int acceptPolicyCallback(void* cls, const sockaddr* addr,
 
 
 
+/// @return true if the query, or each query of its batch, has an expression
+static bool hasExpressions(const Query& query) {
+    if (query.batch.empty()) return !query.tokens.empty();
+    for (const Query* batchQuery : query.batch) {
+        if (batchQuery->tokens.empty()) return false;
+    }
+    return true;
+}
+
 static int accessHandlerCallback(void* cls, struct MHD_Connection* connection,
                                  const char* url, const char* method,
                                  const char* version, const char* upload_data,
@@ -211,22 +222,32 @@ static int accessHandlerCallback(void* cls, struct MHD_Connection* connection,
     if (dynamic_cast<SchemaQueryHandler*>(qh) != nullptr) {
         qMode = QueryMode::QUERY_SCHEMA;
     }
+    auto parseStartTime = QueryProfile::Time::now();
     unique_ptr<Query> mwsQuery(readMwsQuery(memstream->getOutputFile(), qMode));
+    const uint64_t parseTime = QueryProfile::microsSince(parseStartTime);
     delete memstream;
 
     // Check if query failed or is empty
-    if (mwsQuery == nullptr || mwsQuery->tokens.size() == 0) {
+    if (mwsQuery == nullptr || !hasExpressions(*mwsQuery)) {
         PRINT_WARN("Bad query request\n");
         return sendXmlGenericResponse(connection, XML_MWS_BAD_QUERY,
                                       MHD_HTTP_BAD_REQUEST);
     }
 
+    // explained queries of a batch report the parse time of the whole batch
+    mwsQuery->profile.parseTime = parseTime;
+    for (Query* batchQuery : mwsQuery->batch) {
+        batchQuery->profile.parseTime = parseTime;
+    }
+
 // Process query
 #ifdef APPLY_RESTRICTIONS
     mwsQuery->applyRestrictions();
 #endif
 
-    unique_ptr<GenericAnswer> answset(qh->handleQuery(mwsQuery.get()));
+    unique_ptr<GenericAnswer> answset(mwsQuery->batch.empty()
+                                          ? qh->handleQuery(mwsQuery.get())
+                                          : qh->handleBatch(mwsQuery.get()));
     if (answset == nullptr) {
         PRINT_WARN("Error while obtaining answer set\n");
         return sendXmlGenericResponse(connection, XML_MWS_SERVER_ERROR,
@@ -34,6 +34,9 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   */
 
 #include <cinttypes>
+#include <climits>
+#include <memory>
+using std::unique_ptr;
 #include <vector>
 using std::vector;
 
@@ -44,13 +47,20 @@ using mws::types::Query;
 #include "mws/index/ExpressionEncoder.hpp"
 using mws::index::QueryEncoder;
 using mws::index::ExpressionEncoder;
+using mws::index::ExpressionDecoder;
 using mws::index::ExpressionInfo;
+#include "mws/index/MeaningIndex.hpp"
+using mws::index::MeaningIndex;
 #include "mws/index/TmpIndexAccessor.hpp"
 using mws::index::TmpIndexAccessor;
 #include "mws/index/IndexBuilder.hpp"
 using mws::index::IndexBuilder;
 using mws::index::HarvesterConfiguration;
 using mws::index::loadHarvests;
+#include "mws/query/ConjunctiveContext.hpp"
+using mws::query::ConjunctiveContext;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
 #include "mws/query/SearchContext.hpp"
 using mws::query::SearchContext;
 #include "mws/daemon/HarvestQueryHandler.hpp"
@@ -66,6 +76,9 @@ HarvestQueryHandler::HarvestQueryHandler(const HarvesterConfiguration& config)
                               &_meaningDictionary, config.encoding);
     uint64_t numExpressions = loadHarvests(&indexBuilder, config);
     PRINT_LOG("%" PRIu64 " expressions loaded.\n", numExpressions);
+    _meaningIndex.reset(new MeaningIndex(_meaningDictionary));
+    _decoder.reset(new ExpressionDecoder(_meaningDictionary));
+    _numbers.reset(new NumericConstants(&_meaningDictionary));
 }
 
 HarvestQueryHandler::~HarvestQueryHandler() {}
@@ -73,16 +86,17 @@ HarvestQueryHandler::~HarvestQueryHandler() {}
 GenericAnswer* HarvestQueryHandler::handleQuery(Query* mwsQuery) {
     MwsAnswset* result;
 
-    QueryEncoder encoder(&_meaningDictionary);
+    QueryEncoder encoder(_meaningIndex.get());
     vector<encoded_token_t> encodedQuery;
     ExpressionInfo queryInfo;
 
+    if (mwsQuery->tokens.size() > 1) return _conjunctiveQuery(mwsQuery);
     if (encoder.encode(_encodingConfig, mwsQuery->tokens[0], &encodedQuery,
                        &queryInfo) ==
         0) {
         dbc::DbQueryManager dbQueryManger(&_crawlDb, &_formulaDb);
         SearchContext ctxt(encodedQuery, mwsQuery->options,
-                           queryInfo.rangeBounds, &_meaningDictionary);
+                           queryInfo.rangeBounds, _numbers.get());
         result = ctxt.getResult<TmpIndexAccessor>(
             &_index, &dbQueryManger, mwsQuery->attrResultLimitMin,
             mwsQuery->attrResultMaxSize, mwsQuery->attrResultTotalReqNr);
@@ -92,6 +106,49 @@ GenericAnswer* HarvestQueryHandler::handleQuery(Query* mwsQuery) {
 
     result->qvarNames = queryInfo.qvarNames;
     result->qvarXpaths = queryInfo.qvarXpaths;
+    if (mwsQuery->options.includeSubstitutions) {
+        const ExpressionDecoder* decoder = _decoder.get();
+        result->substitutionDecoder = [decoder](
+            const vector<encoded_token_t>& tokens) {
+            return decoder->toCmml(tokens.data(), tokens.size());
+        };
+    }
+
+    return result;
+}
+
+MwsAnswset* HarvestQueryHandler::_conjunctiveQuery(const Query* mwsQuery) {
+    dbc::DbQueryManager dbQueryManger(&_crawlDb, &_formulaDb);
+    ConjunctiveContext ctxt(mwsQuery->options, &dbQueryManger);
+    ExpressionInfo firstInfo;
+    Query::Options exprOptions = mwsQuery->options;
+    exprOptions.includeHits = false;
+    exprOptions.includeMwsIds = true;
+
+    for (size_t i = 0; i < mwsQuery->tokens.size(); i++) {
+        QueryEncoder encoder(_meaningIndex.get());
+        vector<encoded_token_t> encodedQuery;
+        ExpressionInfo queryInfo;
+
+        if (encoder.encode(_encodingConfig, mwsQuery->tokens[i],
+                           &encodedQuery, &queryInfo) != 0) {
+            return new MwsAnswset();
+        }
+        if (i == 0) firstInfo = queryInfo;
+
+        SearchContext searchContext(encodedQuery, exprOptions,
+                                    queryInfo.rangeBounds, _numbers.get());
+        unique_ptr<MwsAnswset> answset(
+            searchContext.getResult<TmpIndexAccessor>(
+                &_index, &dbQueryManger, 0, INT_MAX, INT_MAX));
+        ctxt.addExpression(answset->ids, answset->partial);
+    }
+
+    MwsAnswset* result = ctxt.getResult(mwsQuery->attrResultLimitMin,
+                                        mwsQuery->attrResultMaxSize,
+                                        mwsQuery->attrResultTotalReqNr);
+    result->qvarNames = firstInfo.qvarNames;
+    result->qvarXpaths = firstInfo.qvarXpaths;
 
     return result;
 }
@@ -28,12 +28,17 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   * @date 15 Jun 2014
   */
 
+#include <memory>
+
 #include "mws/daemon/QueryHandler.hpp"
 #include "mws/dbc/MemFormulaDb.hpp"
 #include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/index/ExpressionEncoder.hpp"
 #include "mws/index/TmpIndex.hpp"
 #include "mws/index/MeaningDictionary.hpp"
+#include "mws/index/MeaningIndex.hpp"
 #include "mws/index/IndexBuilder.hpp"
+#include "mws/query/NumericConstants.hpp"
 
 namespace mws {
 namespace daemon {
@@ -46,7 +51,14 @@ class HarvestQueryHandler : public QueryHandler {
     GenericAnswer* handleQuery(types::Query* query);
 
  private:
+    /// Answer a query of several expressions with the documents containing
+    /// all of them
+    MwsAnswset* _conjunctiveQuery(const types::Query* query);
+
     index::MeaningDictionary _meaningDictionary;
+    std::unique_ptr<index::MeaningIndex> _meaningIndex;
+    std::unique_ptr<index::ExpressionDecoder> _decoder;
+    std::unique_ptr<query::NumericConstants> _numbers;
     dbc::MemCrawlDb _crawlDb;
     dbc::MemFormulaDb _formulaDb;
     index::TmpIndex _index;
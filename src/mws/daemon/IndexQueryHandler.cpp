@@ -39,7 +39,11 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include <sys/stat.h>   // POSIX File characteristics
 #include <fcntl.h>      // File control operations
 #include <stdlib.h>
+#include <inttypes.h>
+#include <limits.h>
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 using std::string;
 #include <vector>
@@ -53,6 +57,8 @@ using std::exception;
 #include <memory>
 using std::unique_ptr;
 
+#include "common/thread/WorkerPool.hpp"
+using common::thread::WorkerPool;
 #include "mws/dbc/CrawlDb.hpp"
 using mws::dbc::CrawlData;
 #include "mws/dbc/LevFormulaDb.hpp"
@@ -61,108 +67,740 @@ using mws::dbc::LevFormulaDb;
 using mws::dbc::LevCrawlDb;
 #include "mws/dbc/DbQueryManager.hpp"
 using mws::dbc::DbQueryManager;
-using mws::dbc::DbAnswerCallback;
+#include "mws/index/formula_store.h"
 #include "mws/index/index.h"
+#include "mws/index/token_postings.h"
 #include "mws/index/IndexLoader.hpp"
 using mws::index::IndexLoader;
 #include "mws/index/ExpressionEncoder.hpp"
 using mws::index::QueryEncoder;
+using mws::index::ExpressionDecoder;
 using mws::index::ExpressionInfo;
+using mws::index::mirrorEncoding;
 #include "mws/index/MeaningDictionary.hpp"
 using mws::index::MeaningDictionary;
 #include "mws/index/IndexAccessor.hpp"
 using mws::index::IndexAccessor;
+#include "mws/query/BatchContext.hpp"
+using mws::query::BatchContext;
+#include "mws/query/ConjunctiveContext.hpp"
+using mws::query::ConjunctiveContext;
+#include "mws/query/DocumentContext.hpp"
+using mws::query::DocumentContext;
+#include "mws/query/DocumentFilter.hpp"
+using mws::query::DocumentFilter;
+#include "mws/query/CursorCache.hpp"
+using mws::query::CursorCache;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+using mws::query::PagedSearch;
+#include "mws/query/EngineSelector.hpp"
+using mws::query::EngineSelector;
+#include "mws/query/LeafScorer.hpp"
+using mws::query::LeafScorer;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/query/QueryCache.hpp"
+using mws::query::QueryCache;
 #include "mws/query/SearchContext.hpp"
 using mws::query::SearchContext;
-#include "mws/query/engine.h"
 #include "mws/types/FormulaPath.hpp"
 using mws::types::FormulaId;
 using mws::types::FormulaPath;
 #include "mws/types/Query.hpp"
 using mws::types::Query;
+#include "mws/types/QueryProfile.hpp"
+using mws::types::QueryProfile;
 #include "mws/xmlparser/processMwsHarvest.hpp"
 #include "mws/daemon/IndexQueryHandler.hpp"
 
 namespace mws {
 namespace daemon {
 
-struct HandlerStruct {
-    MwsAnswset* result;
-    types::Query* mwsQuery;
-    DbQueryManager* dbQueryManager;
-};
+static bool hasVarsOrRanges(const vector<encoded_token_t>& encodedQuery) {
+    for (const encoded_token_t& token : encodedQuery) {
+        if (encoded_token_is_var(token) || encoded_token_is_range(token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Answer a query without qvars or ranges from the exact match table,
+ * with the same offset, size and total semantics as SearchContext
+ */
+static MwsAnswset* exactQuery(const IndexLoader& index,
+                              DbQueryManager* dbQueryManager,
+                              const vector<encoded_token_t>& encodedQuery,
+                              const Query* query) {
+    auto startTime = SearchContext::Time::now();
+    auto result = new MwsAnswset();
+    const leaf_t* leaf = index.lookupFormula(encodedQuery);
+    const unsigned offset = query->attrResultLimitMin;
+    const unsigned maxTotal = query->attrResultTotalReqNr;
+    unsigned size = query->attrResultMaxSize;
+
+    if (offset + size > maxTotal) {
+        size = (maxTotal <= offset) ? 0 : maxTotal - offset;
+    }
+
+    if (leaf != nullptr && maxTotal > 0) {
+        unsigned hitsCount =
+            query->options.includeHits ? leaf->num_hits : 1;
+
+        if (size + offset > 0 && hitsCount > offset) {
+            if (query->options.includeHits) {
+                auto callback = [result](const FormulaPath& formulaPath,
+                                         const CrawlData& crawlData) {
+                    auto answer = new mws::types::Answer();
+                    answer->data = crawlData;
+                    answer->uri = formulaPath.xmlId;
+                    answer->xpath = formulaPath.xpath;
+                    result->answers.push_back(answer);
+                    return 0;
+                };
+                dbQueryManager->query((FormulaId)leaf->formula_id, offset,
+                                      size, callback, query->options.profile);
+            }
+            if (query->options.includeMwsIds) {
+                result->ids.insert(leaf->formula_id);
+            }
+        }
+        result->total = std::min(hitsCount, maxTotal);
+    }
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+/**
+ * Minimum ratio between the leaves the trie search visits and the
+ * candidates of the postings for the postings to be used
+ */
+static const uint64_t POSTINGS_MIN_GAIN = 4;
+
+static bool isConstant(const encoded_token_t& token) {
+    return !encoded_token_is_var(token) && !encoded_token_is_range(token);
+}
+
+/// @return number of tokens before the first qvar or range of a query
+static size_t leadingConstants(const vector<encoded_token_t>& encodedQuery) {
+    size_t i = 0;
+    while (i < encodedQuery.size() && isConstant(encodedQuery[i])) i++;
+    return i;
+}
+
+/**
+ * @brief Plan a query with qvars or ranges. The trie search only narrows
+ * down the index on the leading constants of the query, the token postings
+ * on all of them. Estimate the leaves each plan visits from the postings.
+ * @return true to answer the query from the postings, false for the trie
+ */
+static bool usePostings(const IndexLoader& index,
+                        const vector<encoded_token_t>& encodedQuery) {
+    const token_postings_handle_t* postings = index.getTokenPostings();
+    if (postings == nullptr || index.getFormulaStore() == nullptr) {
+        return false;
+    }
+    // candidates are verified without hvar unification
+    if (postings->header->flags & TOKEN_POSTINGS_HAS_VARS) return false;
 
-static result_cb_return_t result_callback(void* _ctxt, const leaf_t* leaf) {
-    assert(leaf->type == LEAF_NODE);
+    vector<uint64_t> keys(2 * encodedQuery.size() + 1);
+    int numKeys = token_postings_formula_keys(
+        encodedQuery.data(), encodedQuery.size(), keys.data());
+    if (numKeys <= 0) return false;
 
-    HandlerStruct* ctxt = reinterpret_cast<HandlerStruct*>(_ctxt);
-    MwsAnswset* result = ctxt->result;
-    Query* mwsQuery = ctxt->mwsQuery;
-    DbQueryManager* dbQueryManager = ctxt->dbQueryManager;
-    DbAnswerCallback queryCallback =
-        [result](const FormulaPath & formulaPath, const CrawlData & crawlData) {
-        auto answer = new mws::types::Answer();
-        answer->data = crawlData;
-        answer->uri = formulaPath.xmlId;
-        answer->xpath = formulaPath.xpath;
-        result->answers.push_back(answer);
-        return 0;
+    // the candidates are at most the leaves of the shortest list
+    uint64_t postingsLeaves = UINT64_MAX;
+    for (int i = 0; i < numKeys; i++) {
+        postingsLeaves = std::min(postingsLeaves,
+                                  token_postings_count(postings, keys[i]));
     }
-    ;
 
-    dbQueryManager->query((FormulaId)leaf->formula_id,
-                          mwsQuery->attrResultLimitMin,
-                          mwsQuery->attrResultMaxSize, queryCallback);
-    result->total += leaf->num_hits;
+    // the trie visits every leaf below its leading constants
+    uint64_t trieLeaves = postings->header->num_leaves;
+    const encoded_token_t& root = encodedQuery[0];
+    if (isConstant(root)) {
+        trieLeaves = token_postings_count(
+            postings, token_postings_key(TOKEN_POSTINGS_PARENT_ROOT, root));
+        if (encodedQuery.size() > 1 && isConstant(encodedQuery[1])) {
+            trieLeaves = std::min(
+                trieLeaves,
+                token_postings_count(postings,
+                                     token_postings_key(
+                                         token_postings_parent(root),
+                                         encodedQuery[1])));
+        }
+    }
 
-    return QUERY_CONTINUE;
+    return POSTINGS_MIN_GAIN * postingsLeaves < trieLeaves;
+}
+
+/**
+ * @brief The trie only narrows down on the leading constants of a query, so
+ * search the mirrored formulae if the query ends with more
+ * @return true to search the mirror index with the mirrored query
+ */
+static bool useMirror(IndexLoader& index,
+                      const vector<encoded_token_t>& encodedQuery) {
+    if (index.getMirrorIndexHandle() == nullptr) return false;
+    return leadingConstants(mirrorEncoding(encodedQuery)) >
+           leadingConstants(encodedQuery);
+}
+
+/**
+ * @brief SearchContext and the exact match table do not unify the query with
+ * hvars, so they only answer queries of indexes without them. The root of
+ * the index records whether some formula has hvars.
+ * @return true if some formula of the index has hvars
+ */
+static bool hasHvars(IndexLoader& index) {
+    return inode_has_hvars((const inode_t*)index.getIndexHandle()->root);
+}
+
+/// @return the tighter of two limits, where 0 means no limit
+template <typename T>
+static T tighterLimit(T limit1, T limit2) {
+    if (limit1 == 0) return limit2;
+    if (limit2 == 0) return limit1;
+    return std::min(limit1, limit2);
+}
+
+/**
+ * @brief Key of a query in the result cache. Qvars are encoded by first
+ * occurrence, so alpha-equivalent queries share a key. The deadline and the
+ * node budget are not part of it since partial results are not cached.
+ * @param withPage if false, the key is shared by all pages of the query
+ */
+static string cacheKey(const vector<encoded_token_t>& encodedQuery,
+                       const ExpressionInfo& queryInfo, const Query* query,
+                       bool withPage = true) {
+    string key;
+    auto append = [&key](const void* data, size_t size) {
+        key.append(reinterpret_cast<const char*>(data), size);
+    };
+
+    const uint32_t params[] = {
+        withPage ? (uint32_t)query->attrResultLimitMin : 0,
+        withPage ? (uint32_t)query->attrResultMaxSize : 0,
+        (uint32_t)query->attrResultTotalReqNr,
+        query->attrResultTotalReq,
+        query->options.includeHits,
+        query->options.includeMwsIds,
+        query->options.ranked,
+        query->options.includeSubstitutions,
+        query->options.estimateTotal,
+        query->options.groupByDocument,
+        (uint32_t)(query->options.collections >> 32),
+        (uint32_t)query->options.collections,
+        query->options.minCrawlId,
+        query->options.maxCrawlId,
+        (uint32_t)encodedQuery.size()};
+    append(params, sizeof(params));
+    for (const encoded_token_t& token : encodedQuery) {
+        append(&token, sizeof(token));
+        if (encoded_token_is_range(token)) {
+            const auto& bounds = queryInfo.rangeBounds.at(token.id);
+            append(&bounds.first, sizeof(bounds.first));
+            append(&bounds.second, sizeof(bounds.second));
+        }
+    }
+
+    return key;
+}
+
+/**
+ * @brief Report the profile of an explained query with its answer set. The
+ * search time is what remains of the answer time once the encoding and the
+ * database lookups are taken out.
+ * @param answerTime microseconds spent answering the query
+ */
+static void setProfile(Query* query,
+                       const vector<encoded_token_t>& encodedQuery,
+                       const ExpressionInfo& queryInfo, uint64_t answerTime,
+                       MwsAnswset* result) {
+    QueryProfile& profile = query->profile;
+    const uint64_t otherTime = profile.encodeTime + profile.dbTime;
+    profile.searchTime = (answerTime > otherTime) ? answerTime - otherTime : 0;
+
+    // the qvar names follow the occurrences of the named qvars
+    size_t occurrence = 0;
+    vector<uint32_t> varIds;
+    for (const encoded_token_t& token : encodedQuery) {
+        if (!encoded_token_is_var(token) || encoded_token_is_anon_var(token)) {
+            continue;
+        }
+        if (occurrence >= queryInfo.qvarNames.size()) break;
+        const string& name = queryInfo.qvarNames[occurrence++];
+        if (std::find(varIds.begin(), varIds.end(), token.id) !=
+            varIds.end()) {
+            continue;
+        }
+        varIds.push_back(token.id);
+        profile.qvarBacktracks.push_back({name, profile.backtracks[token.id]});
+    }
+
+    result->profile.reset(new QueryProfile(profile));
 }
 
 GenericAnswer* IndexQueryHandler::handleQuery(Query* query) {
+    auto startTime = QueryProfile::Time::now();
     MwsAnswset* result;
-    QueryEncoder encoder(_index.getMeaningDictionary());
+    QueryEncoder encoder(_index.getMeaningIndex());
     vector<encoded_token_t> encodedQuery;
     ExpressionInfo queryInfo;
 
-    if (encoder.encode(_config.encoding, query->tokens[0], &encodedQuery,
-                       &queryInfo) ==
-        0) {
-        if (_config.useExperimentalQueryEngine) {
-            HandlerStruct ctxt;
-            ctxt.result = result = new MwsAnswset();
-            ctxt.mwsQuery = query;
-            ctxt.dbQueryManager = _index.getDbQueryManager();
-
-            encoded_formula_t encodedFormula;
-            encodedFormula.data = encodedQuery.data(),
-            encodedFormula.size = encodedQuery.size();
-
-            query_engine_run(_index.getIndexHandle(), &encodedFormula,
-                             result_callback, &ctxt);
-        } else {
-            SearchContext ctxt(encodedQuery, query->options,
-                               queryInfo.rangeBounds,
-                               _index.getMeaningDictionary());
-            result = ctxt.getResult<IndexAccessor>(
-                _index.getIndexHandle(), _index.getDbQueryManager(),
-                query->attrResultLimitMin, query->attrResultMaxSize,
-                query->attrResultTotalReqNr);
+    _applyLimits(query);
+    if (query->attrExplain) query->options.profile = &query->profile;
+    if (query->tokens.size() > 1) {
+        result = _conjunctiveQuery(query);
+        if (query->attrExplain) {
+            // the qvars of the expressions are not told apart
+            setProfile(query, encodedQuery, queryInfo,
+                       QueryProfile::microsSince(startTime), result);
         }
+        return result;
+    }
+    auto encodeStartTime = QueryProfile::Time::now();
+    int ret = encoder.encode(_config.encoding, query->tokens[0],
+                             &encodedQuery, &queryInfo);
+    query->profile.encodeTime += QueryProfile::microsSince(encodeStartTime);
+    if (ret == 0) {
+        result = _answer(query, encodedQuery, queryInfo);
     } else {
         result = new MwsAnswset();
     }
 
     result->qvarNames = queryInfo.qvarNames;
     result->qvarXpaths = queryInfo.qvarXpaths;
+    _setDecoders(result, query);
+    if (query->attrExplain) {
+        setProfile(query, encodedQuery, queryInfo,
+                   QueryProfile::microsSince(startTime), result);
+    }
+
+    return result;
+}
+
+GenericAnswer* IndexQueryHandler::handleBatch(Query* batch) {
+    const size_t numQueries = batch->batch.size();
+    MwsBatchAnswset* result = new MwsBatchAnswset();
+    vector<ExpressionInfo> queryInfos(numQueries);
+    vector<string> keys(numQueries);
+    BatchContext batchContext(_numbers.get());
+    // queries answered by batchContext, in the order they were added
+    vector<size_t> batched;
+
+    // encodings and answer times of the explained queries, which are
+    // answered on their own
+    vector<vector<encoded_token_t>> explainedQueries(numQueries);
+    vector<uint64_t> answerTimes(numQueries, 0);
+
+    result->answsets.resize(numQueries, nullptr);
+    for (size_t i = 0; i < numQueries; i++) {
+        auto startTime = QueryProfile::Time::now();
+        Query* query = batch->batch[i];
+        QueryEncoder encoder(_index.getMeaningIndex());
+        vector<encoded_token_t> encodedQuery;
+        int ret = 0;
+
+        _applyLimits(query);
+        if (query->attrExplain) query->options.profile = &query->profile;
+        if (query->tokens.size() == 1) {
+            auto encodeStartTime = QueryProfile::Time::now();
+            ret = encoder.encode(_config.encoding, query->tokens[0],
+                                 &encodedQuery, &queryInfos[i]);
+            query->profile.encodeTime +=
+                QueryProfile::microsSince(encodeStartTime);
+        }
+        if (query->tokens.size() > 1) {
+            result->answsets[i] = _conjunctiveQuery(query);
+        } else if (ret != 0) {
+            result->answsets[i] = new MwsAnswset();
+        } else if (!_isBatchable(query, encodedQuery)) {
+            result->answsets[i] = _answer(query, encodedQuery, queryInfos[i]);
+        } else {
+            if (_cache != nullptr) {
+                keys[i] = cacheKey(encodedQuery, queryInfos[i], query);
+                result->answsets[i] = _cache->find(keys[i]);
+                if (result->answsets[i] != nullptr) continue;
+            }
+            batchContext.addQuery(encodedQuery, query->options,
+                                  queryInfos[i].rangeBounds,
+                                  query->attrResultLimitMin,
+                                  query->attrResultMaxSize,
+                                  query->attrResultTotalReqNr);
+            batched.push_back(i);
+        }
+        if (query->attrExplain) {
+            explainedQueries[i] = encodedQuery;
+            answerTimes[i] = QueryProfile::microsSince(startTime);
+        }
+    }
+
+    vector<MwsAnswset*> answsets = batchContext.getResults(
+        _index.getIndexHandle(), _index.getDbQueryManager());
+    for (size_t j = 0; j < batched.size(); j++) {
+        size_t i = batched[j];
+        result->answsets[i] = answsets[j];
+        if (_cache != nullptr) _cache->put(keys[i], *answsets[j]);
+    }
+
+    for (size_t i = 0; i < numQueries; i++) {
+        if (batch->batch[i]->attrExplain) {
+            setProfile(batch->batch[i], explainedQueries[i], queryInfos[i],
+                       answerTimes[i], result->answsets[i]);
+        }
+        if (batch->batch[i]->tokens.size() > 1) continue;
+        result->answsets[i]->qvarNames = queryInfos[i].qvarNames;
+        result->answsets[i]->qvarXpaths = queryInfos[i].qvarXpaths;
+        _setDecoders(result->answsets[i], batch->batch[i]);
+    }
+
+    return result;
+}
+
+MwsAnswset* IndexQueryHandler::_conjunctiveQuery(const Query* query) {
+    auto startTime = SearchContext::Time::now();
+    ConjunctiveContext ctxt(query->options, _index.getDbQueryManager());
+    if (query->options.isFiltered()) ctxt.setFilter(_documentFilter(query));
+    ExpressionInfo firstInfo;
+    // each expression is searched for all of its formulae, without answers
+    Query exprQuery;
+    exprQuery.options = query->options;
+    exprQuery.options.includeHits = false;
+    exprQuery.options.includeMwsIds = true;
+    exprQuery.options.ranked = false;
+    exprQuery.attrResultMaxSize = INT_MAX;
+    exprQuery.attrResultTotalReqNr = INT_MAX;
+    exprQuery.attrParallelism = query->attrParallelism;
+
+    for (size_t i = 0; i < query->tokens.size(); i++) {
+        QueryEncoder encoder(_index.getMeaningIndex());
+        vector<encoded_token_t> encodedQuery;
+        ExpressionInfo queryInfo;
+
+        auto encodeStartTime = QueryProfile::Time::now();
+        int ret = encoder.encode(_config.encoding, query->tokens[i],
+                                 &encodedQuery, &queryInfo);
+        if (query->options.profile != nullptr) {
+            query->options.profile->encodeTime +=
+                QueryProfile::microsSince(encodeStartTime);
+        }
+        if (ret != 0) return new MwsAnswset();
+        if (i == 0) firstInfo = queryInfo;
+
+        // the expressions share the deadline of the query
+        if (query->options.timeout > 0) {
+            auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+                SearchContext::Time::now() - startTime);
+            exprQuery.options.timeout = std::max<int64_t>(
+                1, (int64_t)query->options.timeout - elapsedTime.count());
+        }
+        unique_ptr<MwsAnswset> answset(
+            _search(&exprQuery, encodedQuery, queryInfo));
+        ctxt.addExpression(answset->ids, answset->partial);
+    }
+
+    MwsAnswset* result =
+        ctxt.getResult(query->attrResultLimitMin, query->attrResultMaxSize,
+                       query->attrResultTotalReqNr);
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+    result->qvarNames = firstInfo.qvarNames;
+    result->qvarXpaths = firstInfo.qvarXpaths;
+
+    return result;
+}
+
+void IndexQueryHandler::_setDecoders(MwsAnswset* result,
+                                     const Query* query) const {
+    if (_decoder == nullptr) return;
+
+    const ExpressionDecoder* decoder = _decoder.get();
+    if (query->options.includeSubstitutions) {
+        result->substitutionDecoder = [decoder](
+            const vector<encoded_token_t>& tokens) {
+            return decoder->toCmml(tokens.data(), tokens.size());
+        };
+    }
+
+    // the formula of an id is read from the store, without searching the
+    // index for its leaf
+    const formula_store_handle_t* formulaStore = _index.getFormulaStore();
+    if (query->options.includeFormulae && formulaStore != nullptr) {
+        result->formulaDecoder = [decoder, formulaStore](FormulaId formulaId) {
+            encoded_formula_t formula =
+                formula_store_get(formulaStore, formulaId);
+            return decoder->toCmml(formula.data, formula.size);
+        };
+    }
+}
+
+void IndexQueryHandler::_applyLimits(Query* query) const {
+    query->options.timeout =
+        tighterLimit(query->options.timeout, _config.queryTimeout);
+    query->options.maxNodes =
+        tighterLimit(query->options.maxNodes, _config.queryMaxNodes);
+}
+
+DocumentFilter IndexQueryHandler::_documentFilter(const Query* query) {
+    return DocumentFilter(query->options, _index.getCollectionMasks(),
+                          _index.getIndexHandle());
+}
+
+bool IndexQueryHandler::_isBatchable(
+    const Query* query, const vector<encoded_token_t>& encodedQuery) {
+    return hasVarsOrRanges(encodedQuery) && !query->options.ranked &&
+           !query->options.estimateTotal &&
+           !query->options.groupByDocument && !query->options.isFiltered() &&
+           query->options.profile == nullptr && !_config.useSearchContext &&
+           query->attrCursor.empty() &&
+           !usePostings(_index, encodedQuery) &&
+           !useMirror(_index, encodedQuery);
+}
+
+MwsAnswset* IndexQueryHandler::_answer(
+    const Query* query, const vector<encoded_token_t>& encodedQuery,
+    const ExpressionInfo& queryInfo) {
+    MwsAnswset* result;
+    auto search = [&]() {
+        if (query->options.groupByDocument) {
+            return _documentQuery(query, encodedQuery, queryInfo);
+        }
+        return _search(query, encodedQuery, queryInfo);
+    };
+
+    // answers with a continuation token are not shared, and explained
+    // queries are searched to profile them
+    if (_cache != nullptr && query->attrCursor.empty() &&
+        query->options.profile == nullptr) {
+        auto startTime = SearchContext::Time::now();
+        result = _cache->get(cacheKey(encodedQuery, queryInfo, query),
+                             search);
+        auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+            SearchContext::Time::now() - startTime);
+        result->time = elapsedTime.count();
+    } else {
+        result = search();
+    }
+
+    return result;
+}
+
+MwsAnswset* IndexQueryHandler::_documentQuery(
+    const Query* query, const vector<encoded_token_t>& encodedQuery,
+    const ExpressionInfo& queryInfo) {
+    auto startTime = SearchContext::Time::now();
+    DocumentContext ctxt(query->options, _index.getDbQueryManager());
+    if (query->options.isFiltered()) ctxt.setFilter(_documentFilter(query));
+    // the query is searched for all of its formulae, without answers
+    Query formulaQuery;
+    formulaQuery.options = query->options;
+    formulaQuery.options.includeHits = false;
+    formulaQuery.options.includeMwsIds = true;
+    formulaQuery.options.ranked = false;
+    formulaQuery.options.estimateTotal = false;
+    formulaQuery.options.includeSubstitutions = false;
+    formulaQuery.attrResultMaxSize = INT_MAX;
+    formulaQuery.attrResultTotalReqNr = INT_MAX;
+    formulaQuery.attrParallelism = query->attrParallelism;
+
+    unique_ptr<MwsAnswset> formulae(
+        _search(&formulaQuery, encodedQuery, queryInfo));
+    MwsAnswset* result =
+        ctxt.getResult(formulae->ids, query->attrResultLimitMin,
+                       query->attrResultMaxSize, query->attrResultTotalReqNr);
+    result->partial = formulae->partial;
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+MwsAnswset* IndexQueryHandler::_search(
+    const Query* query, vector<encoded_token_t> encodedQuery,
+    const ExpressionInfo& queryInfo) {
+    MwsAnswset* result;
+    // the collection masks annotate the nodes of the index, which only the
+    // query engine prunes
+    const bool filtered = query->options.isFiltered();
+
+    // the exact match table does not unify the constants of the query with
+    // the hvars of the index
+    if (!hasVarsOrRanges(encodedQuery) && !filtered && !_indexHasHvars) {
+        result = exactQuery(_index, _index.getDbQueryManager(), encodedQuery,
+                            query);
+    } else if (query->options.ranked) {
+        // without a requested total, the search may skip subtrees
+        EngineContext ctxt(encodedQuery, query->options, queryInfo.rangeBounds,
+                           _numbers.get());
+        if (filtered) ctxt.setFilter(_documentFilter(query));
+        result = ctxt.getRankedResult(
+            _index.getIndexHandle(), _index.getDbQueryManager(), *_scorer,
+            query->attrResultTotalReq ? nullptr : _index.getSubtreeBounds(),
+            query->attrResultLimitMin, query->attrResultMaxSize,
+            query->attrResultTotalReqNr);
+    } else if (_config.useSearchContext && !filtered) {
+        result = _searchContextResult(query, encodedQuery, queryInfo);
+    } else if (usePostings(_index, encodedQuery)) {
+        EngineContext ctxt(encodedQuery, query->options, queryInfo.rangeBounds,
+                           _numbers.get());
+        if (filtered) ctxt.setFilter(_documentFilter(query));
+        result = ctxt.getPostingsResult(
+            _index.getIndexHandle(), _index.getDbQueryManager(),
+            _index.getTokenPostings(), _index.getFormulaStore(),
+            query->attrResultLimitMin, query->attrResultMaxSize,
+            query->attrResultTotalReqNr);
+    } else if (_selector != nullptr && query->attrCursor.empty() &&
+               !filtered) {
+        const unsigned shape = EngineSelector::getShape(encodedQuery);
+        const EngineSelector::Engine engine = _selector->choose(shape);
+        auto startTime = SearchContext::Time::now();
+        if (engine == EngineSelector::SEARCH_CONTEXT) {
+            result = _searchContextResult(query, encodedQuery, queryInfo);
+        } else {
+            result = _engineResult(query, encodedQuery, queryInfo);
+        }
+        auto elapsedTime =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                SearchContext::Time::now() - startTime);
+        _selector->record(shape, engine, elapsedTime.count());
+    } else {
+        result = _engineResult(query, encodedQuery, queryInfo);
+    }
+
+    return result;
+}
+
+MwsAnswset* IndexQueryHandler::_searchContextResult(
+    const Query* query, const vector<encoded_token_t>& encodedQuery,
+    const ExpressionInfo& queryInfo) {
+    SearchContext ctxt(encodedQuery, query->options, queryInfo.rangeBounds,
+                       _numbers.get());
+    return ctxt.getResult<IndexAccessor>(
+        _index.getIndexHandle(), _index.getDbQueryManager(),
+        query->attrResultLimitMin, query->attrResultMaxSize,
+        query->attrResultTotalReqNr);
+}
+
+MwsAnswset* IndexQueryHandler::_engineResult(
+    const Query* query, vector<encoded_token_t> encodedQuery,
+    const ExpressionInfo& queryInfo) {
+    MwsAnswset* result;
+    // the calling thread runs one of the tasks
+    unsigned parallelism = query->attrParallelism;
+    if (parallelism == 0 || parallelism > _config.queryThreads + 1) {
+        parallelism = _config.queryThreads + 1;
+    }
+    const string pagesKey =
+        cacheKey(encodedQuery, queryInfo, query, /* withPage = */ false);
+    index_handle_t* indexHandle = _index.getIndexHandle();
+    // substitutions follow the qvars of the query, not of its mirror, and
+    // the collection masks annotate the main index only
+    if (!query->options.includeSubstitutions &&
+        !query->options.isFiltered() && useMirror(_index, encodedQuery)) {
+        encodedQuery = mirrorEncoding(encodedQuery);
+        indexHandle = _index.getMirrorIndexHandle();
+    }
+    EngineContext ctxt(encodedQuery, query->options, queryInfo.rangeBounds,
+                       _numbers.get());
+    if (query->options.isFiltered()) ctxt.setFilter(_documentFilter(query));
+    if (!query->attrCursor.empty() && _cursors != nullptr) {
+        result = _getPage(&ctxt, indexHandle, pagesKey, query);
+    } else {
+        result = ctxt.getResult(indexHandle, _index.getDbQueryManager(),
+                                query->attrResultLimitMin,
+                                query->attrResultMaxSize,
+                                query->attrResultTotalReqNr, _pool.get(),
+                                parallelism);
+    }
+
+    return result;
+}
+
+MwsAnswset* IndexQueryHandler::_getPage(EngineContext* ctxt,
+                                        index_handle_t* indexHandle,
+                                        const string& pagesKey,
+                                        const Query* query) {
+    MwsAnswset* result;
+    unique_ptr<PagedSearch> search = _cursors->take(query->attrCursor,
+                                                    pagesKey);
+
+    // the token of another page, or an expired one, starts over
+    if (search != nullptr && search->position() == query->attrResultLimitMin) {
+        result = ctxt->getNextPage(&search, _index.getDbQueryManager(),
+                                   query->attrResultMaxSize);
+    } else {
+        result = ctxt->getFirstPage(
+            indexHandle, _index.getDbQueryManager(), query->attrResultLimitMin,
+            query->attrResultMaxSize, query->attrResultTotalReqNr,
+            query->attrResultTotalReq, &search);
+    }
+    if (search != nullptr) {
+        result->cursor = _cursors->put(pagesKey, std::move(search));
+    }
 
     return result;
 }
 
 IndexQueryHandler::IndexQueryHandler(const std::string& indexPath,
                                      const Config& config)
-    : _index(indexPath), _config(config) {}
+    : _index(indexPath), _config(config), _indexHasHvars(hasHvars(_index)) {
+    size_t numStaticScores;
+    const float* staticScores = _index.getStaticScores(&numStaticScores);
+    _scorer.reset(new LeafScorer(LeafScorer::Weights(), staticScores,
+                                 numStaticScores));
+
+    if (_config.queryThreads > 0) {
+        _pool.reset(new WorkerPool(_config.queryThreads));
+    }
+    if (_config.cacheSize > 0) {
+        _cache.reset(new QueryCache(_config.cacheSize));
+    }
+    if (_index.getMeaningDictionary() != nullptr) {
+        _decoder.reset(new ExpressionDecoder(*_index.getMeaningDictionary()));
+    }
+    _numbers.reset(new NumericConstants(_index.getMeaningDictionary()));
+    if (_config.cursorTtl > 0) {
+        _cursors.reset(new CursorCache(
+            std::chrono::seconds(_config.cursorTtl), MAX_QUERY_CURSORS));
+    }
+    if (_config.adaptiveEngine && !_config.useSearchContext) {
+        if (_indexHasHvars) {
+            PRINT_LOG("Index has hvars, queries use the query engine\n");
+        }
+        _selector.reset(new EngineSelector(!_indexHasHvars));
+    }
+}
 
-IndexQueryHandler::~IndexQueryHandler() {}
+IndexQueryHandler::~IndexQueryHandler() {
+    if (_cache != nullptr) {
+        QueryCache::Stats stats = _cache->getStats();
+        PRINT_LOG("Query cache: %" PRIu64 " hits, %" PRIu64 " misses (%" PRIu64
+                  " shared), %" PRIu64 " evictions\n",
+                  stats.hits, stats.misses, stats.shared, stats.evictions);
+    }
+    if (_selector != nullptr) {
+        for (const EngineSelector::ShapeStats& stats : _selector->getStats()) {
+            const EngineSelector::EngineStats& search =
+                stats.engines[EngineSelector::SEARCH_CONTEXT];
+            const EngineSelector::EngineStats& engine =
+                stats.engines[EngineSelector::QUERY_ENGINE];
+            PRINT_LOG("Queries with %s: %" PRIu64 " by SearchContext (%.0f "
+                      "us), %" PRIu64 " by the query engine (%.0f us)\n",
+                      EngineSelector::describeShape(stats.shape).c_str(),
+                      search.queries, search.meanMicros, engine.queries,
+                      engine.meanMicros);
+        }
+    }
+}
 
 }  // namespace daemon
 }  // namespace mws
@@ -35,14 +35,27 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   *
   */
 
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
+#include "common/thread/WorkerPool.hpp"
 #include "common/utils/compiler_defs.h"
 #include "mws/daemon/QueryHandler.hpp"
 #include "mws/index/ExpressionEncoder.hpp"
 #include "mws/index/IndexLoader.hpp"
+#include "mws/query/CursorCache.hpp"
+#include "mws/query/DocumentFilter.hpp"
+#include "mws/query/EngineContext.hpp"
+#include "mws/query/EngineSelector.hpp"
+#include "mws/query/LeafScorer.hpp"
+#include "mws/query/NumericConstants.hpp"
+#include "mws/query/QueryCache.hpp"
 #include "mws/types/GenericAnswer.hpp"
+#include "mws/types/MwsAnswset.hpp"
+
+#include "build-gen/config.h"
 
 namespace mws {
 namespace daemon {
@@ -51,9 +64,31 @@ class IndexQueryHandler : public QueryHandler {
  public:
     struct Config {
         index::ExpressionEncoder::Config encoding;
-        bool useExperimentalQueryEngine;
-
-        Config() : useExperimentalQueryEngine(false) {}
+        /// Use SearchContext instead of the query engine (no hvars support)
+        bool useSearchContext;
+        /// Choose between SearchContext and the query engine for each query
+        /// by the latencies of both on queries of the same shape
+        bool adaptiveEngine;
+        /// Threads searching the branches of broad queries in parallel
+        unsigned queryThreads;
+        /// Upper bounds of the deadline (ms) and node budget of queries (0
+        /// for none)
+        unsigned queryTimeout;
+        uint64_t queryMaxNodes;
+        /// Size of the query result cache in bytes (0 to disable it)
+        uint64_t cacheSize;
+        /// Time to live of paused paginated searches in seconds (0 to
+        /// disable pagination cursors)
+        unsigned cursorTtl;
+
+        Config()
+            : useSearchContext(false),
+              adaptiveEngine(false),
+              queryThreads(0),
+              queryTimeout(0),
+              queryMaxNodes(0),
+              cacheSize(0),
+              cursorTtl(DEFAULT_QUERY_CURSOR_TTL) {}
     };
 
     IndexQueryHandler(const std::string& indexPath,
@@ -61,10 +96,63 @@ class IndexQueryHandler : public QueryHandler {
     ~IndexQueryHandler();
 
     GenericAnswer* handleQuery(types::Query* query);
+    /// Answer the queries of a batch, descending their shared prefixes once
+    GenericAnswer* handleBatch(types::Query* batch);
 
  private:
+    /// Answer a query of several expressions with the documents containing
+    /// all of them
+    MwsAnswset* _conjunctiveQuery(const types::Query* query);
+    /// Let the formatters decode the substitutions of the answers and the
+    /// formulae of the ids, if the query requested them
+    void _setDecoders(MwsAnswset* result, const types::Query* query) const;
+    /// Apply the server limits to the deadline and node budget of a query
+    void _applyLimits(types::Query* query) const;
+    /// @return the filter of the documents searched by a filtered query
+    query::DocumentFilter _documentFilter(const types::Query* query);
+    /// @return true if the query is answered by the default engine search
+    bool _isBatchable(const types::Query* query,
+                      const std::vector<encoded_token_t>& encodedQuery);
+    /// Answer an encoded query from the result cache or the index
+    MwsAnswset* _answer(const types::Query* query,
+                        const std::vector<encoded_token_t>& encodedQuery,
+                        const index::ExpressionInfo& queryInfo);
+    /// Answer an encoded query from the index with the documents holding
+    /// its solutions
+    MwsAnswset* _documentQuery(const types::Query* query,
+                               const std::vector<encoded_token_t>& encodedQuery,
+                               const index::ExpressionInfo& queryInfo);
+    /// Answer an encoded query from the index
+    MwsAnswset* _search(const types::Query* query,
+                        std::vector<encoded_token_t> encodedQuery,
+                        const index::ExpressionInfo& queryInfo);
+    /// Answer an encoded query with qvars or ranges using SearchContext
+    MwsAnswset* _searchContextResult(
+        const types::Query* query,
+        const std::vector<encoded_token_t>& encodedQuery,
+        const index::ExpressionInfo& queryInfo);
+    /// Answer an encoded query with qvars or ranges using the query engine
+    MwsAnswset* _engineResult(const types::Query* query,
+                              std::vector<encoded_token_t> encodedQuery,
+                              const index::ExpressionInfo& queryInfo);
+    /// Answer a page of a query, resuming the search of the previous page
+    MwsAnswset* _getPage(query::EngineContext* ctxt,
+                         index_handle_t* indexHandle,
+                         const std::string& pagesKey,
+                         const types::Query* query);
+
     index::IndexLoader _index;
     Config _config;
+    /// Whether some formula of the index has hvars
+    const bool _indexHasHvars;
+    std::unique_ptr<common::thread::WorkerPool> _pool;
+    std::unique_ptr<query::LeafScorer> _scorer;
+    std::unique_ptr<query::QueryCache> _cache;
+    std::unique_ptr<query::CursorCache> _cursors;
+    std::unique_ptr<query::EngineSelector> _selector;
+    std::unique_ptr<index::ExpressionDecoder> _decoder;
+    /// Numeric constants of the meaning dictionary of _index
+    std::unique_ptr<query::NumericConstants> _numbers;
 
     DISALLOW_COPY_AND_ASSIGN(IndexQueryHandler);
 };
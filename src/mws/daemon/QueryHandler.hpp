@@ -23,6 +23,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mws/types/Query.hpp"
 #include "mws/types/GenericAnswer.hpp"
+#include "mws/types/MwsAnswset.hpp"
 
 namespace mws {
 namespace daemon {
@@ -31,6 +32,22 @@ class QueryHandler {
  public:
     virtual ~QueryHandler() {}
     virtual GenericAnswer* handleQuery(types::Query* query) = 0;
+
+    /// Answer the queries of a mws:batch request, one after the other
+    /// unless the handler can share work between them
+    virtual GenericAnswer* handleBatch(types::Query* batch) {
+        MwsBatchAnswset* result = new MwsBatchAnswset();
+        for (types::Query* query : batch->batch) {
+            GenericAnswer* answer = handleQuery(query);
+            MwsAnswset* answset = dynamic_cast<MwsAnswset*>(answer);
+            if (answset == nullptr) {
+                delete answer;
+                answset = new MwsAnswset();
+            }
+            result->answsets.push_back(answset);
+        }
+        return result;
+    }
 };
 
 }  // namespace daemon
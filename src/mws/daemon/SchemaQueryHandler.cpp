@@ -39,6 +39,9 @@ using mws::types::ExprSchema;
 using mws::SchemaAnswset;
 #include "mws/types/CmmlToken.hpp"
 using mws::types::CmmlToken;
+#include "mws/types/FlatCmml.hpp"
+using mws::types::FlatCmml;
+using mws::types::StringRef;
 #include "mws/index/ExpressionEncoder.hpp"
 using mws::index::HarvestEncoder;
 using mws::index::ExpressionEncoder;
@@ -67,13 +70,16 @@ GenericAnswer* SchemaQueryHandler::handleQuery(Query* query) {
     vector<EncodedFormula> exprs;
     exprs.reserve(query->tokens.size());
 
-    vector<const CmmlToken*> exprsTokens;
-    exprsTokens.reserve(query->tokens.size());
-    for (const CmmlToken* tok : query->tokens) {
+    vector<FlatCmml::Ref> exprsRoots;
+    vector<uint32_t> exprsDepths;
+    exprsRoots.reserve(query->tokens.size());
+    exprsDepths.reserve(query->tokens.size());
+    for (const FlatCmml::Ref& expr : query->tokens) {
         EncodedFormula encTok;
-        if (encoder.encode(_encodingConfig, tok, &encTok, nullptr) == 0) {
+        if (encoder.encode(_encodingConfig, expr, &encTok, nullptr) == 0) {
             exprs.push_back(std::move(encTok));
-            exprsTokens.push_back(tok);
+            exprsRoots.push_back(expr);
+            exprsDepths.push_back(expr.getExprDepth());
         }
     }
 
@@ -94,7 +100,7 @@ GenericAnswer* SchemaQueryHandler::handleQuery(Query* query) {
 
     SchemaEngine schemaEngine(dict, engineConfig);
     SchemaAnswset* result =
-        schemaEngine.getSchemata(exprs, exprsTokens, max_total, max_depth);
+        schemaEngine.getSchemataByDepth(exprs, exprsDepths, max_total, max_depth);
 
     /* we can't deduce the substitutions in SchemaEngine because we need
      * the original query, so we will do it here */
@@ -102,62 +108,61 @@ GenericAnswer* SchemaQueryHandler::handleQuery(Query* query) {
         /* As a heuristic,
          * we choose the first formula in this class to be schematized */
         const uint32_t representativeId = sch.formulae.front();
-        CmmlToken* exprRoot = query->tokens[representativeId];
-        getSubstitutions(exprRoot, sch.root, &sch.subst);
+        getSubstitutions(exprsRoots[representativeId], sch.root,
+                         &sch.subst);
     }
 
     return result;
 }
 
-void SchemaQueryHandler::getSubstitutions(CmmlToken* exprRoot,
-                                          CmmlToken* schemaRoot,
+void SchemaQueryHandler::getSubstitutions(const FlatCmml::Ref& exprRoot,
+                                          const CmmlToken* schemaRoot,
                                           vector<string>* subst) {
-    if (exprRoot == nullptr || schemaRoot == nullptr || subst == nullptr) {
+    if (!exprRoot.isValid() || schemaRoot == nullptr || subst == nullptr) {
         PRINT_WARN("nullptr pased. Skipping...");
         return;
     }
-    auto exprChildren = exprRoot->getChildNodes();
-    auto schemaChildren = schemaRoot->getChildNodes();
+    const CmmlToken::PtrList& schemaChildren = schemaRoot->getChildNodes();
 
     const string& currSchemaTag = schemaRoot->getTag();
     if (currSchemaTag == types::QVAR_TAG) {
-        const string& xref = exprRoot->getAttribute("xref");
-        if (xref == "") {
+        StringRef xref = exprRoot.getAttribute("xref");
+        if (xref.empty()) {
             PRINT_LOG("Missing href attribute. Skipping...");
             return;
         }
-        subst->push_back(xref);
+        subst->push_back(xref.str());
         return;
     }
 
-    if (exprChildren.size() != schemaChildren.size()) {
+    if (exprRoot.getArity() != schemaChildren.size()) {
         PRINT_WARN("Expression and schema are incompatible. Skipping...");
         return;
     }
 
-    auto expr_it = exprChildren.begin();
+    FlatCmml::Ref expr_it = exprRoot.getFirstChild();
     auto schema_it = schemaChildren.begin();
-    const string& currExprTag = exprRoot->getTag();
+    const string& currExprTag = exprRoot.getTag();
     if (currExprTag != currSchemaTag) {
         PRINT_WARN("Expression and schema are incompatible. Skipping...");
         return;
     }
     // Done with this token?
-    if (exprChildren.size() == 0) {
+    if (exprRoot.getArity() == 0) {
         return;
     }
 
     // disregard the first child of apply
     if (currExprTag == "apply") {
-        expr_it++;
+        expr_it = expr_it.getNextSibling();
         schema_it++;
     }
 
-    /* we know that both exprChildren and schemaChildren have the same length,
+    /* we know that both expression and schema have the same arity,
      * so it is enough to check for one */
-    while (expr_it != exprChildren.end()) {
-        getSubstitutions(*expr_it, *schema_it, subst);
-        ++expr_it;
+    while (expr_it.isValid()) {
+        getSubstitutions(expr_it, *schema_it, subst);
+        expr_it = expr_it.getNextSibling();
         ++schema_it;
     }
 }
@@ -30,6 +30,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 
 #include "mws/types/CmmlToken.hpp"
+#include "mws/types/FlatCmml.hpp"
 #include "mws/daemon/QueryHandler.hpp"
 #include "mws/index/ExpressionEncoder.hpp"
 using mws::index::ExpressionEncoder;
@@ -49,8 +50,8 @@ class SchemaQueryHandler : public QueryHandler {
     GenericAnswer* handleQuery(types::Query* query);
 
  private:
-    void getSubstitutions(types::CmmlToken* exprRoot,
-                          types::CmmlToken* schemaRoot,
+    void getSubstitutions(const types::FlatCmml::Ref& exprRoot,
+                          const types::CmmlToken* schemaRoot,
                           std::vector<std::string>* substitutions);
 
     index::ExpressionEncoder::Config _encodingConfig;
@@ -24,6 +24,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
  * @author cprodescu
  */
 
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,18 +46,84 @@ DbQueryManager::DbQueryManager(CrawlDb* crawlDb, FormulaDb* formulaDb)
 
 int DbQueryManager::query(types::FormulaId formulaId, unsigned limitMin,
                           unsigned limitSize,
-                          DbAnswerCallback dbAnswerCallback) {
-    QueryCallback formulaQueryCallback = [dbAnswerCallback, this](
+                          DbAnswerCallback dbAnswerCallback,
+                          types::QueryProfile* profile) {
+    auto startTime = types::QueryProfile::Time::now();
+    QueryCallback formulaQueryCallback = [dbAnswerCallback, profile, this](
         const CrawlId& crawlId, const types::FormulaPath& formulaPath) {
-        if (crawlId != CRAWLID_NULL && mCrawlDb) {
-            return dbAnswerCallback(formulaPath,
-                                    this->mCrawlDb->getData(crawlId));
-        } else {
-            return dbAnswerCallback(formulaPath, CRAWLDATA_NULL);
-        }
+        return dbAnswerCallback(formulaPath,
+                                _fetchCrawlData(crawlId, profile));
     };
-    return mFormulaDb->queryFormula(formulaId, limitMin, limitSize,
-                                    formulaQueryCallback);
+    int ret = mFormulaDb->queryFormula(formulaId, limitMin, limitSize,
+                                       formulaQueryCallback);
+    if (profile != nullptr) {
+        profile->dbSeeks++;
+        profile->dbTime += types::QueryProfile::microsSince(startTime);
+    }
+    return ret;
+}
+
+int DbQueryManager::query(types::FormulaId formulaId, unsigned limitMin,
+                          unsigned limitSize,
+                          DbAnswerCallback dbAnswerCallback,
+                          const CrawlFilter& crawlFilter,
+                          types::QueryProfile* profile) {
+    unsigned accepted = 0;
+    if (limitSize == 0) return 0;
+
+    auto startTime = types::QueryProfile::Time::now();
+    QueryCallback formulaQueryCallback = [&](
+        const CrawlId& crawlId, const types::FormulaPath& formulaPath) {
+        if (!crawlFilter(crawlId)) return 0;
+        if (accepted++ < limitMin) return 0;
+        int ret = dbAnswerCallback(formulaPath,
+                                   _fetchCrawlData(crawlId, profile));
+        if (ret != 0) return ret;
+        // stop once the last answer is reported
+        return (accepted == limitMin + limitSize) ? 1 : 0;
+    };
+    int ret = mFormulaDb->queryFormula(formulaId, 0, UINT_MAX,
+                                       formulaQueryCallback);
+    if (profile != nullptr) {
+        profile->dbSeeks++;
+        profile->dbTime += types::QueryProfile::microsSince(startTime);
+    }
+    // stopping after the last answer is not an error
+    return (accepted == limitMin + limitSize) ? 0 : ret;
+}
+
+int DbQueryManager::queryCrawlIds(types::FormulaId formulaId,
+                                  QueryCallback queryCallback,
+                                  types::QueryProfile* profile) {
+    auto startTime = types::QueryProfile::Time::now();
+    int ret = mFormulaDb->queryFormula(formulaId, 0, UINT_MAX, queryCallback);
+    if (profile != nullptr) {
+        profile->dbSeeks++;
+        profile->dbTime += types::QueryProfile::microsSince(startTime);
+    }
+    return ret;
+}
+
+CrawlData DbQueryManager::getCrawlData(const CrawlId& crawlId,
+                                       types::QueryProfile* profile) {
+    auto startTime = types::QueryProfile::Time::now();
+    CrawlData crawlData = _fetchCrawlData(crawlId, profile);
+    if (profile != nullptr) {
+        profile->dbTime += types::QueryProfile::microsSince(startTime);
+    }
+    return crawlData;
+}
+
+CrawlData DbQueryManager::_fetchCrawlData(const CrawlId& crawlId,
+                                          types::QueryProfile* profile) {
+    if (crawlId == CRAWLID_NULL || !mCrawlDb) return CRAWLDATA_NULL;
+
+    CrawlData crawlData = mCrawlDb->getData(crawlId);
+    if (profile != nullptr) {
+        profile->dbSeeks++;
+        profile->crawlBytes += crawlData.size();
+    }
+    return crawlData;
 }
 
 }  // namespace dbc
@@ -32,6 +32,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include "common/utils/compiler_defs.h"
 #include "mws/dbc/CrawlDb.hpp"
 #include "mws/dbc/FormulaDb.hpp"
+#include "mws/types/QueryProfile.hpp"
 
 namespace mws {
 namespace dbc {
@@ -39,6 +40,9 @@ namespace dbc {
 typedef std::function<int (const types::FormulaPath&, const CrawlData&)>
 DbAnswerCallback;
 
+/// @return true if the occurrences in the document crawlId are answered
+typedef std::function<bool (const CrawlId&)> CrawlFilter;
+
 class DbQueryManager {
     CrawlDb* mCrawlDb;
     FormulaDb* mFormulaDb;
@@ -46,12 +50,37 @@ class DbQueryManager {
  public:
     DbQueryManager(CrawlDb* crawlDb, FormulaDb* formulaDb);
 
+    /// The lookups of a query add their duration, database seeks and crawl
+    /// data bytes to profile, if not null
+    int query(types::FormulaId formulaId,
+              unsigned limitMin,
+              unsigned limitSize,
+              DbAnswerCallback dbAnswerCallback,
+              types::QueryProfile* profile = nullptr);
+
+    /// Same as query, limitMin and limitSize counting the occurrences in
+    /// the documents accepted by crawlFilter only
     int query(types::FormulaId formulaId,
               unsigned limitMin,
               unsigned limitSize,
-              DbAnswerCallback dbAnswerCallback);
+              DbAnswerCallback dbAnswerCallback,
+              const CrawlFilter& crawlFilter,
+              types::QueryProfile* profile = nullptr);
+
+    /// Query the CrawlIds and paths of all occurrences of a formula, without
+    /// fetching their crawled data
+    int queryCrawlIds(types::FormulaId formulaId, QueryCallback queryCallback,
+                      types::QueryProfile* profile = nullptr);
+
+    /// @return the crawled data of crawlId
+    CrawlData getCrawlData(const CrawlId& crawlId,
+                           types::QueryProfile* profile = nullptr);
 
  private:
+    /// Fetch the crawled data of crawlId, counting the seek and bytes
+    CrawlData _fetchCrawlData(const CrawlId& crawlId,
+                              types::QueryProfile* profile);
+
     DISALLOW_COPY_AND_ASSIGN(DbQueryManager);
 };
 
@@ -30,6 +30,9 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 /* Includes                                                                 */
 /****************************************************************************/
 
+#include <assert.h>
+#include <string.h>
+
 #include <stack>
 using std::stack;
 #include <stdexcept>
@@ -39,6 +42,9 @@ using std::string;
 using std::to_string;
 #include <unordered_map>
 using std::unordered_map;
+#include <utility>
+using std::pair;
+using std::make_pair;
 #include <vector>
 using std::vector;
 
@@ -46,6 +52,9 @@ using std::vector;
 #include "mws/types/CmmlToken.hpp"
 using mws::types::CmmlToken;
 using mws::types::Meaning;
+#include "mws/types/FlatCmml.hpp"
+using mws::types::FlatCmml;
+using mws::types::StringRef;
 #include "mws/index/MeaningDictionary.hpp"
 #include "mws/index/ExpressionEncoder.hpp"
 
@@ -56,20 +65,47 @@ namespace mws {
 namespace index {
 
 ExpressionEncoder::ExpressionEncoder(MeaningDictionary* dictionary)
-    : _meaningDictionary(dictionary), _ciTranslationCounter(0) {}
+    : _meaningDictionary(dictionary),
+      _ciTranslationCounter(0),
+      _anonVarId(0),
+      _anonRangeId(0) {}
 
 ExpressionEncoder::~ExpressionEncoder() {}
 
+namespace {
+
+inline StringRef varNameOf(const CmmlToken& token) {
+    const string& name = token.getVarName();
+    return StringRef(name.data(), name.size());
+}
+
+inline StringRef varNameOf(const FlatCmml::Ref& token) {
+    return token.getVarName();
+}
+
+inline bool isFirstChildOfApply(const CmmlToken& token) {
+    const CmmlToken* parent = token.getParentNode();
+    return (parent != nullptr) && (parent->getTag() == "apply") &&
+           (parent->getChildNodes().front() == &token);
+}
+
+inline bool isFirstChildOfApply(const FlatCmml::Ref& token) {
+    if (token.isRoot()) return false;
+    FlatCmml::Ref parent = token.getParentNode();
+    return (parent.getTagId() == FlatCmml::APPLY_TAG_ID) &&
+           (parent.getId() + 1 == token.getId());
+}
+
+}  // namespace
+
 int ExpressionEncoder::encode(const Config& config, const CmmlToken* expression,
                               vector<encoded_token_t>* encodedFormula,
                               ExpressionInfo* expressionInfo) {
     int rv = 0;
     stack<const CmmlToken*> dfs_stack;
-    MeaningDictionary namedVarDictionary;
-    int anonVarId = 0;
-    int anonRangeId = 0;  // we only allow anonymous ranges
 
     encodedFormula->clear();
+    _resetState();
 
     dfs_stack.push(expression);
     while (!dfs_stack.empty()) {
@@ -77,44 +113,14 @@ int ExpressionEncoder::encode(const Config& config, const CmmlToken* expression,
         dfs_stack.pop();
         encoded_token_t encoded_token;
 
-        if (token->isVar()) {
-            string qvarName = token->getVarName();
-            encoded_token.arity = 1;
-            if (qvarName == "") {
-                encoded_token.id = _getAnonVarOffset() + anonVarId;
-                anonVarId++;
-            } else {
-                encoded_token.id =
-                    _getNamedVarOffset() + namedVarDictionary.put(qvarName);
-                if (expressionInfo != nullptr) {
-                    expressionInfo->qvarNames.push_back(qvarName);
-                    expressionInfo->qvarXpaths
-                        .push_back(token->getXpathRelative());
-                }
-            }
-        } else if (token->isRange()) {
-            encoded_token.arity = 1;
-            encoded_token.id = _getRangeOffset() + anonRangeId;
-            anonRangeId++;
-            if (expressionInfo != nullptr) {
-                MeaningId tokenId = encoded_token.id;
-                expressionInfo->rangeBounds
-                    .insert({tokenId, token->getRangeBounds()});
-            }
-        } else {
-            /* Only cerrors have such a high arity */
-            if (token->getArity() > ENC_TOK_MAX_ARITY) {
-                return -1;
-            }
-            encoded_token.arity = token->getArity();
-            if (config.renameCi && token->getTag() == "ci") {
-                encoded_token.id = _getCiMeaning((token));
-            } else {
-                encoded_token.id = _getConstantEncoding(token->getMeaning());
-            }
-            if (encoded_token.id == MeaningDictionary::KEY_NOT_FOUND) {
-                rv = -1;
-            }
+        switch (_encodeToken(config, *token, &encoded_token, expressionInfo)) {
+        case ENCODE_OK:
+            break;
+        case ENCODE_UNKNOWN_MEANING:
+            rv = -1;
+            break;
+        default:
+            return -1;
         }
         encodedFormula->push_back(encoded_token);
 
@@ -128,17 +134,106 @@ int ExpressionEncoder::encode(const Config& config, const CmmlToken* expression,
     return rv;
 }
 
-MeaningId ExpressionEncoder::_getCiMeaning(const CmmlToken* token) {
-    Meaning tokMeaning = token->getMeaning();
-    CmmlToken* tokParent = token->getParentNode();
+int ExpressionEncoder::encode(const Config& config,
+                              const FlatCmml::Ref& expression,
+                              vector<encoded_token_t>* encodedFormula,
+                              ExpressionInfo* expressionInfo) {
+    int rv = 0;
+    const FlatCmml* tree = expression.getTree();
+
+    encodedFormula->clear();
+    _resetState();
+
+    // nodes are stored in preorder, so the subtree is a contiguous range
+    for (FlatCmml::NodeId id = expression.getId();
+         id < expression.getSubtreeEnd(); id++) {
+        encoded_token_t encoded_token;
+
+        switch (_encodeToken(config, tree->node(id), &encoded_token,
+                             expressionInfo)) {
+        case ENCODE_OK:
+            break;
+        case ENCODE_UNKNOWN_MEANING:
+            rv = -1;
+            break;
+        default:
+            return -1;
+        }
+        encodedFormula->push_back(encoded_token);
+    }
+
+    return rv;
+}
+
+void ExpressionEncoder::resetCiTranslations() {
+    _ciTranslations.clear();
+    _ciTranslationCounter = 0;
+}
+
+void ExpressionEncoder::_resetState() {
+    _namedVars.clear();
+    _anonVarId = 0;
+    _anonRangeId = 0;
+}
+
+template <class Token>
+ExpressionEncoder::TokenStatus ExpressionEncoder::_encodeToken(
+    const Config& config, const Token& token, encoded_token_t* encodedToken,
+    ExpressionInfo* expressionInfo) {
+    if (token.isVar()) {
+        StringRef qvarName = varNameOf(token);
+        // vars and ranges stand for a whole subterm, they have no arguments
+        encodedToken->arity = 0;
+        if (qvarName.empty()) {
+            encodedToken->id = _getAnonVarOffset() + _anonVarId;
+            _anonVarId++;
+        } else {
+            encodedToken->id = _getNamedVarOffset() + _getNamedVarId(qvarName);
+            if (expressionInfo != nullptr) {
+                expressionInfo->qvarNames.push_back(qvarName.str());
+                expressionInfo->qvarXpaths.push_back(token.getXpathRelative());
+            }
+        }
+    } else if (token.isRange()) {
+        encodedToken->arity = 0;
+        encodedToken->id = _getRangeOffset() + _anonRangeId;
+        _anonRangeId++;  // we only allow anonymous ranges
+        if (expressionInfo != nullptr) {
+            MeaningId tokenId = encodedToken->id;
+            expressionInfo->rangeBounds.insert(
+                {tokenId, token.getRangeBounds()});
+        }
+    } else {
+        /* Only cerrors have such a high arity */
+        if (token.getArity() > ENC_TOK_MAX_ARITY) {
+            return ENCODE_ARITY_OVERFLOW;
+        }
+        encodedToken->arity = token.getArity();
+        if (config.renameCi && token.getTag() == "ci") {
+            encodedToken->id = _getCiMeaning(token);
+        } else {
+            token.getMeaning(&_meaningBuffer);
+            encodedToken->id = _getConstantEncoding(_meaningBuffer);
+        }
+        if (encodedToken->id == MeaningDictionary::KEY_NOT_FOUND) {
+            return ENCODE_UNKNOWN_MEANING;
+        }
+    }
+
+    return ENCODE_OK;
+}
+
+template <class Token>
+MeaningId ExpressionEncoder::_getCiMeaning(const Token& token) {
+    token.getMeaning(&_meaningBuffer);
+    const Meaning& tokMeaning = _meaningBuffer;
 
     // check if we should not rename this ci
     if ((tokMeaning == "#P") || (tokMeaning == "#p") ||
         // the content must have only 1 char:
-        (tokMeaning.length() > 2 + token->getTag().length()) ||
+        (tokMeaning.length() > 2 + token.getTag().length()) ||
         // make sure this is not the 1st child of apply
-        ((tokParent != nullptr) && (tokParent->getTag() == "apply") &&
-         (tokParent->getChildNodes().front()) == token)) {
+        isFirstChildOfApply(token)) {
         return _getConstantEncoding(tokMeaning);
     }
 
@@ -154,6 +249,18 @@ MeaningId ExpressionEncoder::_getCiMeaning(const CmmlToken* token) {
     return _getConstantEncoding(translatedMeaning);
 }
 
+MeaningId ExpressionEncoder::_getNamedVarId(const StringRef& varName) {
+    for (size_t i = 0; i < _namedVars.size(); i++) {
+        if (_namedVars[i].size == varName.size &&
+            memcmp(_namedVars[i].data, varName.data, varName.size) == 0) {
+            return i + 1;
+        }
+    }
+    _namedVars.push_back(varName);
+
+    return _namedVars.size();
+}
+
 HarvestEncoder::HarvestEncoder(MeaningDictionary* dictionary)
     : ExpressionEncoder(dictionary) {}
 
@@ -170,18 +277,23 @@ MeaningId HarvestEncoder::_getConstantEncoding(const Meaning& meaning) {
 }
 
 QueryEncoder::QueryEncoder(MeaningDictionary* dictionary)
-    : ExpressionEncoder(dictionary) {}
+    : ExpressionEncoder(dictionary), _meaningIndex(nullptr) {}
+
+QueryEncoder::QueryEncoder(const MeaningIndex* meaningIndex)
+    : ExpressionEncoder(nullptr), _meaningIndex(meaningIndex) {}
 
 QueryEncoder::~QueryEncoder() {}
 
-MeaningId QueryEncoder::_getAnonVarOffset() const { return ANON_HVAR_ID_MIN; }
+MeaningId QueryEncoder::_getAnonVarOffset() const { return ANON_QVAR_ID_MIN; }
 
-MeaningId QueryEncoder::_getNamedVarOffset() const { return HVAR_ID_MIN; }
+MeaningId QueryEncoder::_getNamedVarOffset() const { return QVAR_ID_MIN; }
 
 MeaningId QueryEncoder::_getRangeOffset() const { return RANGE_ID_MIN; }
 
 MeaningId QueryEncoder::_getConstantEncoding(const Meaning& meaning) {
-    MeaningId id = _meaningDictionary->get(meaning);
+    MeaningId id = (_meaningIndex != nullptr)
+                       ? _meaningIndex->get(meaning)
+                       : _meaningDictionary->get(meaning);
 
     if (id != MeaningDictionary::KEY_NOT_FOUND) {
         return CONSTANT_ID_MIN + id;
@@ -211,5 +323,133 @@ Meaning ExpressionDecoder::getMeaning(MeaningId meaningId) const {
     }
 }
 
+CmmlToken* ExpressionDecoder::decode(const encoded_token_t* tokens,
+                                     size_t size) const {
+    CmmlToken* root = nullptr;
+    // tokens which still expect children, with the number expected
+    vector<pair<CmmlToken*, Arity>> parents;
+
+    for (size_t i = 0; i < size; i++) {
+        CmmlToken* token;
+        if (root == nullptr) {
+            token = root = CmmlToken::newRoot();
+        } else if (parents.empty()) {  // more than one formula
+            delete root;
+            return nullptr;
+        } else {
+            token = parents.back().first->newChildNode();
+            if (--parents.back().second == 0) parents.pop_back();
+        }
+
+        const Meaning meaning = getMeaning(tokens[i].id);
+        const size_t separatorPos = meaning.find('#');
+        assert(separatorPos != string::npos);
+        token->setTag(meaning.substr(0, separatorPos));
+        token->appendTextContent(meaning.substr(separatorPos + 1));
+
+        if (tokens[i].arity > 0) {
+            parents.push_back(make_pair(token, (Arity)tokens[i].arity));
+        }
+    }
+
+    if (!parents.empty()) {  // incomplete formula
+        delete root;
+        return nullptr;
+    }
+
+    return root;
+}
+
+/// Append text to xml, escaping the XML special characters
+static void appendEscaped(string* xml, const string& text) {
+    for (char c : text) {
+        switch (c) {
+        case '&':
+            xml->append("&amp;");
+            break;
+        case '<':
+            xml->append("&lt;");
+            break;
+        case '>':
+            xml->append("&gt;");
+            break;
+        default:
+            xml->push_back(c);
+        }
+    }
+}
+
+string ExpressionDecoder::toCmml(const encoded_token_t* tokens,
+                                 size_t size) const {
+    string xml;
+    // tags which still expect children, with the number expected
+    vector<pair<string, Arity>> parents;
+
+    for (size_t i = 0; i < size; i++) {
+        if (i > 0 && parents.empty()) return "";  // more than one formula
+
+        const Meaning meaning = getMeaning(tokens[i].id);
+        const size_t separatorPos = meaning.find('#');
+        assert(separatorPos != string::npos);
+        const string tag = meaning.substr(0, separatorPos);
+        xml += "<" + tag + ">";
+        appendEscaped(&xml, meaning.substr(separatorPos + 1));
+
+        if (tokens[i].arity > 0) {
+            parents.push_back(make_pair(tag, (Arity)tokens[i].arity));
+            continue;
+        }
+        xml += "</" + tag + ">";
+        while (!parents.empty() && --parents.back().second == 0) {
+            xml += "</" + parents.back().first + ">";
+            parents.pop_back();
+        }
+    }
+    if (!parents.empty()) return "";  // incomplete formula
+
+    return xml;
+}
+
+vector<encoded_token_t> mirrorEncoding(
+    const vector<encoded_token_t>& encodedFormula) {
+    const size_t size = encodedFormula.size();
+    vector<encoded_token_t> mirrored;
+    // end of the subterm starting at each token
+    vector<size_t> ends(size, 0);
+    // tokens which still expect arguments, with the number expected
+    vector<pair<size_t, Arity>> parents;
+    // subterms left to mirror
+    stack<size_t> subterms;
+
+    for (size_t i = 0; i < size; i++) {
+        if (encodedFormula[i].arity > 0) {
+            parents.push_back(make_pair(i, (Arity)encodedFormula[i].arity));
+            continue;
+        }
+        ends[i] = i + 1;
+        while (!parents.empty() && --parents.back().second == 0) {
+            ends[parents.back().first] = i + 1;
+            parents.pop_back();
+        }
+    }
+    assert(parents.empty());
+
+    mirrored.reserve(size);
+    if (size > 0) subterms.push(0);
+    while (!subterms.empty()) {
+        size_t begin = subterms.top();
+        subterms.pop();
+        mirrored.push_back(encodedFormula[begin]);
+        // the last argument is popped first
+        size_t child = begin + 1;
+        for (Arity i = 0; i < encodedFormula[begin].arity; i++) {
+            subterms.push(child);
+            child = ends[child];
+        }
+    }
+
+    return mirrored;
+}
+
 }  // namespace index
 }  // namespace mws
@@ -39,7 +39,9 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mws/index/encoded_token.h"
 #include "mws/index/MeaningDictionary.hpp"
+#include "mws/index/MeaningIndex.hpp"
 #include "mws/types/CmmlToken.hpp"
+#include "mws/types/FlatCmml.hpp"
 
 /****************************************************************************/
 /* Type Declarations                                                        */
@@ -69,7 +71,12 @@ class ExpressionEncoder {
     int encode(const Config& config, const types::CmmlToken* expression,
                std::vector<encoded_token_t>* encodedFormula,
                ExpressionInfo* expressionInfo);
+    int encode(const Config& config, const types::FlatCmml::Ref& expression,
+               std::vector<encoded_token_t>* encodedFormula,
+               ExpressionInfo* expressionInfo);
     types::Meaning decodeMeaning(encoded_token_t token);
+    /// Forget ci renamings, so that the next expression starts afresh
+    void resetCiTranslations();
 
  protected:
     virtual MeaningId _getAnonVarOffset() const = 0;
@@ -77,11 +84,33 @@ class ExpressionEncoder {
     virtual MeaningId _getRangeOffset() const = 0;
     virtual MeaningId _getConstantEncoding(const types::Meaning& meaning) = 0;
 
-    MeaningId _getCiMeaning(const mws::types::CmmlToken* token);
+    MeaningId _getNamedVarId(const types::StringRef& varName);
 
     MeaningDictionary* _meaningDictionary;
     std::unordered_map<std::string, std::string> _ciTranslations;
     uint32_t _ciTranslationCounter;
+
+ private:
+    enum TokenStatus {
+        ENCODE_OK,
+        ENCODE_UNKNOWN_MEANING,
+        ENCODE_ARITY_OVERFLOW
+    };
+
+    void _resetState();
+    template <class Token>
+    TokenStatus _encodeToken(const Config& config, const Token& token,
+                             encoded_token_t* encodedToken,
+                             ExpressionInfo* expressionInfo);
+    template <class Token>
+    MeaningId _getCiMeaning(const Token& token);
+
+    /// Scratch buffer for meanings of constants, reused across tokens
+    types::Meaning _meaningBuffer;
+    /// Named variables of the expression being encoded (few, so a vector)
+    std::vector<types::StringRef> _namedVars;
+    int _anonVarId;
+    int _anonRangeId;
 };
 
 class HarvestEncoder : public ExpressionEncoder {
@@ -99,6 +128,11 @@ class HarvestEncoder : public ExpressionEncoder {
 class QueryEncoder : public ExpressionEncoder {
  public:
     explicit QueryEncoder(MeaningDictionary* dictionary);
+    /**
+     * @brief Encoder looking up constants in a read-only hash index. It does
+     * not modify shared state and is safe to use from concurrent handlers.
+     */
+    explicit QueryEncoder(const MeaningIndex* meaningIndex);
     virtual ~QueryEncoder();
 
  protected:
@@ -106,6 +140,9 @@ class QueryEncoder : public ExpressionEncoder {
     virtual MeaningId _getNamedVarOffset() const;
     virtual MeaningId _getRangeOffset() const;
     virtual MeaningId _getConstantEncoding(const types::Meaning& meaning);
+
+ private:
+    const MeaningIndex* _meaningIndex;
 };
 
 class ExpressionDecoder {
@@ -114,8 +151,30 @@ class ExpressionDecoder {
  public:
     explicit ExpressionDecoder(const MeaningDictionary& dictionary);
     types::Meaning getMeaning(MeaningId meaningId) const;
+    /**
+     * @brief Rebuild an expression from its encoding, in O(size)
+     * @return a new CmmlToken tree, owned by the caller, or nullptr if the
+     * tokens are not exactly one complete formula
+     */
+    types::CmmlToken* decode(const encoded_token_t* tokens, size_t size) const;
+    /**
+     * @brief Write an expression from its encoding as compact CMML, without
+     * building its tree
+     * @return the CMML, or an empty string if the tokens are not exactly one
+     * complete formula
+     */
+    std::string toCmml(const encoded_token_t* tokens, size_t size) const;
 };
 
+/**
+ * @brief Mirror an encoded formula: encode it with the arguments of every
+ * token in reverse order, which is its postfix encoding reversed. Mirroring
+ * twice gives back the formula.
+ * @param encodedFormula encoding of exactly one complete formula
+ */
+std::vector<encoded_token_t> mirrorEncoding(
+    const std::vector<encoded_token_t>& encodedFormula);
+
 }  // namespace index
 }  // namespace mws
 
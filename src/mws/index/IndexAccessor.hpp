@@ -65,6 +65,15 @@ class IndexAccessor {
         assert(node->type == INTERNAL_NODE || node->type == LONG_INTERNAL_NODE);
         return Iterator(_Iterator(node, 0), _Iterator(node, node->size));
     }
+    /// @return iterator over the children of node, from the i-th one
+    static Iterator getChildrenIterator(Node* node, size_t i) {
+        assert(node->type == INTERNAL_NODE || node->type == LONG_INTERNAL_NODE);
+        return Iterator(_Iterator(node, i), _Iterator(node, node->size));
+    }
+    static size_t getNumChildren(Node* node) {
+        assert(node->type == INTERNAL_NODE || node->type == LONG_INTERNAL_NODE);
+        return node->size;
+    }
     static encoded_token_t getToken(const Iterator& it) {
         _Iterator _it = it.get();
         encoded_token_t tok;
@@ -28,6 +28,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include <fcntl.h>
 
 #include <cinttypes>
+#include <algorithm>
 #include <set>
 using std::set;
 #include <stack>
@@ -42,6 +43,8 @@ using std::unordered_map;
 #include "mws/types/CmmlToken.hpp"
 using mws::types::CmmlToken;
 using mws::types::TokenCallback;
+#include "mws/types/FlatCmml.hpp"
+using mws::types::FlatCmml;
 #include "mws/types/FormulaPath.hpp"
 using mws::types::FormulaId;
 using mws::types::FormulaPath;
@@ -79,16 +82,45 @@ IndexBuilder::IndexBuilder(dbc::FormulaDb* formulaDb, dbc::CrawlDb* crawlDb,
       m_crawlDb(crawlDb),
       m_index(index),
       m_meaningDictionary(meaningDictionary),
-      m_indexingOptions(std::move(encodingOptions)) {}
+      m_indexingOptions(std::move(encodingOptions)),
+      m_encoder(meaningDictionary) {}
+
+void IndexBuilder::beginCollection() {
+    if (m_collectionFirstCrawls.size() < COLLECTION_MASKS_MAX_COLLECTIONS) {
+        m_collectionFirstCrawls.push_back(CRAWLID_NULL);
+    }
+}
 
 CrawlId IndexBuilder::indexCrawlData(const CrawlData& crawlData) {
     if (m_crawlDb != nullptr) {
-        return m_crawlDb->putData(crawlData);
+        CrawlId crawlId = m_crawlDb->putData(crawlData);
+        // collections without documents end where the next one starts
+        for (auto it = m_collectionFirstCrawls.rbegin();
+             it != m_collectionFirstCrawls.rend() && *it == CRAWLID_NULL;
+             it++) {
+            *it = crawlId;
+        }
+        return crawlId;
     } else {
         return CRAWLID_NULL;
     }
 }
 
+void IndexBuilder::_addOccurrence(FormulaId formulaId,
+                                  const CrawlId& crawlId) {
+    if (crawlId == CRAWLID_NULL || m_collectionFirstCrawls.empty()) return;
+    if (formulaId >= m_formulaMasks.size()) {
+        m_formulaMasks.resize(formulaId + 1, collection_mask_empty());
+    }
+
+    collection_mask_t occurrence;
+    occurrence.mask = 1ULL << (m_collectionFirstCrawls.size() - 1);
+    occurrence.min_crawl = crawlId;
+    occurrence.max_crawl = crawlId;
+    occurrence.num_hits = 1;
+    collection_mask_merge(&m_formulaMasks[formulaId], &occurrence);
+}
+
 int IndexBuilder::indexContentMath(const CmmlToken* cmmlToken,
                                    const string xmlId, const CrawlId& crawlId) {
     assert(cmmlToken != nullptr);
@@ -111,6 +143,7 @@ int IndexBuilder::indexContentMath(const CmmlToken* cmmlToken,
             formulaPath.xmlId = xmlId;
             formulaPath.xpath = token->getXpath();
             m_formulaDb->insertFormula(leaf->id, crawlId, formulaPath);
+            _addOccurrence(leaf->id, crawlId);
             leaf->solutions++;
             numSubExpressions++;
         }
@@ -119,6 +152,99 @@ int IndexBuilder::indexContentMath(const CmmlToken* cmmlToken,
     return numSubExpressions;
 }
 
+/**
+ * @brief Copy the encoding of a subterm out of the encoding of the whole
+ * expression, renumbering variables and ranges as if the subterm had been
+ * encoded on its own.
+ */
+static void sliceSubexpression(const encoded_token_t* begin,
+                               const encoded_token_t* end,
+                               vector<encoded_token_t>* encodedFormula,
+                               vector<MeaningId>* namedVarMap) {
+    MeaningId anonVarId = 0;
+    MeaningId rangeId = 0;
+
+    encodedFormula->assign(begin, end);
+    namedVarMap->clear();
+    for (encoded_token_t& token : *encodedFormula) {
+        if (HVAR_ID_MIN <= token.id && token.id < ANON_HVAR_ID_MIN) {
+            auto it = std::find(namedVarMap->begin(), namedVarMap->end(),
+                                (MeaningId)token.id);
+            if (it == namedVarMap->end()) {
+                namedVarMap->push_back(token.id);
+                it = namedVarMap->end() - 1;
+            }
+            token.id = HVAR_ID_MIN + (it - namedVarMap->begin()) + 1;
+        } else if (ANON_HVAR_ID_MIN <= token.id && token.id <= ANON_HVAR_ID_MAX) {
+            token.id = ANON_HVAR_ID_MIN + anonVarId++;
+        } else if (encoded_token_is_range(token)) {
+            token.id = RANGE_ID_MIN + rangeId++;
+        }
+    }
+}
+
+int IndexBuilder::indexContentMath(const FlatCmml::Ref& expression,
+                                   const string& xmlId,
+                                   const CrawlId& crawlId) {
+    const FlatCmml* tree = expression.getTree();
+    int numSubExpressions = 0;
+
+    m_indexedFormulaIds.clear();
+    m_encoder.resetCiTranslations();
+    if (m_encoder.encode(m_indexingOptions, expression, &m_expressionEncoding,
+                         nullptr) != 0) {
+        // some subterm cannot be encoded: encode subexpressions one by one
+        for (FlatCmml::NodeId id = expression.getId();
+             id < expression.getSubtreeEnd(); id++) {
+            if (m_encoder.encode(m_indexingOptions, tree->node(id),
+                                 &m_subexpressionEncoding, nullptr) != 0) {
+                PRINT_WARN("Skipping a formula (could not encode)\n");
+                continue;
+            }
+            numSubExpressions +=
+                _indexSubexpression(tree->node(id), xmlId, crawlId);
+        }
+        return numSubExpressions;
+    }
+
+    // preorder encoding: subterm id is the slice [id, subtreeEnd)
+    const encoded_token_t* encoding =
+        m_expressionEncoding.data() - expression.getId();
+    for (FlatCmml::NodeId id = expression.getId();
+         id < expression.getSubtreeEnd(); id++) {
+        FlatCmml::Ref subexpression = tree->node(id);
+        sliceSubexpression(encoding + id,
+                           encoding + subexpression.getSubtreeEnd(),
+                           &m_subexpressionEncoding, &m_namedVarMap);
+        numSubExpressions += _indexSubexpression(subexpression, xmlId, crawlId);
+    }
+
+    return numSubExpressions;
+}
+
+int IndexBuilder::_indexSubexpression(const FlatCmml::Ref& subexpression,
+                                      const string& xmlId,
+                                      const CrawlId& crawlId) {
+    TmpLeafNode* leaf = m_index->insertData(m_subexpressionEncoding);
+    FormulaId formulaId = leaf->id;
+
+    auto it = std::lower_bound(m_indexedFormulaIds.begin(),
+                               m_indexedFormulaIds.end(), formulaId);
+    if (it != m_indexedFormulaIds.end() && *it == formulaId) {
+        return 0;
+    }
+    m_indexedFormulaIds.insert(it, formulaId);
+
+    types::FormulaPath formulaPath;
+    formulaPath.xmlId = xmlId;
+    formulaPath.xpath = subexpression.getXpath();
+    m_formulaDb->insertFormula(formulaId, crawlId, formulaPath);
+    _addOccurrence(formulaId, crawlId);
+    leaf->solutions++;
+
+    return 1;
+}
+
 uint64_t loadHarvests(IndexBuilder* indexBuilder,
                       const HarvesterConfiguration& config) {
     uint64_t numExpressions = 0;
@@ -138,6 +264,8 @@ uint64_t loadHarvests(IndexBuilder* indexBuilder,
 
     for (string dirPath : config.paths) {
         PRINT_LOG("Loading from %s...\n", dirPath.c_str());
+        // each harvest path is a collection
+        indexBuilder->beginCollection();
         common::utils::FileCallback fileCallback =
             [&](const std::string & path, const std::string & prefix) {
             UNUSED(prefix);
@@ -214,6 +342,13 @@ HarvestResult loadHarvestFromFd(IndexBuilder* indexBuilder, int fd,
                               const uint32_t& crawlId) {
             return _IndexBuilder->indexContentMath(token, exprUri, crawlId);
         }
+        bool wantsFlatExpressions() const { return true; }
+        int processFlatExpression(const FlatCmml::Ref& expression,
+                                  const string& exprUri,
+                                  const uint32_t& crawlId) {
+            return _IndexBuilder->indexContentMath(expression, exprUri,
+                                                   crawlId);
+        }
         CrawlId processData(const string& data) {
             return _IndexBuilder->indexCrawlData(data);
         }
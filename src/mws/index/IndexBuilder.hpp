@@ -31,9 +31,12 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include "mws/types/CmmlToken.hpp"
+#include "mws/types/FlatCmml.hpp"
+#include "mws/types/FormulaPath.hpp"
 #include "mws/dbc/FormulaDb.hpp"
 #include "mws/dbc/CrawlDb.hpp"
 #include "mws/index/TmpIndex.hpp"
+#include "mws/index/collection_masks.h"
 #include "mws/index/ExpressionEncoder.hpp"
 #include "mws/xmlparser/processMwsHarvest.hpp"
 
@@ -59,6 +62,24 @@ class IndexBuilder {
     index::MeaningDictionary* m_meaningDictionary;
     index::ExpressionEncoder::Config m_indexingOptions;
 
+    // Buffers reused by indexContentMath(FlatCmml::Ref)
+    index::HarvestEncoder m_encoder;
+    std::vector<encoded_token_t> m_expressionEncoding;
+    std::vector<encoded_token_t> m_subexpressionEncoding;
+    std::vector<MeaningId> m_namedVarMap;
+    std::vector<types::FormulaId> m_indexedFormulaIds;
+
+    // Collections of the documents of the formulae
+    std::vector<dbc::CrawlId> m_collectionFirstCrawls;
+    std::vector<collection_mask_t> m_formulaMasks;
+
+    /// Add an occurrence of formulaId in crawlId to the formula masks
+    void _addOccurrence(types::FormulaId formulaId,
+                        const dbc::CrawlId& crawlId);
+    int _indexSubexpression(const types::FlatCmml::Ref& subexpression,
+                            const std::string& xmlId,
+                            const dbc::CrawlId& crawlId);
+
  public:
     IndexBuilder(dbc::FormulaDb* formulaDb, dbc::CrawlDb* crawlDb,
                  mws::index::TmpIndex* index,
@@ -68,6 +89,24 @@ class IndexBuilder {
 
     const mws::index::TmpIndex* getIndex() const { return m_index; }
 
+    /**
+     * @brief Start a new collection: the crawl data indexed next belongs to
+     * it. The first COLLECTION_MASKS_MAX_COLLECTIONS calls start a
+     * collection, later ones continue the last one.
+     */
+    void beginCollection();
+
+    /// @return the first CrawlId of each collection, CRAWLID_NULL for the
+    /// last collections if no document was indexed since they started
+    const std::vector<dbc::CrawlId>& getCollectionFirstCrawls() const {
+        return m_collectionFirstCrawls;
+    }
+
+    /// @return the collection masks of the formulae, indexed by formula id
+    const std::vector<collection_mask_t>& getFormulaMasks() const {
+        return m_formulaMasks;
+    }
+
     /**
      * @brief index crawl data
      * @param crawlData URL and opaque data given in the crawled harvest
@@ -85,6 +124,16 @@ class IndexBuilder {
     int indexContentMath(const types::CmmlToken* cmmlToken,
                          const std::string xmlId,
                          const dbc::CrawlId& crawlId = dbc::CRAWLID_NULL);
+
+    /**
+     * @brief index content math formula given as a flat expression. The
+     * expression is encoded once and each subexpression is indexed from a
+     * slice of that encoding.
+     * @return Number of indexed subexpressions on success, -1 on failure.
+     */
+    int indexContentMath(const types::FlatCmml::Ref& expression,
+                         const std::string& xmlId,
+                         const dbc::CrawlId& crawlId = dbc::CRAWLID_NULL);
 };
 
 parser::HarvestResult loadHarvestFromFd(IndexBuilder* indexBuilder, int fd,
@@ -60,6 +60,7 @@ using mws::types::FormulaPath;
 using mws::dbc::CrawlId;
 using mws::dbc::CrawlData;
 #include "mws/index/ExpressionEncoder.hpp"
+#include "mws/index/IndexAccessor.hpp"
 #include "mws/index/IndexLoader.hpp"
 
 #include "build-gen/config.h"
@@ -68,7 +69,15 @@ namespace mws {
 namespace index {
 
 IndexLoader::IndexLoader(const std::string& path, const LoadingOptions& options)
-    : m_meaningDictionary(path + "/" + MEANING_DICTIONARY_FILE) {
+    : m_meaningDictionary(path + "/" + MEANING_DICTIONARY_FILE),
+      m_meaningIndex(m_meaningDictionary),
+      m_hasMirrorIndex(false),
+      m_hasExactIndex(false),
+      m_hasFormulaStore(false),
+      m_hasSubtreeBounds(false),
+      m_hasCollectionMasks(false),
+      m_hasTokenPostings(false),
+      m_hasStaticScores(false) {
 
     // we need the two databases to include hits
     if (options.includeHits) {
@@ -96,9 +105,93 @@ IndexLoader::IndexLoader(const std::string& path, const LoadingOptions& options)
 
     m_index.ms = m_memsectorHandler.ms;
     m_index.root = memsector_get_root(&m_memsectorHandler);
+
+    m_hasMirrorIndex =
+        (memsector_load(&m_mirrorMemsector,
+                        (path + "/" + MIRROR_MEMSECTOR_FILE).c_str()) == 0);
+    if (m_hasMirrorIndex) {
+        m_mirrorIndex.ms = m_mirrorMemsector.ms;
+        m_mirrorIndex.root = memsector_get_root(&m_mirrorMemsector);
+        PRINT_LOG("Loaded mirror index\n");
+    }
+
+    m_hasExactIndex = (exact_index_load(&m_exactIndex,
+                                        (path + "/" + EXACT_INDEX_FILE).c_str())
+                       == 0);
+    if (m_hasExactIndex) {
+        PRINT_LOG("Loaded exact match table\n");
+    } else {
+        PRINT_WARN("No exact match table, exact lookups will use the index\n");
+    }
+
+    m_hasFormulaStore = (formula_store_load(
+                             &m_formulaStore,
+                             (path + "/" + FORMULA_STORE_FILE).c_str()) == 0);
+    if (m_hasFormulaStore) {
+        PRINT_LOG("Loaded formula store\n");
+    }
+
+    m_hasSubtreeBounds =
+        (subtree_bounds_load(&m_subtreeBounds,
+                             (path + "/" + SUBTREE_BOUNDS_FILE).c_str()) == 0);
+    if (m_hasSubtreeBounds) {
+        PRINT_LOG("Loaded subtree bounds\n");
+    }
+
+    m_hasCollectionMasks = (collection_masks_load(
+                                &m_collectionMasks,
+                                (path + "/" + COLLECTION_MASKS_FILE).c_str()) ==
+                            0);
+    if (m_hasCollectionMasks) {
+        PRINT_LOG("Loaded collection masks\n");
+    }
+
+    m_hasTokenPostings =
+        (token_postings_load(&m_tokenPostings,
+                             (path + "/" + TOKEN_POSTINGS_FILE).c_str()) == 0);
+    if (m_hasTokenPostings) {
+        PRINT_LOG("Loaded token postings\n");
+    }
+
+    // a plain array of floats, indexed by FormulaId
+    m_hasStaticScores =
+        (mmap_load((path + "/" + STATIC_SCORES_FILE).c_str(), MAP_SHARED,
+                   &m_staticScores) == 0);
+    if (m_hasStaticScores && m_staticScores.size % sizeof(float) != 0) {
+        PRINT_WARN("Static scores %s/%s are corrupted (size mismatch)\n",
+                   path.c_str(), STATIC_SCORES_FILE);
+        mmap_unload(&m_staticScores);
+        m_hasStaticScores = false;
+    }
+    if (m_hasStaticScores) {
+        PRINT_LOG("Loaded static scores\n");
+    }
 }
 
-IndexLoader::~IndexLoader() { memsector_unload(&m_memsectorHandler); }
+IndexLoader::~IndexLoader() {
+    if (m_hasStaticScores) {
+        mmap_unload(&m_staticScores);
+    }
+    if (m_hasTokenPostings) {
+        token_postings_unload(&m_tokenPostings);
+    }
+    if (m_hasCollectionMasks) {
+        collection_masks_unload(&m_collectionMasks);
+    }
+    if (m_hasSubtreeBounds) {
+        subtree_bounds_unload(&m_subtreeBounds);
+    }
+    if (m_hasFormulaStore) {
+        formula_store_unload(&m_formulaStore);
+    }
+    if (m_hasExactIndex) {
+        exact_index_unload(&m_exactIndex);
+    }
+    if (m_hasMirrorIndex) {
+        memsector_unload(&m_mirrorMemsector);
+    }
+    memsector_unload(&m_memsectorHandler);
+}
 
 dbc::DbQueryManager* IndexLoader::getDbQueryManager() {
     return m_dbQueryManager.get();
@@ -106,11 +199,101 @@ dbc::DbQueryManager* IndexLoader::getDbQueryManager() {
 
 index_handle_t* IndexLoader::getIndexHandle() { return &m_index; }
 
+index_handle_t* IndexLoader::getMirrorIndexHandle() {
+    return m_hasMirrorIndex ? &m_mirrorIndex : nullptr;
+}
+
 MeaningDictionary* IndexLoader::getMeaningDictionary() {
     return &m_meaningDictionary;
 }
 
+const MeaningIndex* IndexLoader::getMeaningIndex() const {
+    return &m_meaningIndex;
+}
+
 FormulaDb* IndexLoader::getFormulaDb() { return m_formulaDb.get(); }
 
+const leaf_t* IndexLoader::lookupFormula(
+    const vector<encoded_token_t>& encodedFormula) const {
+    if (encodedFormula.empty()) return nullptr;
+
+    if (m_hasExactIndex) {
+        const exact_index_entry_t* entry = exact_index_lookup(
+            &m_exactIndex, encodedFormula.data(), encodedFormula.size());
+        if (entry == nullptr) {
+            return nullptr;
+        }
+        // the key only matches with high probability, the stored formula
+        // settles it
+        if (entry->leaf_off != MEMSECTOR_OFF_NULL && m_hasFormulaStore) {
+            const leaf_t* leaf = reinterpret_cast<const leaf_t*>(
+                memsector_off2addr(m_index.ms, entry->leaf_off));
+            assert(leaf->type == LEAF_NODE);
+            encoded_formula_t formula =
+                formula_store_get(&m_formulaStore, leaf->formula_id);
+            if (formula.size == encodedFormula.size() &&
+                memcmp(formula.data, encodedFormula.data(),
+                       formula.size * sizeof(encoded_token_t)) == 0) {
+                return leaf;
+            }
+        }
+        // ambiguous key, colliding formula or no store to check the match
+        // against, resolve it in the index
+    }
+
+    IndexAccessor::Node* node = IndexAccessor::getRootNode(&m_index);
+    for (const encoded_token_t& token : encodedFormula) {
+        if (node->type == LEAF_NODE) return nullptr;
+        node = IndexAccessor::getChild(&m_index, node, token);
+        if (node == nullptr) return nullptr;
+    }
+    if (node->type != LEAF_NODE) return nullptr;
+
+    return reinterpret_cast<const leaf_t*>(node);
+}
+
+bool IndexLoader::hasFormulaStore() const { return m_hasFormulaStore; }
+
+uint64_t IndexLoader::getNumFormulaIds() const {
+    return m_hasFormulaStore ? m_formulaStore.header->num_ids : 0;
+}
+
+encoded_formula_t IndexLoader::getFormula(FormulaId formulaId) const {
+    if (!m_hasFormulaStore) {
+        encoded_formula_t formula;
+        formula.data = nullptr;
+        formula.size = 0;
+        return formula;
+    }
+
+    return formula_store_get(&m_formulaStore, formulaId);
+}
+
+const formula_store_handle_t* IndexLoader::getFormulaStore() const {
+    return m_hasFormulaStore ? &m_formulaStore : nullptr;
+}
+
+const token_postings_handle_t* IndexLoader::getTokenPostings() const {
+    return m_hasTokenPostings ? &m_tokenPostings : nullptr;
+}
+
+const subtree_bounds_handle_t* IndexLoader::getSubtreeBounds() const {
+    return m_hasSubtreeBounds ? &m_subtreeBounds : nullptr;
+}
+
+const collection_masks_handle_t* IndexLoader::getCollectionMasks() const {
+    return m_hasCollectionMasks ? &m_collectionMasks : nullptr;
+}
+
+const float* IndexLoader::getStaticScores(size_t* numScores) const {
+    if (!m_hasStaticScores) {
+        *numScores = 0;
+        return nullptr;
+    }
+
+    *numScores = m_staticScores.size / sizeof(float);
+    return reinterpret_cast<const float*>(m_staticScores.start_addr);
+}
+
 }  // namespace index
 }  // namespace mws
@@ -29,13 +29,21 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "mws/types/CmmlToken.hpp"
 #include "mws/dbc/FormulaDb.hpp"
 #include "mws/dbc/CrawlDb.hpp"
 #include "mws/dbc/DbQueryManager.hpp"
+#include "mws/types/FormulaPath.hpp"
 #include "mws/index/MeaningDictionary.hpp"
+#include "mws/index/MeaningIndex.hpp"
+#include "mws/index/collection_masks.h"
+#include "mws/index/exact_index.h"
+#include "mws/index/formula_store.h"
 #include "mws/index/index.h"
+#include "mws/index/subtree_bounds.h"
+#include "mws/index/token_postings.h"
 
 namespace mws {
 namespace index {
@@ -58,15 +66,75 @@ class IndexLoader {
     dbc::FormulaDb* getFormulaDb();
     dbc::DbQueryManager* getDbQueryManager();
     index_handle_t* getIndexHandle();
+    /// @return the index of the mirrored formulae, or nullptr if it has none
+    index_handle_t* getMirrorIndexHandle();
     index::MeaningDictionary* getMeaningDictionary();
+    const index::MeaningIndex* getMeaningIndex() const;
+
+    /**
+     * @brief Find the leaf of an indexed formula. Every token is matched
+     * literally, so this only answers queries without qvars and ranges.
+     * Uses the exact match table when the index has one. Its match is
+     * checked against the formula store, or against the index if there
+     * is no store, so the table then only rejects formulae early.
+     * @param encodedFormula encoding of a complete formula
+     * @return the leaf of the formula, or nullptr if it is not indexed
+     */
+    const leaf_t* lookupFormula(
+        const std::vector<encoded_token_t>& encodedFormula) const;
+
+    /// @return true if the index was built with a formula store
+    bool hasFormulaStore() const;
+    /// @return upper bound of the ids in the formula store
+    uint64_t getNumFormulaIds() const;
+
+    /**
+     * @brief Get the encoded formula of a FormulaId from the formula store
+     * @return the formula, empty if the id or the store are missing
+     */
+    encoded_formula_t getFormula(types::FormulaId formulaId) const;
+
+    /// @return the formula store of the index, or nullptr if it has none
+    const formula_store_handle_t* getFormulaStore() const;
+
+    /// @return the token postings of the index, or nullptr if it has none
+    const token_postings_handle_t* getTokenPostings() const;
+
+    /// @return the subtree bounds of the index, or nullptr if it has none
+    const subtree_bounds_handle_t* getSubtreeBounds() const;
+
+    /// @return the collection masks of the index, or nullptr if it has none
+    const collection_masks_handle_t* getCollectionMasks() const;
+
+    /**
+     * @brief Get the static scores of the index, one float per FormulaId
+     * @return the scores, or nullptr if the index has none
+     */
+    const float* getStaticScores(size_t* numScores) const;
 
  private:
     index::MeaningDictionary m_meaningDictionary;
+    index::MeaningIndex m_meaningIndex;
     std::unique_ptr<dbc::FormulaDb> m_formulaDb;
     std::unique_ptr<dbc::CrawlDb> m_crawlDb;
     std::unique_ptr<dbc::DbQueryManager> m_dbQueryManager;
     index_handle_t m_index;
     memsector_handle_t m_memsectorHandler;
+    index_handle_t m_mirrorIndex;
+    memsector_handle_t m_mirrorMemsector;
+    bool m_hasMirrorIndex;
+    exact_index_handle_t m_exactIndex;
+    bool m_hasExactIndex;
+    formula_store_handle_t m_formulaStore;
+    bool m_hasFormulaStore;
+    subtree_bounds_handle_t m_subtreeBounds;
+    bool m_hasSubtreeBounds;
+    collection_masks_handle_t m_collectionMasks;
+    bool m_hasCollectionMasks;
+    token_postings_handle_t m_tokenPostings;
+    bool m_hasTokenPostings;
+    mmap_handle_t m_staticScores;
+    bool m_hasStaticScores;
 
     DISALLOW_COPY_AND_ASSIGN(IndexLoader);
 };
@@ -33,6 +33,8 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 using std::exception;
 #include <string>
 using std::string;
+#include <vector>
+using std::vector;
 #include <fstream>
 #include <memory>
 using std::unique_ptr;
@@ -43,7 +45,12 @@ using common::utils::create_directory;
 #include "mws/dbc/LevCrawlDb.hpp"
 #include "mws/dbc/LevFormulaDb.hpp"
 #include "mws/index/TmpIndex.hpp"
+#include "mws/index/collection_masks.h"
 #include "mws/index/memsector.h"
+#include "mws/index/exact_index.h"
+#include "mws/index/formula_store.h"
+#include "mws/index/subtree_bounds.h"
+#include "mws/index/token_postings.h"
 #include "mws/index/IndexBuilder.hpp"
 #include "mws/index/MeaningDictionary.hpp"
 #include "mws/index/IndexWriter.hpp"
@@ -60,6 +67,14 @@ int createCompressedIndex(const IndexConfiguration& config) {
     unique_ptr<dbc::FormulaDb> formulaDb;
     TmpIndex index;
     MeaningDictionary meaningDictionary;
+    vector<exact_index_entry_t> exactEntries;
+    vector<formula_store_record_t> exportedFormulae;
+    vector<encoded_token_t> exportedTokens;
+    vector<token_postings_pair_t> postingsPairs;
+    vector<uint64_t> keys;
+    uint64_t numLeaves = 0;
+    uint32_t postingsFlags = 0;
+    bool postingsFailed = false;
     std::filebuf fb;
     std::ostream os(&fb);
     uint64_t numExpressions;
@@ -90,11 +105,142 @@ int createCompressedIndex(const IndexConfiguration& config) {
     PRINT_LOG("%" PRIu64 " expressions loaded.\n", numExpressions);
 
     memsector_create(&mwsr, (output_dir + "/" + INDEX_MEMSECTOR_FILE).c_str());
-    index.exportToMemsector(&mwsr);
+    index.exportToMemsector(&mwsr, [&](const vector<encoded_token_t>& formula,
+                                       types::FormulaId formulaId,
+                                       memsector_long_off_t leafOff) {
+        exact_index_entry_t entry =
+            exact_index_key(formula.data(), formula.size());
+        entry.formula_id = formulaId;
+        entry.leaf_off = leafOff;
+        exactEntries.push_back(entry);
+
+        // the formula store verifies the candidates of the postings
+        if (config.writeFormulaStore || config.writeTokenPostings) {
+            formula_store_record_t record;
+            record.formula_id = formulaId;
+            record.size = formula.size();
+            record.begin = exportedTokens.size();
+            exportedFormulae.push_back(record);
+            exportedTokens.insert(exportedTokens.end(), formula.begin(),
+                                  formula.end());
+        }
+
+        if (config.writeTokenPostings) {
+            keys.resize(2 * formula.size() + 1);
+            int numKeys = token_postings_formula_keys(
+                formula.data(), formula.size(), keys.data());
+            postingsFailed |= (numKeys < 0);
+            for (int i = 0; i < numKeys; i++) {
+                postingsPairs.push_back({keys[i], leafOff});
+            }
+            for (const encoded_token_t& token : formula) {
+                if (encoded_token_is_var(token)) {
+                    postingsFlags |= TOKEN_POSTINGS_HAS_VARS;
+                }
+            }
+            numLeaves++;
+        }
+    });
     PRINT_LOG("Created index of %s\n",
               humanReadableByteCount(mwsr.ms.index_size,
                                      /* si= */ false).c_str());
 
+    if (config.writeMirrorIndex) {
+        TmpIndex mirror;
+        memsector_writer_t mirrorWriter;
+        index.buildMirror(&mirror);
+        if (memsector_create(&mirrorWriter, (output_dir + "/" +
+                                             MIRROR_MEMSECTOR_FILE).c_str()) !=
+            0) {
+            PRINT_WARN("Could not create the mirror index\n");
+            return EXIT_FAILURE;
+        }
+        mirror.exportToMemsector(&mirrorWriter);
+        PRINT_LOG("Created mirror index of %s\n",
+                  humanReadableByteCount(mirrorWriter.ms.index_size,
+                                         /* si= */ false).c_str());
+    }
+
+    if (exact_index_write((output_dir + "/" + EXACT_INDEX_FILE).c_str(),
+                          exactEntries.data(), exactEntries.size()) != 0) {
+        PRINT_WARN("Could not write the exact match table\n");
+        return EXIT_FAILURE;
+    }
+
+    if ((config.writeFormulaStore || config.writeTokenPostings) &&
+        formula_store_write((output_dir + "/" + FORMULA_STORE_FILE).c_str(),
+                            exportedFormulae.data(), exportedFormulae.size(),
+                            exportedTokens.data()) != 0) {
+        PRINT_WARN("Could not write the formula store\n");
+        return EXIT_FAILURE;
+    }
+
+    if (config.writeTokenPostings &&
+        (postingsFailed ||
+         token_postings_write(
+             (output_dir + "/" + TOKEN_POSTINGS_FILE).c_str(),
+             postingsPairs.data(), postingsPairs.size(), numLeaves,
+             postingsFlags) != 0)) {
+        PRINT_WARN("Could not write the token postings\n");
+        return EXIT_FAILURE;
+    }
+
+    if (config.writeSubtreeBounds) {
+        const string memsectorPath = output_dir + "/" + INDEX_MEMSECTOR_FILE;
+        memsector_handle_t ms;
+        index_handle_t indexHandle;
+        int ret;
+
+        if (memsector_load(&ms, memsectorPath.c_str()) != 0) {
+            PRINT_WARN("Could not load %s\n", memsectorPath.c_str());
+            return EXIT_FAILURE;
+        }
+        indexHandle.ms = ms.ms;
+        indexHandle.root = memsector_get_root(&ms);
+        ret = subtree_bounds_write(
+            (output_dir + "/" + SUBTREE_BOUNDS_FILE).c_str(), &indexHandle);
+        memsector_unload(&ms);
+        if (ret != 0) {
+            PRINT_WARN("Could not write the subtree bounds\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (config.writeCollectionMasks) {
+        const string memsectorPath = output_dir + "/" + INDEX_MEMSECTOR_FILE;
+        vector<uint32_t> firstCrawls;
+        memsector_handle_t ms;
+        index_handle_t indexHandle;
+        int ret;
+
+        for (dbc::CrawlId crawlId : indexBuilder.getCollectionFirstCrawls()) {
+            // collections without documents hold no CrawlId
+            firstCrawls.push_back(crawlId == dbc::CRAWLID_NULL ? UINT32_MAX
+                                                               : crawlId);
+        }
+        for (size_t i = 0; i < firstCrawls.size(); i++) {
+            PRINT_LOG("Collection %zu: %s\n", i,
+                      config.harvester.paths[i].c_str());
+        }
+        if (memsector_load(&ms, memsectorPath.c_str()) != 0) {
+            PRINT_WARN("Could not load %s\n", memsectorPath.c_str());
+            return EXIT_FAILURE;
+        }
+        indexHandle.ms = ms.ms;
+        indexHandle.root = memsector_get_root(&ms);
+        const vector<collection_mask_t>& formulaMasks =
+            indexBuilder.getFormulaMasks();
+        ret = collection_masks_write(
+            (output_dir + "/" + COLLECTION_MASKS_FILE).c_str(), &indexHandle,
+            firstCrawls.data(), firstCrawls.size(), formulaMasks.data(),
+            formulaMasks.size());
+        memsector_unload(&ms);
+        if (ret != 0) {
+            PRINT_WARN("Could not write the collection masks\n");
+            return EXIT_FAILURE;
+        }
+    }
+
     fb.open((output_dir + "/" + MEANING_DICTIONARY_FILE).c_str(),
             std::ios::out);
     meaningDictionary.save(os);
@@ -41,6 +41,27 @@ struct IndexConfiguration {
     HarvesterConfiguration harvester;
     std::string dataPath;
     bool deleteOldData;
+    /// Also store the encoded formula of every FormulaId
+    bool writeFormulaStore;
+    /// Also store the bounds of every subtree, for ranked queries
+    bool writeSubtreeBounds;
+    /// Also store the leaves of every constant token, for queries starting
+    /// with qvars. Implies writeFormulaStore.
+    bool writeTokenPostings;
+    /// Also store an index of the mirrored formulae, for queries whose
+    /// constants come after their qvars
+    bool writeMirrorIndex;
+    /// Also store the collections and documents of every formula and
+    /// subtree, for filtered queries. Each harvest path is a collection.
+    bool writeCollectionMasks;
+
+    IndexConfiguration()
+        : deleteOldData(false),
+          writeFormulaStore(false),
+          writeSubtreeBounds(false),
+          writeTokenPostings(false),
+          writeMirrorIndex(false),
+          writeCollectionMasks(false) {}
 };
 
 /**
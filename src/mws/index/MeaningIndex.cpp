@@ -0,0 +1,103 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  MeaningIndex implementation
+  * @file   MeaningIndex.cpp
+  * @date   19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  */
+
+#include <string.h>
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/hash.h"
+#include "mws/index/MeaningIndex.hpp"
+
+namespace mws {
+namespace index {
+
+MeaningIndex::MeaningIndex(const MeaningDictionary& dictionary)
+    : _mask(0), _size(0) {
+    MeaningDictionary::ReverseLookupTable table =
+        dictionary.getReverseLookupTable();
+
+    _size = table.size();
+    // keep the load factor below 1/2 so that probe sequences stay short
+    size_t capacity = 2;
+    while (capacity < 2 * _size) {
+        capacity <<= 1;
+    }
+    _mask = capacity - 1;
+
+    Slot emptySlot;
+    memset(&emptySlot, 0, sizeof(emptySlot));
+    emptySlot.id = MeaningDictionary::KEY_NOT_FOUND;
+    _slots.assign(capacity, emptySlot);
+
+    const MeaningId firstId = MeaningDictionary::KEY_NOT_FOUND + 1;
+    size_t keysSize = 0;
+    for (MeaningId id = firstId; id < firstId + _size; id++) {
+        keysSize += table.get(id).size();
+    }
+    _keys.reserve(keysSize);
+
+    for (MeaningId id = firstId; id < firstId + _size; id++) {
+        const string& key = table.get(id);
+        uint32_t hash = hash_fnv1a_32(key.data(), key.size());
+
+        size_t pos = hash & _mask;
+        while (_slots[pos].id != MeaningDictionary::KEY_NOT_FOUND) {
+            pos = (pos + 1) & _mask;
+        }
+
+        Slot& slot = _slots[pos];
+        slot.hash = hash;
+        slot.keySize = key.size();
+        slot.keyOffset = _keys.size();
+        slot.id = id;
+        _keys.insert(_keys.end(), key.begin(), key.end());
+    }
+}
+
+MeaningId MeaningIndex::get(const char* key, size_t keySize) const {
+    uint32_t hash = hash_fnv1a_32(key, keySize);
+
+    size_t pos = hash & _mask;
+    while (_slots[pos].id != MeaningDictionary::KEY_NOT_FOUND) {
+        const Slot& slot = _slots[pos];
+        if (slot.hash == hash && slot.keySize == keySize &&
+            memcmp(_keys.data() + slot.keyOffset, key, keySize) == 0) {
+            return slot.id;
+        }
+        pos = (pos + 1) & _mask;
+    }
+
+    return MeaningDictionary::KEY_NOT_FOUND;
+}
+
+}  // namespace index
+}  // namespace mws
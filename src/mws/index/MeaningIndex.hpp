@@ -0,0 +1,85 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_INDEX_MEANINGINDEX_HPP
+#define _MWS_INDEX_MEANINGINDEX_HPP
+
+/**
+  * @brief  Read-only hash index over a MeaningDictionary
+  * @file   MeaningIndex.hpp
+  * @date   19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/MeaningDictionary.hpp"
+#include "mws/index/encoded_token.h"
+
+namespace mws {
+namespace index {
+
+/**
+ * @brief Immutable open-addressing table mapping meanings to MeaningIds.
+ *
+ * Keys are stored contiguously and looked up by (pointer, length), so a
+ * lookup does not allocate. Safe for concurrent readers.
+ */
+class MeaningIndex {
+ public:
+    explicit MeaningIndex(const MeaningDictionary& dictionary);
+
+    /**
+     * @return the MeaningId of key or MeaningDictionary::KEY_NOT_FOUND
+     */
+    MeaningId get(const char* key, size_t keySize) const;
+    MeaningId get(const types::Meaning& meaning) const {
+        return get(meaning.data(), meaning.size());
+    }
+
+    size_t size() const { return _size; }
+
+ private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t keySize;
+        uint64_t keyOffset;
+        MeaningId id;  // KEY_NOT_FOUND marks an empty slot
+    };
+
+    std::vector<Slot> _slots;
+    std::vector<char> _keys;
+    size_t _mask;
+    size_t _size;
+
+    DISALLOW_COPY_AND_ASSIGN(MeaningIndex);
+};
+
+}  // namespace index
+}  // namespace mws
+
+#endif  // _MWS_INDEX_MEANINGINDEX_HPP
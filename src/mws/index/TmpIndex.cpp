@@ -40,6 +40,7 @@ using std::make_pair;
 using std::function;
 
 #include "mws/index/index.h"
+#include "mws/index/ExpressionEncoder.hpp"
 #include "mws/index/TmpIndex.hpp"
 #include "mws/index/TmpIndexAccessor.hpp"
 #include "mws/index/CallbackIndexIterator.hpp"
@@ -59,6 +60,9 @@ TmpIndexNode::TmpIndexNode() {}
 TmpLeafNode::TmpLeafNode()
     : TmpIndexNode(), id(++TmpLeafNode::nextId), solutions(0) {}
 
+TmpLeafNode::TmpLeafNode(types::FormulaId formulaId)
+    : TmpIndexNode(), id(formulaId), solutions(0) {}
+
 TmpIndex::TmpIndex() : mRoot(new TmpIndexNode) {}
 
 TmpIndex::~TmpIndex() {
@@ -75,6 +79,47 @@ TmpIndex::~TmpIndex() {
 }
 
 TmpLeafNode* TmpIndex::insertData(
+    const vector<encoded_token_t>& encodedFormula) {
+    TmpIndexNode* currentNode = _insertPath(encodedFormula);
+
+    const encoded_token_t& encodedToken = encodedFormula.back();
+    TmpLeafNode* node = (TmpLeafNode*)currentNode->children[encodedToken];
+    if (node == nullptr) {
+        currentNode->children[encodedToken] = node = new TmpLeafNode();
+    }
+
+    return node;
+}
+
+void TmpIndex::buildMirror(TmpIndex* mirror) const {
+    vector<encoded_token_t> path;
+
+    auto onPush = [&](TmpIndexAccessor::Iterator iterator) {
+        path.push_back(TmpIndexAccessor::getToken(iterator));
+    }
+    ;
+
+    auto onPop = [&](TmpIndexAccessor::Iterator iterator) {
+        const TmpIndexNode* node = TmpIndexAccessor::getNode(this, iterator);
+        if (node->children.size() == 0) {  // leaf
+            auto leaf = reinterpret_cast<const TmpLeafNode*>(node);
+            vector<encoded_token_t> mirrored = mirrorEncoding(path);
+            TmpIndexNode* parent = mirror->_insertPath(mirrored);
+            TmpIndexNode*& child = parent->children[mirrored.back()];
+            assert(child == nullptr);
+            TmpLeafNode* mirrorLeaf = new TmpLeafNode(leaf->id);
+            mirrorLeaf->solutions = leaf->solutions;
+            child = mirrorLeaf;
+        }
+        path.pop_back();
+    }
+    ;
+
+    CallbackIndexIterator<TmpIndexAccessor> it(this, mRoot, onPush, onPop);
+    while (it.next() != nullptr) continue;
+}
+
+TmpIndexNode* TmpIndex::_insertPath(
     const vector<encoded_token_t>& encodedFormula) {
     size_t size = encodedFormula.size();
     assert(size > 0);
@@ -90,22 +135,18 @@ TmpLeafNode* TmpIndex::insertData(
         currentNode = node;
     }
 
-    const encoded_token_t& encodedToken = encodedFormula[size - 1];
-    TmpLeafNode* node = (TmpLeafNode*)currentNode->children[encodedToken];
-    if (node == nullptr) {
-        currentNode->children[encodedToken] = node = new TmpLeafNode();
-    }
-
-    return node;
+    return currentNode;
 }
 
 memsector_long_off_t TmpIndex::_writeChildrenOffsets(
     memsector_writer_t* mswr, const TmpIndexNode* node,
-    const vector<memsector_long_off_t>& offsets) {
+    const vector<memsector_long_off_t>& offsets, bool* hasHvars) {
     assert(node->children.size() == offsets.size());
 
+    uint32_t numVars = _countVars(node);
+    *hasHvars = *hasHvars || numVars > 0;
     memsector_long_off_t currOffset = memsector_write_inode_begin(
-        mswr, node->children.size(), offsets.front());
+        mswr, node->children.size(), numVars, *hasHvars, offsets.front());
 
     int i = 0;
     for (const auto& entry : node->children) {
@@ -117,6 +158,15 @@ memsector_long_off_t TmpIndex::_writeChildrenOffsets(
     return currOffset;
 }
 
+uint32_t TmpIndex::_countVars(const TmpIndexNode* node) {
+    uint32_t numVars = 0;
+    for (const auto& entry : node->children) {
+        if (encoded_token_is_var(entry.first)) numVars++;
+    }
+
+    return numVars;
+}
+
 uint64_t TmpIndex::computeMemsectorSize() const {
     uint64_t size = 0;
 
@@ -126,7 +176,7 @@ uint64_t TmpIndex::computeMemsectorSize() const {
         const TmpIndexNode* node = TmpIndexAccessor::getNode(this, iterator);
         uint32_t num_children = node->children.size();
         if (num_children > 0) {  // index node
-            size += memsector_inode_size(num_children);
+            size += memsector_inode_size(num_children, _countVars(node));
         } else {  // leaf node
             size += memsector_leaf_size();
         }
@@ -137,19 +187,26 @@ uint64_t TmpIndex::computeMemsectorSize() const {
     // iterate through entire index, adding sizes of inodes and leafs
     while (it.next() != nullptr) continue;
     // add root size
-    size += memsector_inode_size(mRoot->children.size());
+    size += memsector_inode_size(mRoot->children.size(), _countVars(mRoot));
 
     return size;
 }
 
-void TmpIndex::exportToMemsector(memsector_writer_t* mswr) const {
+void TmpIndex::exportToMemsector(memsector_writer_t* mswr,
+                                 const LeafCallback& onLeaf) const {
     stack<vector<memsector_long_off_t> > dfsStack;
+    // whether the subtrees exported so far of the nodes on the stack have
+    // hvars
+    stack<bool> hvarsStack;
+    vector<encoded_token_t> path;
 
     auto onPush = [&](TmpIndexAccessor::Iterator iterator) {
         const TmpIndexNode* node = TmpIndexAccessor::getNode(this, iterator);
+        path.push_back(TmpIndexAccessor::getToken(iterator));
         if (node->children.size() > 0) {
             dfsStack.push(vector<memsector_long_off_t>());
             dfsStack.top().reserve(node->children.size());
+            hvarsStack.push(false);
         }
     }
     ;
@@ -157,27 +214,35 @@ void TmpIndex::exportToMemsector(memsector_writer_t* mswr) const {
     auto onPop = [&](TmpIndexAccessor::Iterator iterator) {
         const TmpIndexNode* node = TmpIndexAccessor::getNode(this, iterator);
         if (node->children.size() > 0) {  // index node
+            bool hasHvars = hvarsStack.top();
             memsector_long_off_t offset =
-                _writeChildrenOffsets(mswr, node, dfsStack.top());
+                _writeChildrenOffsets(mswr, node, dfsStack.top(), &hasHvars);
             dfsStack.pop();
             dfsStack.top().push_back(offset);
+            hvarsStack.pop();
+            hvarsStack.top() = hvarsStack.top() || hasHvars;
         } else {  // leaf
             auto leaf = reinterpret_cast<const TmpLeafNode*>(node);
             memsector_long_off_t offset =
                 memsector_write_leaf(mswr, leaf->solutions, leaf->id);
             dfsStack.top().push_back(offset);
+            if (onLeaf) {
+                onLeaf(path, leaf->id, offset);
+            }
         }
+        path.pop_back();
     }
     ;
 
     dfsStack.push(vector<memsector_long_off_t>());
+    hvarsStack.push(false);
     CallbackIndexIterator<TmpIndexAccessor> it(this, mRoot, onPush, onPop);
 
     // iterate through entire index, writing inodes and leafs
     while (it.next() != nullptr) continue;
     // write the root, always use 64b offset for root
-    memsector_long_off_t rootOffset =
-        _writeChildrenOffsets(mswr, mRoot, dfsStack.top());
+    memsector_long_off_t rootOffset = _writeChildrenOffsets(
+        mswr, mRoot, dfsStack.top(), &hvarsStack.top());
 
     dfsStack.pop();
     assert(dfsStack.empty());
@@ -31,6 +31,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   *
   */
 
+#include <functional>
 #include <stack>
 #include <utility>
 #include <vector>
@@ -84,6 +85,8 @@ class TmpLeafNode : public TmpIndexNode {
 
  public:
     TmpLeafNode();
+    /// Leaf of an existing formula id, which is not reserved again
+    explicit TmpLeafNode(types::FormulaId formulaId);
 
     uint32_t getNumSolutions() const { return solutions; }
 
@@ -100,6 +103,11 @@ class TmpIndex {
     TmpIndexNode* mRoot;
 
  public:
+    /// Callback for every leaf exported, with the formula leading to it
+    typedef std::function<void(const std::vector<encoded_token_t>& formula,
+                               types::FormulaId formulaId,
+                               memsector_long_off_t leafOff)> LeafCallback;
+
     TmpIndex();
     ~TmpIndex();
 
@@ -109,6 +117,13 @@ class TmpIndex {
       */
     TmpLeafNode* insertData(const std::vector<encoded_token_t>& encodedFormula);
 
+    /**
+     * @brief Insert the mirrored encoding of every formula of the index
+     * into another index, keeping their ids and solutions
+     * @param mirror index without any of these formulae
+     */
+    void buildMirror(TmpIndex* mirror) const;
+
     /**
      * @return size of the resulting memsector in bytes
      */
@@ -117,13 +132,24 @@ class TmpIndex {
     /**
      * @brief exportToMemsector dump index data to a memsector index
      * @param mswr memsector writer handle
+     * @param onLeaf optional callback, used to build index side tables
      */
-    void exportToMemsector(memsector_writer_t* mswr) const;
+    void exportToMemsector(memsector_writer_t* mswr,
+                           const LeafCallback& onLeaf = nullptr) const;
 
  private:
+    /// @return parent node of the leaf of the formula, created if needed
+    TmpIndexNode* _insertPath(
+        const std::vector<encoded_token_t>& encodedFormula);
+    /**
+     * @param hasHvars whether the subtrees of the children have hvars, set
+     * to whether the subtree of node has hvars
+     */
     static memsector_long_off_t _writeChildrenOffsets(
         memsector_writer_t* mswr, const TmpIndexNode* node,
-        const std::vector<memsector_long_off_t>& offsets);
+        const std::vector<memsector_long_off_t>& offsets, bool* hasHvars);
+    /// @return number of children of node with a var token
+    static uint32_t _countVars(const TmpIndexNode* node);
     friend class TmpIndexAccessor;
     ALLOW_TESTER_ACCESS;
     DISALLOW_COPY_AND_ASSIGN(TmpIndex);
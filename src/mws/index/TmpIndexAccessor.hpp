@@ -47,6 +47,11 @@ class TmpIndexAccessor {
     static Iterator getChildrenIterator(Node* node) {
         return Iterator(node->children.begin(), node->children.end());
     }
+    /// @return iterator over the children of node, from the i-th one
+    static Iterator getChildrenIterator(Node* node, size_t i) {
+        return Iterator(node->children.begin() + i, node->children.end());
+    }
+    static size_t getNumChildren(Node* node) { return node->children.size(); }
     static encoded_token_t getToken(const Iterator& it) {
         return it.get()->first;
     }
@@ -0,0 +1,323 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Collection masks
+ * @file    collection_masks.c
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/utils/mmap.h"
+#include "mws/index/collection_masks.h"
+
+const uint32_t COLLECTION_MASKS_MAGIC = 0x8B0A4D5C;
+const uint32_t COLLECTION_MASKS_VERSION = 1;
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/* Internal node being visited, with the masks of its visited children */
+typedef struct dfs_frame_s {
+    const inode_t* node;
+    uint64_t next_child;
+    collection_mask_t mask;
+} dfs_frame_t;
+
+/*--------------------------------------------------------------------------*/
+/* Local methods                                                            */
+/*--------------------------------------------------------------------------*/
+
+static int reserve(void** data, uint64_t* capacity, uint64_t size,
+                   size_t elem_size);
+
+static const inode_t* inode_get_child_at(const inode_t* node, uint64_t i);
+
+static memsector_long_off_t inode_off(const index_handle_t* index,
+                                      const inode_t* node);
+
+static int collection_masks_entry_cmp(const void* e1, const void* e2);
+
+/*--------------------------------------------------------------------------*/
+/* Implementation                                                           */
+/*--------------------------------------------------------------------------*/
+
+collection_mask_t collection_mask_empty(void) {
+    collection_mask_t mask;
+
+    mask.mask = 0;
+    mask.min_crawl = UINT32_MAX;
+    mask.max_crawl = 0;
+    mask.num_hits = 0;
+
+    return mask;
+}
+
+void collection_mask_merge(collection_mask_t* dst,
+                           const collection_mask_t* src) {
+    dst->mask |= src->mask;
+    if (src->min_crawl < dst->min_crawl) dst->min_crawl = src->min_crawl;
+    if (src->max_crawl > dst->max_crawl) dst->max_crawl = src->max_crawl;
+    if (dst->num_hits > UINT32_MAX - src->num_hits) {
+        dst->num_hits = UINT32_MAX;
+    } else {
+        dst->num_hits += src->num_hits;
+    }
+}
+
+int collection_masks_write(const char* path, const index_handle_t* index,
+                           const uint32_t* first_crawls,
+                           uint32_t num_collections,
+                           const collection_mask_t* formulae,
+                           uint32_t num_formulae) {
+    collection_masks_header_t header;
+    collection_masks_entry_t* entries = NULL;
+    uint64_t num_entries = 0, entries_capacity = 0;
+    dfs_frame_t* stack = NULL;
+    uint64_t stack_size = 0, stack_capacity = 0;
+    FILE* file = NULL;
+
+    FAIL_ON(num_collections > COLLECTION_MASKS_MAX_COLLECTIONS);
+    FAIL_ON(reserve((void**)&stack, &stack_capacity, 1, sizeof(*stack)) != 0);
+    stack[0].node = (const inode_t*)index->root;
+    stack[0].next_child = 0;
+    stack[0].mask = collection_mask_empty();
+    stack_size = 1;
+
+    while (stack_size > 0) {
+        dfs_frame_t* top = &stack[stack_size - 1];
+
+        if (top->next_child < top->node->size) {
+            const inode_t* child =
+                inode_get_child_at(top->node, top->next_child);
+            top->next_child++;
+            if (child->type == LEAF_NODE) {
+                const leaf_t* leaf = (const leaf_t*)child;
+                if (leaf->formula_id < num_formulae) {
+                    collection_mask_merge(&top->mask,
+                                          &formulae[leaf->formula_id]);
+                }
+            } else {
+                FAIL_ON(reserve((void**)&stack, &stack_capacity,
+                                stack_size + 1, sizeof(*stack)) != 0);
+                top = &stack[stack_size];
+                top->node = child;
+                top->next_child = 0;
+                top->mask = collection_mask_empty();
+                stack_size++;
+            }
+        } else {
+            // all children visited, save and merge into the parent
+            FAIL_ON(reserve((void**)&entries, &entries_capacity,
+                            num_entries + 1, sizeof(*entries)) != 0);
+            entries[num_entries].node_off = inode_off(index, top->node);
+            entries[num_entries].mask = top->mask;
+            num_entries++;
+
+            stack_size--;
+            if (stack_size > 0) {
+                collection_mask_merge(&stack[stack_size - 1].mask,
+                                      &top->mask);
+            }
+        }
+    }
+
+    qsort(entries, num_entries, sizeof(*entries), collection_masks_entry_cmp);
+
+    header.magic = COLLECTION_MASKS_MAGIC;
+    header.version = COLLECTION_MASKS_VERSION;
+    header.num_collections = num_collections;
+    header.num_formulae = num_formulae;
+    header.num_nodes = num_entries;
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        PRINT_WARN("Error while opening %s: %s\n", path, strerror(errno));
+        goto fail;
+    }
+    FAIL_ON(fwrite(&header, sizeof(header), 1, file) != 1);
+    FAIL_ON(fwrite(first_crawls, sizeof(*first_crawls), num_collections,
+                   file) != num_collections);
+    FAIL_ON(fwrite(formulae, sizeof(*formulae), num_formulae, file) !=
+            num_formulae);
+    FAIL_ON(fwrite(entries, sizeof(*entries), num_entries, file) !=
+            num_entries);
+
+    free(entries);
+    free(stack);
+    return fclose(file);
+
+fail:
+    if (file != NULL) fclose(file);
+    free(entries);
+    free(stack);
+    return -1;
+}
+
+int collection_masks_load(collection_masks_handle_t* handle,
+                          const char* path) {
+    const collection_masks_header_t* header;
+    uint64_t expected_size;
+
+    if (mmap_load(path, MAP_SHARED, &handle->mmap_handle) == -1) {
+        return -1;
+    }
+
+    header = (const collection_masks_header_t*)handle->mmap_handle.start_addr;
+    if (handle->mmap_handle.size < sizeof(*header) ||
+        header->magic != COLLECTION_MASKS_MAGIC) {
+        PRINT_WARN("File %s is not a collection masks table "
+                   "(magic mismatch)\n", path);
+        goto fail;
+    }
+    if (header->version != COLLECTION_MASKS_VERSION) {
+        PRINT_WARN("Cannot process collection masks %s v%d\n", path,
+                   (int)header->version);
+        goto fail;
+    }
+    expected_size =
+        sizeof(*header) + header->num_collections * sizeof(uint32_t) +
+        header->num_formulae * sizeof(collection_mask_t) +
+        header->num_nodes * sizeof(collection_masks_entry_t);
+    if (handle->mmap_handle.size != expected_size ||
+        header->num_collections > COLLECTION_MASKS_MAX_COLLECTIONS) {
+        PRINT_WARN("Collection masks %s are corrupted (size mismatch)\n",
+                   path);
+        goto fail;
+    }
+
+    handle->header = header;
+    handle->first_crawls = (const uint32_t*)(header + 1);
+    handle->formulae = (const collection_mask_t*)(handle->first_crawls +
+                                                  header->num_collections);
+    handle->nodes = (const collection_masks_entry_t*)(handle->formulae +
+                                                      header->num_formulae);
+
+    return 0;
+
+fail:
+    mmap_unload(&handle->mmap_handle);
+    return -1;
+}
+
+int collection_masks_unload(collection_masks_handle_t* handle) {
+    return mmap_unload(&handle->mmap_handle);
+}
+
+const collection_mask_t* collection_masks_lookup_node(
+    const collection_masks_handle_t* handle, const index_handle_t* index,
+    const inode_t* node) {
+    memsector_long_off_t off = inode_off(index, node);
+    uint64_t begin = 0, end = handle->header->num_nodes;
+
+    while (begin < end) {
+        uint64_t mid = begin + (end - begin) / 2;
+        if (handle->nodes[mid].node_off < off) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    if (begin < handle->header->num_nodes &&
+        handle->nodes[begin].node_off == off) {
+        return &handle->nodes[begin].mask;
+    }
+
+    return NULL;
+}
+
+const collection_mask_t* collection_masks_lookup_formula(
+    const collection_masks_handle_t* handle, uint32_t formula_id) {
+    if (formula_id >= handle->header->num_formulae) return NULL;
+
+    return &handle->formulae[formula_id];
+}
+
+int collection_masks_get_collection(const collection_masks_handle_t* handle,
+                                    uint32_t crawl_id) {
+    uint32_t begin = 0, end = handle->header->num_collections;
+
+    // first collection starting after crawl_id
+    while (begin < end) {
+        uint32_t mid = begin + (end - begin) / 2;
+        if (handle->first_crawls[mid] <= crawl_id) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+
+    return (int)begin - 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/* Local implementation                                                     */
+/*--------------------------------------------------------------------------*/
+
+static int reserve(void** data, uint64_t* capacity, uint64_t size,
+                   size_t elem_size) {
+    uint64_t new_capacity = *capacity ? *capacity : 64;
+    void* new_data;
+
+    if (size <= *capacity) return 0;
+    while (new_capacity < size) new_capacity *= 2;
+    new_data = realloc(*data, new_capacity * elem_size);
+    if (new_data == NULL) return -1;
+
+    *data = new_data;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+static const inode_t* inode_get_child_at(const inode_t* node, uint64_t i) {
+    memsector_long_off_t off;
+
+    if (node->type == LONG_INTERNAL_NODE) {
+        off = ((const inode_long_t*)node)->data[i].off;
+    } else {
+        off = node->data[i].off;
+    }
+
+    return (const inode_t*)memsector_relOff2addr((const char*)node, off);
+}
+
+static memsector_long_off_t inode_off(const index_handle_t* index,
+                                      const inode_t* node) {
+    return ((const char*)node - (const char*)index->ms) /
+           MEMSECTOR_ALLOC_UNIT;
+}
+
+static int collection_masks_entry_cmp(const void* e1, const void* e2) {
+    memsector_long_off_t off1 =
+        ((const collection_masks_entry_t*)e1)->node_off;
+    memsector_long_off_t off2 =
+        ((const collection_masks_entry_t*)e2)->node_off;
+
+    return (off1 > off2) - (off1 < off2);
+}
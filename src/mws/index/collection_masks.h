@@ -0,0 +1,171 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Collection masks
+ * @file    collection_masks.h
+ * @date    19 Oct 2026
+ *
+ * Annotates the formulae and the internal nodes of an index with the
+ * documents holding their occurrences: a mask of the collections of the
+ * documents and the range of their CrawlIds. A collection is a harvest path
+ * of the index, whose documents have consecutive CrawlIds starting at the
+ * first CrawlId of the collection. Filtered queries use the annotations to
+ * skip the subtrees and formulae without documents passing the filter.
+ * Formula entries are indexed by formula id, node entries are sorted by
+ * node offset. The table is written next to the memsector and memory mapped
+ * read-only when the index is loaded.
+ *
+ * License: GPLv3
+ */
+
+#ifndef __MWS_INDEX_COLLECTION_MASKS_H
+#define __MWS_INDEX_COLLECTION_MASKS_H
+
+// System includes
+
+#include <stdint.h>
+
+// Local includes
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/mmap.h"
+#include "mws/index/index.h"
+
+/*--------------------------------------------------------------------------*/
+/* Constants                                                                */
+/*--------------------------------------------------------------------------*/
+
+#define COLLECTION_MASKS_MAX_COLLECTIONS 64
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/**
+ * @brief Collection masks file header, followed by the first CrawlIds of
+ * the num_collections collections, num_formulae formula masks and
+ * num_nodes node entries
+ */
+struct collection_masks_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_collections;
+    uint32_t num_formulae;
+    uint64_t num_nodes;
+} PACKED;
+typedef struct collection_masks_header_s collection_masks_header_t;
+
+/**
+ * @brief Documents of the occurrences of a formula or of the formulae below
+ * a node. Occurrences without a document are only counted by the hits of
+ * the formula.
+ */
+struct collection_mask_s {
+    /// bit c is set if a document of collection c holds an occurrence
+    uint64_t mask;
+    /// CrawlIds of the documents, min_crawl > max_crawl if there are none
+    uint32_t min_crawl;
+    uint32_t max_crawl;
+    /// occurrences in documents, saturated at UINT32_MAX
+    uint32_t num_hits;
+} PACKED;
+typedef struct collection_mask_s collection_mask_t;
+
+struct collection_masks_entry_s {
+    /// offset of the internal node in the memsector
+    memsector_long_off_t node_off;
+    collection_mask_t mask;
+} PACKED;
+typedef struct collection_masks_entry_s collection_masks_entry_t;
+
+typedef struct collection_masks_handle_s {
+    mmap_handle_t mmap_handle;
+    const collection_masks_header_t* header;
+    const uint32_t* first_crawls;
+    const collection_mask_t* formulae;
+    const collection_masks_entry_t* nodes;
+} collection_masks_handle_t;
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+BEGIN_DECLS
+
+/**
+ * @brief Empty mask, the identity of collection_mask_merge
+ */
+collection_mask_t collection_mask_empty(void);
+
+/**
+ * @brief Add the documents of src to dst
+ */
+void collection_mask_merge(collection_mask_t* dst,
+                           const collection_mask_t* src);
+
+/**
+ * @brief Compute the masks of every internal node of an index from the
+ * masks of its formulae and write them to path
+ * @param first_crawls first CrawlId of each collection, increasing
+ * @param formulae masks of the formulae, indexed by formula id
+ * @return 0 on success, -1 on failure.
+ */
+int collection_masks_write(const char* path, const index_handle_t* index,
+                           const uint32_t* first_crawls,
+                           uint32_t num_collections,
+                           const collection_mask_t* formulae,
+                           uint32_t num_formulae);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int collection_masks_load(collection_masks_handle_t* handle,
+                          const char* path);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int collection_masks_unload(collection_masks_handle_t* handle);
+
+/**
+ * @return the mask of an internal node of the index, or NULL if the node is
+ * not annotated
+ */
+const collection_mask_t* collection_masks_lookup_node(
+    const collection_masks_handle_t* handle, const index_handle_t* index,
+    const inode_t* node);
+
+/**
+ * @return the mask of a formula, or NULL if the formula is not annotated
+ */
+const collection_mask_t* collection_masks_lookup_formula(
+    const collection_masks_handle_t* handle, uint32_t formula_id);
+
+/**
+ * @return the collection of the document crawl_id, or -1 if it precedes
+ * all collections
+ */
+int collection_masks_get_collection(const collection_masks_handle_t* handle,
+                                    uint32_t crawl_id);
+
+END_DECLS
+
+#endif  // __MWS_INDEX_COLLECTION_MASKS_H
@@ -0,0 +1,158 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Exact match formula table
+ * @file    exact_index.c
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/utils/mmap.h"
+#include "mws/index/exact_index.h"
+
+const uint32_t EXACT_INDEX_MAGIC = 0x88E8AC88;
+const uint32_t EXACT_INDEX_VERSION = 1;
+
+/*--------------------------------------------------------------------------*/
+/* Local methods                                                            */
+/*--------------------------------------------------------------------------*/
+
+static uint64_t exact_index_num_slots(uint64_t num_entries);
+
+/*--------------------------------------------------------------------------*/
+/* Implementation                                                           */
+/*--------------------------------------------------------------------------*/
+
+int exact_index_write(const char* path, const exact_index_entry_t* entries,
+                      uint64_t num_entries) {
+    exact_index_header_t header;
+    exact_index_entry_t* slots = NULL;
+    FILE* file = NULL;
+    uint64_t i, mask;
+
+    /* build table in memory */
+    header.magic = EXACT_INDEX_MAGIC;
+    header.version = EXACT_INDEX_VERSION;
+    header.num_slots = exact_index_num_slots(num_entries);
+    header.num_entries = 0;
+    mask = header.num_slots - 1;
+
+    slots = calloc(header.num_slots, sizeof(*slots));
+    FAIL_ON(slots == NULL);
+
+    for (i = 0; i < num_entries; i++) {
+        const exact_index_entry_t* entry = &entries[i];
+        uint64_t pos = entry->hash & mask;
+
+        assert(entry->size > 0);
+        while (slots[pos].size != 0 &&
+               !exact_index_same_key(&slots[pos], entry)) {
+            pos = (pos + 1) & mask;
+        }
+
+        if (slots[pos].size == 0) {
+            slots[pos] = *entry;
+            header.num_entries++;
+        } else {  // distinct formulae share a key
+            slots[pos].formula_id = 0;
+            slots[pos].leaf_off = MEMSECTOR_OFF_NULL;
+        }
+    }
+
+    /* dump to disk */
+    file = fopen(path, "w");
+    if (file == NULL) {
+        PRINT_WARN("Error while opening %s: %s\n", path, strerror(errno));
+        goto fail;
+    }
+    FAIL_ON(fwrite(&header, sizeof(header), 1, file) != 1);
+    FAIL_ON(fwrite(slots, sizeof(*slots), header.num_slots, file) !=
+            header.num_slots);
+    FAIL_ON(fclose(file) != 0);
+    free(slots);
+
+    return 0;
+
+fail:
+    if (file != NULL) fclose(file);
+    free(slots);
+    return -1;
+}
+
+int exact_index_load(exact_index_handle_t* handle, const char* path) {
+    const exact_index_header_t* header;
+
+    if (mmap_load(path, MAP_SHARED, &handle->mmap_handle) == -1) {
+        return -1;
+    }
+
+    header = (const exact_index_header_t*)handle->mmap_handle.start_addr;
+    if (handle->mmap_handle.size < sizeof(*header) ||
+        header->magic != EXACT_INDEX_MAGIC) {
+        PRINT_WARN("File %s is not an exact table (magic mismatch)\n", path);
+        goto fail;
+    }
+    if (header->version != EXACT_INDEX_VERSION) {
+        PRINT_WARN("Cannot process exact table %s v%d\n", path,
+                   (int)header->version);
+        goto fail;
+    }
+    if (handle->mmap_handle.size !=
+        sizeof(*header) + header->num_slots * sizeof(exact_index_entry_t)) {
+        PRINT_WARN("Exact table %s is corrupted (size mismatch)\n", path);
+        goto fail;
+    }
+
+    handle->header = header;
+    handle->slots = (const exact_index_entry_t*)(header + 1);
+
+    return 0;
+
+fail:
+    mmap_unload(&handle->mmap_handle);
+    return -1;
+}
+
+int exact_index_unload(exact_index_handle_t* handle) {
+    return mmap_unload(&handle->mmap_handle);
+}
+
+/*--------------------------------------------------------------------------*/
+/* Local implementation                                                     */
+/*--------------------------------------------------------------------------*/
+
+/**
+ * Smallest power of 2 keeping the load factor at most 1/2
+ */
+static uint64_t exact_index_num_slots(uint64_t num_entries) {
+    uint64_t num_slots = 2;
+
+    while (num_slots < 2 * num_entries) num_slots *= 2;
+
+    return num_slots;
+}
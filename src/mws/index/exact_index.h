@@ -0,0 +1,162 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Exact match formula table
+ * @file    exact_index.h
+ * @date    19 Oct 2026
+ *
+ * Open addressing hash table mapping the encoding of every indexed formula
+ * to its leaf in the index memsector. It is written next to the memsector
+ * at index creation and memory mapped read-only when the index is loaded.
+ * Keys are the 64 bit FNV-1a hash of the encoded formula, checked against
+ * a second 32 bit hash and the formula size. Formulae whose keys collide
+ * at build time are marked ambiguous and must be looked up in the index.
+ * A lookup matches the formula with high probability only: a formula which
+ * is not indexed may collide with the key of one which is. Callers compare
+ * the formula store entry of the leaf, or descend the index when there is
+ * no store.
+ *
+ * License: GPLv3
+ */
+
+#ifndef __MWS_INDEX_EXACT_INDEX_H
+#define __MWS_INDEX_EXACT_INDEX_H
+
+// System includes
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Local includes
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/hash.h"
+#include "common/utils/mmap.h"
+#include "mws/index/encoded_token.h"
+#include "mws/index/memsector.h"
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/**
+ * @brief Exact table slot. Empty slots have size 0, ambiguous ones have
+ * leaf_off MEMSECTOR_OFF_NULL.
+ */
+struct exact_index_entry_s {
+    uint64_t hash;
+    uint32_t check;
+    uint32_t size;
+    uint32_t formula_id;
+    memsector_long_off_t leaf_off;
+} PACKED;
+typedef struct exact_index_entry_s exact_index_entry_t;
+
+/**
+ * @brief Exact table file header, followed by num_slots entries
+ */
+struct exact_index_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t num_slots; /* power of 2 */
+    uint64_t num_entries;
+} PACKED;
+typedef struct exact_index_header_s exact_index_header_t;
+
+typedef struct exact_index_handle_s {
+    mmap_handle_t mmap_handle;
+    const exact_index_header_t* header;
+    const exact_index_entry_t* slots;
+} exact_index_handle_t;
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+BEGIN_DECLS
+
+/**
+ * @brief Compute the key of an encoded formula. Only hash, check and size
+ * are set.
+ */
+static inline exact_index_entry_t exact_index_key(
+    const encoded_token_t* tokens, uint32_t size) {
+    exact_index_entry_t key;
+
+    key.hash = hash_fnv1a_64(tokens, size * sizeof(encoded_token_t));
+    key.check = hash_fnv1a_32(tokens, size * sizeof(encoded_token_t));
+    key.size = size;
+    key.formula_id = 0;
+    key.leaf_off = MEMSECTOR_OFF_NULL;
+
+    return key;
+}
+
+static inline bool exact_index_same_key(const exact_index_entry_t* e1,
+                                        const exact_index_entry_t* e2) {
+    return e1->hash == e2->hash && e1->check == e2->check &&
+           e1->size == e2->size;
+}
+
+/**
+ * @brief Find the slot of an encoded formula, matching its hashes and size
+ * @return the matching slot, which holds another formula if their keys
+ * collide, or NULL if the formula is not indexed
+ */
+static inline const exact_index_entry_t* exact_index_lookup(
+    const exact_index_handle_t* handle, const encoded_token_t* tokens,
+    uint32_t size) {
+    const exact_index_entry_t key = exact_index_key(tokens, size);
+    const uint64_t mask = handle->header->num_slots - 1;
+    uint64_t pos = key.hash & mask;
+
+    while (handle->slots[pos].size != 0) {
+        if (exact_index_same_key(&handle->slots[pos], &key)) {
+            return &handle->slots[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Write an exact table. Entries with colliding keys are stored once
+ * and marked ambiguous.
+ * @param entries keyed entries, one per indexed formula
+ * @return 0 on success, -1 on failure.
+ */
+int exact_index_write(const char* path, const exact_index_entry_t* entries,
+                      uint64_t num_entries);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int exact_index_load(exact_index_handle_t* handle, const char* path);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int exact_index_unload(exact_index_handle_t* handle);
+
+END_DECLS
+
+#endif  // __MWS_INDEX_EXACT_INDEX_H
@@ -0,0 +1,154 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Formula store
+ * @file    formula_store.c
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/utils/mmap.h"
+#include "mws/index/formula_store.h"
+
+const uint32_t FORMULA_STORE_MAGIC = 0x88F0E588;
+const uint32_t FORMULA_STORE_VERSION = 1;
+
+/*--------------------------------------------------------------------------*/
+/* Local methods                                                            */
+/*--------------------------------------------------------------------------*/
+
+static int formula_store_record_cmp(const void* r1, const void* r2);
+
+/*--------------------------------------------------------------------------*/
+/* Implementation                                                           */
+/*--------------------------------------------------------------------------*/
+
+int formula_store_write(const char* path, formula_store_record_t* records,
+                        uint64_t num_records, const encoded_token_t* tokens) {
+    formula_store_header_t header;
+    FILE* file;
+    uint64_t i, offset;
+    uint32_t id;
+
+    qsort(records, num_records, sizeof(*records), formula_store_record_cmp);
+
+    header.magic = FORMULA_STORE_MAGIC;
+    header.version = FORMULA_STORE_VERSION;
+    header.num_ids =
+        (num_records > 0) ? records[num_records - 1].formula_id + 1 : 0;
+    header.num_tokens = 0;
+    for (i = 0; i < num_records; i++) {
+        assert(i == 0 || records[i - 1].formula_id < records[i].formula_id);
+        header.num_tokens += records[i].size;
+    }
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        PRINT_WARN("Error while opening %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    FAIL_ON(fwrite(&header, sizeof(header), 1, file) != 1);
+
+    /* offsets, ids without a record get an empty range */
+    offset = 0;
+    i = 0;
+    for (id = 0; id <= header.num_ids; id++) {
+        FAIL_ON(fwrite(&offset, sizeof(offset), 1, file) != 1);
+        if (i < num_records && records[i].formula_id == id) {
+            offset += records[i].size;
+            i++;
+        }
+    }
+
+    /* tokens, in id order */
+    for (i = 0; i < num_records; i++) {
+        FAIL_ON(records[i].size > 0 &&
+                fwrite(tokens + records[i].begin, sizeof(*tokens),
+                       records[i].size, file) != records[i].size);
+    }
+
+    return fclose(file);
+
+fail:
+    fclose(file);
+    return -1;
+}
+
+int formula_store_load(formula_store_handle_t* handle, const char* path) {
+    const formula_store_header_t* header;
+    uint64_t expected_size;
+
+    if (mmap_load(path, MAP_SHARED, &handle->mmap_handle) == -1) {
+        return -1;
+    }
+
+    header = (const formula_store_header_t*)handle->mmap_handle.start_addr;
+    if (handle->mmap_handle.size < sizeof(*header) ||
+        header->magic != FORMULA_STORE_MAGIC) {
+        PRINT_WARN("File %s is not a formula store (magic mismatch)\n", path);
+        goto fail;
+    }
+    if (header->version != FORMULA_STORE_VERSION) {
+        PRINT_WARN("Cannot process formula store %s v%d\n", path,
+                   (int)header->version);
+        goto fail;
+    }
+    expected_size = sizeof(*header) + (header->num_ids + 1) * sizeof(uint64_t) +
+                    header->num_tokens * sizeof(encoded_token_t);
+    if (handle->mmap_handle.size != expected_size) {
+        PRINT_WARN("Formula store %s is corrupted (size mismatch)\n", path);
+        goto fail;
+    }
+
+    handle->header = header;
+    handle->offsets = (const uint64_t*)(header + 1);
+    handle->tokens =
+        (const encoded_token_t*)(handle->offsets + header->num_ids + 1);
+
+    return 0;
+
+fail:
+    mmap_unload(&handle->mmap_handle);
+    return -1;
+}
+
+int formula_store_unload(formula_store_handle_t* handle) {
+    return mmap_unload(&handle->mmap_handle);
+}
+
+/*--------------------------------------------------------------------------*/
+/* Local implementation                                                     */
+/*--------------------------------------------------------------------------*/
+
+static int formula_store_record_cmp(const void* r1, const void* r2) {
+    uint32_t id1 = ((const formula_store_record_t*)r1)->formula_id;
+    uint32_t id2 = ((const formula_store_record_t*)r2)->formula_id;
+
+    return (id1 > id2) - (id1 < id2);
+}
@@ -0,0 +1,128 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Formula store
+ * @file    formula_store.h
+ * @date    19 Oct 2026
+ *
+ * Maps every FormulaId of an index back to its encoded formula. The
+ * formulae are stored in compressed sparse row form: the tokens of id i
+ * are tokens[offsets[i] .. offsets[i + 1]). Ids without a formula have an
+ * empty range. The store is written next to the memsector at index
+ * creation and memory mapped read-only when the index is loaded.
+ *
+ * License: GPLv3
+ */
+
+#ifndef __MWS_INDEX_FORMULA_STORE_H
+#define __MWS_INDEX_FORMULA_STORE_H
+
+// System includes
+
+#include <stdint.h>
+
+// Local includes
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/mmap.h"
+#include "mws/index/encoded_token.h"
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/**
+ * @brief Formula store file header, followed by num_ids + 1 offsets and
+ * num_tokens encoded tokens
+ */
+struct formula_store_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t num_ids;
+    uint64_t num_tokens;
+} PACKED;
+typedef struct formula_store_header_s formula_store_header_t;
+
+/**
+ * @brief Formula to be stored, as a slice of a token buffer
+ */
+typedef struct formula_store_record_s {
+    uint32_t formula_id;
+    uint32_t size;
+    uint64_t begin;
+} formula_store_record_t;
+
+typedef struct formula_store_handle_s {
+    mmap_handle_t mmap_handle;
+    const formula_store_header_t* header;
+    const uint64_t* offsets;
+    const encoded_token_t* tokens;
+} formula_store_handle_t;
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+BEGIN_DECLS
+
+/**
+ * @return the encoded formula with the given id, or an empty formula if
+ * the id is not stored.
+ */
+static inline encoded_formula_t formula_store_get(
+    const formula_store_handle_t* handle, uint32_t formula_id) {
+    encoded_formula_t formula;
+
+    if (formula_id < handle->header->num_ids) {
+        uint64_t begin = handle->offsets[formula_id];
+        formula.data = (encoded_token_t*)handle->tokens + begin;
+        formula.size = handle->offsets[formula_id + 1] - begin;
+    } else {
+        formula.data = NULL;
+        formula.size = 0;
+    }
+
+    return formula;
+}
+
+/**
+ * @brief Write a formula store
+ * @param records one record per formula id, in any order. They are sorted
+ * by id in place.
+ * @param tokens buffer the records point into
+ * @return 0 on success, -1 on failure.
+ */
+int formula_store_write(const char* path, formula_store_record_t* records,
+                        uint64_t num_records, const encoded_token_t* tokens);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int formula_store_load(formula_store_handle_t* handle, const char* path);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int formula_store_unload(formula_store_handle_t* handle);
+
+END_DECLS
+
+#endif  // __MWS_INDEX_FORMULA_STORE_H
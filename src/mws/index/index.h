@@ -70,22 +70,38 @@ struct encoded_token_dict_entry_long_s {
 typedef struct encoded_token_dict_entry_long_s encoded_token_dict_entry_long_t;
 
 /**
- * @brief Internal index node
+ * @brief Internal index node. Nodes with var children are followed by their
+ * inode_vars_t directory.
  */
 struct inode_s {
     node_type_t type : 2; /* should be INTERNAL_NODE */
-    uint64_t size : 62;
+    uint64_t num_vars : 16; /* number of children with a var token */
+    uint64_t has_hvars : 1; /* some formula of the subtree has hvars */
+    uint64_t size : 45;
     encoded_token_dict_entry_t data[];
 } PACKED;
 typedef struct inode_s inode_t;
 
 struct inode_long_s {
     node_type_t type : 2; /* should be LONG_INTERNAL_NODE */
-    uint64_t size : 62;
+    uint64_t num_vars : 16;
+    uint64_t has_hvars : 1;
+    uint64_t size : 45;
     encoded_token_dict_entry_long_t data[];
 } PACKED;
 typedef struct inode_long_s inode_long_t;
 
+/**
+ * @brief Positions of the var children of an internal node, in [begin, end).
+ * Entries are sorted by token bytes, so constants of arity 0 may precede the
+ * vars or lie between them.
+ */
+struct inode_vars_s {
+    uint32_t begin;
+    uint32_t end;
+} PACKED;
+typedef struct inode_vars_s inode_vars_t;
+
 /**
  * @brief Leaf index node
  */
@@ -115,19 +131,33 @@ typedef struct index_handle_s {
 
 BEGIN_DECLS
 
-static inline uint32_t memsector_inode_size(uint32_t num_children) {
-    return sizeof(inode_t) + num_children * sizeof(encoded_token_dict_entry_t);
+static inline uint32_t memsector_inode_size(uint32_t num_children,
+                                            uint32_t num_vars) {
+    uint32_t size =
+        sizeof(inode_t) + num_children * sizeof(encoded_token_dict_entry_t);
+    if (num_vars > 0) size += sizeof(inode_vars_t);
+
+    return size;
 }
 
 static inline uint32_t memsector_leaf_size(void) { return sizeof(leaf_t); }
 
+/**
+ * @param num_vars number of children with a var token
+ * @param has_hvars whether some formula of the subtree has hvars, including
+ * the var children
+ */
 static inline memsector_long_off_t memsector_write_inode_begin(
-    memsector_writer_t* msw, uint32_t num_children,
-    memsector_long_off_t furthermost_child_off) {
+    memsector_writer_t* msw, uint32_t num_children, uint32_t num_vars,
+    bool has_hvars, memsector_long_off_t furthermost_child_off) {
     // No inode write should be in progress
     assert(msw->inode.entries_delivered == 0);
     assert(msw->inode.entries_promised == 0);
+    assert(num_vars <= num_children);
+    assert(num_vars == 0 || has_hvars);
     msw->inode.entries_promised = num_children;
+    msw->inode.vars_promised = num_vars;
+    msw->inode.vars_delivered = 0;
 
     memsector_long_off_t currOff = memsector_get_current_offset(msw);
 
@@ -137,11 +167,15 @@ static inline memsector_long_off_t memsector_write_inode_begin(
     if (msw->inode.has_long_offsets) {
         inode_long_t inode;
         inode.type = LONG_INTERNAL_NODE;
+        inode.num_vars = num_vars;
+        inode.has_hvars = has_hvars;
         inode.size = num_children;
         memsector_write(msw, &inode, sizeof(inode));
     } else {
         inode_t inode;
         inode.type = INTERNAL_NODE;
+        inode.num_vars = num_vars;
+        inode.has_hvars = has_hvars;
         inode.size = num_children;
         memsector_write(msw, &inode, sizeof(inode));
     }
@@ -155,6 +189,11 @@ static inline void memsector_write_inode_encoded_token_entry(
     assert(msw->inode.entries_promised > msw->inode.entries_delivered++);
     assert(off != MEMSECTOR_OFF_NULL);
 
+    if (encoded_token_is_var(encoded_token)) {
+        uint32_t pos = msw->inode.entries_delivered - 1;
+        if (msw->inode.vars_delivered++ == 0) msw->inode.vars_begin = pos;
+        msw->inode.vars_end = pos + 1;
+    }
     if (msw->inode.has_long_offsets) {
         encoded_token_dict_entry_long_t entry;
         entry.token = encoded_token;
@@ -171,6 +210,13 @@ static inline void memsector_write_inode_encoded_token_entry(
 static inline void memsector_write_inode_end(memsector_writer_t* msw) {
     assert(msw->inode.entries_delivered > 0);
     assert(msw->inode.entries_delivered == msw->inode.entries_promised);
+    assert(msw->inode.vars_delivered == msw->inode.vars_promised);
+    if (msw->inode.vars_promised > 0) {
+        inode_vars_t vars;
+        vars.begin = msw->inode.vars_begin;
+        vars.end = msw->inode.vars_end;
+        memsector_write(msw, &vars, sizeof(vars));
+    }
     msw->inode.entries_delivered = 0;
     msw->inode.entries_promised = 0;
 }
@@ -242,11 +288,36 @@ static inline memsector_long_off_t inode_long_get_child(
     return MEMSECTOR_OFF_NULL;
 }
 
-static inline uint32_t inode_get_max_var(const inode_t* inode) {
-    uint32_t i = 0;
-    while (inode->data[i].token.id <= VAR_ID_MAX) i++;
+/**
+ * @return number of children of an internal node with a var token
+ */
+static inline uint32_t inode_get_num_vars(const inode_t* inode) {
+    return inode->num_vars;
+}
+
+/**
+ * @return whether some formula below an internal node has hvars
+ */
+static inline bool inode_has_hvars(const inode_t* inode) {
+    return inode->has_hvars;
+}
+
+/**
+ * @brief Get the positions of the var children of an internal node, which
+ * must have some.
+ */
+static inline inode_vars_t inode_get_vars(const inode_t* inode) {
+    const char* entries_end;
+
+    assert(inode->num_vars > 0);
+    if (inode->type == LONG_INTERNAL_NODE) {
+        const inode_long_t* inode_long = (const inode_long_t*)inode;
+        entries_end = (const char*)&inode_long->data[inode_long->size];
+    } else {
+        entries_end = (const char*)&inode->data[inode->size];
+    }
 
-    return i;
+    return *(const inode_vars_t*)entries_end;
 }
 
 static inline memsector_off_t inode_get_qvar(const inode_t* inode,
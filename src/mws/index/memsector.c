@@ -39,7 +39,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include "mws/index/memsector.h"
 
 const uint64_t MEMSECTOR_MAGIC = 0x88CAFE88;
-const uint32_t MEMSECTOR_VERSION = 1;
+const uint32_t MEMSECTOR_VERSION = 2;
 
 /*--------------------------------------------------------------------------*/
 /* Local methods                                                            */
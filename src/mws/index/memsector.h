@@ -79,6 +79,11 @@ typedef struct memsector_writer_s {
         uint32_t entries_promised;
         uint32_t entries_delivered;
         bool has_long_offsets;
+        /* var children and their positions */
+        uint32_t vars_promised;
+        uint32_t vars_delivered;
+        uint32_t vars_begin;
+        uint32_t vars_end;
     } inode;
 } memsector_writer_t;
 
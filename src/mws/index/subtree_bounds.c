@@ -0,0 +1,269 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Subtree bounds
+ * @file    subtree_bounds.c
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/utils/mmap.h"
+#include "mws/index/subtree_bounds.h"
+
+const uint32_t SUBTREE_BOUNDS_MAGIC = 0x8B0A4D5B;
+const uint32_t SUBTREE_BOUNDS_VERSION = 1;
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/* Internal node being visited, with the bounds of its visited children */
+typedef struct dfs_frame_s {
+    const inode_t* node;
+    uint64_t next_child;
+    uint32_t depth;
+    uint32_t max_hits;
+    uint32_t min_size;
+} dfs_frame_t;
+
+/*--------------------------------------------------------------------------*/
+/* Local methods                                                            */
+/*--------------------------------------------------------------------------*/
+
+static int reserve(void** data, uint64_t* capacity, uint64_t size,
+                   size_t elem_size);
+
+static const inode_t* inode_get_child_at(const inode_t* node, uint64_t i);
+
+static memsector_long_off_t inode_off(const index_handle_t* index,
+                                      const inode_t* node);
+
+static int subtree_bounds_entry_cmp(const void* e1, const void* e2);
+
+/*--------------------------------------------------------------------------*/
+/* Implementation                                                           */
+/*--------------------------------------------------------------------------*/
+
+int subtree_bounds_write(const char* path, const index_handle_t* index) {
+    subtree_bounds_header_t header;
+    subtree_bounds_entry_t* entries = NULL;
+    uint64_t num_entries = 0, entries_capacity = 0;
+    dfs_frame_t* stack = NULL;
+    uint64_t stack_size = 0, stack_capacity = 0;
+    FILE* file = NULL;
+
+    FAIL_ON(reserve((void**)&stack, &stack_capacity, 1, sizeof(*stack)) != 0);
+    stack[0].node = (const inode_t*)index->root;
+    stack[0].next_child = 0;
+    stack[0].depth = 0;
+    stack[0].max_hits = 0;
+    stack[0].min_size = UINT32_MAX;
+    stack_size = 1;
+
+    while (stack_size > 0) {
+        dfs_frame_t* top = &stack[stack_size - 1];
+
+        if (top->next_child < top->node->size) {
+            const inode_t* child =
+                inode_get_child_at(top->node, top->next_child);
+            top->next_child++;
+            if (child->type == LEAF_NODE) {
+                const leaf_t* leaf = (const leaf_t*)child;
+                if (leaf->num_hits > top->max_hits) {
+                    top->max_hits = leaf->num_hits;
+                }
+                if (top->depth + 1 < top->min_size) {
+                    top->min_size = top->depth + 1;
+                }
+            } else {
+                uint32_t depth = top->depth + 1;
+                FAIL_ON(reserve((void**)&stack, &stack_capacity,
+                                stack_size + 1, sizeof(*stack)) != 0);
+                top = &stack[stack_size];
+                top->node = child;
+                top->next_child = 0;
+                top->depth = depth;
+                top->max_hits = 0;
+                top->min_size = UINT32_MAX;
+                stack_size++;
+            }
+        } else {
+            // all children visited, save and merge into the parent
+            FAIL_ON(reserve((void**)&entries, &entries_capacity,
+                            num_entries + 1, sizeof(*entries)) != 0);
+            entries[num_entries].node_off = inode_off(index, top->node);
+            entries[num_entries].max_hits = top->max_hits;
+            entries[num_entries].min_size = top->min_size;
+            num_entries++;
+
+            stack_size--;
+            if (stack_size > 0) {
+                dfs_frame_t* parent = &stack[stack_size - 1];
+                if (top->max_hits > parent->max_hits) {
+                    parent->max_hits = top->max_hits;
+                }
+                if (top->min_size < parent->min_size) {
+                    parent->min_size = top->min_size;
+                }
+            }
+        }
+    }
+
+    qsort(entries, num_entries, sizeof(*entries), subtree_bounds_entry_cmp);
+
+    header.magic = SUBTREE_BOUNDS_MAGIC;
+    header.version = SUBTREE_BOUNDS_VERSION;
+    header.num_entries = num_entries;
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        PRINT_WARN("Error while opening %s: %s\n", path, strerror(errno));
+        goto fail;
+    }
+    FAIL_ON(fwrite(&header, sizeof(header), 1, file) != 1);
+    FAIL_ON(fwrite(entries, sizeof(*entries), num_entries, file) !=
+            num_entries);
+
+    free(entries);
+    free(stack);
+    return fclose(file);
+
+fail:
+    if (file != NULL) fclose(file);
+    free(entries);
+    free(stack);
+    return -1;
+}
+
+int subtree_bounds_load(subtree_bounds_handle_t* handle, const char* path) {
+    const subtree_bounds_header_t* header;
+    uint64_t expected_size;
+
+    if (mmap_load(path, MAP_SHARED, &handle->mmap_handle) == -1) {
+        return -1;
+    }
+
+    header = (const subtree_bounds_header_t*)handle->mmap_handle.start_addr;
+    if (handle->mmap_handle.size < sizeof(*header) ||
+        header->magic != SUBTREE_BOUNDS_MAGIC) {
+        PRINT_WARN("File %s is not a subtree bounds table (magic mismatch)\n",
+                   path);
+        goto fail;
+    }
+    if (header->version != SUBTREE_BOUNDS_VERSION) {
+        PRINT_WARN("Cannot process subtree bounds %s v%d\n", path,
+                   (int)header->version);
+        goto fail;
+    }
+    expected_size = sizeof(*header) +
+                    header->num_entries * sizeof(subtree_bounds_entry_t);
+    if (handle->mmap_handle.size != expected_size) {
+        PRINT_WARN("Subtree bounds %s are corrupted (size mismatch)\n", path);
+        goto fail;
+    }
+
+    handle->header = header;
+    handle->entries = (const subtree_bounds_entry_t*)(header + 1);
+
+    return 0;
+
+fail:
+    mmap_unload(&handle->mmap_handle);
+    return -1;
+}
+
+int subtree_bounds_unload(subtree_bounds_handle_t* handle) {
+    return mmap_unload(&handle->mmap_handle);
+}
+
+const subtree_bounds_entry_t* subtree_bounds_lookup(
+    const subtree_bounds_handle_t* handle, const index_handle_t* index,
+    const inode_t* node) {
+    memsector_long_off_t off = inode_off(index, node);
+    uint64_t begin = 0, end = handle->header->num_entries;
+
+    while (begin < end) {
+        uint64_t mid = begin + (end - begin) / 2;
+        if (handle->entries[mid].node_off < off) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    if (begin < handle->header->num_entries &&
+        handle->entries[begin].node_off == off) {
+        return &handle->entries[begin];
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/* Local implementation                                                     */
+/*--------------------------------------------------------------------------*/
+
+static int reserve(void** data, uint64_t* capacity, uint64_t size,
+                   size_t elem_size) {
+    uint64_t new_capacity = *capacity ? *capacity : 64;
+    void* new_data;
+
+    if (size <= *capacity) return 0;
+    while (new_capacity < size) new_capacity *= 2;
+    new_data = realloc(*data, new_capacity * elem_size);
+    if (new_data == NULL) return -1;
+
+    *data = new_data;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+static const inode_t* inode_get_child_at(const inode_t* node, uint64_t i) {
+    memsector_long_off_t off;
+
+    if (node->type == LONG_INTERNAL_NODE) {
+        off = ((const inode_long_t*)node)->data[i].off;
+    } else {
+        off = node->data[i].off;
+    }
+
+    return (const inode_t*)memsector_relOff2addr((const char*)node, off);
+}
+
+static memsector_long_off_t inode_off(const index_handle_t* index,
+                                      const inode_t* node) {
+    return ((const char*)node - (const char*)index->ms) /
+           MEMSECTOR_ALLOC_UNIT;
+}
+
+static int subtree_bounds_entry_cmp(const void* e1, const void* e2) {
+    memsector_long_off_t off1 = ((const subtree_bounds_entry_t*)e1)->node_off;
+    memsector_long_off_t off2 = ((const subtree_bounds_entry_t*)e2)->node_off;
+
+    return (off1 > off2) - (off1 < off2);
+}
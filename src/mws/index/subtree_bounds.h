@@ -0,0 +1,110 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Subtree bounds
+ * @file    subtree_bounds.h
+ * @date    19 Oct 2026
+ *
+ * Annotates every internal node of an index with bounds over the leaves
+ * below it: the maximum number of hits and the minimum formula size. A
+ * leaf's formula size is its depth in the index. Ranked queries use them to
+ * skip subtrees which cannot beat the current results. The table is sorted
+ * by node offset, written next to the memsector and memory mapped
+ * read-only when the index is loaded.
+ *
+ * License: GPLv3
+ */
+
+#ifndef __MWS_INDEX_SUBTREE_BOUNDS_H
+#define __MWS_INDEX_SUBTREE_BOUNDS_H
+
+// System includes
+
+#include <stdint.h>
+
+// Local includes
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/mmap.h"
+#include "mws/index/index.h"
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/**
+ * @brief Subtree bounds file header, followed by num_entries entries
+ */
+struct subtree_bounds_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t num_entries;
+} PACKED;
+typedef struct subtree_bounds_header_s subtree_bounds_header_t;
+
+struct subtree_bounds_entry_s {
+    /// offset of the internal node in the memsector
+    memsector_long_off_t node_off;
+    uint32_t max_hits;
+    uint32_t min_size;
+} PACKED;
+typedef struct subtree_bounds_entry_s subtree_bounds_entry_t;
+
+typedef struct subtree_bounds_handle_s {
+    mmap_handle_t mmap_handle;
+    const subtree_bounds_header_t* header;
+    const subtree_bounds_entry_t* entries;
+} subtree_bounds_handle_t;
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+BEGIN_DECLS
+
+/**
+ * @brief Compute the bounds of every internal node of an index and write
+ * them to path
+ * @return 0 on success, -1 on failure.
+ */
+int subtree_bounds_write(const char* path, const index_handle_t* index);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int subtree_bounds_load(subtree_bounds_handle_t* handle, const char* path);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int subtree_bounds_unload(subtree_bounds_handle_t* handle);
+
+/**
+ * @return the bounds of an internal node of the index, or NULL if the node
+ * is not annotated
+ */
+const subtree_bounds_entry_t* subtree_bounds_lookup(
+    const subtree_bounds_handle_t* handle, const index_handle_t* index,
+    const inode_t* node);
+
+END_DECLS
+
+#endif  // __MWS_INDEX_SUBTREE_BOUNDS_H
@@ -0,0 +1,318 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Token postings
+ * @file    token_postings.c
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/utils/mmap.h"
+#include "mws/index/token_postings.h"
+
+const uint32_t TOKEN_POSTINGS_MAGIC = 0x8C70E591;
+const uint32_t TOKEN_POSTINGS_VERSION = 1;
+
+/* Maximum size of a LEB128 encoded 64 bit value */
+#define VARINT_MAX_SIZE 10
+
+/*--------------------------------------------------------------------------*/
+/* Local methods                                                            */
+/*--------------------------------------------------------------------------*/
+
+static bool is_constant(encoded_token_t token);
+
+static uint32_t varint_encode(uint64_t value, uint8_t* out);
+
+/**
+ * @brief Scan the pairs of the key of pairs[begin]
+ * @return the end of the key's pairs, with the number of distinct leaves
+ * and the size of their posting list
+ */
+static uint64_t scan_key(const token_postings_pair_t* pairs,
+                         uint64_t num_pairs, uint64_t begin, uint64_t* count,
+                         uint64_t* data_size);
+
+static int key_cmp(const void* k1, const void* k2);
+
+static int token_postings_pair_cmp(const void* p1, const void* p2);
+
+/*--------------------------------------------------------------------------*/
+/* Implementation                                                           */
+/*--------------------------------------------------------------------------*/
+
+int token_postings_formula_keys(const encoded_token_t* tokens, uint32_t size,
+                                uint64_t* keys) {
+    uint32_t* parents;
+    uint32_t* remaining;
+    uint32_t depth = 0;
+    uint32_t i, num_keys = 0, num_unique = 0;
+
+    if (size == 0) return 0;
+    parents = malloc(2 * size * sizeof(uint32_t));
+    if (parents == NULL) return -1;
+    remaining = parents + size;
+
+    for (i = 0; i < size; i++) {
+        encoded_token_t token = tokens[i];
+
+        if (is_constant(token)) {
+            if (i == 0) {
+                keys[num_keys++] =
+                    token_postings_key(TOKEN_POSTINGS_PARENT_ROOT, token);
+            }
+            keys[num_keys++] =
+                token_postings_key(TOKEN_POSTINGS_PARENT_ANY, token);
+            if (depth > 0) {
+                keys[num_keys++] =
+                    token_postings_key(parents[depth - 1], token);
+            }
+        }
+
+        // the token is the next argument of the top of the stack
+        if (depth > 0) remaining[depth - 1]--;
+        while (depth > 0 && remaining[depth - 1] == 0) depth--;
+        if (token.arity > 0) {
+            parents[depth] = token_postings_parent(token);
+            remaining[depth] = token.arity;
+            depth++;
+        }
+    }
+    free(parents);
+
+    qsort(keys, num_keys, sizeof(*keys), key_cmp);
+    for (i = 0; i < num_keys; i++) {
+        if (num_unique == 0 || keys[num_unique - 1] != keys[i]) {
+            keys[num_unique++] = keys[i];
+        }
+    }
+
+    return num_unique;
+}
+
+const token_postings_entry_t* token_postings_lookup(
+    const token_postings_handle_t* handle, uint64_t key) {
+    uint64_t begin = 0, end = handle->header->num_keys;
+
+    while (begin < end) {
+        uint64_t mid = begin + (end - begin) / 2;
+        if (handle->entries[mid].key < key) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    if (begin < handle->header->num_keys &&
+        handle->entries[begin].key == key) {
+        return &handle->entries[begin];
+    }
+
+    return NULL;
+}
+
+void token_postings_decode(const token_postings_handle_t* handle,
+                           const token_postings_entry_t* entry,
+                           memsector_long_off_t* leaf_offs) {
+    const uint8_t* data = handle->data + entry->data_off;
+    memsector_long_off_t leaf_off = 0;
+    uint64_t i;
+
+    for (i = 0; i < entry->count; i++) {
+        uint64_t delta = 0;
+        uint32_t shift = 0;
+        uint8_t byte;
+        do {
+            byte = *data++;
+            delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        leaf_off += delta;
+        leaf_offs[i] = leaf_off;
+    }
+}
+
+int token_postings_write(const char* path, token_postings_pair_t* pairs,
+                         uint64_t num_pairs, uint64_t num_leaves,
+                         uint32_t flags) {
+    token_postings_header_t header;
+    token_postings_entry_t entry;
+    uint8_t buf[VARINT_MAX_SIZE];
+    FILE* file;
+    uint64_t begin, end, i, count, data_size;
+
+    qsort(pairs, num_pairs, sizeof(*pairs), token_postings_pair_cmp);
+
+    header.magic = TOKEN_POSTINGS_MAGIC;
+    header.version = TOKEN_POSTINGS_VERSION;
+    header.flags = flags;
+    header.reserved = 0;
+    header.num_keys = 0;
+    header.num_leaves = num_leaves;
+    header.data_size = 0;
+    for (begin = 0; begin < num_pairs; begin = end) {
+        end = scan_key(pairs, num_pairs, begin, &count, &data_size);
+        header.num_keys++;
+        header.data_size += data_size;
+    }
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        PRINT_WARN("Error while opening %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    FAIL_ON(fwrite(&header, sizeof(header), 1, file) != 1);
+
+    /* entries */
+    entry.data_off = 0;
+    for (begin = 0; begin < num_pairs; begin = end) {
+        end = scan_key(pairs, num_pairs, begin, &count, &data_size);
+        entry.key = pairs[begin].key;
+        entry.count = count;
+        FAIL_ON(fwrite(&entry, sizeof(entry), 1, file) != 1);
+        entry.data_off += data_size;
+    }
+
+    /* posting lists, as deltas of the sorted leaf offsets */
+    for (begin = 0; begin < num_pairs; begin = end) {
+        memsector_long_off_t prev_off = 0;
+        uint32_t size;
+        end = scan_key(pairs, num_pairs, begin, &count, &data_size);
+        for (i = begin; i < end; i++) {
+            if (i > begin && pairs[i].leaf_off == prev_off) continue;
+            size = varint_encode(pairs[i].leaf_off - prev_off, buf);
+            FAIL_ON(fwrite(buf, 1, size, file) != size);
+            prev_off = pairs[i].leaf_off;
+        }
+    }
+
+    return fclose(file);
+
+fail:
+    fclose(file);
+    return -1;
+}
+
+int token_postings_load(token_postings_handle_t* handle, const char* path) {
+    const token_postings_header_t* header;
+    uint64_t expected_size;
+
+    if (mmap_load(path, MAP_SHARED, &handle->mmap_handle) == -1) {
+        return -1;
+    }
+
+    header = (const token_postings_header_t*)handle->mmap_handle.start_addr;
+    if (handle->mmap_handle.size < sizeof(*header) ||
+        header->magic != TOKEN_POSTINGS_MAGIC) {
+        PRINT_WARN("File %s is not a token postings file (magic mismatch)\n",
+                   path);
+        goto fail;
+    }
+    if (header->version != TOKEN_POSTINGS_VERSION) {
+        PRINT_WARN("Cannot process token postings %s v%d\n", path,
+                   (int)header->version);
+        goto fail;
+    }
+    expected_size = sizeof(*header) +
+                    header->num_keys * sizeof(token_postings_entry_t) +
+                    header->data_size;
+    if (handle->mmap_handle.size != expected_size) {
+        PRINT_WARN("Token postings %s are corrupted (size mismatch)\n", path);
+        goto fail;
+    }
+
+    handle->header = header;
+    handle->entries = (const token_postings_entry_t*)(header + 1);
+    handle->data = (const uint8_t*)(handle->entries + header->num_keys);
+
+    return 0;
+
+fail:
+    mmap_unload(&handle->mmap_handle);
+    return -1;
+}
+
+int token_postings_unload(token_postings_handle_t* handle) {
+    return mmap_unload(&handle->mmap_handle);
+}
+
+/*--------------------------------------------------------------------------*/
+/* Local implementation                                                     */
+/*--------------------------------------------------------------------------*/
+
+static bool is_constant(encoded_token_t token) {
+    return !encoded_token_is_var(token) && !encoded_token_is_range(token);
+}
+
+static uint32_t varint_encode(uint64_t value, uint8_t* out) {
+    uint32_t size = 0;
+
+    while (value >= 0x80) {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+
+    return size;
+}
+
+static uint64_t scan_key(const token_postings_pair_t* pairs,
+                         uint64_t num_pairs, uint64_t begin, uint64_t* count,
+                         uint64_t* data_size) {
+    uint8_t buf[VARINT_MAX_SIZE];
+    memsector_long_off_t prev_off = 0;
+    uint64_t end;
+
+    *count = 0;
+    *data_size = 0;
+    for (end = begin; end < num_pairs && pairs[end].key == pairs[begin].key;
+         end++) {
+        if (end > begin && pairs[end].leaf_off == prev_off) continue;
+        *data_size += varint_encode(pairs[end].leaf_off - prev_off, buf);
+        (*count)++;
+        prev_off = pairs[end].leaf_off;
+    }
+
+    return end;
+}
+
+static int key_cmp(const void* k1, const void* k2) {
+    uint64_t key1 = *(const uint64_t*)k1;
+    uint64_t key2 = *(const uint64_t*)k2;
+
+    return (key1 > key2) - (key1 < key2);
+}
+
+static int token_postings_pair_cmp(const void* p1, const void* p2) {
+    const token_postings_pair_t* pair1 = (const token_postings_pair_t*)p1;
+    const token_postings_pair_t* pair2 = (const token_postings_pair_t*)p2;
+
+    if (pair1->key != pair2->key) return (pair1->key > pair2->key) ? 1 : -1;
+    return (pair1->leaf_off > pair2->leaf_off) -
+           (pair1->leaf_off < pair2->leaf_off);
+}
@@ -0,0 +1,192 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Token postings
+ * @file    token_postings.h
+ * @date    19 Oct 2026
+ *
+ * Maps keys of the constant tokens of the indexed formulae to the sorted
+ * offsets of the leaves containing them. A formula has a key for its root
+ * token, for each of its constant tokens and for each constant token with
+ * its parent. Queries whose leading tokens are query variables use them to
+ * find candidate leaves without scanning the index. The posting lists are
+ * delta encoded as LEB128 varints. They are written next to the memsector
+ * at index creation and memory mapped read-only when the index is loaded.
+ *
+ * License: GPLv3
+ */
+
+#ifndef __MWS_INDEX_TOKEN_POSTINGS_H
+#define __MWS_INDEX_TOKEN_POSTINGS_H
+
+// System includes
+
+#include <stdint.h>
+#include <string.h>
+
+// Local includes
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/mmap.h"
+#include "mws/index/encoded_token.h"
+#include "mws/index/memsector.h"
+
+/*--------------------------------------------------------------------------*/
+/* Constants                                                                */
+/*--------------------------------------------------------------------------*/
+
+/* Parent of the key of a root token */
+#define TOKEN_POSTINGS_PARENT_ROOT 0
+/* Parent of the key of a token anywhere in the formula */
+#define TOKEN_POSTINGS_PARENT_ANY 1
+
+/* Some indexed formula has variables */
+#define TOKEN_POSTINGS_HAS_VARS 0x1
+
+/*--------------------------------------------------------------------------*/
+/* Type declarations                                                        */
+/*--------------------------------------------------------------------------*/
+
+/**
+ * @brief Token postings file header, followed by num_keys entries sorted by
+ * key and data_size bytes of posting lists
+ */
+struct token_postings_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t num_keys;
+    uint64_t num_leaves;
+    uint64_t data_size;
+} PACKED;
+typedef struct token_postings_header_s token_postings_header_t;
+
+struct token_postings_entry_s {
+    uint64_t key;
+    /// offset of the posting list in the data
+    uint64_t data_off;
+    /// number of leaves in the posting list
+    uint64_t count;
+} PACKED;
+typedef struct token_postings_entry_s token_postings_entry_t;
+
+/**
+ * @brief Leaf containing a key, to be written
+ */
+typedef struct token_postings_pair_s {
+    uint64_t key;
+    memsector_long_off_t leaf_off;
+} token_postings_pair_t;
+
+typedef struct token_postings_handle_s {
+    mmap_handle_t mmap_handle;
+    const token_postings_header_t* header;
+    const token_postings_entry_t* entries;
+    const uint8_t* data;
+} token_postings_handle_t;
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+BEGIN_DECLS
+
+/**
+ * @param parent the parent token, or one of the TOKEN_POSTINGS_PARENT_*
+ * markers, which are not valid constant tokens
+ */
+static inline uint64_t token_postings_key(uint32_t parent,
+                                          encoded_token_t token) {
+    uint32_t value;
+
+    memcpy(&value, &token, sizeof(value));
+
+    return ((uint64_t)parent << 32) | value;
+}
+
+static inline uint32_t token_postings_parent(encoded_token_t token) {
+    uint32_t value;
+
+    memcpy(&value, &token, sizeof(value));
+
+    return value;
+}
+
+/**
+ * @brief Compute the keys of an encoded formula or query. Variables and
+ * ranges have no keys and do not appear as parents.
+ * @param keys buffer of at least 2 * size + 1 keys, filled sorted and
+ * without duplicates
+ * @return the number of keys, or -1 on allocation failure
+ */
+int token_postings_formula_keys(const encoded_token_t* tokens, uint32_t size,
+                                uint64_t* keys);
+
+/**
+ * @return the entry of a key, or NULL if no leaf contains it
+ */
+const token_postings_entry_t* token_postings_lookup(
+    const token_postings_handle_t* handle, uint64_t key);
+
+/**
+ * @return the number of leaves containing a key
+ */
+static inline uint64_t token_postings_count(
+    const token_postings_handle_t* handle, uint64_t key) {
+    const token_postings_entry_t* entry = token_postings_lookup(handle, key);
+
+    return (entry != NULL) ? entry->count : 0;
+}
+
+/**
+ * @brief Decode the posting list of an entry
+ * @param leaf_offs buffer of at least entry->count offsets, filled in
+ * increasing order
+ */
+void token_postings_decode(const token_postings_handle_t* handle,
+                           const token_postings_entry_t* entry,
+                           memsector_long_off_t* leaf_offs);
+
+/**
+ * @brief Write token postings
+ * @param pairs leaves of every key, in any order. They are sorted in place.
+ * @param num_leaves number of leaves of the index
+ * @param flags TOKEN_POSTINGS_* flags of the index
+ * @return 0 on success, -1 on failure.
+ */
+int token_postings_write(const char* path, token_postings_pair_t* pairs,
+                         uint64_t num_pairs, uint64_t num_leaves,
+                         uint32_t flags);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int token_postings_load(token_postings_handle_t* handle, const char* path);
+
+/**
+ * @return 0 on success, -1 on failure.
+ */
+int token_postings_unload(token_postings_handle_t* handle);
+
+END_DECLS
+
+#endif  // __MWS_INDEX_TOKEN_POSTINGS_H
@@ -46,6 +46,11 @@ int main(int argc, char* argv[]) {
     FlagParser::addFlag('r', "recursive", FLAG_OPT, ARG_NONE);
     FlagParser::addFlag('e', "harvest-file-extension", FLAG_OPT, ARG_REQ);
     FlagParser::addFlag('c', "enable-ci-renaming", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('S', "write-formula-store", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('B', "write-subtree-bounds", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('P', "write-token-postings", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('M', "write-mirror-index", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('K', "write-collection-masks", FLAG_OPT, ARG_NONE);
 
     if (FlagParser::parse(argc, argv) != 0) {
         fprintf(stderr, "%s", FlagParser::getUsage().c_str());
@@ -62,6 +67,11 @@ int main(int argc, char* argv[]) {
     indexConfig.harvester.paths = FlagParser::getArgs('I');
     indexConfig.harvester.encoding.renameCi = FlagParser::hasArg('c');
     indexConfig.dataPath = FlagParser::getArg('o');
+    indexConfig.writeFormulaStore = FlagParser::hasArg('S');
+    indexConfig.writeSubtreeBounds = FlagParser::hasArg('B');
+    indexConfig.writeTokenPostings = FlagParser::hasArg('P');
+    indexConfig.writeMirrorIndex = FlagParser::hasArg('M');
+    indexConfig.writeCollectionMasks = FlagParser::hasArg('K');
 
     return createCompressedIndex(indexConfig);
 }
@@ -76,7 +76,15 @@ int main(int argc, char* argv[]) {
     FlagParser::addFlag('I', "include-harvest-path", FLAG_OPT, ARG_REQ);
     FlagParser::addFlag('n', "ignore-harvest-data", FLAG_OPT, ARG_NONE);
     FlagParser::addFlag('D', "data-path", FLAG_OPT, ARG_REQ);
+    // kept for compatibility, the query engine is the default
     FlagParser::addFlag('x', "experimental-query-engine", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('L', "legacy-query-engine", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('A', "adaptive-query-engine", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('t', "query-threads", FLAG_OPT, ARG_REQ);
+    FlagParser::addFlag('T', "query-timeout", FLAG_OPT, ARG_REQ);
+    FlagParser::addFlag('N', "query-max-nodes", FLAG_OPT, ARG_REQ);
+    FlagParser::addFlag('C', "query-cache-mb", FLAG_OPT, ARG_REQ);
+    FlagParser::addFlag('u', "query-cursor-ttl", FLAG_OPT, ARG_REQ);
     FlagParser::addFlag('p', "mws-port", FLAG_OPT, ARG_REQ);
     FlagParser::addFlag('i', "pid-file", FLAG_OPT, ARG_REQ);
     FlagParser::addFlag('l', "log-file", FLAG_OPT, ARG_REQ);
@@ -86,6 +94,11 @@ int main(int argc, char* argv[]) {
     FlagParser::addFlag('f', "delete-old-data", FLAG_OPT, ARG_NONE);
     FlagParser::addFlag('6', "enable-ipv6", FLAG_OPT, ARG_NONE);
     FlagParser::addFlag('s', "log-index-stats", FLAG_OPT, ARG_REQ);
+    FlagParser::addFlag('S', "write-formula-store", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('B', "write-subtree-bounds", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('P', "write-token-postings", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('M', "write-mirror-index", FLAG_OPT, ARG_NONE);
+    FlagParser::addFlag('K', "write-collection-masks", FLAG_OPT, ARG_NONE);
 #ifndef __APPLE__
     FlagParser::addFlag('d', "daemonize", FLAG_OPT, ARG_NONE);
 #endif  // !__APPLE__
@@ -148,6 +161,13 @@ int main(int argc, char* argv[]) {
     // should delete old data
     indexConfig.deleteOldData = FlagParser::hasArg('f');
 
+    // store formulae by id when building the index
+    indexConfig.writeFormulaStore = FlagParser::hasArg('S');
+    indexConfig.writeSubtreeBounds = FlagParser::hasArg('B');
+    indexConfig.writeTokenPostings = FlagParser::hasArg('P');
+    indexConfig.writeMirrorIndex = FlagParser::hasArg('M');
+    indexConfig.writeCollectionMasks = FlagParser::hasArg('K');
+
     if (FlagParser::hasArg('s')) {
         indexConfig.harvester.statisticsLogFile = FlagParser::getArg('s');
     }
@@ -180,7 +200,29 @@ int main(int argc, char* argv[]) {
             indexConfig.dataPath = FlagParser::getArg('D');
             IndexQueryHandler::Config config;
             config.encoding = indexConfig.harvester.encoding;
-            config.useExperimentalQueryEngine = FlagParser::hasArg('x');
+            config.useSearchContext = FlagParser::hasArg('L');
+            config.adaptiveEngine = FlagParser::hasArg('A');
+            if (FlagParser::hasArg('t')) {
+                int queryThreads = atoi(FlagParser::getArg('t').c_str());
+                if (queryThreads > 0) config.queryThreads = queryThreads;
+            }
+            if (FlagParser::hasArg('T')) {
+                int queryTimeout = atoi(FlagParser::getArg('T').c_str());
+                if (queryTimeout > 0) config.queryTimeout = queryTimeout;
+            }
+            if (FlagParser::hasArg('N')) {
+                long long queryMaxNodes =
+                    atoll(FlagParser::getArg('N').c_str());
+                if (queryMaxNodes > 0) config.queryMaxNodes = queryMaxNodes;
+            }
+            if (FlagParser::hasArg('C')) {
+                int cacheMb = atoi(FlagParser::getArg('C').c_str());
+                if (cacheMb > 0) config.cacheSize = (uint64_t)cacheMb << 20;
+            }
+            if (FlagParser::hasArg('u')) {
+                int cursorTtl = atoi(FlagParser::getArg('u').c_str());
+                if (cursorTtl >= 0) config.cursorTtl = cursorTtl;
+            }
             QueryHandler* qh = nullptr;
 
             try {
@@ -0,0 +1,147 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Query of a compressed index with a batch of queries
+  * @file   BatchContext.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+using std::vector;
+
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/query/engine.h"
+#include "mws/query/BatchContext.hpp"
+
+namespace mws {
+namespace query {
+
+namespace {
+
+bool isConstant(encoded_token_t token) {
+    return !encoded_token_is_var(token) && !encoded_token_is_range(token);
+}
+
+bool tokenLess(encoded_token_t t1, encoded_token_t t2) {
+    return (t1.id < t2.id) || (t1.id == t2.id && t1.arity < t2.arity);
+}
+
+bool sameToken(encoded_token_t t1, encoded_token_t t2) {
+    return t1.id == t2.id && t1.arity == t2.arity;
+}
+
+}  // namespace
+
+BatchContext::BatchContext(const NumericConstants* numbers)
+    : _numbers(numbers), _lookups(0) {}
+
+void BatchContext::addQuery(const vector<encoded_token_t>& encodedFormula,
+                            const types::Query::Options& options,
+                            const RangeBounds& rangeBounds,
+                            unsigned int offset, unsigned int size,
+                            unsigned int maxTotal) {
+    Entry entry;
+    entry.encodedFormula = encodedFormula;
+    entry.options = options;
+    entry.rangeBounds = rangeBounds;
+    entry.offset = offset;
+    entry.size = size;
+    entry.maxTotal = maxTotal;
+    entry.prefixSize = 0;
+    while (entry.prefixSize < encodedFormula.size() &&
+           isConstant(encodedFormula[entry.prefixSize])) {
+        entry.prefixSize++;
+    }
+    _entries.push_back(entry);
+}
+
+size_t BatchContext::size() const { return _entries.size(); }
+
+vector<MwsAnswset*> BatchContext::getResults(index_handle_t* index,
+                                             DbQueryManager* dbQueryManager) {
+    vector<MwsAnswset*> results(_entries.size(), nullptr);
+    vector<size_t> order(_entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t i1,
+                                                        size_t i2) {
+        const Entry& e1 = _entries[i1];
+        const Entry& e2 = _entries[i2];
+        return std::lexicographical_compare(
+            e1.encodedFormula.begin(),
+            e1.encodedFormula.begin() + e1.prefixSize,
+            e2.encodedFormula.begin(),
+            e2.encodedFormula.begin() + e2.prefixSize, tokenLess);
+    });
+
+    // nodes reached by the prefix of the previous query, the first one is
+    // the root, the last one is null if no formula matches
+    vector<const inode_t*> path = {(const inode_t*)index->root};
+    const Entry* previous = nullptr;
+
+    for (size_t i : order) {
+        const Entry& entry = _entries[i];
+        const vector<encoded_token_t>& formula = entry.encodedFormula;
+
+        // keep the nodes of the prefix shared with the previous query
+        size_t depth = 0;
+        if (previous != nullptr) {
+            while (depth + 1 < path.size() && depth < entry.prefixSize &&
+                   sameToken(formula[depth], previous->encodedFormula[depth])) {
+                depth++;
+            }
+        }
+        path.resize(depth + 1);
+        while (depth < entry.prefixSize && path.back() != nullptr) {
+            const inode_t* child;
+            if (!query_engine_descend(path.back(), formula[depth], &child)) {
+                break;
+            }
+            _lookups++;
+            path.push_back(child);
+            depth++;
+        }
+        previous = &entry;
+
+        if (path.back() == nullptr) {
+            results[i] = new MwsAnswset();
+            results[i]->time = 0;
+        } else {
+            index_handle_t subindex = *index;
+            subindex.root = (const inode_long_t*)path.back();
+            EngineContext ctxt(
+                vector<encoded_token_t>(formula.begin() + depth, formula.end()),
+                entry.options, entry.rangeBounds, _numbers);
+            results[i] = ctxt.getResult(&subindex, dbQueryManager,
+                                        entry.offset, entry.size,
+                                        entry.maxTotal);
+        }
+    }
+
+    return results;
+}
+
+uint64_t BatchContext::getLookups() const { return _lookups; }
+
+}  // namespace query
+}  // namespace mws
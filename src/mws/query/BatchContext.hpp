@@ -0,0 +1,104 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_BATCHCONTEXT_HPP
+#define _MWS_QUERY_BATCHCONTEXT_HPP
+
+/**
+  * @brief  Query of a compressed index with a batch of queries
+  * @file   BatchContext.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <cstdint>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+#include "mws/index/encoded_token.h"
+#include "mws/index/index.h"
+#include "mws/query/EngineContext.hpp"
+#include "mws/query/NumericConstants.hpp"
+#include "mws/types/MwsAnswset.hpp"
+#include "mws/types/Query.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Batch of queries run together by EngineContext. The queries are
+ * sorted by their leading constants and the index nodes on a prefix shared
+ * by consecutive queries are looked up once. Each query then searches the
+ * subindex where its prefix ends, so the batch fans out where the queries
+ * diverge or the index has hvars.
+ */
+class BatchContext {
+ public:
+    typedef EngineContext::RangeBounds RangeBounds;
+
+    explicit BatchContext(const NumericConstants* numbers = nullptr);
+
+    /**
+      * @brief Add a query to the batch, with the same offset, size and
+      * maxTotal semantics as EngineContext::getResult.
+      */
+    void addQuery(const std::vector<encoded_token_t>& encodedFormula,
+                  const types::Query::Options& options,
+                  const RangeBounds& rangeBounds, unsigned int offset,
+                  unsigned int size, unsigned int maxTotal);
+
+    /// @return the number of queries in the batch
+    size_t size() const;
+
+    /**
+      * @brief Get the results of the queries of the batch.
+      * @return the answer sets of the queries, owned by the caller, in the
+      * order they were added. Each is the one EngineContext::getResult
+      * returns for the query alone.
+      */
+    std::vector<MwsAnswset*> getResults(index_handle_t* index,
+                                        dbc::DbQueryManager* dbQueryManager);
+
+    /// @return the number of index nodes looked up to descend the prefixes
+    uint64_t getLookups() const;
+
+ private:
+    struct Entry {
+        std::vector<encoded_token_t> encodedFormula;
+        types::Query::Options options;
+        RangeBounds rangeBounds;
+        unsigned int offset;
+        unsigned int size;
+        unsigned int maxTotal;
+        /// number of leading constant tokens
+        size_t prefixSize;
+    };
+
+    std::vector<Entry> _entries;
+    const NumericConstants* _numbers;
+    uint64_t _lookups;
+
+    DISALLOW_COPY_AND_ASSIGN(BatchContext);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_BATCHCONTEXT_HPP
@@ -0,0 +1,180 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Conjunctive queries of several expressions
+  * @file   ConjunctiveContext.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <set>
+using std::set;
+#include <vector>
+using std::vector;
+
+#include "mws/dbc/CrawlDb.hpp"
+using mws::dbc::CrawlData;
+using mws::dbc::CrawlId;
+using mws::dbc::CRAWLID_NULL;
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/query/SearchContext.hpp"
+#include "mws/types/FormulaPath.hpp"
+using mws::types::FormulaId;
+using mws::types::FormulaPath;
+#include "mws/query/ConjunctiveContext.hpp"
+
+namespace mws {
+namespace query {
+
+ConjunctiveContext::ConjunctiveContext(const types::Query::Options& options,
+                                       DbQueryManager* dbQueryManager)
+    : _options(options), _dbQueryManager(dbQueryManager), _partial(false) {}
+
+void ConjunctiveContext::setFilter(const DocumentFilter& filter) {
+    _filter.reset(new DocumentFilter(filter));
+}
+
+void ConjunctiveContext::addExpression(const set<FormulaId>& formulaIds,
+                                       bool partial) {
+    const DocumentFilter* filter = _filter.get();
+    vector<Document> documents;
+
+    for (FormulaId formulaId : formulaIds) {
+        _dbQueryManager->queryCrawlIds(
+            formulaId, [&documents, formulaId, filter](
+                           const CrawlId& crawlId, const FormulaPath& path) {
+                UNUSED(path);
+                if (crawlId != CRAWLID_NULL &&
+                    (filter == nullptr || filter->accepts(crawlId))) {
+                    documents.push_back({crawlId, formulaId});
+                }
+                return 0;
+            },
+            _options.profile);
+    }
+    // keep the first formula of each document
+    std::stable_sort(documents.begin(), documents.end());
+    documents.erase(std::unique(documents.begin(), documents.end(),
+                                [](const Document& d1, const Document& d2) {
+                        return d1.crawlId == d2.crawlId;
+                    }),
+                    documents.end());
+
+    _expressions.push_back(std::move(documents));
+    _partial |= partial;
+}
+
+MwsAnswset* ConjunctiveContext::getResult(unsigned int offset,
+                                          unsigned int size,
+                                          unsigned int maxTotal) {
+    auto startTime = SearchContext::Time::now();
+    auto result = new MwsAnswset();
+    vector<CrawlId> crawlIds;
+
+    // intersect from the most selective expression, so the candidates only
+    // shrink and each longer list is searched for few of them
+    vector<size_t> order(_expressions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t e1, size_t e2) {
+        return _expressions[e1].size() < _expressions[e2].size();
+    });
+    for (size_t k = 0; k < order.size(); k++) {
+        const vector<Document>& documents = _expressions[order[k]];
+        if (k == 0) {
+            for (const Document& document : documents) {
+                crawlIds.push_back(document.crawlId);
+            }
+            continue;
+        }
+
+        size_t kept = 0;
+        size_t pos = 0;
+        for (CrawlId crawlId : crawlIds) {
+            // gallop to the first document not before crawlId
+            size_t bound = 1;
+            while (pos + bound < documents.size() &&
+                   documents[pos + bound].crawlId < crawlId) {
+                bound *= 2;
+            }
+            pos = std::lower_bound(
+                      documents.begin() + pos + bound / 2,
+                      documents.begin() +
+                          std::min(pos + bound + 1, documents.size()),
+                      Document{crawlId, 0}) -
+                  documents.begin();
+            if (pos == documents.size()) break;
+            if (documents[pos].crawlId == crawlId) crawlIds[kept++] = crawlId;
+        }
+        crawlIds.resize(kept);
+        if (crawlIds.empty()) break;
+    }
+
+    const unsigned int total =
+        std::min((unsigned int)crawlIds.size(), maxTotal);
+    const unsigned int end =
+        (offset < total) ? offset + std::min(size, total - offset) : offset;
+    for (unsigned int i = offset; i < end; i++) {
+        const CrawlId crawlId = crawlIds[i];
+        if (_options.includeMwsIds) {
+            for (const vector<Document>& documents : _expressions) {
+                result->ids.insert(find(documents, crawlId)->formulaId);
+            }
+        }
+        if (_options.includeHits) {
+            auto answer = new types::Answer();
+            _dbQueryManager->queryCrawlIds(
+                find(_expressions[0], crawlId)->formulaId,
+                [answer, crawlId](const CrawlId& pathCrawlId,
+                                  const FormulaPath& path) {
+                    if (pathCrawlId != crawlId) return 0;
+                    answer->uri = path.xmlId;
+                    answer->xpath = path.xpath;
+                    return 1;
+                },
+                _options.profile);
+            answer->data =
+                _dbQueryManager->getCrawlData(crawlId, _options.profile);
+            result->answers.push_back(answer);
+        }
+    }
+    result->total = total;
+    result->partial = _partial;
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+const ConjunctiveContext::Document* ConjunctiveContext::find(
+    const vector<Document>& documents, CrawlId crawlId) {
+    auto it = std::lower_bound(documents.begin(), documents.end(),
+                               Document{crawlId, 0});
+    if (it == documents.end() || it->crawlId != crawlId) return nullptr;
+    return &*it;
+}
+
+}  // namespace query
+}  // namespace mws
@@ -0,0 +1,110 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_CONJUNCTIVECONTEXT_HPP
+#define _MWS_QUERY_CONJUNCTIVECONTEXT_HPP
+
+/**
+  * @brief  Conjunctive queries of several expressions
+  * @file   ConjunctiveContext.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/CrawlDb.hpp"
+#include "mws/dbc/DbQueryManager.hpp"
+#include "mws/query/DocumentFilter.hpp"
+#include "mws/types/FormulaPath.hpp"
+#include "mws/types/MwsAnswset.hpp"
+#include "mws/types/Query.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Query for the documents containing a solution of each of several
+ * expressions. The formulae matching each expression are mapped to the
+ * sorted CrawlIds of their documents. The lists are intersected from the
+ * shortest one, galloping through the longer ones, and only the documents
+ * of the returned page are fetched.
+ */
+class ConjunctiveContext {
+ public:
+    ConjunctiveContext(const types::Query::Options& options,
+                       dbc::DbQueryManager* dbQueryManager);
+
+    /// Only search the documents passing filter. Set it before adding the
+    /// expressions.
+    void setFilter(const DocumentFilter& filter);
+
+    /**
+      * @brief Add an expression of the query.
+      * @param formulaIds formulae matching the expression
+      * @param partial true if formulaIds only covers part of them
+      */
+    void addExpression(const std::set<types::FormulaId>& formulaIds,
+                       bool partial);
+
+    /**
+      * @brief Get the documents containing a solution of every expression,
+      * in CrawlId order. Each answer is the first occurrence of the first
+      * expression in a document, with the data of the document.
+      * @param offset is the offset where to start returning documents.
+      * @param size is the maximum number of documents to return.
+      * @param maxTotal is the maximum number of documents to count.
+      * @return an answer set with the corresponding results.
+      */
+    MwsAnswset* getResult(unsigned int offset, unsigned int size,
+                          unsigned int maxTotal);
+
+ private:
+    /// Document of an expression, and a formula matching it there
+    struct Document {
+        dbc::CrawlId crawlId;
+        types::FormulaId formulaId;
+
+        bool operator<(const Document& other) const {
+            return crawlId < other.crawlId;
+        }
+    };
+
+    /// @return the document crawlId of an expression or nullptr
+    static const Document* find(const std::vector<Document>& documents,
+                                dbc::CrawlId crawlId);
+
+    types::Query::Options _options;
+    dbc::DbQueryManager* _dbQueryManager;
+    /// Documents of each expression, sorted by CrawlId
+    std::vector<std::vector<Document>> _expressions;
+    bool _partial;
+    /// Documents searched, all if null
+    std::unique_ptr<DocumentFilter> _filter;
+
+    DISALLOW_COPY_AND_ASSIGN(ConjunctiveContext);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_CONJUNCTIVECONTEXT_HPP
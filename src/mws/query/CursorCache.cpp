@@ -0,0 +1,98 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Paused searches of paginated queries, by continuation token
+  * @file   CursorCache.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+using std::unique_ptr;
+#include <mutex>
+using std::lock_guard;
+using std::mutex;
+#include <random>
+#include <string>
+using std::string;
+
+#include "mws/query/CursorCache.hpp"
+
+namespace mws {
+namespace query {
+
+CursorCache::CursorCache(std::chrono::milliseconds ttl, size_t capacity)
+    : _ttl(ttl), _capacity(capacity), _random(std::random_device()()) {}
+
+string CursorCache::put(const string& key, unique_ptr<PagedSearch> search) {
+    lock_guard<mutex> lock(_lock);
+    Clock::time_point now = Clock::now();
+    _expire(now);
+    while (!_entries.empty() && _entries.size() >= _capacity) {
+        _tokens.erase(_entries.front().token);
+        _entries.pop_front();
+    }
+    if (_capacity == 0) return "";
+
+    string token;
+    do {
+        char buffer[17];
+        snprintf(buffer, sizeof(buffer), "%016" PRIx64, (uint64_t)_random());
+        token = buffer;
+    } while (_tokens.count(token) > 0);
+
+    _entries.push_back({token, key, std::move(search), now + _ttl});
+    _tokens[token] = std::prev(_entries.end());
+
+    return token;
+}
+
+unique_ptr<PagedSearch> CursorCache::take(const string& token,
+                                          const string& key) {
+    lock_guard<mutex> lock(_lock);
+    _expire(Clock::now());
+
+    auto it = _tokens.find(token);
+    if (it == _tokens.end() || it->second->key != key) return nullptr;
+
+    unique_ptr<PagedSearch> search = std::move(it->second->search);
+    _entries.erase(it->second);
+    _tokens.erase(it);
+
+    return search;
+}
+
+size_t CursorCache::size() const {
+    lock_guard<mutex> lock(_lock);
+    return _entries.size();
+}
+
+void CursorCache::_expire(Clock::time_point now) {
+    while (!_entries.empty() && _entries.front().expiry <= now) {
+        _tokens.erase(_entries.front().token);
+        _entries.pop_front();
+    }
+}
+
+}  // namespace query
+}  // namespace mws
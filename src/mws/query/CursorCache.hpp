@@ -0,0 +1,99 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_CURSORCACHE_HPP
+#define _MWS_QUERY_CURSORCACHE_HPP
+
+/**
+  * @brief  Paused searches of paginated queries, by continuation token
+  * @file   CursorCache.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/query/EngineContext.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Paused searches, each under a random continuation token. A search
+ * is taken out of the cache while its next page is computed, so it serves
+ * a single request at a time. Searches expire after a fixed time to live,
+ * the oldest ones are dropped when the cache is full.
+ */
+class CursorCache {
+ public:
+    typedef std::chrono::steady_clock Clock;
+
+    CursorCache(std::chrono::milliseconds ttl, size_t capacity);
+
+    /**
+     * @brief Store a search of the query identified by key
+     * @return the continuation token of the search
+     */
+    std::string put(const std::string& key,
+                    std::unique_ptr<PagedSearch> search);
+
+    /**
+     * @return the search stored under token, or nullptr if it expired or
+     * does not belong to the query identified by key
+     */
+    std::unique_ptr<PagedSearch> take(const std::string& token,
+                                      const std::string& key);
+
+    /// @return number of searches stored, expired ones included
+    size_t size() const;
+
+ private:
+    struct Entry {
+        std::string token;
+        std::string key;
+        std::unique_ptr<PagedSearch> search;
+        Clock::time_point expiry;
+    };
+    /// Entries by expiry, which is the order of insertion
+    typedef std::list<Entry> Entries;
+
+    void _expire(Clock::time_point now);
+
+    const std::chrono::milliseconds _ttl;
+    const size_t _capacity;
+    Entries _entries;
+    std::unordered_map<std::string, Entries::iterator> _tokens;
+    std::mt19937_64 _random;
+    mutable std::mutex _lock;
+
+    DISALLOW_COPY_AND_ASSIGN(CursorCache);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_CURSORCACHE_HPP
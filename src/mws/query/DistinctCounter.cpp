@@ -0,0 +1,103 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Count of distinct values, exact or estimated
+  * @file   DistinctCounter.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <cmath>
+#include <unordered_set>
+using std::unordered_set;
+
+#include "mws/query/DistinctCounter.hpp"
+
+namespace mws {
+namespace query {
+
+static const uint32_t NUM_REGISTERS = 1U << DistinctCounter::HLL_BITS;
+
+/// @return a 64 bit hash of value, with well mixed bits (splitmix64)
+static uint64_t mix(uint32_t value) {
+    uint64_t hash = value + 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+DistinctCounter::DistinctCounter(size_t exactMax) : _exactMax(exactMax) {}
+
+void DistinctCounter::insert(uint32_t value) {
+    if (!_registers.empty()) {
+        addToSketch(value);
+        return;
+    }
+
+    _values.insert(value);
+    if (_values.size() > _exactMax) {
+        _registers.resize(NUM_REGISTERS, 0);
+        for (uint32_t exactValue : _values) addToSketch(exactValue);
+        unordered_set<uint32_t>().swap(_values);
+    }
+}
+
+uint64_t DistinctCounter::count() const {
+    if (_registers.empty()) return _values.size();
+
+    const double m = NUM_REGISTERS;
+    double sum = 0;
+    unsigned zeros = 0;
+    for (uint8_t rank : _registers) {
+        sum += std::ldexp(1.0, -rank);
+        if (rank == 0) zeros++;
+    }
+    double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+    // linear counting is more accurate for small counts
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / zeros);
+    }
+
+    return std::llround(estimate);
+}
+
+bool DistinctCounter::isEstimate() const { return !_registers.empty(); }
+
+double DistinctCounter::relativeError() const {
+    if (_registers.empty()) return 0;
+    return 1.04 / std::sqrt((double)NUM_REGISTERS);
+}
+
+void DistinctCounter::addToSketch(uint32_t value) {
+    const uint64_t hash = mix(value);
+    const uint32_t index = hash >> (64 - HLL_BITS);
+    // rank of the first 1 bit in the other bits, bounded by a sentinel bit
+    uint64_t rest = (hash << HLL_BITS) | (1ULL << (HLL_BITS - 1));
+    uint8_t rank = 1;
+    while ((rest & (1ULL << 63)) == 0) {
+        rest <<= 1;
+        rank++;
+    }
+
+    if (rank > _registers[index]) _registers[index] = rank;
+}
+
+}  // namespace query
+}  // namespace mws
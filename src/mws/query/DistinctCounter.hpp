@@ -0,0 +1,76 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_DISTINCTCOUNTER_HPP
+#define _MWS_QUERY_DISTINCTCOUNTER_HPP
+
+/**
+  * @brief  Count of distinct values, exact or estimated
+  * @file   DistinctCounter.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+
+#include "build-gen/config.h"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Count of the distinct values inserted. They are kept in a set
+ * while they are at most exactMax, then folded into a HyperLogLog sketch of
+ * 2^HLL_BITS registers, whose count has a relative standard error of
+ * 1.04 / sqrt(2^HLL_BITS).
+ */
+class DistinctCounter {
+ public:
+    static const unsigned HLL_BITS = 12;
+
+    explicit DistinctCounter(size_t exactMax = QUERY_DOCUMENTS_EXACT_MAX);
+
+    void insert(uint32_t value);
+
+    /// @return the number of distinct values inserted, estimated if
+    /// isEstimate()
+    uint64_t count() const;
+    bool isEstimate() const;
+    /// @return relative standard error of count(), 0 if it is exact
+    double relativeError() const;
+
+ private:
+    void addToSketch(uint32_t value);
+
+    const size_t _exactMax;
+    std::unordered_set<uint32_t> _values;
+    /// HyperLogLog registers, empty while the count is exact
+    std::vector<uint8_t> _registers;
+
+    DISALLOW_COPY_AND_ASSIGN(DistinctCounter);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_DISTINCTCOUNTER_HPP
@@ -0,0 +1,144 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Solutions of a query grouped by document
+  * @file   DocumentContext.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <map>
+using std::map;
+#include <set>
+using std::set;
+#include <vector>
+using std::vector;
+
+#include "mws/dbc/CrawlDb.hpp"
+using mws::dbc::CrawlId;
+using mws::dbc::CRAWLID_NULL;
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/query/DistinctCounter.hpp"
+#include "mws/query/SearchContext.hpp"
+#include "mws/types/FormulaPath.hpp"
+using mws::types::FormulaId;
+using mws::types::FormulaPath;
+#include "mws/query/DocumentContext.hpp"
+
+namespace mws {
+namespace query {
+
+/// z-score of the 95% interval of an estimated total
+static const double DOCUMENTS_Z = 1.96;
+
+/// Occurrence of a formula in a document
+struct Hit {
+    FormulaId formulaId;
+    FormulaPath path;
+};
+
+DocumentContext::DocumentContext(const types::Query::Options& options,
+                                 DbQueryManager* dbQueryManager,
+                                 size_t exactMax)
+    : _options(options), _dbQueryManager(dbQueryManager),
+      _exactMax(exactMax) {}
+
+void DocumentContext::setFilter(const DocumentFilter& filter) {
+    _filter.reset(new DocumentFilter(filter));
+}
+
+MwsAnswset* DocumentContext::getResult(const set<FormulaId>& formulaIds,
+                                       unsigned int offset,
+                                       unsigned int size,
+                                       unsigned int maxTotal) {
+    auto startTime = SearchContext::Time::now();
+    auto result = new MwsAnswset();
+    DistinctCounter counter(_exactMax);
+    // first documents up to the end of the page, with their hits
+    map<CrawlId, vector<Hit>> documents;
+    const size_t maxDocuments =
+        std::min((size_t)offset + size, (size_t)maxTotal);
+
+    for (FormulaId formulaId : formulaIds) {
+        _dbQueryManager->queryCrawlIds(
+            formulaId, [&](const CrawlId& crawlId, const FormulaPath& path) {
+                if (crawlId == CRAWLID_NULL) return 0;
+                if (_filter != nullptr && !_filter->accepts(crawlId)) return 0;
+                counter.insert(crawlId);
+                if (maxDocuments == 0) return 0;
+
+                auto it = documents.find(crawlId);
+                if (it == documents.end()) {
+                    if (documents.size() == maxDocuments) {
+                        auto last = std::prev(documents.end());
+                        if (crawlId > last->first) return 0;
+                        documents.erase(last);
+                    }
+                    it = documents.insert({crawlId, vector<Hit>()}).first;
+                }
+                it->second.push_back({formulaId, path});
+                return 0;
+            },
+            _options.profile);
+    }
+
+    const uint64_t count = counter.count();
+    result->total = (int)std::min<uint64_t>(count, maxTotal);
+    if (counter.isEstimate() && count < maxTotal) {
+        const double margin = DOCUMENTS_Z * counter.relativeError() * count;
+        result->estimated = true;
+        result->totalLow = std::max<int64_t>(documents.size(),
+                                             std::llround(count - margin));
+        result->totalHigh = (int)std::min<double>(
+            std::min<double>(maxTotal, INT_MAX), std::ceil(count + margin));
+    }
+
+    auto it = documents.begin();
+    for (unsigned int i = 0; i < offset && it != documents.end(); i++) it++;
+    for (; it != documents.end(); it++) {
+        const vector<Hit>& hits = it->second;
+        if (_options.includeMwsIds) {
+            for (const Hit& hit : hits) result->ids.insert(hit.formulaId);
+        }
+        if (_options.includeHits) {
+            auto answer = new types::Answer();
+            answer->uri = hits[0].path.xmlId;
+            answer->xpath = hits[0].path.xpath;
+            answer->data =
+                _dbQueryManager->getCrawlData(it->first, _options.profile);
+            for (const Hit& hit : hits) answer->hits.push_back(hit.path);
+            result->answers.push_back(answer);
+        }
+    }
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+}  // namespace query
+}  // namespace mws
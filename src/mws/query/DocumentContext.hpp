@@ -0,0 +1,90 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_DOCUMENTCONTEXT_HPP
+#define _MWS_QUERY_DOCUMENTCONTEXT_HPP
+
+/**
+  * @brief  Solutions of a query grouped by document
+  * @file   DocumentContext.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <memory>
+#include <set>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+#include "mws/query/DocumentFilter.hpp"
+#include "mws/types/FormulaPath.hpp"
+#include "mws/types/MwsAnswset.hpp"
+#include "mws/types/Query.hpp"
+
+#include "build-gen/config.h"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Grouping of the occurrences of the formulae matching a query by
+ * the document holding them. The documents are counted by a
+ * DistinctCounter, exactly up to exactMax of them. Only the occurrences of
+ * the documents up to the end of the page are kept, and the data of each
+ * returned document is fetched once. Occurrences without a document are
+ * ignored.
+ */
+class DocumentContext {
+ public:
+    DocumentContext(const types::Query::Options& options,
+                    dbc::DbQueryManager* dbQueryManager,
+                    size_t exactMax = QUERY_DOCUMENTS_EXACT_MAX);
+
+    /// Only group the occurrences in the documents passing filter
+    void setFilter(const DocumentFilter& filter);
+
+    /**
+      * @brief Get the documents holding the formulae, in CrawlId order. Each
+      * answer has the data of its document and lists its occurrences of
+      * the formulae, by formula and then database order.
+      * @param formulaIds formulae matching the query
+      * @param offset is the offset where to start returning documents.
+      * @param size is the maximum number of documents to return.
+      * @param maxTotal is the maximum number of documents to count.
+      * @return an answer set with the corresponding results. Its total is
+      * estimated if there are more than exactMax documents.
+      */
+    MwsAnswset* getResult(const std::set<types::FormulaId>& formulaIds,
+                          unsigned int offset, unsigned int size,
+                          unsigned int maxTotal);
+
+ private:
+    types::Query::Options _options;
+    dbc::DbQueryManager* _dbQueryManager;
+    const size_t _exactMax;
+    /// Documents grouped, all if null
+    std::unique_ptr<DocumentFilter> _filter;
+
+    DISALLOW_COPY_AND_ASSIGN(DocumentContext);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_DOCUMENTCONTEXT_HPP
@@ -0,0 +1,113 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Filter of the documents searched by a query
+  * @file   DocumentFilter.cpp
+  * @date   19 Oct 2026
+  */
+
+#include "mws/query/DocumentFilter.hpp"
+
+namespace mws {
+namespace query {
+
+DocumentFilter::DocumentFilter(const types::Query::Options& options,
+                               const collection_masks_handle_t* masks,
+                               const index_handle_t* index)
+    : _collections(options.collections),
+      _minCrawlId(options.minCrawlId),
+      _maxCrawlId(options.maxCrawlId),
+      _masks(masks),
+      _index(index) {}
+
+bool DocumentFilter::prune(const inode_t* node) const {
+    if (_masks == nullptr) return false;
+    const collection_mask_t* mask =
+        collection_masks_lookup_node(_masks, _index, node);
+    return mask != nullptr && overlap(mask) == NONE;
+}
+
+bool DocumentFilter::accepts(dbc::CrawlId crawlId) const {
+    if (crawlId == dbc::CRAWLID_NULL) return false;
+    if (crawlId < _minCrawlId || crawlId > _maxCrawlId) return false;
+    if (_collections == UINT64_MAX) return true;
+    if (_masks == nullptr) return false;
+
+    int collection = collection_masks_get_collection(_masks, crawlId);
+    return collection >= 0 && ((_collections >> collection) & 1);
+}
+
+unsigned int DocumentFilter::countHits(const leaf_t* leaf,
+                                       dbc::DbQueryManager* dbQueryManager,
+                                       bool any) const {
+    const collection_mask_t* mask = nullptr;
+    if (_masks != nullptr) {
+        mask = collection_masks_lookup_formula(_masks, leaf->formula_id);
+    }
+    if (mask != nullptr) {
+        switch (overlap(mask)) {
+        case NONE:
+            return 0;
+        case FULL:
+            return any ? (mask->num_hits > 0) : mask->num_hits;
+        case PARTIAL:
+            break;
+        }
+    }
+    if (dbQueryManager == nullptr) return 0;
+
+    unsigned int hits = 0;
+    dbQueryManager->queryCrawlIds(leaf->formula_id,
+                                  [&](const dbc::CrawlId& crawlId,
+                                      const types::FormulaPath&) {
+        if (accepts(crawlId)) hits++;
+        return (any && hits > 0) ? 1 : 0;
+    });
+
+    return hits;
+}
+
+dbc::CrawlFilter DocumentFilter::getCrawlFilter() const {
+    const DocumentFilter filter = *this;
+    return [filter](const dbc::CrawlId& crawlId) {
+        return filter.accepts(crawlId);
+    };
+}
+
+bool DocumentFilter::pruneCallback(void* handle, const inode_t* node) {
+    return reinterpret_cast<const DocumentFilter*>(handle)->prune(node);
+}
+
+DocumentFilter::Overlap DocumentFilter::overlap(
+    const collection_mask_t* mask) const {
+    if ((mask->mask & _collections) == 0 || mask->min_crawl > _maxCrawlId ||
+        mask->max_crawl < _minCrawlId || mask->min_crawl > mask->max_crawl) {
+        return NONE;
+    }
+    if ((mask->mask & ~_collections) == 0 && mask->min_crawl >= _minCrawlId &&
+        mask->max_crawl <= _maxCrawlId) {
+        return FULL;
+    }
+    return PARTIAL;
+}
+
+}  // namespace query
+}  // namespace mws
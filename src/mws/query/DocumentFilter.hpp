@@ -0,0 +1,99 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_DOCUMENTFILTER_HPP
+#define _MWS_QUERY_DOCUMENTFILTER_HPP
+
+/**
+  * @brief  Filter of the documents searched by a query
+  * @file   DocumentFilter.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <cstdint>
+
+#include "mws/dbc/DbQueryManager.hpp"
+#include "mws/index/collection_masks.h"
+#include "mws/index/index.h"
+#include "mws/types/Query.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Collections and CrawlId range of the documents searched by a
+ * filtered query. The collection masks of the index, if any, answer for
+ * whole subtrees and formulae; the occurrences of the formulae with
+ * documents both inside and outside the filter are read from the database.
+ * Without collection masks, a query restricted to some collections matches
+ * no document.
+ */
+class DocumentFilter {
+ public:
+    /**
+      * @param masks collection masks of index, or nullptr if it has none.
+      * Both must outlive the filter.
+      */
+    DocumentFilter(const types::Query::Options& options,
+                   const collection_masks_handle_t* masks,
+                   const index_handle_t* index);
+
+    /// @return true if no document holding a formula below node passes
+    bool prune(const inode_t* node) const;
+
+    /// @return true if the document crawlId passes
+    bool accepts(dbc::CrawlId crawlId) const;
+
+    /**
+      * @brief Count the occurrences of a leaf in the documents passing
+      * @param any stop at the first occurrence
+      * @return the number of occurrences, at most 1 if any
+      */
+    unsigned int countHits(const leaf_t* leaf,
+                           dbc::DbQueryManager* dbQueryManager,
+                           bool any) const;
+
+    /// @return filter of the occurrences read by DbQueryManager::query
+    dbc::CrawlFilter getCrawlFilter() const;
+
+    /// Prune callback of the query engine, handle is the DocumentFilter
+    static bool pruneCallback(void* handle, const inode_t* node);
+
+ private:
+    enum Overlap {
+        NONE,
+        PARTIAL,
+        FULL,
+    };
+
+    /// @return how much of the documents of mask pass
+    Overlap overlap(const collection_mask_t* mask) const;
+
+    uint64_t _collections;
+    uint32_t _minCrawlId;
+    uint32_t _maxCrawlId;
+    const collection_masks_handle_t* _masks;
+    const index_handle_t* _index;
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_DOCUMENTFILTER_HPP
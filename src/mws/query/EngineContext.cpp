@@ -0,0 +1,1011 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Query of a compressed index using the C query engine
+  * @file   EngineContext.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+using std::vector;
+
+#include "common/thread/WorkerPool.hpp"
+using common::thread::WorkerPool;
+#include "mws/dbc/CrawlDb.hpp"
+using mws::dbc::CrawlData;
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/formula_store.h"
+#include "mws/index/subtree_bounds.h"
+#include "mws/index/token_postings.h"
+#include "mws/query/engine.h"
+#include "mws/query/LeafScorer.hpp"
+#include "mws/query/NumericConstants.hpp"
+#include "mws/query/SearchBudget.hpp"
+#include "mws/types/FormulaPath.hpp"
+using mws::types::FormulaId;
+using mws::types::FormulaPath;
+#include "mws/query/EngineContext.hpp"
+
+namespace mws {
+namespace query {
+
+namespace {
+
+/// Subterm matched by each named qvar of the query
+typedef vector<vector<encoded_token_t>> Substitutions;
+
+struct EngineQuery {
+    const EngineContext::RangeBounds* rangeBounds;
+    const NumericConstants* numbers;
+    const types::Query::Options* options;
+    /// Documents searched, all if null
+    const DocumentFilter* filter;
+    DbQueryManager* dbQueryManager;
+    MwsAnswset* result;
+    unsigned int offset;
+    unsigned int size;
+    unsigned int maxTotal;
+    /// # of found matches
+    unsigned int found;
+    /// Var ids of the named qvars, empty unless substitutions are requested
+    const vector<uint32_t>* qvarIds;
+    /// Cursor of the reported leaf, to read its substitutions from. If null,
+    /// they are given by substitutions.
+    query_cursor_t* cursor;
+    Substitutions substitutions;
+};
+
+/// Read the substitutions of the last leaf reported by cursor
+void readSubstitutions(query_cursor_t* cursor,
+                       const vector<uint32_t>& qvarIds,
+                       Substitutions* substitutions) {
+    substitutions->resize(qvarIds.size());
+    for (size_t i = 0; i < qvarIds.size(); i++) {
+        const encoded_token_t* tokens = nullptr;
+        uint32_t size =
+            query_cursor_get_instantiation(cursor, qvarIds[i], &tokens);
+        (*substitutions)[i].assign(tokens, tokens + size);
+    }
+}
+
+bool rangeCallback(void* handle, encoded_token_t range,
+                   encoded_token_t token) {
+    const EngineQuery* query = reinterpret_cast<EngineQuery*>(handle);
+    auto it = query->rangeBounds->find(range.id);
+    if (it == query->rangeBounds->end()) return false;
+
+    return query->numbers->isInRange(token, it->second);
+}
+
+/// @return the solutions of leaf counted by the query, 0 if the filter of
+/// the query rejects all of its occurrences
+unsigned int countSolutions(const EngineQuery* query, const leaf_t* leaf) {
+    const bool includeHits = query->options->includeHits;
+    if (query->filter == nullptr) return includeHits ? leaf->num_hits : 1;
+
+    return query->filter->countHits(leaf, query->dbQueryManager, !includeHits);
+}
+
+/// Fetch the answers [offset, offset + size) of a formula passing the
+/// filter of the query
+void queryAnswers(const EngineQuery* query, DbQueryManager* dbQueryManager,
+                  FormulaId formulaId, unsigned int offset, unsigned int size,
+                  dbc::DbAnswerCallback dbAnswerCallback) {
+    if (query->filter == nullptr) {
+        dbQueryManager->query(formulaId, offset, size, dbAnswerCallback,
+                              query->options->profile);
+    } else {
+        dbQueryManager->query(formulaId, offset, size, dbAnswerCallback,
+                              query->filter->getCrawlFilter(),
+                              query->options->profile);
+    }
+}
+
+/// Add the work of cursors to profile, if not null
+void addStats(const query_stats_t& stats, types::QueryProfile* profile) {
+    if (profile == nullptr) return;
+    profile->nodesVisited += stats.visited;
+    profile->childLookups += stats.child_lookups;
+    profile->rangeRejects += stats.range_rejects;
+    for (uint32_t varId = 0; varId <= VAR_ID_MAX; varId++) {
+        profile->backtracks[varId] += stats.backtracks[varId];
+    }
+}
+
+/**
+ * @brief Add the work of cursor to profile, if not null
+ * @param reported if not null, the work already reported, which is skipped
+ * and then updated
+ */
+void profileCursor(const query_cursor_t* cursor, types::QueryProfile* profile,
+                   query_stats_t* reported = nullptr) {
+    if (profile == nullptr || cursor == nullptr) return;
+    query_stats_t stats = query_stats_t();
+    query_cursor_add_stats(cursor, &stats);
+    query_stats_t delta = stats;
+    if (reported != nullptr) {
+        delta.visited -= reported->visited;
+        delta.child_lookups -= reported->child_lookups;
+        delta.range_rejects -= reported->range_rejects;
+        for (uint32_t varId = 0; varId <= VAR_ID_MAX; varId++) {
+            delta.backtracks[varId] -= reported->backtracks[varId];
+        }
+        *reported = stats;
+    }
+    addStats(delta, profile);
+}
+
+// Same accounting as the solution handling of SearchContext::getResult
+result_cb_return_t resultCallback(void* handle, const leaf_t* leaf) {
+    assert(leaf->type == LEAF_NODE);
+    EngineQuery* query = reinterpret_cast<EngineQuery*>(handle);
+    MwsAnswset* result = query->result;
+    const unsigned int offset = query->offset;
+    const unsigned int size = query->size;
+    unsigned int hitsCount = countSolutions(query, leaf);
+    if (hitsCount == 0 && query->filter != nullptr) return QUERY_CONTINUE;
+
+    if (query->found < size + offset && query->found + hitsCount > offset) {
+        if (query->options->includeHits) {
+            unsigned dbOffset;
+            unsigned dbMaxSize;
+            if (offset < query->found) {
+                dbOffset = 0;
+                dbMaxSize = size + offset - query->found;
+            } else {
+                dbOffset = offset - query->found;
+                dbMaxSize = size;
+            }
+            if (query->cursor != nullptr && !query->qvarIds->empty()) {
+                readSubstitutions(query->cursor, *query->qvarIds,
+                                  &query->substitutions);
+            }
+
+            queryAnswers(
+                query, query->dbQueryManager, (FormulaId)leaf->formula_id,
+                dbOffset, dbMaxSize,
+                [query, result](const FormulaPath& formulaPath,
+                                const CrawlData& crawlData) {
+                    auto answer = new mws::types::Answer();
+                    answer->data = crawlData;
+                    answer->uri = formulaPath.xmlId;
+                    answer->xpath = formulaPath.xpath;
+                    answer->substitutions = query->substitutions;
+                    result->answers.push_back(answer);
+                    return 0;
+                });
+        }
+        if (query->options->includeMwsIds) {
+            result->ids.insert(leaf->formula_id);
+        }
+    }
+
+    query->found += hitsCount;
+
+    // making sure we haven't surpassed maxTotal
+    if (query->found >= query->maxTotal) {
+        query->found = query->maxTotal;
+        return QUERY_STOP;
+    }
+
+    return QUERY_CONTINUE;
+}
+
+/**
+ * @brief Create a cursor over the solutions of the query, limited by budget.
+ * The numCursors cursors of a parallel search share its node budget.
+ * @return the cursor or nullptr on allocation failure
+ */
+query_cursor_t* createCursor(index_handle_t* index, encoded_formula_t* formula,
+                             EngineQuery* query, const SearchBudget& budget,
+                             unsigned int numCursors = 1) {
+    query_cursor_t* cursor =
+        query_cursor_create(index, formula, rangeCallback, query);
+    if (cursor == nullptr) return nullptr;
+
+    uint64_t maxNodes = budget.maxNodes();
+    if (maxNodes > 0) maxNodes = std::max<uint64_t>(maxNodes / numCursors, 1);
+    query_cursor_set_limits(cursor, maxNodes, SearchBudget::stopCallback,
+                            const_cast<SearchBudget*>(&budget));
+    if (query->filter != nullptr) {
+        query_cursor_set_prune(cursor, DocumentFilter::pruneCallback,
+                               const_cast<DocumentFilter*>(query->filter));
+    }
+
+    return cursor;
+}
+
+/// Leaf found under a branch of the split node
+struct BranchLeaf {
+    uint32_t branch;
+    const leaf_t* leaf;
+    Substitutions substitutions;
+};
+
+/**
+ * @brief Claim a branch of the split node for the calling cursor. Cursors
+ * visit the same branches in increasing order, so a branch is free iff no
+ * cursor claimed it or a later one.
+ */
+bool splitCallback(void* handle, uint32_t branch) {
+    auto nextFree = reinterpret_cast<std::atomic<uint32_t>*>(handle);
+    uint32_t free = nextFree->load();
+    while (free <= branch) {
+        if (nextFree->compare_exchange_weak(free, branch + 1)) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Collect the leaves of the branches claimed by a cursor, stopping
+ * after maxTotal hits: later leaves of the cursor can not be among the first
+ * maxTotal hits of the query.
+ * @param stats the work of the cursor is added to
+ * @return true if the cursor stopped at the limits of the budget
+ */
+bool collectLeaves(index_handle_t* index, encoded_formula_t* formula,
+                   EngineQuery* query, const SearchBudget& budget,
+                   unsigned int numCursors, std::atomic<uint32_t>* nextFree,
+                   vector<BranchLeaf>* leaves, query_stats_t* stats) {
+    query_cursor_t* cursor =
+        createCursor(index, formula, query, budget, numCursors);
+    if (cursor == nullptr) return false;
+    query_cursor_set_split(cursor, splitCallback, nextFree);
+
+    const leaf_t* leaf;
+    unsigned int found = 0;
+    int ret = QUERY_CONTINUE;
+    while (found < query->maxTotal &&
+           (ret = query_cursor_next(cursor, &leaf)) == QUERY_CONTINUE) {
+        unsigned int hitsCount = countSolutions(query, leaf);
+        if (hitsCount == 0 && query->filter != nullptr) continue;
+        leaves->push_back({query_cursor_get_branch(cursor), leaf, {}});
+        if (!query->qvarIds->empty()) {
+            readSubstitutions(cursor, *query->qvarIds,
+                              &leaves->back().substitutions);
+        }
+        found += hitsCount;
+    }
+    query_cursor_add_stats(cursor, stats);
+    query_cursor_destroy(cursor);
+
+    return ret == QUERY_LIMIT;
+}
+
+/// Report the leaves of all tasks in branch order, as a serial search would
+void mergeLeaves(const vector<vector<BranchLeaf>>& taskLeaves,
+                 EngineQuery* query) {
+    vector<size_t> next(taskLeaves.size(), 0);
+    for (;;) {
+        // task with the lowest pending branch
+        size_t task = taskLeaves.size();
+        for (size_t i = 0; i < taskLeaves.size(); i++) {
+            if (next[i] == taskLeaves[i].size()) continue;
+            if (task == taskLeaves.size() ||
+                taskLeaves[i][next[i]].branch <
+                    taskLeaves[task][next[task]].branch) {
+                task = i;
+            }
+        }
+        if (task == taskLeaves.size()) return;
+
+        // a branch is explored by a single task
+        const vector<BranchLeaf>& leaves = taskLeaves[task];
+        uint32_t branch = leaves[next[task]].branch;
+        while (next[task] < leaves.size() &&
+               leaves[next[task]].branch == branch) {
+            query->substitutions = leaves[next[task]].substitutions;
+            if (resultCallback(query, leaves[next[task]].leaf) !=
+                QUERY_CONTINUE) {
+                return;
+            }
+            next[task]++;
+        }
+    }
+}
+
+struct RankedLeaf {
+    double score;
+    /// position in index order
+    uint64_t position;
+    const leaf_t* leaf;
+    Substitutions substitutions;
+    /// solutions of the leaf counted by the query
+    unsigned int hits;
+};
+
+/// Order of the ranking: decreasing score, then index order
+bool rankedBefore(const RankedLeaf& l1, const RankedLeaf& l2) {
+    return (l1.score > l2.score ||
+            (l1.score == l2.score && l1.position < l2.position));
+}
+
+/**
+ * @brief Bounded heap of the best leaves, worst on top. It keeps the fewest
+ * leaves whose hits cover the first `needed` hits of the ranking.
+ */
+struct RankedQuery {
+    const LeafScorer* scorer;
+    const subtree_bounds_handle_t* bounds;
+    index_handle_t* index;
+    /// Documents searched, all if null
+    const DocumentFilter* filter;
+    unsigned int needed;
+    vector<RankedLeaf> heap;
+    unsigned int heapHits;
+
+    /// @return true if leaves ranked after the top of the heap are useless
+    bool isFull() const {
+        return heapHits >= needed;
+    }
+
+    void add(RankedLeaf&& rankedLeaf) {
+        if (isFull() &&
+            (heap.empty() || !rankedBefore(rankedLeaf, heap.front()))) {
+            return;
+        }
+        heapHits += rankedLeaf.hits;
+        heap.push_back(std::move(rankedLeaf));
+        std::push_heap(heap.begin(), heap.end(), rankedBefore);
+        while (heapHits - heap.front().hits >= needed) {
+            heapHits -= heap.front().hits;
+            std::pop_heap(heap.begin(), heap.end(), rankedBefore);
+            heap.pop_back();
+            if (heap.empty()) break;
+        }
+    }
+};
+
+// Skip the subtrees whose leaves would all be ranked after the heap top
+bool pruneCallback(void* handle, const inode_t* node) {
+    const RankedQuery* query = reinterpret_cast<RankedQuery*>(handle);
+    if (query->filter != nullptr && query->filter->prune(node)) return true;
+    if (!query->isFull()) return false;
+    if (query->heap.empty()) return true;
+
+    const subtree_bounds_entry_t* bounds =
+        subtree_bounds_lookup(query->bounds, query->index, node);
+    if (bounds == nullptr) return false;
+
+    // leaves below come later in index order and lose ties
+    return query->scorer->bound(bounds) <= query->heap.front().score;
+}
+
+/**
+ * Stop intersecting the posting lists once the next one is this many times
+ * longer than the candidates: verifying them is cheaper than decoding it.
+ */
+const uint64_t POSTINGS_MAX_RATIO = 16;
+
+/**
+ * @brief Intersect the posting lists of keys, shortest first
+ * @return offsets of the candidate leaves, in index order
+ */
+vector<memsector_long_off_t> intersectPostings(
+    const token_postings_handle_t* postings, const vector<uint64_t>& keys) {
+    vector<const token_postings_entry_t*> entries;
+    for (uint64_t key : keys) {
+        const token_postings_entry_t* entry =
+            token_postings_lookup(postings, key);
+        if (entry == nullptr) return vector<memsector_long_off_t>();
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const token_postings_entry_t* e1,
+                 const token_postings_entry_t* e2) {
+        return e1->count < e2->count;
+    });
+
+    vector<memsector_long_off_t> candidates(entries[0]->count);
+    vector<memsector_long_off_t> leafOffs;
+    token_postings_decode(postings, entries[0], candidates.data());
+    for (size_t i = 1; i < entries.size() && !candidates.empty(); i++) {
+        if (entries[i]->count > POSTINGS_MAX_RATIO * candidates.size()) break;
+        leafOffs.resize(entries[i]->count);
+        token_postings_decode(postings, entries[i], leafOffs.data());
+        auto end = std::set_intersection(candidates.begin(), candidates.end(),
+                                         leafOffs.begin(), leafOffs.end(),
+                                         candidates.begin());
+        candidates.erase(end, candidates.end());
+    }
+
+    return candidates;
+}
+
+/// @return index after the subterm of formula starting at begin
+uint32_t subtermEnd(encoded_formula_t formula, uint32_t begin) {
+    uint32_t arity = 1;
+    uint32_t end = begin;
+    while (arity > 0 && end < formula.size) {
+        arity += formula.data[end].arity;
+        arity--;
+        end++;
+    }
+    return end;
+}
+
+bool sameToken(encoded_token_t t1, encoded_token_t t2) {
+    return t1.id == t2.id && t1.arity == t2.arity;
+}
+
+/**
+ * @brief Unify a query with an indexed formula without variables, as the
+ * query engine would. The substitutions of query are set on success.
+ */
+bool matchFormula(EngineQuery* query, const vector<encoded_token_t>& tokens,
+                  encoded_formula_t formula) {
+    // subterm of formula bound to each variable, [begin, end)
+    vector<std::pair<uint32_t, uint32_t>> vars(VAR_ID_MAX + 1, {0, 0});
+    uint32_t pos = 0;
+
+    for (encoded_token_t token : tokens) {
+        if (pos >= formula.size) return false;
+        encoded_token_t indexed = formula.data[pos];
+        if (encoded_token_is_range(token)) {
+            if (indexed.arity != 0 || encoded_token_is_var(indexed) ||
+                !rangeCallback(query, token, indexed)) {
+                return false;
+            }
+            pos++;
+        } else if (encoded_token_is_var(token)) {
+            uint32_t end = subtermEnd(formula, pos);
+            std::pair<uint32_t, uint32_t>& var = vars[token.id];
+            if (var.first == var.second) {
+                var = {pos, end};
+            } else if (end - pos != var.second - var.first ||
+                       !std::equal(formula.data + pos, formula.data + end,
+                                   formula.data + var.first, sameToken)) {
+                return false;
+            }
+            pos = end;
+        } else {
+            if (!sameToken(token, indexed)) return false;
+            pos++;
+        }
+    }
+    if (pos != formula.size) return false;
+
+    query->substitutions.resize(query->qvarIds->size());
+    for (size_t i = 0; i < query->qvarIds->size(); i++) {
+        const std::pair<uint32_t, uint32_t>& var = vars[(*query->qvarIds)[i]];
+        query->substitutions[i].assign(formula.data + var.first,
+                                       formula.data + var.second);
+    }
+
+    return true;
+}
+
+}  // namespace
+
+struct PagedSearch::State {
+    EngineContext::RangeBounds rangeBounds;
+    types::Query::Options options;
+    vector<uint32_t> qvarIds;
+    std::unique_ptr<DocumentFilter> filter;
+    EngineQuery query;
+    query_cursor_t* cursor;
+    /// leaf of the next solutions, number of its solutions and number of
+    /// them already paged
+    const leaf_t* leaf;
+    unsigned int leafHits;
+    unsigned int leafOffset;
+    /// number of solutions paged or skipped
+    unsigned int position;
+    unsigned int maxTotal;
+    /// total of the first page, if counted up to maxTotal, and its bounds
+    /// if estimated
+    unsigned int total;
+    bool estimated;
+    int totalLow;
+    int totalHigh;
+    bool counted;
+    /// work of the cursor already added to the profile of the options
+    query_stats_t profiled;
+
+    State()
+        : cursor(nullptr),
+          leaf(nullptr),
+          leafHits(0),
+          leafOffset(0),
+          position(0),
+          maxTotal(0),
+          total(0),
+          estimated(false),
+          totalLow(0),
+          totalHigh(0),
+          counted(false),
+          profiled() {}
+
+    ~State() { query_cursor_destroy(cursor); }
+};
+
+PagedSearch::PagedSearch(State* state) : _state(state) {}
+
+PagedSearch::~PagedSearch() {}
+
+unsigned int PagedSearch::position() const { return _state->position; }
+
+namespace {
+
+/**
+ * @brief Advance a paused search by size solutions, adding them to result
+ * unless they are skipped. Leaves are split across pages by hit.
+ * @return QUERY_CONTINUE if a solution follows, QUERY_STOP at the end of the
+ * results or the cursor error
+ */
+int advance(PagedSearch::State* state, DbQueryManager* dbQueryManager,
+            MwsAnswset* result, unsigned int size, bool skip) {
+    const bool includeHits = state->options.includeHits;
+    size = std::min(size, state->maxTotal - state->position);
+
+    for (;;) {
+        if (state->position >= state->maxTotal) return QUERY_STOP;
+        if (state->leaf == nullptr) {
+            int ret = query_cursor_next(state->cursor, &state->leaf);
+            if (ret != QUERY_CONTINUE) {
+                state->leaf = nullptr;
+                return ret;
+            }
+            state->leafOffset = 0;
+            state->leafHits = countSolutions(&state->query, state->leaf);
+            if (state->leafHits == 0) {
+                state->leaf = nullptr;
+                continue;
+            }
+        }
+        if (size == 0) return QUERY_CONTINUE;
+
+        const leaf_t* leaf = state->leaf;
+        const unsigned int hitsCount = state->leafHits;
+        unsigned int taken = std::min(hitsCount - state->leafOffset, size);
+        if (!skip && taken > 0) {
+            if (includeHits) {
+                Substitutions substitutions;
+                readSubstitutions(state->cursor, state->qvarIds,
+                                  &substitutions);
+                queryAnswers(
+                    &state->query, dbQueryManager,
+                    (FormulaId)leaf->formula_id, state->leafOffset, taken,
+                    [result, &substitutions](const FormulaPath& formulaPath,
+                                             const CrawlData& crawlData) {
+                        auto answer = new mws::types::Answer();
+                        answer->data = crawlData;
+                        answer->uri = formulaPath.xmlId;
+                        answer->xpath = formulaPath.xpath;
+                        answer->substitutions = substitutions;
+                        result->answers.push_back(answer);
+                        return 0;
+                    });
+            }
+            if (state->options.includeMwsIds) {
+                result->ids.insert(leaf->formula_id);
+            }
+        }
+        state->leafOffset += taken;
+        state->position += taken;
+        size -= taken;
+        if (state->leafOffset == hitsCount) state->leaf = nullptr;
+    }
+}
+
+/// Limit the cursor of a paused search to the budget of the current page
+void setPageLimits(PagedSearch::State* state, const SearchBudget& budget) {
+    uint64_t maxNodes = budget.maxNodes();
+    if (maxNodes > 0) maxNodes += query_cursor_get_visited(state->cursor);
+    query_cursor_set_limits(state->cursor, maxNodes,
+                            SearchBudget::stopCallback,
+                            const_cast<SearchBudget*>(&budget));
+}
+
+}  // namespace
+
+EngineContext::EngineContext(const vector<encoded_token_t>& encodedFormula,
+                             const types::Query::Options& options,
+                             const RangeBounds& rangeBounds,
+                             const NumericConstants* numbers)
+    : _encodedFormula(encodedFormula),
+      _options(options),
+      _rangeBounds(rangeBounds),
+      _numbers(numbers != nullptr ? numbers : &NumericConstants::EMPTY) {
+    if (_options.includeSubstitutions) {
+        for (encoded_token_t token : _encodedFormula) {
+            if (encoded_token_is_var(token) &&
+                !encoded_token_is_anon_var(token)) {
+                _qvarIds.push_back(token.id);
+            }
+        }
+    }
+}
+
+void EngineContext::setFilter(const DocumentFilter& filter) {
+    _filter.reset(new DocumentFilter(filter));
+}
+
+MwsAnswset* EngineContext::getResult(index_handle_t* index,
+                                     DbQueryManager* dbQueryManager,
+                                     unsigned int offset, unsigned int size,
+                                     unsigned int maxTotal, WorkerPool* pool,
+                                     unsigned int parallelism) {
+    auto startTime = SearchContext::Time::now();
+    SearchBudget budget(_options);
+    auto result = new MwsAnswset();
+
+    // Checking the arguments
+    if (offset + size > maxTotal) {
+        if (maxTotal <= offset) {
+            size = 0;
+        } else {
+            size = maxTotal - offset;
+        }
+    }
+
+    // with an estimated total, count a single solution past the page. The
+    // samples do not unify the query with hvars, so their indexes are
+    // counted exactly.
+    const unsigned int requestedTotal = maxTotal;
+    if (_options.estimateTotal && _filter == nullptr &&
+        !inode_has_hvars((const inode_t*)index->root) &&
+        offset + size < maxTotal) {
+        maxTotal = offset + size + 1;
+    }
+
+    if (maxTotal > 0) {
+        EngineQuery query;
+        query.rangeBounds = &_rangeBounds;
+        query.numbers = _numbers;
+        query.options = &_options;
+        query.filter = _filter.get();
+        query.dbQueryManager = dbQueryManager;
+        query.result = result;
+        query.offset = offset;
+        query.size = size;
+        query.maxTotal = maxTotal;
+        query.found = 0;
+        query.qvarIds = &_qvarIds;
+        query.cursor = nullptr;
+
+        encoded_formula_t encodedFormula;
+        encodedFormula.data = _encodedFormula.data();
+        encodedFormula.size = _encodedFormula.size();
+
+        if (pool != nullptr && parallelism > 1) {
+            std::atomic<uint32_t> nextFree(0);
+            std::atomic<bool> limited(false);
+            vector<vector<BranchLeaf>> taskLeaves(parallelism);
+            vector<query_stats_t> taskStats(parallelism, query_stats_t());
+            pool->run(parallelism, [&](unsigned task) {
+                if (collectLeaves(index, &encodedFormula, &query, budget,
+                                  parallelism, &nextFree, &taskLeaves[task],
+                                  &taskStats[task])) {
+                    limited = true;
+                }
+            });
+            for (const query_stats_t& stats : taskStats) {
+                addStats(stats, _options.profile);
+            }
+            mergeLeaves(taskLeaves, &query);
+            result->partial = limited;
+        } else {
+            query_cursor_t* cursor =
+                createCursor(index, &encodedFormula, &query, budget);
+            if (cursor != nullptr) {
+                const leaf_t* leaf;
+                int ret;
+                query.cursor = cursor;
+                while ((ret = query_cursor_next(cursor, &leaf)) ==
+                           QUERY_CONTINUE &&
+                       resultCallback(&query, leaf) == QUERY_CONTINUE) {
+                }
+                result->partial = (ret == QUERY_LIMIT);
+                profileCursor(cursor, _options.profile);
+                query_cursor_destroy(cursor);
+            }
+        }
+        result->total = query.found;
+        if (query.found >= maxTotal && maxTotal < requestedTotal &&
+            !result->partial) {
+            SearchContext ctxt(_encodedFormula, _options, _rangeBounds,
+                               _numbers);
+            ctxt.estimateTotal<IndexAccessor>(index, query.found, result);
+        }
+    }
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+MwsAnswset* EngineContext::getFirstPage(index_handle_t* index,
+                                        DbQueryManager* dbQueryManager,
+                                        unsigned int offset, unsigned int size,
+                                        unsigned int maxTotal, bool countTotal,
+                                        std::unique_ptr<PagedSearch>* search) {
+    auto startTime = SearchContext::Time::now();
+    SearchBudget budget(_options);
+    auto result = new MwsAnswset();
+    search->reset();
+
+    std::unique_ptr<PagedSearch::State> state(new PagedSearch::State());
+    state->rangeBounds = _rangeBounds;
+    state->options = _options;
+    state->query.rangeBounds = &state->rangeBounds;
+    state->query.numbers = _numbers;
+    state->query.options = &state->options;
+    if (_filter != nullptr) state->filter.reset(new DocumentFilter(*_filter));
+    state->query.filter = state->filter.get();
+    state->query.dbQueryManager = dbQueryManager;
+    state->query.result = nullptr;
+    state->qvarIds = _qvarIds;
+    state->query.qvarIds = &state->qvarIds;
+    state->query.cursor = nullptr;
+    state->maxTotal = maxTotal;
+
+    encoded_formula_t encodedFormula;
+    encodedFormula.data = _encodedFormula.data();
+    encodedFormula.size = _encodedFormula.size();
+    state->cursor =
+        createCursor(index, &encodedFormula, &state->query, budget);
+
+    if (state->cursor != nullptr) {
+        int ret = advance(state.get(), dbQueryManager, result, offset, true);
+        if (ret == QUERY_CONTINUE) {
+            ret = advance(state.get(), dbQueryManager, result, size, false);
+        }
+        query_cursor_set_limits(state->cursor, 0, nullptr, nullptr);
+        result->partial = (ret == QUERY_LIMIT);
+        profileCursor(state->cursor, _options.profile, &state->profiled);
+
+        if (countTotal) {
+            std::unique_ptr<MwsAnswset> counted(
+                getResult(index, dbQueryManager, 0, 0, maxTotal));
+            result->total = counted->total;
+            result->estimated = counted->estimated;
+            result->totalLow = counted->totalLow;
+            result->totalHigh = counted->totalHigh;
+            result->partial |= counted->partial;
+            state->total = counted->total;
+            state->estimated = counted->estimated;
+            state->totalLow = counted->totalLow;
+            state->totalHigh = counted->totalHigh;
+            state->counted = true;
+        } else {
+            result->total = state->position;
+        }
+
+        if (ret == QUERY_CONTINUE && !result->partial) {
+            search->reset(new PagedSearch(state.release()));
+        }
+    }
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+MwsAnswset* EngineContext::getNextPage(std::unique_ptr<PagedSearch>* search,
+                                       DbQueryManager* dbQueryManager,
+                                       unsigned int size) {
+    auto startTime = SearchContext::Time::now();
+    SearchBudget budget(_options);
+    auto result = new MwsAnswset();
+    PagedSearch::State* state = (*search)->_state.get();
+
+    // the profile of the first page belongs to its query
+    state->options.profile = _options.profile;
+    setPageLimits(state, budget);
+    int ret = advance(state, dbQueryManager, result, size, false);
+    query_cursor_set_limits(state->cursor, 0, nullptr, nullptr);
+    result->partial = (ret == QUERY_LIMIT);
+    profileCursor(state->cursor, _options.profile, &state->profiled);
+    if (state->counted) {
+        result->total = state->total;
+        result->estimated = state->estimated;
+        result->totalLow = state->totalLow;
+        result->totalHigh = state->totalHigh;
+    } else {
+        result->total = state->position;
+    }
+    if (ret != QUERY_CONTINUE) search->reset();
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+MwsAnswset* EngineContext::getPostingsResult(
+    index_handle_t* index, DbQueryManager* dbQueryManager,
+    const token_postings_handle_t* postings,
+    const formula_store_handle_t* formulaStore, unsigned int offset,
+    unsigned int size, unsigned int maxTotal) {
+    vector<uint64_t> keys(2 * _encodedFormula.size() + 1);
+    int numKeys = token_postings_formula_keys(
+        _encodedFormula.data(), _encodedFormula.size(), keys.data());
+    if (numKeys <= 0) {
+        return getResult(index, dbQueryManager, offset, size, maxTotal);
+    }
+    keys.resize(numKeys);
+
+    auto startTime = SearchContext::Time::now();
+    SearchBudget budget(_options);
+    auto result = new MwsAnswset();
+
+    // Checking the arguments
+    if (offset + size > maxTotal) {
+        if (maxTotal <= offset) {
+            size = 0;
+        } else {
+            size = maxTotal - offset;
+        }
+    }
+
+    if (maxTotal > 0) {
+        EngineQuery query;
+        query.rangeBounds = &_rangeBounds;
+        query.numbers = _numbers;
+        query.options = &_options;
+        query.filter = _filter.get();
+        query.dbQueryManager = dbQueryManager;
+        query.result = result;
+        query.offset = offset;
+        query.size = size;
+        query.maxTotal = maxTotal;
+        query.found = 0;
+        query.qvarIds = &_qvarIds;
+        query.cursor = nullptr;
+
+        // leaves are stored in index order, which is the engine's
+        uint64_t checked = 0;
+        for (memsector_long_off_t leafOff : intersectPostings(postings, keys)) {
+            if (budget.exceeded(++checked)) {
+                result->partial = true;
+                break;
+            }
+            const leaf_t* leaf = reinterpret_cast<const leaf_t*>(
+                memsector_off2addr(index->ms, leafOff));
+            assert(leaf->type == LEAF_NODE);
+            if (!matchFormula(&query, _encodedFormula,
+                              formula_store_get(formulaStore,
+                                                leaf->formula_id))) {
+                continue;
+            }
+            if (resultCallback(&query, leaf) != QUERY_CONTINUE) break;
+        }
+        // each candidate leaf is visited once
+        if (_options.profile != nullptr) {
+            _options.profile->nodesVisited += checked;
+        }
+        result->total = query.found;
+    }
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+MwsAnswset* EngineContext::getRankedResult(
+    index_handle_t* index, DbQueryManager* dbQueryManager,
+    const LeafScorer& scorer, const subtree_bounds_handle_t* bounds,
+    unsigned int offset, unsigned int size, unsigned int maxTotal) {
+    auto startTime = SearchContext::Time::now();
+    SearchBudget budget(_options);
+    auto result = new MwsAnswset();
+
+    // Checking the arguments
+    if (offset + size > maxTotal) {
+        if (maxTotal <= offset) {
+            size = 0;
+        } else {
+            size = maxTotal - offset;
+        }
+    }
+
+    encoded_formula_t encodedFormula;
+    encodedFormula.data = _encodedFormula.data();
+    encodedFormula.size = _encodedFormula.size();
+
+    EngineQuery query;
+    query.rangeBounds = &_rangeBounds;
+    query.numbers = _numbers;
+    query.options = &_options;
+    query.filter = _filter.get();
+    query.dbQueryManager = dbQueryManager;
+    query.result = result;
+    query.offset = offset;
+    query.size = size;
+    query.maxTotal = offset + size;
+    query.found = 0;
+    query.qvarIds = &_qvarIds;
+    query.cursor = nullptr;
+
+    RankedQuery ranked;
+    ranked.scorer = &scorer;
+    ranked.bounds = bounds;
+    ranked.index = index;
+    ranked.filter = _filter.get();
+    ranked.needed = offset + size;
+    ranked.heapHits = 0;
+
+    query_cursor_t* cursor = nullptr;
+    if (maxTotal > 0) {
+        cursor = createCursor(index, &encodedFormula, &query, budget);
+    }
+    if (cursor != nullptr) {
+        if (bounds != nullptr) {
+            // also prunes the subtrees rejected by the filter
+            query_cursor_set_prune(cursor, pruneCallback, &ranked);
+        }
+
+        const leaf_t* leaf;
+        uint64_t position = 0;
+        unsigned int found = 0;
+        int ret = QUERY_CONTINUE;
+        while (found < maxTotal &&
+               (ret = query_cursor_next(cursor, &leaf)) == QUERY_CONTINUE) {
+            unsigned int hitsCount = countSolutions(&query, leaf);
+            if (hitsCount == 0 && _filter != nullptr) continue;
+            RankedLeaf rankedLeaf = {
+                scorer.score(leaf, query_cursor_get_depth(cursor)), position++,
+                leaf, {}, hitsCount};
+            if (!_qvarIds.empty()) {
+                readSubstitutions(cursor, _qvarIds, &rankedLeaf.substitutions);
+            }
+            ranked.add(std::move(rankedLeaf));
+            found += hitsCount;
+        }
+        profileCursor(cursor, _options.profile);
+        query_cursor_destroy(cursor);
+        result->total = std::min(found, maxTotal);
+        // the page ranks the solutions found before the limits only
+        result->partial = (ret == QUERY_LIMIT);
+
+        // fetch the answers of the page only
+        std::sort(ranked.heap.begin(), ranked.heap.end(), rankedBefore);
+        for (const RankedLeaf& rankedLeaf : ranked.heap) {
+            query.substitutions = rankedLeaf.substitutions;
+            if (resultCallback(&query, rankedLeaf.leaf) != QUERY_CONTINUE) {
+                break;
+            }
+        }
+    }
+
+    auto elapsedTime = std::chrono::duration_cast<SearchContext::ms>(
+        SearchContext::Time::now() - startTime);
+    result->time = elapsedTime.count();
+
+    return result;
+}
+
+}  // namespace query
+}  // namespace mws
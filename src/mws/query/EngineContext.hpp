@@ -0,0 +1,199 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_ENGINECONTEXT_HPP
+#define _MWS_QUERY_ENGINECONTEXT_HPP
+
+/**
+  * @brief  Query of a compressed index using the C query engine
+  * @file   EngineContext.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <memory>
+#include <vector>
+
+#include "common/thread/WorkerPool.hpp"
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+#include "mws/index/encoded_token.h"
+#include "mws/index/formula_store.h"
+#include "mws/index/index.h"
+#include "mws/index/subtree_bounds.h"
+#include "mws/index/token_postings.h"
+#include "mws/query/DocumentFilter.hpp"
+#include "mws/query/LeafScorer.hpp"
+#include "mws/query/NumericConstants.hpp"
+#include "mws/query/SearchContext.hpp"
+#include "mws/types/MwsAnswset.hpp"
+#include "mws/types/Query.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Search of a paginated query, paused after a page. The next page
+ * resumes it instead of enumerating the previous pages again. The index
+ * must outlive it.
+ */
+class PagedSearch {
+ public:
+    /// Opaque state of the search
+    struct State;
+
+    explicit PagedSearch(State* state);
+    ~PagedSearch();
+
+    /// @return offset of the next page in the results
+    unsigned int position() const;
+
+ private:
+    std::unique_ptr<State> _state;
+    friend class EngineContext;
+
+    DISALLOW_COPY_AND_ASSIGN(PagedSearch);
+};
+
+/**
+ * @brief Drop-in replacement of SearchContext on a compressed index, running
+ * the query through the cursors of the query engine. Unlike SearchContext,
+ * it also unifies query variables with index hvars. Like SearchContext, it
+ * stops at the deadline and node budget of the query options and returns
+ * the solutions found until then as a partial answer set.
+ */
+class EngineContext {
+ public:
+    typedef SearchContext::RangeBounds RangeBounds;
+
+    EngineContext(const std::vector<encoded_token_t>& encodedFormula,
+                  const types::Query::Options& options,
+                  const RangeBounds& rangeBounds = RangeBounds(),
+                  const NumericConstants* numbers = nullptr);
+
+    /**
+      * @brief Only search the occurrences in the documents passing filter.
+      * Subtrees without such documents are skipped, and totals and pages
+      * count the remaining occurrences. Totals are not estimated.
+      */
+    void setFilter(const DocumentFilter& filter);
+
+    /**
+      * @brief Get the result of the query, with the same offset, size and
+      * total semantics as SearchContext::getResult.
+      * @param index is the compressed index to search.
+      * @param offset is the offset where to start returning the solutions.
+      * @param size is the maximum number of solutions to return.
+      * @param maxTotal is the maximum number of solutions to count (with or
+      * without returning). The search stops once it is reached.
+      * @param pool runs the search in parallel if not null
+      * @param parallelism is the number of tasks splitting the branches of
+      * the first index node where the search branches. The result does not
+      * depend on it.
+      * @return an answer set with the corresponding results.
+      */
+    MwsAnswset* getResult(index_handle_t* index,
+                          dbc::DbQueryManager* dbQueryManager,
+                          unsigned int offset, unsigned int size,
+                          unsigned int maxTotal,
+                          common::thread::WorkerPool* pool = nullptr,
+                          unsigned int parallelism = 1);
+
+    /**
+      * @brief Get a page of the result like getResult, without parallelism.
+      * The search is paused after the page if more solutions follow.
+      * @param countTotal if false, the total only counts the solutions up
+      * to the end of the page. Otherwise the search counts them up to
+      * maxTotal, or estimates them like getResult, once for all pages.
+      * @param search set to the paused search, or to nullptr if the page is
+      * the last one or partial.
+      * @return an answer set with the corresponding results.
+      */
+    MwsAnswset* getFirstPage(index_handle_t* index,
+                             dbc::DbQueryManager* dbQueryManager,
+                             unsigned int offset, unsigned int size,
+                             unsigned int maxTotal, bool countTotal,
+                             std::unique_ptr<PagedSearch>* search);
+
+    /**
+      * @brief Get the page following the previous page of a paused search of
+      * the same query, at the cost of this page only. The search is reset
+      * to nullptr once it ends.
+      * @param size is the maximum number of solutions to return.
+      * @return an answer set with the corresponding results.
+      */
+    MwsAnswset* getNextPage(std::unique_ptr<PagedSearch>* search,
+                            dbc::DbQueryManager* dbQueryManager,
+                            unsigned int size);
+
+    /**
+      * @brief Get the result of the query from the leaves containing all of
+      * its constant tokens, with the same semantics and order as getResult.
+      * Each candidate is verified against its formula in the formula store.
+      * The index must not have hvars. Queries without constant tokens are
+      * run by getResult.
+      * @param postings token postings of the index
+      * @param formulaStore formula store of the index
+      * @return an answer set with the corresponding results.
+      */
+    MwsAnswset* getPostingsResult(index_handle_t* index,
+                                  dbc::DbQueryManager* dbQueryManager,
+                                  const token_postings_handle_t* postings,
+                                  const formula_store_handle_t* formulaStore,
+                                  unsigned int offset, unsigned int size,
+                                  unsigned int maxTotal);
+
+    /**
+      * @brief Get the best solutions of the query by decreasing score, ties
+      * in index order. Only the answers of the returned page are fetched.
+      * @param scorer ranks the solutions.
+      * @param bounds if not null, subtrees which cannot beat the current
+      * page are skipped. The total then only counts the scored solutions.
+      * @param offset is the offset of the page in the ranking.
+      * @param size is the maximum number of solutions to return.
+      * @param maxTotal is the maximum number of solutions to score. The
+      * search stops once it is reached.
+      * @return an answer set with the corresponding results.
+      */
+    MwsAnswset* getRankedResult(index_handle_t* index,
+                                dbc::DbQueryManager* dbQueryManager,
+                                const LeafScorer& scorer,
+                                const subtree_bounds_handle_t* bounds,
+                                unsigned int offset, unsigned int size,
+                                unsigned int maxTotal);
+
+ private:
+    std::vector<encoded_token_t> _encodedFormula;
+    types::Query::Options _options;
+    RangeBounds _rangeBounds;
+    /// Numeric constants of the index, must outlive the paged searches
+    const NumericConstants* _numbers;
+    /// Var ids of the named qvars of the query, in query order, if the
+    /// options request substitutions
+    std::vector<uint32_t> _qvarIds;
+    /// Documents searched, all if null
+    std::unique_ptr<DocumentFilter> _filter;
+
+    DISALLOW_COPY_AND_ASSIGN(EngineContext);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_ENGINECONTEXT_HPP
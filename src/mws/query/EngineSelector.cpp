@@ -0,0 +1,162 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Choice of the search engine of a query by its shape
+  * @file   EngineSelector.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <algorithm>
+#include <mutex>
+using std::lock_guard;
+using std::mutex;
+#include <string>
+using std::string;
+using std::to_string;
+#include <vector>
+using std::vector;
+
+#include "mws/query/EngineSelector.hpp"
+
+namespace mws {
+namespace query {
+
+/// Weight of the latest latency in the moving average of an engine
+static const double MEAN_WEIGHT = 0.125;
+
+EngineSelector::EngineSelector(bool searchContextSupported)
+    : _searchContextSupported(searchContextSupported), _slots() {}
+
+unsigned EngineSelector::getShape(const vector<encoded_token_t>& encodedQuery) {
+    unsigned shape = 0;
+    unsigned firstVarDepth = MAX_DEPTH;
+    bool seenVar = false;
+    vector<MeaningId> qvars;
+    // arguments left to each open token
+    vector<Arity> pending;
+
+    for (const encoded_token_t& token : encodedQuery) {
+        const bool isVar = encoded_token_is_var(token);
+        const bool isRange = encoded_token_is_range(token);
+
+        if ((isVar || isRange) && !seenVar) {
+            if (pending.size() < MAX_DEPTH) firstVarDepth = pending.size();
+            seenVar = true;
+        }
+        if (isRange) shape |= SHAPE_RANGES;
+        if (isVar && !encoded_token_is_anon_var(token)) {
+            if (std::find(qvars.begin(), qvars.end(), token.id) !=
+                qvars.end()) {
+                shape |= SHAPE_REPEATED_QVARS;
+            } else {
+                qvars.push_back(token.id);
+            }
+        }
+
+        // vars and ranges stand for a whole subterm
+        if (!isVar && !isRange && token.arity > 0) {
+            pending.push_back(token.arity);
+            continue;
+        }
+        while (!pending.empty() && --pending.back() == 0) pending.pop_back();
+    }
+
+    return shape | (firstVarDepth << SHAPE_DEPTH_SHIFT);
+}
+
+string EngineSelector::describeShape(unsigned shape) {
+    string description;
+    if (shape & SHAPE_REPEATED_QVARS) description += "repeated qvars, ";
+    if (shape & SHAPE_RANGES) description += "ranges, ";
+    unsigned depth = shape >> SHAPE_DEPTH_SHIFT;
+    description += "first var at depth " + to_string(depth);
+    if (depth == MAX_DEPTH) description += "+";
+    return description;
+}
+
+const char* EngineSelector::engineName(Engine engine) {
+    switch (engine) {
+    case SEARCH_CONTEXT:
+        return "SearchContext";
+    case QUERY_ENGINE:
+        return "query engine";
+    default:
+        return "unknown";
+    }
+}
+
+EngineSelector::Engine EngineSelector::choose(unsigned shape) {
+    if (!_searchContextSupported || shape >= NUM_SHAPES) return QUERY_ENGINE;
+
+    lock_guard<mutex> lock(_lock);
+    Slot& slot = _slots[shape];
+    const EngineStats& search = slot.engines[SEARCH_CONTEXT];
+    const EngineStats& engine = slot.engines[QUERY_ENGINE];
+    slot.choices++;
+
+    // sample both engines, alternating
+    if (search.queries < MIN_SAMPLES || engine.queries < MIN_SAMPLES) {
+        return (search.queries < engine.queries) ? SEARCH_CONTEXT
+                                                 : QUERY_ENGINE;
+    }
+    Engine faster = (search.meanMicros < engine.meanMicros) ? SEARCH_CONTEXT
+                                                            : QUERY_ENGINE;
+    if (slot.choices % EXPLORE_PERIOD == 0) {
+        return (faster == SEARCH_CONTEXT) ? QUERY_ENGINE : SEARCH_CONTEXT;
+    }
+    return faster;
+}
+
+void EngineSelector::record(unsigned shape, Engine engine, uint64_t micros) {
+    if (shape >= NUM_SHAPES || engine >= NUM_ENGINES) return;
+
+    lock_guard<mutex> lock(_lock);
+    EngineStats& stats = _slots[shape].engines[engine];
+    if (stats.queries == 0) {
+        stats.meanMicros = micros;
+    } else {
+        stats.meanMicros += MEAN_WEIGHT * (micros - stats.meanMicros);
+    }
+    stats.queries++;
+}
+
+vector<EngineSelector::ShapeStats> EngineSelector::getStats() const {
+    vector<ShapeStats> stats;
+
+    lock_guard<mutex> lock(_lock);
+    for (unsigned shape = 0; shape < NUM_SHAPES; shape++) {
+        const Slot& slot = _slots[shape];
+        if (slot.engines[SEARCH_CONTEXT].queries == 0 &&
+            slot.engines[QUERY_ENGINE].queries == 0) {
+            continue;
+        }
+        ShapeStats shapeStats;
+        shapeStats.shape = shape;
+        std::copy(slot.engines, slot.engines + NUM_ENGINES,
+                  shapeStats.engines);
+        stats.push_back(shapeStats);
+    }
+
+    return stats;
+}
+
+}  // namespace query
+}  // namespace mws
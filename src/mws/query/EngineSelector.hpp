@@ -0,0 +1,116 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_ENGINESELECTOR_HPP
+#define _MWS_QUERY_ENGINESELECTOR_HPP
+
+/**
+  * @brief  Choice of the search engine of a query by its shape
+  * @file   EngineSelector.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/encoded_token.h"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Choice between SearchContext and the query engine for each query,
+ * by the latencies both had on previous queries of the same shape. Each
+ * engine first runs MIN_SAMPLES queries of a shape, then the faster one
+ * runs them, except one in EXPLORE_PERIOD which keeps the statistics of the
+ * other one up to date. Thread safe.
+ */
+class EngineSelector {
+ public:
+    enum Engine {
+        SEARCH_CONTEXT,
+        QUERY_ENGINE,
+        NUM_ENGINES
+    };
+
+    /// Shape bits of a query
+    static const unsigned SHAPE_REPEATED_QVARS = 1;
+    static const unsigned SHAPE_RANGES = 2;
+    /// The other bits are the depth of the first var or range, capped
+    static const unsigned SHAPE_DEPTH_SHIFT = 2;
+    static const unsigned MAX_DEPTH = 3;
+    static const unsigned NUM_SHAPES = (MAX_DEPTH + 1) << SHAPE_DEPTH_SHIFT;
+
+    /// Queries of a shape each engine runs before the faster one is chosen
+    static const uint64_t MIN_SAMPLES = 8;
+    /// Period of the queries of a shape run by the slower engine
+    static const uint64_t EXPLORE_PERIOD = 64;
+
+    struct EngineStats {
+        uint64_t queries;
+        /// Exponential moving average of the latency, in microseconds
+        double meanMicros;
+    };
+    struct ShapeStats {
+        unsigned shape;
+        EngineStats engines[NUM_ENGINES];
+    };
+
+    /**
+     * @param searchContextSupported false if SearchContext can not answer
+     * the queries, e.g. since the index has hvars
+     */
+    explicit EngineSelector(bool searchContextSupported = true);
+
+    /// @return shape of an encoded query
+    static unsigned getShape(const std::vector<encoded_token_t>& encodedQuery);
+    /// @return description of a shape, for logs
+    static std::string describeShape(unsigned shape);
+    static const char* engineName(Engine engine);
+
+    /// @return the engine to run the next query of shape
+    Engine choose(unsigned shape);
+    /// Record the latency of a query of shape run by engine
+    void record(unsigned shape, Engine engine, uint64_t micros);
+
+    /// @return statistics of the shapes with queries, by shape
+    std::vector<ShapeStats> getStats() const;
+
+ private:
+    struct Slot {
+        EngineStats engines[NUM_ENGINES];
+        /// Queries chosen for the shape
+        uint64_t choices;
+    };
+
+    const bool _searchContextSupported;
+    Slot _slots[NUM_SHAPES];
+    mutable std::mutex _lock;
+
+    DISALLOW_COPY_AND_ASSIGN(EngineSelector);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_ENGINESELECTOR_HPP
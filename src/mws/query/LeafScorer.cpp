@@ -0,0 +1,66 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Score of indexed formulae for ranked queries
+  * @file   LeafScorer.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <algorithm>
+#include <cmath>
+
+#include "mws/query/LeafScorer.hpp"
+
+namespace mws {
+namespace query {
+
+LeafScorer::LeafScorer(const Weights& weights, const float* staticScores,
+                       size_t numStaticScores)
+    : _weights(weights),
+      _staticScores(staticScores),
+      _numStaticScores(numStaticScores),
+      _maxStaticScore(0) {
+    for (size_t i = 0; i < _numStaticScores; i++) {
+        _maxStaticScore = std::max(_maxStaticScore, (double)_staticScores[i]);
+    }
+}
+
+double LeafScorer::score(const leaf_t* leaf, uint32_t size) const {
+    double staticScore = 0;
+    if (leaf->formula_id < _numStaticScores) {
+        staticScore = _staticScores[leaf->formula_id];
+    }
+
+    return _score(leaf->num_hits, size, staticScore);
+}
+
+double LeafScorer::bound(const subtree_bounds_entry_t* bounds) const {
+    return _score(bounds->max_hits, bounds->min_size, _maxStaticScore);
+}
+
+double LeafScorer::_score(uint32_t hits, uint32_t size,
+                          double staticScore) const {
+    return _weights.hits * std::log1p(hits) - _weights.size * size +
+           _weights.staticScore * staticScore;
+}
+
+}  // namespace query
+}  // namespace mws
@@ -0,0 +1,81 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_LEAFSCORER_HPP
+#define _MWS_QUERY_LEAFSCORER_HPP
+
+/**
+  * @brief  Score of indexed formulae for ranked queries
+  * @file   LeafScorer.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mws/index/index.h"
+#include "mws/index/subtree_bounds.h"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Query independent score of an index leaf, from its number of hits,
+ * the size of its formula and an optional static score per FormulaId.
+ * Frequent, small and highly scored formulae rank first.
+ */
+class LeafScorer {
+ public:
+    /// Non-negative weights of the score components
+    struct Weights {
+        double hits;
+        double size;
+        double staticScore;
+
+        Weights() : hits(1.0), size(0.05), staticScore(1.0) {}
+    };
+
+    /**
+     * @param staticScores score of every FormulaId below numStaticScores,
+     * others have a static score of 0. Must outlive the scorer.
+     */
+    explicit LeafScorer(const Weights& weights = Weights(),
+                        const float* staticScores = nullptr,
+                        size_t numStaticScores = 0);
+
+    /// @param size is the number of tokens of the formula of the leaf
+    double score(const leaf_t* leaf, uint32_t size) const;
+
+    /// @return upper bound of the scores of the leaves below a node
+    double bound(const subtree_bounds_entry_t* bounds) const;
+
+ private:
+    double _score(uint32_t hits, uint32_t size, double staticScore) const;
+
+    Weights _weights;
+    const float* _staticScores;
+    size_t _numStaticScores;
+    double _maxStaticScore;
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_LEAFSCORER_HPP
@@ -0,0 +1,84 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Values of the numeric constants of a meaning dictionary
+  * @file   NumericConstants.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+using std::string;
+#include <utility>
+using std::make_pair;
+
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/query/NumericConstants.hpp"
+
+namespace mws {
+namespace query {
+
+constexpr char NUMBER_PREF[] = "cn#";
+
+const NumericConstants NumericConstants::EMPTY;
+
+NumericConstants::NumericConstants(const MeaningDictionary* meaningDict) {
+    if (meaningDict == nullptr) return;
+
+    const MeaningDictionary::ReverseLookupTable meanings =
+        meaningDict->getReverseLookupTable();
+    const size_t prefixSize = strlen(NUMBER_PREF);
+    // value ids are allocated contiguously after KEY_NOT_FOUND
+    for (size_t i = 1; i <= meanings.size(); i++) {
+        MeaningId valueId = MeaningDictionary::KEY_NOT_FOUND + i;
+        const string& meaning = meanings.get(valueId);
+        if (meaning.compare(0, prefixSize, NUMBER_PREF) != 0) continue;
+
+        // same numbers as std::stod accepts
+        const char* value = meaning.c_str() + prefixSize;
+        char* valueEnd;
+        errno = 0;
+        double number = strtod(value, &valueEnd);
+        if (valueEnd == value || errno == ERANGE) continue;
+
+        _numbers.push_back(make_pair(CONSTANT_ID_MIN + valueId, number));
+    }
+}
+
+bool NumericConstants::isInRange(encoded_token_t token,
+                                 const Bounds& bounds) const {
+    if (token.arity != 0) return false;
+
+    auto it = std::lower_bound(_numbers.begin(), _numbers.end(),
+                               make_pair((MeaningId)token.id, -HUGE_VAL));
+    if (it == _numbers.end() || it->first != token.id) return false;
+
+    return (bounds.first <= it->second && it->second <= bounds.second);
+}
+
+}  // namespace query
+}  // namespace mws
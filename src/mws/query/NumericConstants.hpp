@@ -0,0 +1,73 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_NUMERICCONSTANTS_HPP
+#define _MWS_QUERY_NUMERICCONSTANTS_HPP
+
+/**
+  * @brief  Values of the numeric constants of a meaning dictionary
+  * @file   NumericConstants.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <utility>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/encoded_token.h"
+#include "mws/index/MeaningDictionary.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Table of the "cn#" constants of a meaning dictionary and their
+ * values, used to solve mws:range query tokens. It is built once by the
+ * owner of the dictionary (the query handler of a loaded index) and
+ * shared read-only by the query contexts.
+ */
+class NumericConstants {
+ public:
+    typedef std::pair<double, double> Bounds;
+
+    /**
+     * @param meaningDict dictionary to read the constants from, or nullptr
+     * for an empty table. The dictionary is not referenced afterwards.
+     */
+    explicit NumericConstants(
+        const index::MeaningDictionary* meaningDict = nullptr);
+
+    /// Table without constants, for queries run without a dictionary
+    static const NumericConstants EMPTY;
+
+    /// @return true if token is a number constant within bounds
+    bool isInRange(encoded_token_t token, const Bounds& bounds) const;
+
+ private:
+    /// Values of the numeric constants, sorted by meaning id
+    std::vector<std::pair<MeaningId, double>> _numbers;
+
+    DISALLOW_COPY_AND_ASSIGN(NumericConstants);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_NUMERICCONSTANTS_HPP
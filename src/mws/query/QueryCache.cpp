@@ -0,0 +1,219 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  Size bounded cache of query results
+  * @file   QueryCache.cpp
+  * @date   19 Oct 2026
+  */
+
+#include <iterator>
+#include <memory>
+using std::shared_ptr;
+#include <mutex>
+using std::unique_lock;
+using std::mutex;
+
+#include "mws/query/QueryCache.hpp"
+
+namespace mws {
+namespace query {
+
+/// Bookkeeping of an entry besides its answer set and key, in bytes
+static const uint64_t ENTRY_OVERHEAD = 128;
+/// Node of the set of FormulaIds of an answer set, in bytes
+static const uint64_t ID_NODE_SIZE = 48;
+
+QueryCache::QueryCache(uint64_t capacity)
+    : _capacity(capacity), _protectedBytes(0), _generation(0), _stats() {}
+
+MwsAnswset* QueryCache::get(const Key& key, const Compute& compute) {
+    unique_lock<mutex> lock(_lock);
+
+    auto entryIt = _entries.find(key);
+    if (entryIt != _entries.end()) {
+        _stats.hits++;
+        _promote(entryIt->second);
+        Value value = entryIt->second->value;
+        lock.unlock();
+        return value->clone();
+    }
+    _stats.misses++;
+
+    // wait for a concurrent computation of the same key
+    auto flightIt = _flights.find(key);
+    if (flightIt != _flights.end()) {
+        shared_ptr<Flight> flight = flightIt->second;
+        _flightDone.wait(lock, [&flight]() { return flight->done; });
+        if (flight->value != nullptr) {
+            _stats.shared++;
+            Value value = flight->value;
+            lock.unlock();
+            return value->clone();
+        }
+        // the computation failed, try on our own
+        lock.unlock();
+        return compute();
+    }
+
+    shared_ptr<Flight> flight(new Flight());
+    _flights[key] = flight;
+    uint64_t generation = _generation;
+    lock.unlock();
+
+    Value value;
+    try {
+        value.reset(compute());
+    }
+    catch (...) {
+        lock.lock();
+        flight->done = true;
+        _flights.erase(key);
+        _flightDone.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    flight->done = true;
+    flight->value = value;
+    _flights.erase(key);
+    if (generation == _generation && !value->partial) {
+        _insert(key, value);
+    }
+    _flightDone.notify_all();
+    lock.unlock();
+
+    return value->clone();
+}
+
+MwsAnswset* QueryCache::find(const Key& key) {
+    unique_lock<mutex> lock(_lock);
+
+    auto entryIt = _entries.find(key);
+    if (entryIt == _entries.end()) {
+        _stats.misses++;
+        return nullptr;
+    }
+    _stats.hits++;
+    _promote(entryIt->second);
+    Value value = entryIt->second->value;
+    lock.unlock();
+
+    return value->clone();
+}
+
+void QueryCache::put(const Key& key, const MwsAnswset& answset) {
+    if (answset.partial) return;
+    Value value(answset.clone());
+
+    unique_lock<mutex> lock(_lock);
+    if (_entries.count(key) == 0 && _flights.count(key) == 0) {
+        _insert(key, value);
+    }
+}
+
+void QueryCache::clear() {
+    unique_lock<mutex> lock(_lock);
+    _probation.clear();
+    _protected.clear();
+    _entries.clear();
+    _protectedBytes = 0;
+    _stats.entries = 0;
+    _stats.bytes = 0;
+    _generation++;
+}
+
+QueryCache::Stats QueryCache::getStats() const {
+    unique_lock<mutex> lock(_lock);
+    return _stats;
+}
+
+uint64_t QueryCache::sizeOf(const MwsAnswset& answset) {
+    uint64_t bytes = sizeof(answset);
+
+    for (const types::Answer* answer : answset.answers) {
+        bytes += sizeof(answer) + sizeof(*answer) + answer->uri.capacity() +
+                 answer->xpath.capacity() + answer->data.capacity();
+        for (const auto& substitution : answer->substitutions) {
+            bytes += sizeof(substitution) +
+                     substitution.capacity() * sizeof(encoded_token_t);
+        }
+        bytes += answer->hits.capacity() * sizeof(types::FormulaPath);
+        for (const types::FormulaPath& hit : answer->hits) {
+            bytes += hit.xmlId.capacity() + hit.xpath.capacity();
+        }
+    }
+    for (size_t i = 0; i < answset.qvarNames.size(); i++) {
+        bytes += sizeof(std::string) + answset.qvarNames[i].capacity();
+    }
+    for (size_t i = 0; i < answset.qvarXpaths.size(); i++) {
+        bytes += sizeof(std::string) + answset.qvarXpaths[i].capacity();
+    }
+    bytes += answset.ids.size() * ID_NODE_SIZE;
+
+    return bytes;
+}
+
+void QueryCache::_insert(const Key& key, const Value& value) {
+    uint64_t bytes = ENTRY_OVERHEAD + key.capacity() + sizeOf(*value);
+    if (bytes > _capacity) return;
+
+    _probation.push_front({key, value, bytes, false});
+    _entries[key] = _probation.begin();
+    _stats.entries++;
+    _stats.bytes += bytes;
+    _evict();
+}
+
+void QueryCache::_promote(Segment::iterator it) {
+    if (it->isProtected) {
+        _protected.splice(_protected.begin(), _protected, it);
+        return;
+    }
+
+    _protected.splice(_protected.begin(), _probation, it);
+    it->isProtected = true;
+    _protectedBytes += it->bytes;
+
+    // demote the least recently used protected entries
+    const uint64_t protectedCapacity = _capacity / 100 * PROTECTED_PERCENT;
+    while (_protectedBytes > protectedCapacity && _protected.size() > 1) {
+        auto demoted = std::prev(_protected.end());
+        demoted->isProtected = false;
+        _protectedBytes -= demoted->bytes;
+        _probation.splice(_probation.begin(), _protected, demoted);
+    }
+}
+
+void QueryCache::_evict() {
+    while (_stats.bytes > _capacity) {
+        Segment& segment = _probation.empty() ? _protected : _probation;
+        auto victim = std::prev(segment.end());
+        if (victim->isProtected) _protectedBytes -= victim->bytes;
+        _stats.bytes -= victim->bytes;
+        _stats.entries--;
+        _stats.evictions++;
+        _entries.erase(victim->key);
+        segment.erase(victim);
+    }
+}
+
+}  // namespace query
+}  // namespace mws
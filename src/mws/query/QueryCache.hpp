@@ -0,0 +1,142 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_QUERYCACHE_HPP
+#define _MWS_QUERY_QUERYCACHE_HPP
+
+/**
+  * @brief  Size bounded cache of query results
+  * @file   QueryCache.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/types/MwsAnswset.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Segmented LRU cache of answer sets, bounded by their size in
+ * bytes. Entries start in a probation segment and move to a protected one
+ * on their second hit, so a burst of one-off queries can not evict the
+ * popular ones. Concurrent lookups of the same missing key share a single
+ * computation. Partial answer sets are shared but not cached.
+ */
+class QueryCache {
+ public:
+    typedef std::string Key;
+    typedef std::function<MwsAnswset*()> Compute;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        /// Misses answered by the computation of a concurrent lookup
+        uint64_t shared;
+        uint64_t evictions;
+        uint64_t entries;
+        uint64_t bytes;
+    };
+
+    /// Share of the capacity reserved to the protected segment
+    static const unsigned PROTECTED_PERCENT = 80;
+
+    /// @param capacity maximum size of the cached answer sets, in bytes
+    explicit QueryCache(uint64_t capacity);
+
+    /**
+     * @brief Get a copy of the answer set of key, computed by compute on a
+     * miss. compute must not return nullptr.
+     * @return an answer set owned by the caller
+     */
+    MwsAnswset* get(const Key& key, const Compute& compute);
+
+    /**
+     * @brief Get a copy of the cached answer set of key. Unlike get, a miss
+     * does not wait for a concurrent computation of the key.
+     * @return an answer set owned by the caller, or nullptr on a miss
+     */
+    MwsAnswset* find(const Key& key);
+
+    /**
+     * @brief Cache a copy of the answer set of key computed after a miss of
+     * find, unless it is partial or key was cached in the meantime
+     */
+    void put(const Key& key, const MwsAnswset& answset);
+
+    /// Drop all entries, e.g. when the index changes
+    void clear();
+
+    Stats getStats() const;
+
+    /// @return approximate memory used by an answer set, in bytes
+    static uint64_t sizeOf(const MwsAnswset& answset);
+
+ private:
+    typedef std::shared_ptr<const MwsAnswset> Value;
+
+    struct Entry {
+        Key key;
+        Value value;
+        uint64_t bytes;
+        bool isProtected;
+    };
+    typedef std::list<Entry> Segment;
+
+    /// Computation of a missing key
+    struct Flight {
+        bool done;
+        Value value;
+
+        Flight() : done(false) {}
+    };
+
+    void _insert(const Key& key, const Value& value);
+    void _promote(Segment::iterator it);
+    void _evict();
+
+    const uint64_t _capacity;
+    Segment _probation;
+    Segment _protected;
+    uint64_t _protectedBytes;
+    std::unordered_map<Key, Segment::iterator> _entries;
+    std::unordered_map<Key, std::shared_ptr<Flight>> _flights;
+    /// Incremented by clear(), computations started before are not cached
+    uint64_t _generation;
+    Stats _stats;
+    mutable std::mutex _lock;
+    std::condition_variable _flightDone;
+
+    DISALLOW_COPY_AND_ASSIGN(QueryCache);
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_QUERYCACHE_HPP
@@ -62,6 +62,22 @@ SchemaAnswset* SchemaEngine::getSchemata(const vector<EncodedFormula>& formulae,
                                 const vector<const CmmlToken*>& exprsTokens,
                                 uint32_t max_total,
                                 uint8_t depth) const {
+    vector<uint32_t> exprsDepths;
+    if (_config.cutoffHeuristic == RELATIVE) {
+        exprsDepths.reserve(exprsTokens.size());
+        for (const CmmlToken* token : exprsTokens) {
+            exprsDepths.push_back(token->getExprDepth());
+        }
+    }
+
+    return getSchemataByDepth(formulae, exprsDepths, max_total, depth);
+}
+
+SchemaAnswset* SchemaEngine::getSchemataByDepth(
+                                const vector<EncodedFormula>& formulae,
+                                const vector<uint32_t>& exprsDepths,
+                                uint32_t max_total,
+                                uint8_t depth) const {
     SchemaAnswset* result = new SchemaAnswset();
 
     unordered_map<string, vector<uint32_t>> schemaGroup;
@@ -75,7 +91,7 @@ SchemaAnswset* SchemaEngine::getSchemata(const vector<EncodedFormula>& formulae,
             break;
         case RELATIVE:
             // "depth" percentages of token depth
-            cutoff = 0.01 * depth * exprsTokens[i]->getExprDepth();
+            cutoff = 0.01 * depth * exprsDepths[i];
             break;
         default:
             assert(false);
@@ -120,6 +136,44 @@ SchemaAnswset* SchemaEngine::getSchemata(const vector<EncodedFormula>& formulae,
     return result;
 }
 
+/// @return depth of an encoded formula, as CmmlToken::getExprDepth()
+static uint32_t encodedDepth(const encoded_token_t* tokens, size_t size) {
+    // arguments left to read at each level of the current path
+    stack<uint32_t> unexplored;
+    uint32_t maxDepth = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        if (tokens[i].arity != 0) {
+            unexplored.push(tokens[i].arity);
+            continue;
+        }
+        maxDepth = std::max(maxDepth, (uint32_t)unexplored.size());
+        while (!unexplored.empty() && --unexplored.top() == 0) {
+            unexplored.pop();
+        }
+    }
+
+    return maxDepth;
+}
+
+SchemaAnswset* SchemaEngine::getSchemataOfIds(
+                                const formula_store_handle_t* formulaStore,
+                                const vector<types::FormulaId>& ids,
+                                uint32_t max_total,
+                                uint8_t depth) const {
+    vector<EncodedFormula> formulae;
+    vector<uint32_t> exprsDepths;
+    formulae.reserve(ids.size());
+    exprsDepths.reserve(ids.size());
+    for (types::FormulaId formulaId : ids) {
+        encoded_formula_t formula = formula_store_get(formulaStore, formulaId);
+        formulae.emplace_back(formula.data, formula.data + formula.size);
+        exprsDepths.push_back(encodedDepth(formula.data, formula.size));
+    }
+
+    return getSchemataByDepth(formulae, exprsDepths, max_total, depth);
+}
+
 EncodedFormula SchemaEngine::reduceFormula(const EncodedFormula& expr,
                                            uint8_t max_depth) const {
     EncodedFormula reducedExpr;
@@ -35,8 +35,10 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mws/index/ExpressionEncoder.hpp"
 #include "mws/index/MeaningDictionary.hpp"
+#include "mws/index/formula_store.h"
 #include "mws/index/index.h"
 #include "mws/types/CmmlToken.hpp"
+#include "mws/types/FormulaPath.hpp"
 #include "mws/types/SchemaAnswset.hpp"
 #include "common/utils/util.hpp"
 #include "build-gen/config.h"
@@ -67,6 +69,27 @@ class SchemaEngine {
                             const std::vector<const types::CmmlToken*>& toks,
                             uint32_t max_total,
                             uint8_t depth = DEFAULT_SCHEMA_DEPTH) const;
+    /**
+     * @brief Same as above, for callers which do not hold CmmlTokens
+     * @param exprsDepths depth of each formula, used by RELATIVE cutoffs
+     */
+    mws::SchemaAnswset* getSchemataByDepth(
+                            const std::vector<EncodedFormula>& formulae,
+                            const std::vector<uint32_t>& exprsDepths,
+                            uint32_t max_total,
+                            uint8_t depth = DEFAULT_SCHEMA_DEPTH) const;
+    /**
+     * @brief Schemata of indexed formulae, such as the ids of a result. Each
+     * formula is read from the formula store of the index in O(size), so
+     * the index is not searched. The engine must use the meaning dictionary
+     * of the index.
+     * @param ids FormulaIds, which the schemata refer to by position
+     */
+    mws::SchemaAnswset* getSchemataOfIds(
+                            const formula_store_handle_t* formulaStore,
+                            const std::vector<types::FormulaId>& ids,
+                            uint32_t max_total,
+                            uint8_t depth = DEFAULT_SCHEMA_DEPTH) const;
 
  private:
     const index::ExpressionDecoder decoder;
@@ -0,0 +1,94 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_QUERY_SEARCHBUDGET_HPP
+#define _MWS_QUERY_SEARCHBUDGET_HPP
+
+/**
+  * @brief  Deadline and node budget of a search
+  * @file   SearchBudget.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <chrono>
+#include <cstdint>
+
+#include "mws/types/Query.hpp"
+
+namespace mws {
+namespace query {
+
+/**
+ * @brief Limits of a search from its query options. The deadline starts
+ * with the budget. Searches check it at their backtrack points and return
+ * the solutions found so far as a partial result once it is exceeded.
+ */
+class SearchBudget {
+ public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Visits between two clock reads of exceeded()
+    static const uint64_t CLOCK_INTERVAL = 1024;
+
+    explicit SearchBudget(const types::Query::Options& options)
+        : _maxNodes(options.maxNodes),
+          _hasDeadline(options.timeout > 0),
+          _deadline(Clock::now() + std::chrono::milliseconds(options.timeout)) {
+    }
+
+    /// @return the node budget, 0 if unlimited
+    uint64_t maxNodes() const { return _maxNodes; }
+
+    /// @return true if the deadline passed
+    bool expired() const { return _hasDeadline && Clock::now() >= _deadline; }
+
+    /**
+     * @return true if a search which visited this many nodes must stop. The
+     * clock is only read every CLOCK_INTERVAL visits.
+     */
+    bool exceeded(uint64_t visited) const {
+        return exceeded(visited, visited);
+    }
+
+    /**
+     * @return true if a search which visited this many nodes must stop, at
+     * its checks-th check. For searches checking between several visits,
+     * the clock is only read every CLOCK_INTERVAL checks.
+     */
+    bool exceeded(uint64_t visited, uint64_t checks) const {
+        if (_maxNodes > 0 && visited > _maxNodes) return true;
+        return (checks % CLOCK_INTERVAL == 0) && expired();
+    }
+
+    /// stop_callback_t of the query engine, with the budget as handle
+    static bool stopCallback(void* handle) {
+        return reinterpret_cast<const SearchBudget*>(handle)->expired();
+    }
+
+ private:
+    uint64_t _maxNodes;
+    bool _hasDeadline;
+    Clock::time_point _deadline;
+};
+
+}  // namespace query
+}  // namespace mws
+
+#endif  // _MWS_QUERY_SEARCHBUDGET_HPP
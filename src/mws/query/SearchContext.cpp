@@ -31,15 +31,14 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   *
   */
 
+#include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <chrono>
+#include <random>
 
-#include <list>
-using std::list;
-#include <map>
-using std::map;
 #include <utility>
 using std::pair;
 using std::make_pair;
@@ -47,16 +46,10 @@ using std::make_pair;
 using std::vector;
 #include <string>
 using std::string;
-#include <memory>
-using std::unique_ptr;
 
-#include "common/utils/ContainerIterator.hpp"
-using common::utils::ContainerIterator;
+#include "common/utils/ThreadArena.hpp"
+using common::utils::ThreadArena;
 #include "mws/index/encoded_token.h"
-#include "mws/index/MeaningDictionary.hpp"
-using mws::index::MeaningDictionary;
-#include "mws/index/ExpressionEncoder.hpp"
-using mws::index::ExpressionDecoder;
 #include "mws/index/TmpIndexAccessor.hpp"
 using mws::index::TmpIndexAccessor;
 #include "mws/index/IndexAccessor.hpp"
@@ -64,205 +57,271 @@ using mws::index::IndexAccessor;
 #include "mws/types/FormulaPath.hpp"
 using mws::types::FormulaPath;
 using mws::types::FormulaId;
-#include "mws/index/IndexIterator.hpp"
-using mws::index::IndexIterator;
 #include "mws/dbc/CrawlDb.hpp"
 using mws::dbc::CrawlData;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/query/SearchBudget.hpp"
+using mws::query::SearchBudget;
 #include "mws/query/SearchContext.hpp"
 
+#include "build-gen/config.h"
+
 namespace mws {
 namespace query {
 
-constexpr char NUMBER_PREF[] = "cn#";
+/// Seed of the paths sampled by estimateTotal, fixed so that estimates are
+/// reproducible
+static const uint64_t ESTIMATE_SEED = 0x9e3779b97f4a7c15ULL;
+/// Quantile of the normal distribution for a 95% confidence interval
+static const double ESTIMATE_Z = 1.96;
 
+/**
+ * @brief Backtrack point of a qvar or range. Its iterators are the segment
+ * [begin, end) of the search stack.
+ */
 template <class Accessor>
-struct BacktrackCtxt {
+struct Backtrack {
     bool isSolved;
-    BacktrackCtxt() : isSolved(false) {}
-    virtual typename Accessor::Node* solve(typename Accessor::Index* index,
-                                           typename Accessor::Node* root) = 0;
-    virtual typename Accessor::Node* nextSol() = 0;
-
-    virtual ~BacktrackCtxt() {}
+    bool isRange;
+    uint32_t begin;
+    uint32_t end;
+    /// Tokens still missing to complete the subterm of a qvar
+    int arity;
+    std::pair<double, double> bounds;
 };
 
+/**
+ * @brief Search state reused by the searches of a thread
+ */
 template <class Accessor>
-struct QvarCtxt : public BacktrackCtxt<Accessor> {
-    IndexIterator<Accessor> iterator;
-
-    typename Accessor::Node* solve(typename Accessor::Index* index,
-                                   typename Accessor::Node* root) {
-        iterator.set(index, root);
-        typename Accessor::Node* node = iterator.next();
-        if (node != nullptr) {
-            this->isSolved = true;
-        }
-        return node;
-    }
-
-    typename Accessor::Node* nextSol() {
-        typename Accessor::Node* node = iterator.next();
-        if (node == nullptr) {
-            this->isSolved = false;
-        }
-        return node;
-    }
+struct SearchState {
+    std::vector<Backtrack<Accessor>> table;
+    /// Index iterators of all solved qvars and ranges, in order
+    std::vector<typename Accessor::Iterator> stack;
 };
 
-template <class Accessor>
-struct RangeCtxt : public BacktrackCtxt<Accessor> {
-    pair<double, double> bounds;
-    ExpressionDecoder* decoder;
-
-    RangeCtxt(pair<double, double> bounds, ExpressionDecoder* decoder)
-        : bounds(bounds), decoder(decoder) {}
-
-    typename Accessor::Index* index;
-    typename Accessor::Node* root;
-    typename Accessor::Iterator* iterator;
-
-    typename Accessor::Node* solve(typename Accessor::Index* index,
-                                   typename Accessor::Node* root) {
-        this->index = index;
-        this->root = root;
-
-        // XXX:
-        typename Accessor::Iterator it = Accessor::getChildrenIterator(root);
-        // malloc'ed because there is no default constructor
-        iterator = (typename Accessor::Iterator*)malloc(sizeof(it));
-        assert(iterator != nullptr);
-        *iterator = it;
-
-        encoded_token_t tok = Accessor::getToken(*iterator);
-        while (!validSubst(tok) && iterator->hasNext()) {
-            iterator->next();
-            tok = Accessor::getToken(*iterator);
-        }
-
-        if (!validSubst(tok)) {
-            this->isSolved = false;
-            return nullptr;
-        }
+template <class A /* Accessor */>
+class Searcher {
+    typedef typename A::Node Node;
+    typedef typename A::Iterator Iterator;
+
+    typename A::Index* _index;
+    SearchState<A>* _state;
+    const NumericConstants& _numbers;
+    const SearchBudget& _budget;
+    /// # of budget checks
+    uint64_t _checks;
+
+ public:
+    /// Index nodes visited by the search
+    uint64_t visited;
+    /// Whether the search stopped at the limits of its budget
+    bool exceeded;
+    /// Children looked up by token while replaying solved qvars
+    uint64_t childLookups;
+    /// Index tokens rejected by a range
+    uint64_t rangeRejects;
+
+    Searcher(typename A::Index* index, SearchState<A>* state,
+             const NumericConstants& numbers, const SearchBudget& budget)
+        : _index(index),
+          _state(state),
+          _numbers(numbers),
+          _budget(budget),
+          _checks(0),
+          visited(0),
+          exceeded(false),
+          childLookups(0),
+          rangeRejects(0) {}
+
+    /// @return true if the search must stop at the limits of its budget
+    bool budgetExceeded() {
+        if (!exceeded) exceeded = _budget.exceeded(visited, ++_checks);
+        return exceeded;
+    }
 
-        typename Accessor::Node* node = Accessor::getChild(index, root, tok);
-        assert(node != nullptr);
-        this->isSolved = true;
+    Node* bindQvar(Backtrack<A>* bk, Node* root) {
+        bk->begin = _state->stack.size();
+        bk->arity = 1;
+        _push(bk, A::getChildrenIterator(root));
+        bk->isSolved = true;
+        return _completeQvar(bk);
+    }
 
-        return node;
+    Node* scanRange(Backtrack<A>* bk, Node* root) {
+        bk->begin = _state->stack.size();
+        _state->stack.push_back(A::getChildrenIterator(root));
+        return _nextRange(bk);
     }
 
-    typename Accessor::Node* nextSol() {
-        if (!iterator->hasNext()) {
-            this->isSolved = false;
-            return nullptr;
+    Node* nextSol(Backtrack<A>* bk) {
+        assert(bk->end == _state->stack.size());
+        if (bk->isRange) {
+            if (!_state->stack.back().hasNext()) {
+                return _drop(bk);
+            }
+            _state->stack.back().next();
+            return _nextRange(bk);
+        } else {
+            while (!_state->stack.back().hasNext()) {
+                bk->arity -= A::getArity(_state->stack.back()) - 1;
+                _state->stack.pop_back();
+                if (_state->stack.size() == bk->begin) {
+                    return _drop(bk);
+                }
+            }
+            Arity prevArity = A::getArity(_state->stack.back());
+            _state->stack.back().next();
+            bk->arity += A::getArity(_state->stack.back()) - prevArity;
+            return _completeQvar(bk);
         }
+    }
 
-        iterator->next();
-        encoded_token_t tok = Accessor::getToken(*iterator);
-        while (!validSubst(tok) && iterator->hasNext()) {
-            iterator->next();
-            tok = Accessor::getToken(*iterator);
+    /// @return the tokens of the solution of a solved qvar
+    vector<encoded_token_t> solution(const Backtrack<A>& bk) const {
+        vector<encoded_token_t> tokens;
+        for (uint32_t i = bk.begin; i < bk.end; i++) {
+            tokens.push_back(A::getToken(_state->stack[i]));
         }
+        return tokens;
+    }
 
-        if (!validSubst(tok)) {
-            this->isSolved = false;
-            return nullptr;
+    /// Follow the solution of a solved qvar starting from node
+    Node* replay(const Backtrack<A>& bk, Node* node) {
+        for (uint32_t i = bk.begin; i < bk.end && node != nullptr; i++) {
+            node = A::getChild(_index, node, A::getToken(_state->stack[i]));
+            childLookups++;
         }
-
-        typename Accessor::Node* node = Accessor::getChild(index, root, tok);
-        assert(node != nullptr);
-        this->isSolved = true;
-
         return node;
     }
 
-    ~RangeCtxt() { free(iterator); }
-
  private:
-    bool isCmmlNumber(encoded_token_t tok) {
-        if (tok.arity != 0) return false;
+    void _push(Backtrack<A>* bk, const Iterator& iterator) {
+        bk->arity += A::getArity(iterator) - 1;
+        _state->stack.push_back(iterator);
+    }
 
-        string meaning = decoder->getMeaning(tok.id);
-        const string NR_PREF(NUMBER_PREF);
-        if (meaning.substr(0, NR_PREF.size()) == NR_PREF) {
-            return true;
+    Node* _completeQvar(Backtrack<A>* bk) {
+        while (bk->arity > 0) {
+            Node* node = A::getNode(_index, _state->stack.back());
+            _push(bk, A::getChildrenIterator(node));
         }
-
-        return false;
+        bk->end = _state->stack.size();
+        return A::getNode(_index, _state->stack.back());
     }
 
-    bool isInRange(encoded_token_t tok) {
-        string cnMeaning = decoder->getMeaning(tok.id);
-        const string NR_PREF(NUMBER_PREF);
-        string val = cnMeaning.substr(NR_PREF.size());
-
-        double num;
-        try {
-            num = std::stod(val);
-        }
-        catch (std::exception & e) {
-            UNUSED(e);
-            return false;
+    /// Skip to the first valid range substitution, starting with the current
+    Node* _nextRange(Backtrack<A>* bk) {
+        Iterator& iterator = _state->stack.back();
+        while (!_validSubst(bk, A::getToken(iterator))) {
+            rangeRejects++;
+            if (!iterator.hasNext() || budgetExceeded()) {
+                return _drop(bk);
+            }
+            iterator.next();
+            visited++;
         }
+        bk->isSolved = true;
+        bk->end = _state->stack.size();
+        return A::getNode(_index, iterator);
+    }
 
-        return (bounds.first <= num && num <= bounds.second);
+    Node* _drop(Backtrack<A>* bk) {
+        _state->stack.erase(_state->stack.begin() + bk->begin,
+                            _state->stack.end());
+        bk->isSolved = false;
+        return nullptr;
     }
 
-    // returns true if tok is a valid substitution
-    bool validSubst(encoded_token_t tok) {
-        if (!isCmmlNumber(tok)) return false;
-        if (!isInRange(tok)) return false;
-        return true;
+    // returns true if tok is a number within the range bounds
+    bool _validSubst(const Backtrack<A>* bk, encoded_token_t tok) const {
+        return _numbers.isInRange(tok, bk->bounds);
     }
 };
 
-SearchContext::_NodeTriple::_NodeTriple(TokType type, MeaningId aMeaningId,
-                                        Arity anArity)
-    : type(type), meaningId(aMeaningId), arity(anArity) {}
+/**
+ * @brief Descend to a child of node picked uniformly at random
+ * @param weight is multiplied by the number of children of node
+ * @param token is set to the token of the child
+ * @return the child, or nullptr if node has none
+ */
+template <class A /* Accessor */>
+static typename A::Node* randomChild(typename A::Index* index,
+                                     typename A::Node* node,
+                                     std::mt19937_64* random, double* weight,
+                                     encoded_token_t* token) {
+    const size_t numChildren = A::getNumChildren(node);
+    if (numChildren == 0) return nullptr;
+
+    std::uniform_int_distribution<size_t> pick(0, numChildren - 1);
+    auto it = A::getChildrenIterator(node, pick(*random));
+    *weight *= numChildren;
+    *token = A::getToken(it);
+    return A::getNode(index, it);
+}
+
+/// @return an estimate as a total, at least counted
+static int estimatedTotal(double estimate, unsigned int counted) {
+    if (estimate >= (double)INT_MAX) return INT_MAX;
+    if (estimate <= (double)counted) return counted;
+    return (int)std::llround(estimate);
+}
 
 SearchContext::SearchContext(const vector<encoded_token_t>& encodedFormula,
                              const types::Query::Options& options,
                              const RangeBounds& rangeBounds,
-                             const MeaningDictionary* meaningDict)
-    : options(options), rangeBounds(rangeBounds) {
-    if (meaningDict != nullptr) {
-        decoder.reset(new ExpressionDecoder(*meaningDict));
-    }
-
-    map<MeaningId, int> indexedQvars;
-    int tokenCount = 0;
-    int specialCount = 0;  // special vars, i.e. ranges & qvars
-    for (encoded_token_t encodedToken : encodedFormula) {
-        MeaningId meaningId = encodedToken.id;
-
-        if (encoded_token_is_var(encodedToken)) {           // qvar
-            if (encoded_token_is_anon_var(encodedToken)) {  // anonymous qvar
-                expr.push_back(_NodeTriple(QVAR, meaningId, specialCount));
-                backtrackPoints.push_back(tokenCount + 1);
-                specialCount++;
-            } else {  // named qvar
-                auto mapIt = indexedQvars.find(meaningId);
-                if (mapIt == indexedQvars.end()) {
-                    indexedQvars.insert(make_pair(meaningId, specialCount));
-                    expr.push_back(_NodeTriple(QVAR, meaningId, specialCount));
-                    backtrackPoints.push_back(tokenCount + 1);
-                    specialCount++;
-                } else {
-                    expr.push_back(_NodeTriple(QVAR, meaningId, mapIt->second));
+                             const NumericConstants* numbers)
+    : _encodedFormula(encodedFormula),
+      _rangeBounds(rangeBounds),
+      _numbers(numbers != nullptr ? numbers : &NumericConstants::EMPTY),
+      options(options) {}
+
+void SearchContext::_compile(_Arena* arena) const {
+    vector<_Instruction>& program = arena->program;
+    vector<uint32_t>& backtrackPoints = arena->backtrackPoints;
+    vector<_Special>& specials = arena->specials;
+    vector<uint32_t>& qvarSpecials = arena->qvarSpecials;
+    program.clear();
+    backtrackPoints.clear();
+    specials.clear();
+    qvarSpecials.clear();
+
+    for (encoded_token_t encodedToken : _encodedFormula) {
+        _Instruction instruction = {MATCH_CONST, 0, encodedToken};
+
+        if (encoded_token_is_var(encodedToken)) {  // qvar
+            instruction.opcode = BIND_QVAR;
+            if (!encoded_token_is_anon_var(encodedToken)) {  // named qvar
+                // named qvars are few, a linear search is enough
+                for (const _Instruction& previous : program) {
+                    if (previous.opcode == BIND_QVAR &&
+                        previous.token.id == encodedToken.id) {
+                        instruction.opcode = CHECK_QVAR;
+                        instruction.special = previous.special;
+                        break;
+                    }
                 }
             }
+            if (instruction.opcode == BIND_QVAR) {
+                instruction.special = specials.size();
+                specials.push_back({false, {0, 0}, encodedToken.id});
+                backtrackPoints.push_back(program.size() + 1);
+            }
+            if (!encoded_token_is_anon_var(encodedToken)) {
+                qvarSpecials.push_back(instruction.special);
+            }
         } else if (encoded_token_is_range(encodedToken)) {
-            expr.push_back(_NodeTriple(RANGE, meaningId, specialCount));
-            backtrackPoints.push_back(tokenCount + 1);
-            specialCount++;
-        } else {  // constant
-            expr.push_back(_NodeTriple(CONST, meaningId, encodedToken.arity));
+            auto it = _rangeBounds.find(encodedToken.id);
+            assert(it != _rangeBounds.end());
+            instruction.opcode = RANGE_SCAN;
+            instruction.special = specials.size();
+            specials.push_back({true, it->second, 0});
+            backtrackPoints.push_back(program.size() + 1);
         }
-
-        tokenCount++;
+        program.push_back(instruction);
     }
-
-    mSpecialCount = specialCount;
+    program.push_back({EMIT, 0, encoded_token(0, 0)});
 }
 
 template <class A /* Accessor */>
@@ -270,36 +329,36 @@ MwsAnswset* SearchContext::getResult(typename A::Index* index,
                                      dbc::DbQueryManager* dbQueryManager,
                                      unsigned int offset, unsigned int size,
                                      unsigned int maxTotal) {
+    // the compiled query, leased on this thread for this search only
+    ThreadArena<_Arena> arena;
+    _compile(&*arena);
+    const _Instruction* const program = arena->program.data();
+    const uint32_t* const backtrackPoints = arena->backtrackPoints.data();
     // Table containing resolved Qvar/ranges and backtrack points
-    vector<unique_ptr<BacktrackCtxt<A>>> bkTable;
-    // setup the backtrack table:
-    bkTable.resize(mSpecialCount);
-    uint32_t bkTablePos = 0;
-    for (_NodeTriple i : expr) {
-        if (i.type == CONST) continue;
-
-        uint32_t specialId = i.arity;
-        if (specialId < bkTablePos) continue;  // we already setup this
+    ThreadArena<SearchState<A>> state;
+    vector<Backtrack<A>>& bkTable = state->table;
 
-        if (i.type == QVAR) {
-            bkTable[bkTablePos].reset(new QvarCtxt<A>());
-        } else {
-            assert(i.type == RANGE);
-            auto it = rangeBounds.find(i.meaningId);
-            assert(it != rangeBounds.end());
-            pair<double, double> limits = it->second;
-            bkTable[bkTablePos].reset(new RangeCtxt<A>(limits, decoder.get()));
-        }
-        bkTablePos++;
+    // setup the backtrack table:
+    state->stack.clear();
+    bkTable.resize(arena->specials.size());
+    for (size_t i = 0; i < bkTable.size(); i++) {
+        bkTable[i].isSolved = false;
+        bkTable[i].isRange = arena->specials[i].isRange;
+        bkTable[i].bounds = arena->specials[i].bounds;
     }
 
     auto result = new MwsAnswset();
-    size_t currentToken = 0;  // index for the expression vector
+    const _Instruction* ip = program;  // next instruction to run
     unsigned int found = 0;   // # of found matches
     int lastSolved = -1;      // last qvar/range that was solved
     typename A::Node* currentNode = A::getRootNode(index);
 
     auto startTime = Time::now();
+    SearchBudget budget(options);
+    Searcher<A> searcher(index, &*state, *_numbers, budget);
+    uint64_t lookups = 0;  // # of children of constants looked up
+    // # of solutions of each qvar or range undone, if the query is profiled
+    vector<uint64_t> backtracks(options.profile ? bkTable.size() : 0, 0);
 
     // Checking the arguments
     if (offset + size > maxTotal) {
@@ -310,130 +369,246 @@ MwsAnswset* SearchContext::getResult(typename A::Index* index,
         }
     }
 
-    // Retrieving the solutions
-    while (found < maxTotal) {
-        // By default not backtracking
-        bool backtrack = false;
-
-        // Evaluating current token and deciding if to go ahead or backtrack
-        if (currentToken < expr.size()) {
-            TokType currType = expr[currentToken].type;
-            if (currType == QVAR) {
-                int qvarId = expr[currentToken].arity;
-                if (bkTable[qvarId]->isSolved) {
-                    QvarCtxt<A>* qCtxt =
-                        dynamic_cast<QvarCtxt<A>*>(bkTable[qvarId].get());
-                    for (auto& elem : qCtxt->iterator.getPath()) {
-                        encoded_token_t token = A::getToken(elem);
-                        currentNode = A::getChild(index, currentNode, token);
-                        if (currentNode == nullptr) {
-                            backtrack = true;
-                            break;
-                        }
-                    }
-                } else {
-                    currentNode = bkTable[qvarId]->solve(index, currentNode);
-                    if (currentNode != nullptr) {
-                        lastSolved = qvarId;
-                    } else {
-                        backtrack = true;
-                    }
-                }
-            } else if (currType == RANGE) {
-                int rangeId = expr[currentToken].arity;
-                currentNode = bkTable[rangeId]->solve(index, currentNode);
-
-                if (currentNode != nullptr) {
-                    lastSolved = rangeId;
-                } else {
-                    backtrack = true;
-                }
-            } else {
-                assert(currType == CONST);
-                encoded_token_t token = encoded_token(
-                    expr[currentToken].meaningId, expr[currentToken].arity);
-                currentNode = A::getChild(index, currentNode, token);
-                if (currentNode == nullptr) {
-                    backtrack = true;
-                }
-            }
-        } else {
-            // Handling the solutions
-            size_t hitsCount;
-            if (options.includeHits) {
-                hitsCount = A::getHitsCount(currentNode);
-            } else {
-                hitsCount = 1;
-            }
-
-            if (found < size + offset && found + hitsCount > offset) {
-                if (options.includeHits) {
-                    FormulaId formulaId = A::getFormulaId(currentNode);
-                    unsigned dbOffset;
-                    unsigned dbMaxSize;
-                    if (offset < found) {
-                        dbOffset = 0;
-                        dbMaxSize = size + offset - found;
-                    } else {
-                        dbOffset = offset - found;
-                        dbMaxSize = size;
-                    }
+    // with an estimated total, count a single solution past the page
+    const unsigned int requestedTotal = maxTotal;
+    if (options.estimateTotal && offset + size < maxTotal) {
+        maxTotal = offset + size + 1;
+    }
 
-                    auto callback = [result](const FormulaPath & formulaPath,
+    // qvar substitutions of the current solution, if requested
+    vector<vector<encoded_token_t>> substitutions;
+    auto callback = [result, &substitutions](const FormulaPath & formulaPath,
                                              const CrawlData & crawlData) {
-                        auto answer = new mws::types::Answer();
-                        answer->data = crawlData;
-                        answer->uri = formulaPath.xmlId;
-                        answer->xpath = formulaPath.xpath;
-                        result->answers.push_back(answer);
-                        return 0;
-                    }
-                    ;
+        auto answer = new mws::types::Answer();
+        answer->data = crawlData;
+        answer->uri = formulaPath.xmlId;
+        answer->xpath = formulaPath.xpath;
+        answer->substitutions = substitutions;
+        result->answers.push_back(answer);
+        return 0;
+    }
+    ;
+
+    // Retrieving the solutions: each instruction jumps directly to the code
+    // of the next one (GNU labels as values), so every opcode has its own
+    // indirect branch to predict. A run of instructions is at most as long
+    // as the query, so the budget is only checked where the search
+    // backtracks and where ranges skip children.
+    static const void* const dispatch[] = {
+        &&match_const, &&bind_qvar, &&check_qvar, &&range_scan, &&emit,
+    };
+#define DISPATCH()                                                          \
+    do {                                                                    \
+        searcher.visited++;                                                 \
+        goto* dispatch[ip->opcode];                                         \
+    } while (0)
+
+    if (maxTotal == 0) goto done;
+    DISPATCH();
+
+match_const:
+    currentNode = A::getChild(index, currentNode, ip->token);
+    lookups++;
+    if (currentNode == nullptr) goto backtrack;
+    ip++;
+    DISPATCH();
+
+bind_qvar:
+    currentNode = searcher.bindQvar(&bkTable[ip->special], currentNode);
+    if (currentNode == nullptr) goto backtrack;
+    lastSolved = ip->special;
+    ip++;
+    DISPATCH();
+
+check_qvar:
+    currentNode = searcher.replay(bkTable[ip->special], currentNode);
+    if (currentNode == nullptr) goto backtrack;
+    ip++;
+    DISPATCH();
+
+range_scan:
+    currentNode = searcher.scanRange(&bkTable[ip->special], currentNode);
+    if (currentNode == nullptr) goto backtrack;
+    lastSolved = ip->special;
+    ip++;
+    DISPATCH();
+
+emit: {
+    // Handling the solutions
+    size_t hitsCount;
+    if (options.includeHits) {
+        hitsCount = A::getHitsCount(currentNode);
+    } else {
+        hitsCount = 1;
+    }
 
-                    dbQueryManager->query(formulaId, dbOffset, dbMaxSize,
-                                          callback);
-                }
-                if (options.includeMwsIds) {
-                    result->ids.insert(A::getFormulaId(currentNode));
+    if (found < size + offset && found + hitsCount > offset) {
+        if (options.includeHits) {
+            FormulaId formulaId = A::getFormulaId(currentNode);
+            unsigned dbOffset;
+            unsigned dbMaxSize;
+            if (offset < found) {
+                dbOffset = 0;
+                dbMaxSize = size + offset - found;
+            } else {
+                dbOffset = offset - found;
+                dbMaxSize = size;
+            }
+            if (options.includeSubstitutions) {
+                substitutions.clear();
+                for (uint32_t special : arena->qvarSpecials) {
+                    substitutions.push_back(
+                        searcher.solution(bkTable[special]));
                 }
             }
 
-            found += hitsCount;
+            dbQueryManager->query(formulaId, dbOffset, dbMaxSize, callback,
+                                  options.profile);
+        }
+        if (options.includeMwsIds) {
+            result->ids.insert(A::getFormulaId(currentNode));
+        }
+    }
 
-            // making sure we haven't surpassed maxTotal
-            if (found > maxTotal) found = maxTotal;
+    found += hitsCount;
 
-            // backtracking to the next
-            backtrack = true;
-        }
+    // making sure we haven't surpassed maxTotal
+    if (found >= maxTotal) {
+        found = maxTotal;
+        goto done;
+    }
+}   // backtracking to the next solution
+
+backtrack:
+    // Backtracking or going to the next expression token
+    // starting with the last
+    if (searcher.budgetExceeded()) goto exceeded;
+    while (lastSolved >= 0) {
+        if (!backtracks.empty()) backtracks[lastSolved]++;
+        currentNode = searcher.nextSol(&bkTable[lastSolved]);
+        if (currentNode != nullptr) break;
+        if (searcher.exceeded) goto exceeded;
+        lastSolved--;
+    }
+    if (lastSolved == -1) {
+        // No more solutions
+        goto done;
+    }
+    ip = program + backtrackPoints[lastSolved];
+    DISPATCH();
 
-        if (backtrack) {
-            // Backtracking or going to the next expression token
-            // starting with the last
-            while (lastSolved >= 0 &&
-                   nullptr == (currentNode = bkTable[lastSolved]->nextSol())) {
-                lastSolved--;
-            }
+#undef DISPATCH
 
-            if (lastSolved == -1) {
-                // No more solutions
-                break;
-            } else {
-                currentToken = backtrackPoints[lastSolved];
+exceeded:
+    result->partial = true;
+
+done:
+    result->total = found;
+    if (found == maxTotal && maxTotal < requestedTotal && !result->partial) {
+        _estimateTotal<A>(index, found, result, *arena);
+    }
+    if (options.profile != nullptr) {
+        types::QueryProfile* profile = options.profile;
+        profile->nodesVisited += searcher.visited;
+        profile->childLookups += lookups + searcher.childLookups;
+        profile->rangeRejects += searcher.rangeRejects;
+        for (size_t i = 0; i < backtracks.size(); i++) {
+            if (!arena->specials[i].isRange) {
+                profile->backtracks[arena->specials[i].varId] +=
+                    backtracks[i];
             }
-        } else {
-            currentToken++;
         }
     }
+
     auto endTime = Time::now();
     ms elapsed_time = std::chrono::duration_cast<ms>(endTime-startTime);
-
     result->time = elapsed_time.count();
-    result->total = found;
 
     return result;
 }
 
+template <class A /* Accessor */>
+void SearchContext::estimateTotal(typename A::Index* index,
+                                  unsigned int counted, MwsAnswset* result) {
+    ThreadArena<_Arena> arena;
+    _compile(&*arena);
+    _estimateTotal<A>(index, counted, result, *arena);
+}
+
+template <class A /* Accessor */>
+void SearchContext::_estimateTotal(typename A::Index* index,
+                                   unsigned int counted, MwsAnswset* result,
+                                   const _Arena& arena) const {
+    const vector<_Instruction>& program = arena.program;
+    const NumericConstants& numbers = *_numbers;
+    // subterm solving each qvar on the current path
+    vector<vector<encoded_token_t>> solutions(arena.specials.size());
+    std::mt19937_64 random(ESTIMATE_SEED);
+    double sum = 0;
+    double sumSquares = 0;
+
+    for (unsigned i = 0; i < QUERY_TOTAL_ESTIMATE_SAMPLES; i++) {
+        typename A::Node* node = A::getRootNode(index);
+        double weight = 1;
+        encoded_token_t token;
+
+        for (const _Instruction& instruction : program) {
+            switch (instruction.opcode) {
+            case MATCH_CONST:
+                node = A::getChild(index, node, instruction.token);
+                break;
+            case BIND_QVAR: {
+                vector<encoded_token_t>& solution =
+                    solutions[instruction.special];
+                int arity = 1;
+                solution.clear();
+                while (node != nullptr && arity > 0) {
+                    node = randomChild<A>(index, node, &random, &weight,
+                                          &token);
+                    solution.push_back(token);
+                    arity += token.arity - 1;
+                }
+                break;
+            }
+            case CHECK_QVAR:
+                for (const encoded_token_t& solved :
+                     solutions[instruction.special]) {
+                    if (node == nullptr) break;
+                    node = A::getChild(index, node, solved);
+                }
+                break;
+            case RANGE_SCAN:
+                node = randomChild<A>(index, node, &random, &weight, &token);
+                if (node != nullptr &&
+                    !numbers.isInRange(
+                        token, arena.specials[instruction.special].bounds)) {
+                    node = nullptr;
+                }
+                break;
+            case EMIT:
+                if (options.includeHits) weight *= A::getHitsCount(node);
+                break;
+            }
+            if (node == nullptr) {
+                weight = 0;
+                break;
+            }
+        }
+        sum += weight;
+        sumSquares += weight * weight;
+    }
+
+    const double n = QUERY_TOTAL_ESTIMATE_SAMPLES;
+    const double mean = sum / n;
+    const double variance =
+        std::max(0.0, sumSquares / n - mean * mean) * n / (n - 1);
+    const double margin = ESTIMATE_Z * std::sqrt(variance / n);
+    result->estimated = true;
+    result->total = estimatedTotal(mean, counted);
+    result->totalLow = estimatedTotal(mean - margin, counted);
+    result->totalHigh = estimatedTotal(mean + margin, counted);
+}
+
 // Declare specializations
 
 template MwsAnswset* SearchContext::getResult<TmpIndexAccessor>(
@@ -444,5 +619,11 @@ template MwsAnswset* SearchContext::getResult<IndexAccessor>(
     IndexAccessor::Index* index, dbc::DbQueryManager* dbQueryManger,
     unsigned int offset, unsigned int size, unsigned int maxTotal);
 
+template void SearchContext::estimateTotal<TmpIndexAccessor>(
+    TmpIndexAccessor::Index* index, unsigned int counted, MwsAnswset* result);
+
+template void SearchContext::estimateTotal<IndexAccessor>(
+    IndexAccessor::Index* index, unsigned int counted, MwsAnswset* result);
+
 }  // namespace query
 }  // namespace mws
@@ -32,18 +32,15 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   */
 
 #include <utility>
-#include <map>
 #include <vector>
 #include <string>
-#include <list>
 #include <unordered_map>
-#include <memory>
 #include <chrono>
 
+#include "common/utils/compiler_defs.h"
 #include "mws/dbc/DbQueryManager.hpp"
 #include "mws/index/encoded_token.h"
-#include "mws/index/MeaningDictionary.hpp"
-#include "mws/index/ExpressionEncoder.hpp"
+#include "mws/query/NumericConstants.hpp"
 #include "mws/types/CmmlToken.hpp"
 #include "mws/types/MwsAnswset.hpp"
 #include "mws/types/Query.hpp"
@@ -62,7 +59,7 @@ class SearchContext {
     SearchContext(const std::vector<encoded_token_t>& encodedFormula,
                   const types::Query::Options& options,
                   const RangeBounds& rangeBounds = RangeBounds(),
-                  const index::MeaningDictionary* meaningDict = nullptr);
+                  const NumericConstants* numbers = nullptr);
 
     /**
       * @brief Method to get the result of the search context, starting with
@@ -72,7 +69,8 @@ class SearchContext {
       * @param aSize is the maximum number of solutions to return.
       * @param aMaxTotal is the maximum number of soulutions to count (with or
       * without returning).
-      * @return an answer set with the corresponding results.
+      * @return an answer set with the corresponding results, partial if the
+      * search reached the deadline or node budget of the options.
       */
     template <class Accessor>
     mws::MwsAnswset* getResult(typename Accessor::Index* aNode,
@@ -80,29 +78,79 @@ class SearchContext {
                                unsigned int anOffset, unsigned int aSize,
                                unsigned int aMaxTotal);
 
+    /**
+      * @brief Estimate the total of the query, in hits if the options
+      * include them, and mark it as estimated in result. Random paths
+      * descend the index along the query: qvars and ranges pick a child
+      * uniformly at random and the path is weighted by the number of
+      * children it picked from. The mean weight of the paths is the total.
+      * @param index is the index to sample.
+      * @param counted is the number of solutions already found, a lower
+      * bound of the total.
+      * @param result is the answer set whose total is replaced.
+      */
+    template <class Accessor>
+    void estimateTotal(typename Accessor::Index* index, unsigned int counted,
+                       mws::MwsAnswset* result);
+
  private:
-    enum TokType {
-        QVAR,
-        RANGE,
-        CONST
+    /// Instructions of the compiled query
+    enum Opcode {
+        /// Descend to the child of a constant token
+        MATCH_CONST,
+        /// Solve the first occurrence of a qvar with a subterm of the index
+        BIND_QVAR,
+        /// Follow the subterm of an already solved qvar
+        CHECK_QVAR,
+        /// Solve a range with a number among the children of the node
+        RANGE_SCAN,
+        /// Count the solution and fetch its hits
+        EMIT
+    };
+
+    struct _Instruction {
+        Opcode opcode;
+        /// Qvar or range of BIND_QVAR, CHECK_QVAR and RANGE_SCAN
+        uint32_t special;
+        /// Query token of the instruction
+        encoded_token_t token;
     };
 
-    struct _NodeTriple {
-        TokType type;
-        MeaningId meaningId;
-        Arity arity;
-        _NodeTriple(TokType type, MeaningId aMeaningId, Arity anArity);
+    /// Qvar or range of the query, in order of first occurrence
+    struct _Special {
+        bool isRange;
+        /// Bounds of a range
+        std::pair<double, double> bounds;
+        /// Var id of a qvar
+        uint32_t varId;
     };
 
-    int mSpecialCount;
-    /// Vector containing the DFS traversal of the query expression
-    std::vector<_NodeTriple> expr;
-    /// Qvar or Range points in the Cmml Dfs Vector from where to backtrack.
-    /// The vector starts with -1 to mark the beginning
-    std::vector<int> backtrackPoints;
+    /// Query state reused by the searches of a thread. It is leased for
+    /// the duration of one search, on the thread running it.
+    struct _Arena {
+        /// Query compiled to one instruction per token, and EMIT
+        std::vector<_Instruction> program;
+        /// Instruction following the first occurrence of each qvar or range,
+        /// where the search resumes once it found its next solution
+        std::vector<uint32_t> backtrackPoints;
+        std::vector<_Special> specials;
+        /// Special of each occurrence of a named qvar, in query order
+        std::vector<uint32_t> qvarSpecials;
+    };
+
+    /// Compile the query into arena
+    void _compile(_Arena* arena) const;
+
+    template <class Accessor>
+    void _estimateTotal(typename Accessor::Index* index, unsigned int counted,
+                        mws::MwsAnswset* result, const _Arena& arena) const;
+
+    std::vector<encoded_token_t> _encodedFormula;
+    RangeBounds _rangeBounds;
+    const NumericConstants* _numbers;
     types::Query::Options options;
-    RangeBounds rangeBounds;
-    std::unique_ptr<index::ExpressionDecoder> decoder;
+
+    DISALLOW_COPY_AND_ASSIGN(SearchContext);
 };
 
 }  // namespace query
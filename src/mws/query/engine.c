@@ -23,9 +23,17 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
  * @file    engine.c
  * @date    21 Feb 2013
  *
+ * The matcher is a state machine over an explicit stack of frames, one per
+ * pending step of the search: matching a query token, a range or a
+ * variable. A frame which needs a sub-search pushes a new frame and resumes
+ * once that one returns. All buffers live on the heap and grow on demand.
+ *
  * License: GPLv3
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "mws/query/engine.h"
 
 #include "mws/index/encoded_token.h"
@@ -35,37 +43,187 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 /* Constants                                                                */
 /*--------------------------------------------------------------------------*/
 
-#define MAX_VAR_INSTATIATION_SIZE 256
-#define MAX_QUERY_STACK_SIZE 512
+#define INITIAL_STACK_CAPACITY 64
+/* Upper bound of every cursor buffer, in elements */
+#define MAX_STACK_CAPACITY (1 << 24)
+/* Depth of the split frame before it is reached */
+#define NO_SPLIT UINT32_MAX
+/* Steps between two calls of the stop callback */
+#define STOP_CHECK_INTERVAL 1024
 
 /*--------------------------------------------------------------------------*/
 /* Type declarations                                                        */
 /*--------------------------------------------------------------------------*/
 
+typedef struct token_stack_s {
+    encoded_token_t* data;
+    uint32_t size;
+    uint32_t capacity;
+} token_stack_t;
+
 typedef struct var_instantiation_s {
     bool solved;
-    encoded_token_t tokens[MAX_VAR_INSTATIATION_SIZE];
-    int num_tokens;
+    token_stack_t tokens;
 } var_instantiation_t;
 
-typedef struct token_stack_s {
-    encoded_token_t data[MAX_QUERY_STACK_SIZE];
-    int size;
-} token_stack_t;
+typedef enum frame_kind_e {
+    PROCESS_QUERY_TOKEN,
+    MATCH_RANGE,
+    MATCH_VAR_TO_INDEX,
+    MATCH_VAR_TO_QUERY
+} frame_kind_t;
+
+typedef enum frame_state_e {
+    FRAME_START,
+    /* PROCESS_QUERY_TOKEN */
+    PROCESS_RESTORE_TOKEN,
+    PROCESS_SOLVED_VAR_DONE,
+    PROCESS_CHILD_DONE,
+    PROCESS_MATCH_HVARS,
+    PROCESS_HVAR_DONE,
+    /* MATCH_RANGE and MATCH_VAR_TO_INDEX */
+    MATCH_CHILDREN,
+    MATCH_CHILD_DONE,
+    /* MATCH_VAR_TO_INDEX and MATCH_VAR_TO_QUERY */
+    MATCH_SOLVED_DONE
+} frame_state_t;
+
+typedef enum step_result_e {
+    STEP_CALL,
+    STEP_RETURN,
+    STEP_YIELD,
+    STEP_FAIL
+} step_result_t;
+
+typedef struct frame_s {
+    uint8_t kind;
+    uint8_t state;
+    /* query token being matched */
+    encoded_token_t token;
+    /* index node to revert to */
+    const inode_t* node;
+    /* iterator over children or hvars */
+    uint32_t i;
+    uint32_t end;
+    /* arity left to complete a variable instantiation */
+    uint32_t arity;
+    /* variable being solved and its instantiation size to revert to */
+    uint32_t var_id;
+    uint32_t var_size;
+    /* tokens to revert */
+    uint32_t count;
+    /* trail size to revert to */
+    uint32_t trail_size;
+} frame_t;
+
+struct query_cursor_s {
+    /* query tokens and iterator */
+    token_stack_t query_stack;
+    /* index iterator and its depth */
+    const inode_t* curr_index_inode;
+    uint32_t depth;
+
+    /* var instantiations, indexed by var id */
+    var_instantiation_t vars[VAR_ID_MAX + 1];
+    /* var being solved */
+    uint32_t solving_var_id;
+    /* query subterms taken by pending var matches */
+    token_stack_t taken_tokens;
+    /* vars solved by pending unifications, as var tokens */
+    token_stack_t trail;
+    /* terms being unified, next token on top */
+    token_stack_t unify_query;
+    token_stack_t unify_index;
+    /* scratch space of a single step */
+    token_stack_t scratch;
+    /* instantiation returned by query_cursor_get_instantiation() */
+    token_stack_t resolved;
+
+    /* pending steps */
+    frame_t* frames;
+    uint32_t num_frames;
+    uint32_t frames_capacity;
+    bool failed;
+
+    /* index allocator */
+    const memsector_header_t* alloc;
+
+    /* range check */
+    range_callback_t range_cb;
+    void* range_cb_handle;
+
+    /* split check, split frame and current branch */
+    split_callback_t split_cb;
+    void* split_cb_handle;
+    uint32_t split_depth;
+    uint32_t branch;
+
+    /* prune check */
+    prune_callback_t prune_cb;
+    void* prune_cb_handle;
+
+    /* limits, visited index nodes and steps */
+    uint64_t max_nodes;
+    stop_callback_t stop_cb;
+    void* stop_cb_handle;
+    uint64_t visited;
+    uint64_t steps;
+    bool limited;
+
+    /* work counters, besides the visited nodes */
+    uint64_t child_lookups;
+    uint64_t range_rejects;
+    uint64_t backtracks[VAR_ID_MAX + 1];
+};
+
+/*--------------------------------------------------------------------------*/
+/* Local methods                                                            */
+/*--------------------------------------------------------------------------*/
+
+static int grow(void** data, uint32_t* capacity, uint32_t min_capacity,
+                size_t elem_size);
+
+static bool limit_reached(query_cursor_t* cursor);
+
+static int step_process_query_token(query_cursor_t* cursor, frame_t* frame);
+
+static int step_match_range(query_cursor_t* cursor, frame_t* frame);
+
+static int step_match_var_to_index(query_cursor_t* cursor, frame_t* frame);
+
+static int step_match_var_to_query(query_cursor_t* cursor, frame_t* frame);
+
+static int push_solved_var(query_cursor_t* cursor, token_stack_t* stack,
+                           uint32_t var_id);
+
+/*--------------------------------------------------------------------------*/
+/* Token stack                                                              */
+/*--------------------------------------------------------------------------*/
+
+static inline int token_stack_reserve(token_stack_t* RESTRICT stack,
+                                      uint32_t extra) {
+    if (stack->capacity - stack->size >= extra) return 0;
+    if (extra > MAX_STACK_CAPACITY - stack->size) return -1;
+
+    return grow((void**)&stack->data, &stack->capacity, stack->size + extra,
+                sizeof(encoded_token_t));
+}
 
 static inline encoded_token_t token_stack_pop(token_stack_t* RESTRICT stack) {
     stack->size--;
     return stack->data[stack->size];
 }
 
+/* push a token after reserving space for it */
 static inline void token_stack_push(token_stack_t* RESTRICT stack,
                                     encoded_token_t token) {
+    assert(stack->size < stack->capacity);
     stack->data[stack->size] = token;
     stack->size++;
 }
 
 static inline void token_stack_pop_many(token_stack_t* RESTRICT stack,
-                                        int to_pop) {
+                                        uint32_t to_pop) {
     assert(stack->size >= to_pop);
     stack->size -= to_pop;
 }
@@ -74,378 +232,923 @@ static inline bool token_stack_empty(const token_stack_t* RESTRICT stack) {
     return (stack->size == 0);
 }
 
-typedef struct query_ctxt_s {
-    /* query tokens and iterator */
-    token_stack_t query_stack;
-    /* index iterator */
-    const inode_t* curr_index_inode;
-    token_stack_t index_stack;
+static inline void token_stack_destroy(token_stack_t* RESTRICT stack) {
+    free(stack->data);
+    stack->data = NULL;
+    stack->size = stack->capacity = 0;
+}
 
-    /* var instantiations */
-    var_instantiation_t vars[VAR_ID_MAX];
-    /* var solve stack */
-    uint32_t solving_var_id;
+/*--------------------------------------------------------------------------*/
+/* Implementation                                                           */
+/*--------------------------------------------------------------------------*/
 
-    /* index allocator */
-    const memsector_header_t* alloc;
+query_cursor_t* query_cursor_create(index_handle_t* RESTRICT index,
+                                    encoded_formula_t* RESTRICT query,
+                                    range_callback_t range_cb,
+                                    void* range_cb_handle) {
+    query_cursor_t* cursor = (query_cursor_t*)calloc(1, sizeof(*cursor));
+    uint32_t i;
 
-    /* result callback */
-    result_callback_t result_cb;
-    void* result_cb_handle;
-} query_ctxt_t;
+    FAIL_ON(cursor == NULL);
+    FAIL_ON(query->size > MAX_STACK_CAPACITY);
 
-/*--------------------------------------------------------------------------*/
-/* Local methods                                                            */
-/*--------------------------------------------------------------------------*/
+    // initialize query stack
+    FAIL_ON(token_stack_reserve(&cursor->query_stack, query->size) != 0);
+    for (i = 0; i < query->size; i++) {
+        token_stack_push(&cursor->query_stack,
+                         query->data[query->size - i - 1]);
+    }
 
-static void query_ctxt_init(query_ctxt_t* RESTRICT query_ctxt,
-                            index_handle_t* RESTRICT index,
-                            encoded_formula_t* RESTRICT query,
-                            result_callback_t result_cb,
-                            void* RESTRICT result_cb_handle);
+    // initialize index
+    cursor->curr_index_inode = (inode_t*)index->root;
+    cursor->alloc = index->ms;
 
-static int process_query_token(query_ctxt_t* query_ctxt);
+    // initialize range check
+    cursor->range_cb = range_cb;
+    cursor->range_cb_handle = range_cb_handle;
 
-static int match_var_to_index(query_ctxt_t* query_ctxt, uint32_t arity);
+    // no split until query_cursor_set_split()
+    cursor->split_depth = NO_SPLIT;
 
-static int match_var_to_query(query_ctxt_t* query_ctxt, uint32_t arity);
+    // start with processing the first query token
+    FAIL_ON(grow((void**)&cursor->frames, &cursor->frames_capacity, 1,
+                 sizeof(frame_t)) != 0);
+    memset(&cursor->frames[0], 0, sizeof(frame_t));
+    cursor->frames[0].kind = PROCESS_QUERY_TOKEN;
+    cursor->frames[0].state = FRAME_START;
+    cursor->num_frames = 1;
 
-static int match_var_to_stack(query_ctxt_t* query_ctxt, token_stack_t* stack);
+    return cursor;
 
-/*--------------------------------------------------------------------------*/
-/* Implementation                                                           */
-/*--------------------------------------------------------------------------*/
+fail:
+    query_cursor_destroy(cursor);
+    return NULL;
+}
+
+int query_cursor_next(query_cursor_t* RESTRICT cursor,
+                      const leaf_t** RESTRICT leaf) {
+    if (cursor->failed) return QUERY_ERROR;
+    if (cursor->limited) return QUERY_LIMIT;
+
+    while (cursor->num_frames > 0) {
+        frame_t* frame = &cursor->frames[cursor->num_frames - 1];
+        int step;
+
+        if (limit_reached(cursor)) {
+            cursor->limited = true;
+            return QUERY_LIMIT;
+        }
+
+        switch (frame->kind) {
+        case PROCESS_QUERY_TOKEN:
+            step = step_process_query_token(cursor, frame);
+            break;
+        case MATCH_RANGE:
+            step = step_match_range(cursor, frame);
+            break;
+        case MATCH_VAR_TO_INDEX:
+            step = step_match_var_to_index(cursor, frame);
+            break;
+        case MATCH_VAR_TO_QUERY:
+            step = step_match_var_to_query(cursor, frame);
+            break;
+        default:
+            assert(false);
+            step = STEP_FAIL;
+        }
+
+        switch (step) {
+        case STEP_CALL:
+            break;
+        case STEP_RETURN:
+            cursor->num_frames--;
+            break;
+        case STEP_YIELD:
+            cursor->num_frames--;
+            // the only leaf of a search without branches
+            if (cursor->split_cb != NULL && cursor->split_depth == NO_SPLIT &&
+                !cursor->split_cb(cursor->split_cb_handle, 0)) {
+                break;
+            }
+            *leaf = (const leaf_t*)cursor->curr_index_inode;
+            assert((*leaf)->type == LEAF_NODE);
+            return QUERY_CONTINUE;
+        default:
+            cursor->failed = true;
+            return QUERY_ERROR;
+        }
+    }
+
+    return QUERY_STOP;
+}
+
+void query_cursor_set_split(query_cursor_t* RESTRICT cursor,
+                            split_callback_t split_cb, void* split_cb_handle) {
+    cursor->split_cb = split_cb;
+    cursor->split_cb_handle = split_cb_handle;
+}
+
+uint32_t query_cursor_get_branch(const query_cursor_t* cursor) {
+    return cursor->branch;
+}
+
+void query_cursor_set_prune(query_cursor_t* RESTRICT cursor,
+                            prune_callback_t prune_cb, void* prune_cb_handle) {
+    cursor->prune_cb = prune_cb;
+    cursor->prune_cb_handle = prune_cb_handle;
+}
+
+void query_cursor_set_limits(query_cursor_t* RESTRICT cursor,
+                             uint64_t max_nodes, stop_callback_t stop_cb,
+                             void* stop_cb_handle) {
+    cursor->max_nodes = max_nodes;
+    cursor->stop_cb = stop_cb;
+    cursor->stop_cb_handle = stop_cb_handle;
+}
+
+uint64_t query_cursor_get_visited(const query_cursor_t* cursor) {
+    return cursor->visited;
+}
+
+void query_cursor_add_stats(const query_cursor_t* RESTRICT cursor,
+                            query_stats_t* RESTRICT stats) {
+    uint32_t i;
+
+    stats->visited += cursor->visited;
+    stats->child_lookups += cursor->child_lookups;
+    stats->range_rejects += cursor->range_rejects;
+    for (i = 0; i <= VAR_ID_MAX; i++) {
+        stats->backtracks[i] += cursor->backtracks[i];
+    }
+}
+
+uint32_t query_cursor_get_depth(const query_cursor_t* cursor) {
+    return cursor->depth;
+}
+
+uint32_t query_cursor_get_instantiation(query_cursor_t* RESTRICT cursor,
+                                        uint32_t var_id,
+                                        const encoded_token_t** tokens) {
+    const var_instantiation_t* var = &cursor->vars[var_id];
+    token_stack_t* pending = &cursor->scratch;
+    token_stack_t* resolved = &cursor->resolved;
+    uint32_t i;
+
+    assert(var_id <= VAR_ID_MAX);
+    if (!var->solved) return 0;
+
+    // vars solved after var was are replaced by their instantiation
+    for (i = 0; i < var->tokens.size; i++) {
+        encoded_token_t token = var->tokens.data[i];
+        if (encoded_token_is_var(token) &&
+            cursor->vars[encoded_token_get_id(token)].solved) {
+            break;
+        }
+    }
+    if (i == var->tokens.size) {
+        *tokens = var->tokens.data;
+        return var->tokens.size;
+    }
+
+    pending->size = 0;
+    resolved->size = 0;
+    if (push_solved_var(cursor, pending, var_id) != 0) return 0;
+    while (!token_stack_empty(pending)) {
+        encoded_token_t token = token_stack_pop(pending);
+        if (encoded_token_is_var(token) &&
+            cursor->vars[encoded_token_get_id(token)].solved) {
+            if (push_solved_var(cursor, pending,
+                                encoded_token_get_id(token)) != 0) {
+                return 0;
+            }
+            continue;
+        }
+        if (token_stack_reserve(resolved, 1) != 0) return 0;
+        token_stack_push(resolved, token);
+    }
+    *tokens = resolved->data;
+
+    return resolved->size;
+}
+
+void query_cursor_destroy(query_cursor_t* cursor) {
+    uint32_t i;
+
+    if (cursor == NULL) return;
+
+    token_stack_destroy(&cursor->query_stack);
+    token_stack_destroy(&cursor->taken_tokens);
+    token_stack_destroy(&cursor->trail);
+    token_stack_destroy(&cursor->unify_query);
+    token_stack_destroy(&cursor->unify_index);
+    token_stack_destroy(&cursor->scratch);
+    token_stack_destroy(&cursor->resolved);
+    for (i = 0; i <= VAR_ID_MAX; i++) {
+        token_stack_destroy(&cursor->vars[i].tokens);
+    }
+    free(cursor->frames);
+    free(cursor);
+}
+
+bool query_engine_descend(const inode_t* RESTRICT node, encoded_token_t token,
+                          const inode_t** RESTRICT child) {
+    memsector_long_off_t off;
+
+    if (encoded_token_is_var(token) || encoded_token_is_range(token)) {
+        return false;
+    }
+    if (node->type == LONG_INTERNAL_NODE) {
+        off = inode_long_get_child((inode_long_t*)node, token);
+    } else if (node->type == INTERNAL_NODE) {
+        off = inode_get_child(node, token);
+    } else {
+        return false;
+    }
+    // the token may also match the hvars of the node
+    if (inode_get_num_vars(node) > 0) return false;
+
+    if (off == MEMSECTOR_OFF_NULL) {
+        *child = NULL;
+    } else {
+        *child = (const inode_t*)memsector_relOff2addr((char*)node, off);
+    }
+
+    return true;
+}
 
 int query_engine_run(index_handle_t* RESTRICT index,
                      encoded_formula_t* RESTRICT query,
                      result_callback_t result_cb,
                      void* RESTRICT result_cb_handle) {
-    query_ctxt_t query_ctxt;
+    return query_engine_run_with_ranges(index, query, NULL, NULL, result_cb,
+                                        result_cb_handle);
+}
+
+int query_engine_run_with_ranges(index_handle_t* RESTRICT index,
+                                 encoded_formula_t* RESTRICT query,
+                                 range_callback_t range_cb,
+                                 void* range_cb_handle,
+                                 result_callback_t result_cb,
+                                 void* result_cb_handle) {
+    query_cursor_t* cursor;
+    const leaf_t* leaf;
+    int ret;
+
+    cursor = query_cursor_create(index, query, range_cb, range_cb_handle);
+    if (cursor == NULL) return QUERY_ERROR;
 
-    query_ctxt_init(&query_ctxt, index, query, result_cb, result_cb_handle);
+    for (;;) {
+        ret = query_cursor_next(cursor, &leaf);
+        if (ret == QUERY_STOP) {
+            // all leaves were reported
+            ret = QUERY_CONTINUE;
+            break;
+        }
+        if (ret != QUERY_CONTINUE) break;
+
+        ret = result_cb(result_cb_handle, leaf);
+        if (ret != QUERY_CONTINUE) break;
+    }
+    query_cursor_destroy(cursor);
 
-    return process_query_token(&query_ctxt);
+    return ret;
 }
 
 /*--------------------------------------------------------------------------*/
 /* Local Implementation                                                     */
 /*--------------------------------------------------------------------------*/
 
-static void query_ctxt_init(query_ctxt_t* RESTRICT query_ctxt,
-                            index_handle_t* RESTRICT index,
-                            encoded_formula_t* RESTRICT query,
-                            result_callback_t result_cb,
-                            void* RESTRICT result_cb_handle) {
-    int i;
+static int grow(void** data, uint32_t* capacity, uint32_t min_capacity,
+                size_t elem_size) {
+    uint32_t new_capacity = *capacity ? *capacity : INITIAL_STACK_CAPACITY;
+    void* new_data;
 
-    // initialize variables table
-    for (i = 0; i < VAR_ID_MAX; i++) {
-        query_ctxt->vars[i].solved = false;
+    while (new_capacity < min_capacity) {
+        if (new_capacity > MAX_STACK_CAPACITY / 2) return -1;
+        new_capacity *= 2;
     }
+    new_data = realloc(*data, (size_t)new_capacity * elem_size);
+    if (new_data == NULL) return -1;
 
-    // initialize query stack
-    int size = query->size;
-    query_ctxt->query_stack.size = size;
-    for (i = 0; i < size; i++) {
-        query_ctxt->query_stack.data[size - i - 1] = query->data[i];
+    *data = new_data;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+/* Check the limits of the cursor before its next step */
+static bool limit_reached(query_cursor_t* RESTRICT cursor) {
+    // searches visiting up to max_nodes nodes complete
+    if (cursor->max_nodes != 0 && cursor->visited > cursor->max_nodes) {
+        return true;
+    }
+    cursor->steps++;
+    if (cursor->stop_cb == NULL || cursor->steps % STOP_CHECK_INTERVAL != 0) {
+        return false;
     }
 
-    // intialize index
-    query_ctxt->curr_index_inode = (inode_t*)index->root;
-    query_ctxt->index_stack.size = 0;
+    return cursor->stop_cb(cursor->stop_cb_handle);
+}
+
+/* Push a frame for a sub-search. Frames may move, so the calling step must
+ * not access its own frame afterwards. */
+static int call(query_cursor_t* RESTRICT cursor, frame_kind_t kind,
+                encoded_token_t token, uint32_t arity) {
+    if (cursor->num_frames == cursor->frames_capacity &&
+        grow((void**)&cursor->frames, &cursor->frames_capacity,
+             cursor->num_frames + 1, sizeof(frame_t)) != 0) {
+        return STEP_FAIL;
+    }
 
-    // initialize memsector alloc
-    query_ctxt->alloc = index->ms;
+    frame_t* frame = &cursor->frames[cursor->num_frames];
+    frame->kind = kind;
+    frame->state = FRAME_START;
+    frame->token = token;
+    frame->arity = arity;
+    cursor->num_frames++;
 
-    // initialize result callback data
-    query_ctxt->result_cb = result_cb;
-    query_ctxt->result_cb_handle = result_cb_handle;
+    return STEP_CALL;
 }
 
-static int process_query_token(query_ctxt_t* RESTRICT query_ctxt) {
-    int ret;
-    token_stack_t* query = &query_ctxt->query_stack;
+static inline int call_process_query_token(query_cursor_t* RESTRICT cursor) {
+    return call(cursor, PROCESS_QUERY_TOKEN, encoded_token(0, 0), 0);
+}
 
-    // check if we reached a leaf - report results
-    if (token_stack_empty(query)) {
-        const leaf_t* leaf = (leaf_t*)query_ctxt->curr_index_inode;
-        assert(leaf->type == LEAF_NODE);
+static inline uint32_t inode_get_size(const inode_t* inode) {
+    if (inode->type == LONG_INTERNAL_NODE) {
+        return ((const inode_long_t*)inode)->size;
+    } else {
+        return inode->size;
+    }
+}
 
-        return query_ctxt->result_cb(query_ctxt->result_cb_handle, leaf);
+static inline encoded_token_t inode_get_entry(const inode_t* inode,
+                                              uint32_t i,
+                                              const inode_t** child) {
+    encoded_token_t token;
+    memsector_long_off_t off;
+
+    if (inode->type == LONG_INTERNAL_NODE) {
+        token = ((const inode_long_t*)inode)->data[i].token;
+        off = ((const inode_long_t*)inode)->data[i].off;
+    } else {
+        token = inode->data[i].token;
+        off = inode->data[i].off;
     }
+    *child = (const inode_t*)memsector_relOff2addr((const char*)inode, off);
 
-    // otherwise get next token and find match
-    encoded_token_t query_token = token_stack_pop(query);
+    return token;
+}
 
-    if (encoded_token_is_var(query_token)) {  // variable query token
-        int var_id = encoded_token_get_id(query_token);
-        if (query_ctxt->vars[var_id].solved) {  // solved
-            var_instantiation_t* var = &query_ctxt->vars[var_id];
-            int i;
-            int size = var->num_tokens;
-            for (i = 0; i < size; ++i) {
-                token_stack_push(query, var->tokens[size - i - 1]);
-            }
+/* Set the iterator of a frame to the positions of the var children of node */
+static inline void iterate_vars(frame_t* RESTRICT frame,
+                                const inode_t* node) {
+    if (inode_get_num_vars(node) > 0) {
+        inode_vars_t vars = inode_get_vars(node);
+        frame->i = vars.begin;
+        frame->end = vars.end;
+    } else {
+        frame->i = 0;
+        frame->end = 0;
+    }
+}
 
-            // continue
-            ret = process_query_token(query_ctxt);
-            if (ret != QUERY_CONTINUE) return ret;
-
-            // revert token stack
-            token_stack_pop_many(query, size);
-        } else {  // unsolved
-            query_ctxt->solving_var_id = var_id;
-            query_ctxt->vars[var_id].num_tokens = 0;
-            ret = match_var_to_index(query_ctxt, 1);
-            if (ret != QUERY_CONTINUE) return ret;
-        }
+/**
+ * @brief Check a branch of a frame with num_branches alternatives against
+ * the split callback. The first frame with several alternatives becomes the
+ * split frame, branches of other frames are always taken.
+ */
+static bool take_branch(query_cursor_t* RESTRICT cursor,
+                        const frame_t* RESTRICT frame, uint32_t num_branches,
+                        uint32_t branch) {
+    uint32_t depth = (uint32_t)(frame - cursor->frames);
+
+    if (cursor->split_cb == NULL) return true;
+    if (cursor->split_depth == NO_SPLIT) {
+        if (num_branches < 2) return true;
+        cursor->split_depth = depth;
+    } else if (cursor->split_depth != depth) {
+        return true;
+    }
+    cursor->branch = branch;
 
-        token_stack_push(query, query_token);
-    } else {  // constant query token
-        if (!token_stack_empty(&query_ctxt->index_stack)) {  // index stack
-            encoded_token_t index_token =
-                token_stack_pop(&query_ctxt->index_stack);
-            if (encoded_token_is_var(index_token)) {  // variable index token
-                // push back query token to stack
-                token_stack_push(query, query_token);
-
-                int var_id = encoded_token_get_id(index_token);
-                query_ctxt->solving_var_id = var_id;
-                ret = match_var_to_query(query_ctxt, 1);
-                if (ret != QUERY_CONTINUE) return ret;
-            } else {  // constant index token
-                if (memcmp(&query_token, &index_token, sizeof(query_token)) ==
-                    0) {
-                    // continue
-                    ret = process_query_token(query_ctxt);
-                    if (ret != QUERY_CONTINUE) return ret;
-                }
-                // revert query stack
-                token_stack_push(query, query_token);
-            }
-            token_stack_push(&query_ctxt->index_stack, index_token);
-        } else {  // regular index
-            const inode_t* curr = query_ctxt->curr_index_inode;
-            memsector_long_off_t off;
-            if (curr->type == LONG_INTERNAL_NODE) {
-                off = inode_long_get_child((inode_long_t*)curr, query_token);
-            } else if (curr->type == INTERNAL_NODE) {
-                off = inode_get_child(curr, query_token);
-            } else {
-                assert(false);
-            }
-            if (off != MEMSECTOR_OFF_NULL) {  // move to corresponding child
-                const inode_t* child =
-                    (inode_t*)memsector_relOff2addr((char*)curr, off);
+    return cursor->split_cb(cursor->split_cb_handle, branch);
+}
+
+static inline bool prune(const query_cursor_t* RESTRICT cursor,
+                         const inode_t* node) {
+    if (cursor->prune_cb == NULL || node->type == LEAF_NODE) return false;
 
-                query_ctxt->curr_index_inode = child;
+    return cursor->prune_cb(cursor->prune_cb_handle, node);
+}
+
+/* Move the index iterator to a child of the current node */
+static inline void enter_child(query_cursor_t* RESTRICT cursor,
+                               const inode_t* child) {
+    cursor->curr_index_inode = child;
+    cursor->depth++;
+    cursor->visited++;
+}
+
+/* Move the index iterator back to the parent node */
+static inline void leave_child(query_cursor_t* RESTRICT cursor,
+                               const inode_t* parent) {
+    cursor->curr_index_inode = parent;
+    cursor->depth--;
+}
+
+static bool range_accepts(const query_cursor_t* RESTRICT cursor,
+                          encoded_token_t range, encoded_token_t token) {
+    if (cursor->range_cb == NULL) return false;
+    if (token.arity != 0 || encoded_token_is_var(token)) return false;
+
+    return cursor->range_cb(cursor->range_cb_handle, range, token);
+}
 
-                // continue
-                ret = process_query_token(query_ctxt);
-                if (ret != QUERY_CONTINUE) return ret;
+/* Push the tokens of a solved variable on stack, in reverse order */
+static int push_solved_var(query_cursor_t* RESTRICT cursor,
+                           token_stack_t* RESTRICT stack, uint32_t var_id) {
+    const token_stack_t* tokens = &cursor->vars[var_id].tokens;
+    uint32_t i;
 
-                // revert
-                query_ctxt->curr_index_inode = curr;
+    if (token_stack_reserve(stack, tokens->size) != 0) return -1;
+    for (i = tokens->size; i > 0; --i) {
+        token_stack_push(stack, tokens->data[i - 1]);
+    }
+
+    return 0;
+}
 
-                // revert query token before hvars processing
-                token_stack_push(query, query_token);
+/**
+ * @brief Save the tokens of scratch to the variable being solved, replacing
+ * solved variables by their instantiation.
+ * @return 0 if the instantiation is complete, 1 if the variable references
+ * itself and remains unsolved, -1 if it is infinitely recursive, -2 on
+ * allocation failure
+ */
+static int instantiate_var(query_cursor_t* RESTRICT cursor, uint32_t var_id,
+                           uint32_t* num_pushed) {
+    var_instantiation_t* var = &cursor->vars[var_id];
+    token_stack_t* scratch = &cursor->scratch;
 
-                // hvars
-                uint32_t hvar_id_max =
-                    inode_get_max_var(query_ctxt->curr_index_inode);
-                uint32_t hvar_id;
-                for (hvar_id = 0; hvar_id < hvar_id_max; hvar_id++) {
-                    query_ctxt->solving_var_id = hvar_id;
-                    ret = match_var_to_query(query_ctxt, 1);
-                    if (ret != QUERY_CONTINUE) return ret;
+    while (!token_stack_empty(scratch)) {
+        encoded_token_t token = token_stack_pop(scratch);
+        if (encoded_token_is_var(token)) {  // var
+            uint32_t token_var_id = encoded_token_get_id(token);
+            // check self-referencing variable
+            if (token_var_id == var_id) {
+                if (token_stack_empty(scratch) && var->tokens.size == 0) {
+                    // variable self references (e.g. Q1 -> H1 -> Q1)
+                    // => set as not solved and proceed
+                    return 1;
+                } else {
+                    // variable is infinitely recursive
+                    // (e.g. Q1 -> f(H1) -> f(g(Q1)))
+                    // => no solution
+                    return -1;
+                }
+            }
+            if (cursor->vars[token_var_id].solved) {  // solved var
+                if (push_solved_var(cursor, scratch, token_var_id) != 0) {
+                    return -2;
                 }
-            } else {  // no child node exists
-                // revert query token
-                token_stack_push(query, query_token);
+                continue;
             }
         }
+        // save to var_instantiation
+        if (token_stack_reserve(&var->tokens, 1) != 0) return -2;
+        token_stack_push(&var->tokens, token);
+        (*num_pushed)++;
     }
 
-    return QUERY_CONTINUE;
+    return 0;
+}
+
+/* Revert the vars solved since the trail had size trail_size */
+static void undo_trail(query_cursor_t* RESTRICT cursor, uint32_t trail_size) {
+    while (cursor->trail.size > trail_size) {
+        var_instantiation_t* var =
+            &cursor->vars[encoded_token_get_id(token_stack_pop(&cursor->trail))];
+        var->solved = false;
+        var->tokens.size = 0;
+    }
 }
 
-static int match_var_to_index(query_ctxt_t* RESTRICT query_ctxt,
-                              uint32_t arity) {
+/**
+ * @brief Solve an unsolved variable with the subterm on top of terms, which
+ * is removed. The variable is pushed on the trail if solved.
+ * @return 0 on success, -1 if the variable occurs in the subterm, -2 on
+ * allocation failure
+ */
+static int bind_var(query_cursor_t* RESTRICT cursor, uint32_t var_id,
+                    token_stack_t* RESTRICT terms) {
+    token_stack_t* scratch = &cursor->scratch;
+    uint32_t num_pushed = 0;
+    uint32_t count = 0;
+    int arity = 1;
     int ret;
-    var_instantiation_t* var = &query_ctxt->vars[query_ctxt->solving_var_id];
 
-    if (arity == 0) {
-        uint32_t var_id = query_ctxt->solving_var_id;
-        if (var->num_tokens > 0) {
-            var->solved = true;
-        }
+    // the subterm is the top of terms, in the order of scratch
+    while (arity > 0) {
+        arity += encoded_token_get_arity(terms->data[terms->size - 1 - count]);
+        arity--;
+        count++;
+    }
+    scratch->size = 0;
+    if (token_stack_reserve(scratch, count) != 0) return -2;
+    memcpy(scratch->data, terms->data + terms->size - count,
+           count * sizeof(encoded_token_t));
+    scratch->size = count;
+    token_stack_pop_many(terms, count);
+
+    cursor->vars[var_id].tokens.size = 0;
+    ret = instantiate_var(cursor, var_id, &num_pushed);
+    if (ret < 0) {
+        cursor->vars[var_id].tokens.size = 0;
+        return ret;
+    }
+    if (ret == 0) {
+        if (token_stack_reserve(&cursor->trail, 1) != 0) return -2;
+        token_stack_push(&cursor->trail, encoded_token(var_id, 0));
+        cursor->vars[var_id].solved = true;
+    }
 
-        // continue
-        ret = process_query_token(query_ctxt);
-        if (ret != QUERY_CONTINUE) return ret;
+    return 0;
+}
 
-        query_ctxt->solving_var_id = var_id;
-        var->solved = false;
+/**
+ * @brief Unify the query subterm in scratch, next token on top, with a var,
+ * solving the unsolved vars of both. Solved vars are pushed on the trail
+ * and stay solved on failure.
+ * @return 0 on success, -1 if the terms do not unify, -2 on allocation
+ * failure
+ */
+static int unify_var(query_cursor_t* RESTRICT cursor, uint32_t var_id) {
+    token_stack_t* query = &cursor->unify_query;
+    token_stack_t* index = &cursor->unify_index;
+
+    query->size = 0;
+    if (token_stack_reserve(query, cursor->scratch.size) != 0) return -2;
+    memcpy(query->data, cursor->scratch.data,
+           cursor->scratch.size * sizeof(encoded_token_t));
+    query->size = cursor->scratch.size;
+    index->size = 0;
+    if (token_stack_reserve(index, 1) != 0) return -2;
+    token_stack_push(index, encoded_token(var_id, 0));
+
+    while (!token_stack_empty(query)) {
+        encoded_token_t q = token_stack_pop(query);  // query side
+        encoded_token_t x = token_stack_pop(index);  // index side
+        bool q_var = encoded_token_is_var(q);
+        bool x_var = encoded_token_is_var(x);
+        int ret = 0;
+
+        // replace solved vars by their instantiation
+        if (q_var && cursor->vars[encoded_token_get_id(q)].solved) {
+            if (push_solved_var(cursor, query, encoded_token_get_id(q)) != 0) {
+                return -2;
+            }
+            token_stack_push(index, x);
+            continue;
+        }
+        if (x_var && cursor->vars[encoded_token_get_id(x)].solved) {
+            if (push_solved_var(cursor, index, encoded_token_get_id(x)) != 0) {
+                return -2;
+            }
+            token_stack_push(query, q);
+            continue;
+        }
 
-    } else if (!token_stack_empty(&query_ctxt->index_stack)) {  // index stack
-        return match_var_to_stack(query_ctxt, &query_ctxt->index_stack);
-    } else {  // regular index
-        uint32_t i;
-        uint32_t size = query_ctxt->curr_index_inode->size;
-        const encoded_token_dict_entry_t* data;
-        const encoded_token_dict_entry_long_t* long_data;
-        const node_type_t node_type = query_ctxt->curr_index_inode->type;
-        if (node_type == LONG_INTERNAL_NODE) {
-            long_data = ((inode_long_t*)query_ctxt->curr_index_inode)->data;
-        } else {
-            data = query_ctxt->curr_index_inode->data;
+        if (q_var && x_var &&
+            encoded_token_get_id(q) == encoded_token_get_id(x)) {
+            continue;
+        }
+        if (q_var) {
+            token_stack_push(index, x);
+            ret = bind_var(cursor, encoded_token_get_id(q), index);
+        } else if (x_var) {
+            token_stack_push(query, q);
+            ret = bind_var(cursor, encoded_token_get_id(x), query);
+        } else if (q.id != x.id || q.arity != x.arity) {
+            ret = -1;
         }
-        for (i = 0; i < size; ++i) {
-            encoded_token_t entry_token;
-            memsector_long_off_t entry_off;
-            if (node_type == LONG_INTERNAL_NODE) {
-                entry_token = long_data->token;
-                entry_off = long_data->off;
+        if (ret != 0) return ret;
+    }
+    assert(token_stack_empty(index));
+
+    return 0;
+}
+
+static int step_process_query_token(query_cursor_t* RESTRICT cursor,
+                                    frame_t* RESTRICT frame) {
+    token_stack_t* query = &cursor->query_stack;
+
+    switch (frame->state) {
+    case FRAME_START:
+        // check if we reached a leaf - report results
+        if (token_stack_empty(query)) return STEP_YIELD;
+
+        // otherwise get next token and find match
+        frame->token = token_stack_pop(query);
+
+        if (encoded_token_is_range(frame->token)) {  // range query token
+            frame->state = PROCESS_RESTORE_TOKEN;
+            return call(cursor, MATCH_RANGE, frame->token, 0);
+        } else if (encoded_token_is_var(frame->token)) {  // variable
+            uint32_t var_id = encoded_token_get_id(frame->token);
+            var_instantiation_t* var = &cursor->vars[var_id];
+            if (var->solved) {  // solved
+                if (push_solved_var(cursor, query, var_id) != 0) {
+                    return STEP_FAIL;
+                }
+                frame->count = var->tokens.size;
+                frame->state = PROCESS_SOLVED_VAR_DONE;
+                return call_process_query_token(cursor);
+            } else {  // unsolved
+                cursor->solving_var_id = var_id;
+                var->tokens.size = 0;
+                frame->state = PROCESS_RESTORE_TOKEN;
+                return call(cursor, MATCH_VAR_TO_INDEX, frame->token, 1);
+            }
+        } else {  // constant query token
+            const inode_t* curr = cursor->curr_index_inode;
+            memsector_long_off_t off;
+            frame->node = curr;
+            cursor->child_lookups++;
+            if (curr->type == LONG_INTERNAL_NODE) {
+                off = inode_long_get_child((inode_long_t*)curr, frame->token);
+            } else if (curr->type == INTERNAL_NODE) {
+                off = inode_get_child(curr, frame->token);
             } else {
-                entry_token = data->token;
-                entry_off = data->off;
+                assert(false);
+                off = MEMSECTOR_OFF_NULL;
             }
-            int pushed_var_tokens = 0;
-            token_stack_t var_stack;
-            var_stack.size = 0;
-            token_stack_push(&var_stack, entry_token);
-
-            while (!token_stack_empty(&var_stack)) {
-                encoded_token_t token = token_stack_pop(&var_stack);
-                if (encoded_token_is_var(token)) {  // var
-                    uint32_t var_id = encoded_token_get_id(token);
-                    // check self-referencing variable
-                    if (var_id == query_ctxt->solving_var_id) {
-                        if (token_stack_empty(&var_stack) &&
-                            var->num_tokens == 0) {
-                            // variable self references (e.g. Q1 -> H1 -> Q1)
-                            // => set as not solved and proceed
-                            break;
-                        } else {
-                            // variable is infinitely recursive
-                            // (e.g. Q1 -> f(H1) -> f(g(Q1)))
-                            // => no solution
-                            goto revert_index;
-                        }
-                    }
-                    if (query_ctxt->vars[var_id].solved) {  // solved var
-                        var_instantiation_t* solved_var =
-                            &query_ctxt->vars[var_id];
-                        // push in reverse order on stack
-                        int i;
-                        for (i = solved_var->num_tokens - 1; i >= 0; --i) {
-                            token_stack_push(&var_stack, solved_var->tokens[i]);
-                        }
-                        continue;
-                    }
+
+            // move to corresponding child, if any
+            if (off != MEMSECTOR_OFF_NULL &&
+                take_branch(cursor, frame, inode_get_num_vars(curr) + 1, 0)) {
+                const inode_t* child =
+                    (const inode_t*)memsector_relOff2addr((char*)curr, off);
+                if (!prune(cursor, child)) {
+                    enter_child(cursor, child);
+                    frame->state = PROCESS_CHILD_DONE;
+                    return call_process_query_token(cursor);
                 }
-                // save to var_instantiation
-                var->tokens[var->num_tokens] = token;
-                var->num_tokens++;
-                pushed_var_tokens++;
             }
 
-            // advance in the index
-            const inode_t* curr = query_ctxt->curr_index_inode;
-            const inode_t* child =
-                (inode_t*)memsector_relOff2addr((char*)curr, entry_off);
-            query_ctxt->curr_index_inode = child;
-
-            // continue
-            ret = match_var_to_index(query_ctxt, arity + entry_token.arity - 1);
-            if (ret != QUERY_CONTINUE) return ret;
+            // revert query token before hvars processing
+            token_stack_push(query, frame->token);
+            iterate_vars(frame, curr);
+            frame->state = PROCESS_MATCH_HVARS;
+            return step_process_query_token(cursor, frame);
+        }
 
-        revert_index:
-            // revert
-            var->num_tokens -= pushed_var_tokens;
-            query_ctxt->curr_index_inode = curr;
+    case PROCESS_RESTORE_TOKEN:
+        token_stack_push(query, frame->token);
+        return STEP_RETURN;
+
+    case PROCESS_SOLVED_VAR_DONE:
+        // revert token stack
+        token_stack_pop_many(query, frame->count);
+        token_stack_push(query, frame->token);
+        return STEP_RETURN;
+
+    case PROCESS_CHILD_DONE:
+        // revert
+        leave_child(cursor, frame->node);
+
+        // revert query token before hvars processing
+        token_stack_push(query, frame->token);
+
+        iterate_vars(frame, frame->node);
+        frame->state = PROCESS_MATCH_HVARS;
+        /* fall through */
+
+    case PROCESS_MATCH_HVARS:
+        // hvars, branches numbered by position after the constant child
+        while (frame->i < frame->end) {
+            const inode_t* child;
+            uint32_t pos = frame->i++;
+            encoded_token_t entry_token =
+                inode_get_entry(frame->node, pos, &child);
+            if (!encoded_token_is_var(entry_token)) continue;
+            if (!take_branch(cursor, frame,
+                             inode_get_num_vars(frame->node) + 1,
+                             pos - inode_get_vars(frame->node).begin + 1) ||
+                prune(cursor, child)) {
+                continue;
+            }
+            // the hvar takes the query subterm in the child
+            enter_child(cursor, child);
+            cursor->solving_var_id = encoded_token_get_id(entry_token);
+            frame->state = PROCESS_HVAR_DONE;
+            return call(cursor, MATCH_VAR_TO_QUERY, frame->token, 1);
         }
-    }
+        return STEP_RETURN;
 
-    return QUERY_CONTINUE;
-}
+    case PROCESS_HVAR_DONE:
+        leave_child(cursor, frame->node);
+        frame->state = PROCESS_MATCH_HVARS;
+        return step_process_query_token(cursor, frame);
 
-static int match_var_to_query(query_ctxt_t* query_ctxt, uint32_t arity) {
-    UNUSED(arity);
-    return match_var_to_stack(query_ctxt, &query_ctxt->query_stack);
+    default:
+        assert(false);
+        return STEP_FAIL;
+    }
 }
 
-static int match_var_to_stack(query_ctxt_t* query_ctxt, token_stack_t* stack) {
-    int ret;
-    var_instantiation_t* var = &query_ctxt->vars[query_ctxt->solving_var_id];
+static int step_match_range(query_cursor_t* RESTRICT cursor,
+                            frame_t* RESTRICT frame) {
+    switch (frame->state) {
+    case FRAME_START:
+        frame->node = cursor->curr_index_inode;
+        frame->i = 0;
+        frame->end = inode_get_size(frame->node);
+        frame->state = MATCH_CHILDREN;
+        /* fall through */
+
+    case MATCH_CHILDREN:
+        while (frame->i < frame->end) {
+            const inode_t* child;
+            encoded_token_t entry_token =
+                inode_get_entry(frame->node, frame->i, &child);
+            frame->i++;
+            if (!range_accepts(cursor, frame->token, entry_token)) {
+                cursor->range_rejects++;
+                continue;
+            }
+            if (!take_branch(cursor, frame, frame->end, frame->i - 1) ||
+                prune(cursor, child)) {
+                continue;
+            }
 
-    token_stack_t tmp_rev_stack;
-    tmp_rev_stack.size = 0;
+            enter_child(cursor, child);
+            frame->state = MATCH_CHILD_DONE;
+            return call_process_query_token(cursor);
+        }
+        return STEP_RETURN;
 
-    // move the var matching to a temp reverted stack
-    int arity = 1;
-    while (arity > 0) {
-        encoded_token_t token = token_stack_pop(stack);
-        arity += encoded_token_get_arity(token) - 1;
-        token_stack_push(&tmp_rev_stack, token);
-    }
+    case MATCH_CHILD_DONE:
+        // revert
+        leave_child(cursor, frame->node);
+        frame->state = MATCH_CHILDREN;
+        return step_match_range(cursor, frame);
 
-    // copy stack and revert
-    token_stack_t var_stack;
-    int i;
-    int size = tmp_rev_stack.size;
-    var_stack.size = size;
-    for (i = 0; i < size; ++i) {
-        var_stack.data[i] = tmp_rev_stack.data[size - 1 - i];
+    default:
+        assert(false);
+        return STEP_FAIL;
     }
+}
 
-    // simplify using solved vars and save to var_instantiation
-    bool solved = true;
-    while (!token_stack_empty(&var_stack)) {
-        encoded_token_t token = token_stack_pop(&var_stack);
-        if (encoded_token_is_var(token)) {  // var
-            uint32_t var_id = encoded_token_get_id(token);
-            // check self-referencing variable
-            if (var_id == query_ctxt->solving_var_id) {
-                if (token_stack_empty(&var_stack) && var->num_tokens == 0) {
-                    // variable self references (e.g. Q1 -> H1 -> Q1)
-                    // => set as not solved and proceed
-                    solved = false;
-                    break;
-                } else {
-                    // variable is infinitely recursive
-                    // (e.g. Q1 -> f(H1) -> f(g(Q1)))
-                    // => no solution
-                    goto revert_stack;
-                }
+static int step_match_var_to_index(query_cursor_t* RESTRICT cursor,
+                                   frame_t* RESTRICT frame) {
+    var_instantiation_t* var;
+
+    switch (frame->state) {
+    case FRAME_START:
+        frame->var_id = cursor->solving_var_id;
+        var = &cursor->vars[frame->var_id];
+        if (frame->arity == 0) {
+            if (var->tokens.size > 0) {
+                var->solved = true;
             }
-            if (query_ctxt->vars[var_id].solved) {  // solved var
-                var_instantiation_t* solved_var = &query_ctxt->vars[var_id];
-                // push in reverse order on stack
-                int i;
-                for (i = solved_var->num_tokens - 1; i >= 0; --i) {
-                    token_stack_push(&var_stack, solved_var->tokens[i]);
-                }
+
+            // continue
+            frame->state = MATCH_SOLVED_DONE;
+            return call_process_query_token(cursor);
+        }
+        frame->node = cursor->curr_index_inode;
+        frame->i = 0;
+        frame->end = inode_get_size(frame->node);
+        frame->state = MATCH_CHILDREN;
+        /* fall through */
+
+    case MATCH_CHILDREN:
+        while (frame->i < frame->end) {
+            const inode_t* child;
+            encoded_token_t entry_token =
+                inode_get_entry(frame->node, frame->i, &child);
+            uint32_t pushed_var_tokens = 0;
+            int ret;
+
+            frame->i++;
+            if (!take_branch(cursor, frame, frame->end, frame->i - 1) ||
+                prune(cursor, child)) {
                 continue;
             }
+            if (!inode_has_hvars(frame->node)) {
+                // constant token, no var to resolve
+                token_stack_t* tokens = &cursor->vars[frame->var_id].tokens;
+                if (token_stack_reserve(tokens, 1) != 0) return STEP_FAIL;
+                token_stack_push(tokens, entry_token);
+                pushed_var_tokens = 1;
+            } else {
+                cursor->scratch.size = 0;
+                if (token_stack_reserve(&cursor->scratch, 1) != 0) {
+                    return STEP_FAIL;
+                }
+                token_stack_push(&cursor->scratch, entry_token);
+                ret = instantiate_var(cursor, frame->var_id,
+                                      &pushed_var_tokens);
+                if (ret == -2) return STEP_FAIL;
+                if (ret == -1) {
+                    // revert
+                    token_stack_pop_many(&cursor->vars[frame->var_id].tokens,
+                                         pushed_var_tokens);
+                    continue;
+                }
+            }
+
+            // advance in the index
+            enter_child(cursor, child);
+            frame->count = pushed_var_tokens;
+            frame->state = MATCH_CHILD_DONE;
+            return call(cursor, MATCH_VAR_TO_INDEX, frame->token,
+                        frame->arity + entry_token.arity - 1);
         }
-        // save to var_instantiation
-        var->tokens[var->num_tokens] = token;
-        var->num_tokens++;
+        return STEP_RETURN;
+
+    case MATCH_CHILD_DONE:
+        // revert
+        token_stack_pop_many(&cursor->vars[frame->var_id].tokens,
+                             frame->count);
+        leave_child(cursor, frame->node);
+        frame->state = MATCH_CHILDREN;
+        return step_match_var_to_index(cursor, frame);
+
+    case MATCH_SOLVED_DONE:
+        cursor->backtracks[frame->var_id]++;
+        cursor->solving_var_id = frame->var_id;
+        cursor->vars[frame->var_id].solved = false;
+        return STEP_RETURN;
+
+    default:
+        assert(false);
+        return STEP_FAIL;
     }
+}
 
-    // set var as solved
-    var->solved = solved;
+/* Unify the variable being solved with the next query subterm */
+static int step_match_var_to_query(query_cursor_t* RESTRICT cursor,
+                                   frame_t* RESTRICT frame) {
+    token_stack_t* query = &cursor->query_stack;
+    token_stack_t* taken = &cursor->taken_tokens;
+    uint32_t i;
+
+    switch (frame->state) {
+    case FRAME_START: {
+        bool has_range = false;
+        int arity = 1;
+        int ret;
+
+        frame->var_id = cursor->solving_var_id;
+        frame->trail_size = cursor->trail.size;
+
+        // move the var matching to the taken tokens, reverted
+        frame->count = 0;
+        while (arity > 0) {
+            encoded_token_t token = token_stack_pop(query);
+            arity += encoded_token_get_arity(token) - 1;
+            has_range |= encoded_token_is_range(token);
+            if (token_stack_reserve(taken, 1) != 0) return STEP_FAIL;
+            token_stack_push(taken, token);
+            frame->count++;
+        }
 
-    // continue
-    ret = process_query_token(query_ctxt);
-    if (ret != QUERY_CONTINUE) return ret;
+        // ranges do not unify with index variables
+        if (has_range) goto revert;
 
-revert_stack:
-    var->solved = false;
-    while (!token_stack_empty(&tmp_rev_stack)) {
-        token_stack_push(stack, token_stack_pop(&tmp_rev_stack));
+        // copy in query order
+        cursor->scratch.size = 0;
+        if (token_stack_reserve(&cursor->scratch, frame->count) != 0) {
+            return STEP_FAIL;
+        }
+        for (i = 0; i < frame->count; ++i) {
+            token_stack_push(&cursor->scratch, taken->data[taken->size - 1 - i]);
+        }
+
+        // solve the variable, or the vars of both if it is already solved
+        ret = unify_var(cursor, frame->var_id);
+        if (ret == -2) return STEP_FAIL;
+        if (ret == -1) goto revert;
+
+        // continue
+        frame->state = MATCH_SOLVED_DONE;
+        return call_process_query_token(cursor);
     }
 
-    return QUERY_CONTINUE;
+    case MATCH_SOLVED_DONE:
+        goto revert;
+
+    default:
+        assert(false);
+        return STEP_FAIL;
+    }
+
+revert:
+    undo_trail(cursor, frame->trail_size);
+    for (i = 0; i < frame->count; ++i) {
+        token_stack_push(query, token_stack_pop(taken));
+    }
+    return STEP_RETURN;
 }
@@ -40,23 +40,200 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 typedef enum result_cb_return_e {
     QUERY_CONTINUE,
     QUERY_STOP,
-    QUERY_ERROR
+    QUERY_ERROR,
+    /// the search ran out of its node budget or was stopped
+    QUERY_LIMIT
 } result_cb_return_t;
 
-/* TODO report unificating instantiation */
+/**
+ * @brief Result callback of query_engine_run, called with each leaf
+ * unifying with the query. It only gets the leaf: callers which need the
+ * instantiations of the query variables pull the leaves from a cursor
+ * instead and read them with query_cursor_get_instantiation() before
+ * advancing it.
+ */
 typedef result_cb_return_t (*result_callback_t)(void* handle,
                                                 const leaf_t* leaf);
 
+/// Pull iterator over the results of a query
+typedef struct query_cursor_s query_cursor_t;
+
+/**
+ * @brief Range check of the query engine
+ * @return true if the index token is a valid substitution of the range
+ * query token
+ */
+typedef bool (*range_callback_t)(void* handle, encoded_token_t range,
+                                 encoded_token_t token);
+
+/**
+ * @brief Split check of the query engine, called with the branches of the
+ * first index node where the search branches, in increasing order.
+ * @return true if the cursor should explore the branch
+ */
+typedef bool (*split_callback_t)(void* handle, uint32_t branch);
+
+/**
+ * @brief Prune check of the query engine, called before entering an
+ * internal index node
+ * @return true if the subtree of the node should be skipped
+ */
+typedef bool (*prune_callback_t)(void* handle, const inode_t* node);
+
+/**
+ * @brief Stop check of the query engine, called periodically while the
+ * cursor searches, e.g. to enforce a deadline
+ * @return true if the search should stop
+ */
+typedef bool (*stop_callback_t)(void* handle);
+
+/// Work done by a cursor so far
+typedef struct query_stats_s {
+    /// index nodes visited
+    uint64_t visited;
+    /// children looked up by the token of a constant
+    uint64_t child_lookups;
+    /// index tokens rejected by a range
+    uint64_t range_rejects;
+    /// solutions of each query variable undone, by var id
+    uint64_t backtracks[VAR_ID_MAX + 1];
+} query_stats_t;
+
 /*--------------------------------------------------------------------------*/
 /* Methods                                                                  */
 /*--------------------------------------------------------------------------*/
 
 BEGIN_DECLS
 
+/**
+ * @brief Create a cursor over the leaves of the index unifying with the
+ * query. The query is copied, the index must outlive the cursor. Ranges
+ * of the query match the constants of the index accepted by range_cb, if
+ * any, and do not unify with index hvars.
+ * @return the cursor or NULL on allocation failure
+ */
+query_cursor_t* query_cursor_create(index_handle_t* RESTRICT index,
+                                    encoded_formula_t* RESTRICT query,
+                                    range_callback_t range_cb,
+                                    void* range_cb_handle);
+
+/**
+ * @brief Advance the cursor to the next leaf, in index order. Cursors are
+ * independent, so several queries can be interleaved. Until the next call,
+ * query_cursor_get_instantiation() reads how the leaf instantiates each
+ * query variable.
+ * @return QUERY_CONTINUE with *leaf set, QUERY_STOP when there are no more
+ * leaves, QUERY_ERROR if a buffer could not grow, or QUERY_LIMIT if the
+ * limits of the cursor were reached first
+ */
+int query_cursor_next(query_cursor_t* RESTRICT cursor,
+                      const leaf_t** RESTRICT leaf);
+
+void query_cursor_destroy(query_cursor_t* cursor);
+
+/**
+ * @brief Restrict the cursor to the branches of the split node accepted by
+ * split_cb. The split node is the first one where the search has several
+ * alternatives: children of a qvar or range, or a constant and the hvars
+ * matching it. Leaves found without branching are branch 0. Cursors of the
+ * same query whose split callbacks accept disjoint branches report disjoint
+ * leaves. Must be called before the first query_cursor_next().
+ */
+void query_cursor_set_split(query_cursor_t* RESTRICT cursor,
+                            split_callback_t split_cb, void* split_cb_handle);
+
+/**
+ * @return the split node branch of the last leaf reported by the cursor.
+ * Leaves are reported in increasing branch order.
+ */
+uint32_t query_cursor_get_branch(const query_cursor_t* cursor);
+
+/**
+ * @brief Skip the subtrees of the internal nodes for which prune_cb returns
+ * true. The callback may change its answers while the cursor runs.
+ */
+void query_cursor_set_prune(query_cursor_t* RESTRICT cursor,
+                            prune_callback_t prune_cb, void* prune_cb_handle);
+
+/**
+ * @brief Limit the search of the cursor to max_nodes visited index nodes (0
+ * for no limit) and stop it once stop_cb returns true, if not NULL. Limits
+ * are checked between the backtracking steps of the search. Once reached,
+ * the cursor only returns QUERY_LIMIT: the leaves reported so far are a
+ * prefix of the results.
+ */
+void query_cursor_set_limits(query_cursor_t* RESTRICT cursor,
+                             uint64_t max_nodes, stop_callback_t stop_cb,
+                             void* stop_cb_handle);
+
+/**
+ * @return the number of index nodes the cursor visited so far
+ */
+uint64_t query_cursor_get_visited(const query_cursor_t* cursor);
+
+/**
+ * @brief Add the work done by the cursor so far to stats
+ */
+void query_cursor_add_stats(const query_cursor_t* RESTRICT cursor,
+                            query_stats_t* RESTRICT stats);
+
+/**
+ * @return the depth of the last leaf reported by the cursor, which is the
+ * number of tokens of its formula
+ */
+uint32_t query_cursor_get_depth(const query_cursor_t* cursor);
+
+/**
+ * @brief Instantiation of a query variable in the last leaf reported by the
+ * cursor, in prefix order. Variables solved after it are replaced by their
+ * own instantiation, so it only contains unsolved variables, e.g. hvars
+ * of the index matched by nothing else. The replacement is built in a
+ * buffer of the cursor, hence the cursor is not const. To read the
+ * substitution of each named qvar of a leaf, call it with their var ids
+ * after each QUERY_CONTINUE of query_cursor_next(), copying the tokens
+ * before the next call.
+ * @param tokens set to the tokens, valid until the cursor moves on or the
+ * next call
+ * @return the number of tokens, 0 if the variable is not solved or on
+ * allocation failure
+ */
+uint32_t query_cursor_get_instantiation(query_cursor_t* RESTRICT cursor,
+                                        uint32_t var_id,
+                                        const encoded_token_t** tokens);
+
+/**
+ * @brief Descend from an internal node along a constant query token, if the
+ * child for that token is its only match: the node has no hvars. A cursor of
+ * the remaining query tokens on the subindex rooted at the child reports the
+ * same leaves as a cursor of the whole query.
+ * @param child set to the child, or to NULL if no index formula matches
+ * @return false if the token is not a constant or the search branches at
+ * node, leaving child unchanged
+ */
+bool query_engine_descend(const inode_t* RESTRICT node, encoded_token_t token,
+                          const inode_t** RESTRICT child);
+
+/**
+ * @brief Report the leaves of the index unifying with the query, in index
+ * order. Ranges of the query do not match any token.
+ * @return QUERY_CONTINUE if all leaves were reported, otherwise the first
+ * result callback return value which is not QUERY_CONTINUE
+ */
 int query_engine_run(index_handle_t* RESTRICT index,
                      encoded_formula_t* RESTRICT query, result_callback_t cb,
                      void* RESTRICT cb_handle);
 
+/**
+ * @brief Same as query_engine_run, with ranges of the query matching the
+ * constants of the index accepted by range_cb
+ */
+int query_engine_run_with_ranges(index_handle_t* RESTRICT index,
+                                 encoded_formula_t* RESTRICT query,
+                                 range_callback_t range_cb,
+                                 void* range_cb_handle,
+                                 result_callback_t cb,
+                                 void* cb_handle);
+
 END_DECLS
 
 #endif  // !__MWS_QUERY_QUERYENGINE_H
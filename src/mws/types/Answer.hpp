@@ -33,6 +33,10 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   */
 
 #include <string>
+#include <vector>
+
+#include "mws/index/encoded_token.h"
+#include "mws/types/FormulaPath.hpp"
 
 namespace mws {
 namespace types {
@@ -44,6 +48,13 @@ struct Answer {
     std::string uri;
     std::string xpath;
     std::string data;
+    /// Encoded subterm matched by each qvar of the query, in the order of
+    /// MwsAnswset::qvarNames. Only filled if the query requested them.
+    std::vector<std::vector<encoded_token_t>> substitutions;
+    /// Occurrences of the solutions in the document of the answer, the
+    /// first one being uri and xpath. Only filled if the query groups the
+    /// answers by document.
+    std::vector<FormulaPath> hits;
 };
 
 }  // namespace types
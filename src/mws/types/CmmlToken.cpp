@@ -225,6 +225,10 @@ std::string CmmlToken::getAttribute(const std::string& attr) const {
     }
 }
 
+const map<string, string>& CmmlToken::getAttributes() const {
+    return _attributes;
+}
+
 /**
  * @brief CmmlToken::getRangeBounds
  * @return a pair with the first field set to the low bound
@@ -269,13 +273,23 @@ const std::pair<double, double> CmmlToken::getRangeBounds() const {
 }
 
 std::string CmmlToken::getMeaning() const {
+    string meaning;
+    getMeaning(&meaning);
+
+    return meaning;
+}
+
+void CmmlToken::getMeaning(std::string* meaning) const {
     assert(getType() == CONSTANT);
 
     if (_tag == "mtext") {  // mtext content is discarded
-        return "mtext#";
+        meaning->assign("mtext#");
+        return;
     }
 
-    return _tag + "#" + _textContent;
+    meaning->assign(_tag);
+    meaning->push_back('#');
+    meaning->append(_textContent);
 }
 
 uint32_t CmmlToken::getArity() const { return _childNodes.size(); }
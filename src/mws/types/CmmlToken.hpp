@@ -104,6 +104,7 @@ class CmmlToken {
     const std::string& getTag() const;
     const std::string& getXpath() const;
     std::string getAttribute(const std::string& attr) const;
+    const std::map<std::string, std::string>& getAttributes() const;
     /**
      * @brief getXpathRelative
      * @return Xpath wihout root selector prefix
@@ -117,6 +118,8 @@ class CmmlToken {
     const std::pair<double, double> getRangeBounds() const;
     // CONSTANT specific
     std::string getMeaning() const;
+    /// Write the meaning into a caller owned buffer, reusing its storage
+    void getMeaning(std::string* meaning) const;
 
     // Logging / stats
     std::string toString(int indent = 0) const;
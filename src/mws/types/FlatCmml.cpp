@@ -0,0 +1,438 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief  FlatCmml implementation
+  * @file   FlatCmml.cpp
+  * @date   19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  */
+
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+
+#include <limits>
+using std::numeric_limits;
+#include <string>
+using std::string;
+#include <utility>
+using std::pair;
+#include <vector>
+using std::vector;
+
+#include "common/utils/hash.h"
+#include "mws/types/FlatCmml.hpp"
+
+namespace mws {
+namespace types {
+
+/*--------------------------------------------------------------------------*/
+/* StringRef                                                                */
+/*--------------------------------------------------------------------------*/
+
+bool StringRef::equals(const char* str) const {
+    return strncmp(data, str, size) == 0 && str[size] == '\0';
+}
+
+/*--------------------------------------------------------------------------*/
+/* StringInterner                                                           */
+/*--------------------------------------------------------------------------*/
+
+const TagId StringInterner::NOT_FOUND;
+
+StringInterner::StringInterner() : _slots(16, NOT_FOUND) {}
+
+TagId StringInterner::find(const char* str, size_t size) const {
+    uint32_t hash = hash_fnv1a_32(str, size);
+    size_t mask = _slots.size() - 1;
+
+    for (size_t pos = hash & mask; _slots[pos] != NOT_FOUND;
+         pos = (pos + 1) & mask) {
+        TagId id = _slots[pos];
+        if (_hashes[id] == hash && _strings[id].size() == size &&
+            memcmp(_strings[id].data(), str, size) == 0) {
+            return id;
+        }
+    }
+
+    return NOT_FOUND;
+}
+
+TagId StringInterner::intern(const char* str, size_t size) {
+    TagId id = find(str, size);
+    if (id != NOT_FOUND) {
+        return id;
+    }
+
+    if (2 * (_strings.size() + 1) > _slots.size()) {
+        _grow();
+    }
+
+    id = _strings.size();
+    uint32_t hash = hash_fnv1a_32(str, size);
+    _strings.push_back(string(str, size));
+    _hashes.push_back(hash);
+
+    size_t mask = _slots.size() - 1;
+    size_t pos = hash & mask;
+    while (_slots[pos] != NOT_FOUND) {
+        pos = (pos + 1) & mask;
+    }
+    _slots[pos] = id;
+
+    return id;
+}
+
+void StringInterner::_grow() {
+    _slots.assign(2 * _slots.size(), NOT_FOUND);
+    size_t mask = _slots.size() - 1;
+
+    for (TagId id = 0; id < _strings.size(); id++) {
+        size_t pos = _hashes[id] & mask;
+        while (_slots[pos] != NOT_FOUND) {
+            pos = (pos + 1) & mask;
+        }
+        _slots[pos] = id;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/* FlatCmml                                                                 */
+/*--------------------------------------------------------------------------*/
+
+const FlatCmml::NodeId FlatCmml::NO_NODE;
+const uint32_t FlatCmml::INLINE_ATTRIBUTES;
+
+FlatCmml::FlatCmml() {
+    // Order must match the predefined TagId enumeration
+    _names.intern(QVAR_TAG);
+    _names.intern(RANGE_TAG);
+    _names.intern("apply");
+    _names.intern("ci");
+    _names.intern("mtext");
+    _names.intern(VAR_NAME_ATTR);
+    _names.intern(RANGE_LOW_ATTR);
+    _names.intern(RANGE_HIGH_ATTR);
+}
+
+void FlatCmml::clear() {
+    _nodes.clear();
+    _chars.clear();
+    _extraAttributes.clear();
+    _openStack.clear();
+}
+
+uint32_t FlatCmml::_appendChars(const char* data, size_t size) {
+    uint32_t offset = _chars.size();
+    _chars.insert(_chars.end(), data, data + size);
+
+    return offset;
+}
+
+FlatCmml::NodeId FlatCmml::beginNode(const char* tag, size_t tagSize) {
+    if (tagSize >= 2 && tag[0] == 'm' && tag[1] == ':') {
+        tag += 2;
+        tagSize -= 2;
+    }
+
+    NodeId id = _nodes.size();
+    Node node;
+    memset(&node, 0, sizeof(node));
+    node.tag = _names.intern(tag, tagSize);
+    node.end = NO_NODE;
+    if (_openStack.empty()) {
+        node.parent = NO_NODE;
+        node.position = 1;
+    } else {
+        Node& parent = _nodes[_openStack.back()];
+        node.parent = _openStack.back();
+        node.position = ++parent.arity;
+    }
+    _nodes.push_back(node);
+
+    _openStack.push_back(id);
+    if (_pendingText.size() < _openStack.size()) {
+        _pendingText.resize(_openStack.size());
+    }
+    _pendingText[_openStack.size() - 1].clear();
+
+    return id;
+}
+
+void FlatCmml::addAttribute(const char* name, const char* value) {
+    assert(!_openStack.empty() && _openStack.back() + 1 == _nodes.size());
+
+    Node& node = _nodes.back();
+    Attribute attribute;
+    attribute.name = _names.intern(name, strlen(name));
+    attribute.valueSize = strlen(value);
+    attribute.valueOffset = _appendChars(value, attribute.valueSize);
+
+    if (node.numAttributes < INLINE_ATTRIBUTES) {
+        node.attributes[node.numAttributes] = attribute;
+    } else {
+        if (node.numAttributes == INLINE_ATTRIBUTES) {
+            node.extraAttributes = _extraAttributes.size();
+        }
+        _extraAttributes.push_back(attribute);
+    }
+    node.numAttributes++;
+}
+
+void FlatCmml::addAttribute(const string& name, const string& value) {
+    addAttribute(name.c_str(), value.c_str());
+}
+
+void FlatCmml::appendTextContent(const char* text, size_t nBytes) {
+    assert(!_openStack.empty());
+
+    string& pending = _pendingText[_openStack.size() - 1];
+    for (size_t i = 0; i < nBytes; i++) {
+        if (!isspace(text[i])) {
+            pending.push_back(text[i]);
+        }
+    }
+}
+
+void FlatCmml::endNode() {
+    assert(!_openStack.empty());
+
+    const string& pending = _pendingText[_openStack.size() - 1];
+    Node& node = _nodes[_openStack.back()];
+    node.textSize = pending.size();
+    node.textOffset = _appendChars(pending.data(), pending.size());
+    node.end = _nodes.size();
+    _openStack.pop_back();
+}
+
+void FlatCmml::assign(const CmmlToken* token) {
+    clear();
+    append(token);
+}
+
+FlatCmml::NodeId FlatCmml::append(const CmmlToken* token) {
+    typedef CmmlToken::PtrList::const_iterator ChildIt;
+    vector<pair<const CmmlToken*, ChildIt> > dfsStack;
+
+    assert(_openStack.empty());
+    dfsStack.push_back({token, token->getChildNodes().begin()});
+    NodeId root = beginNode(token->getTag());
+    for (const auto& attr : token->getAttributes()) {
+        addAttribute(attr.first, attr.second);
+    }
+    while (!dfsStack.empty()) {
+        auto& top = dfsStack.back();
+        if (top.second == top.first->getChildNodes().end()) {
+            const string& text = top.first->getTextContent();
+            appendTextContent(text.data(), text.size());
+            endNode();
+            dfsStack.pop_back();
+        } else {
+            const CmmlToken* child = *top.second;
+            ++top.second;
+            beginNode(child->getTag());
+            for (const auto& attr : child->getAttributes()) {
+                addAttribute(attr.first, attr.second);
+            }
+            dfsStack.push_back({child, child->getChildNodes().begin()});
+        }
+    }
+
+    return root;
+}
+
+const FlatCmml::Attribute* FlatCmml::_getAttribute(NodeId id,
+                                                   TagId name) const {
+    const Node& node = _nodes[id];
+
+    for (uint32_t i = 0; i < node.numAttributes; i++) {
+        const Attribute* attribute =
+            (i < INLINE_ATTRIBUTES)
+                ? &node.attributes[i]
+                : &_extraAttributes[node.extraAttributes + i -
+                                    INLINE_ATTRIBUTES];
+        if (attribute->name == name) {
+            return attribute;
+        }
+    }
+
+    return nullptr;
+}
+
+/*--------------------------------------------------------------------------*/
+/* FlatCmml::Ref                                                            */
+/*--------------------------------------------------------------------------*/
+
+CmmlToken::Type FlatCmml::Ref::getType() const {
+    if (isVar()) {
+        return CmmlToken::VAR;
+    } else if (isRange()) {
+        return CmmlToken::RANGE;
+    } else {
+        return CmmlToken::CONSTANT;
+    }
+}
+
+StringRef FlatCmml::Ref::getTextContent() const {
+    const Node& node = _node();
+
+    return StringRef(_tree->_chars.data() + node.textOffset, node.textSize);
+}
+
+StringRef FlatCmml::Ref::getAttribute(const char* attr) const {
+    TagId name = _tree->_names.find(attr, strlen(attr));
+    if (name == StringInterner::NOT_FOUND) {
+        return StringRef();
+    }
+
+    const Attribute* attribute = _tree->_getAttribute(_id, name);
+    if (attribute == nullptr) {
+        return StringRef();
+    }
+
+    return StringRef(_tree->_chars.data() + attribute->valueOffset,
+                     attribute->valueSize);
+}
+
+FlatCmml::Ref FlatCmml::Ref::getFirstChild() const {
+    if (_node().arity == 0) {
+        return Ref(_tree, NO_NODE);
+    }
+
+    return Ref(_tree, _id + 1);
+}
+
+FlatCmml::Ref FlatCmml::Ref::getNextSibling() const {
+    NodeId parent = _node().parent;
+    if (parent == NO_NODE || _node().end == _tree->_nodes[parent].end) {
+        return Ref(_tree, NO_NODE);
+    }
+
+    return Ref(_tree, _node().end);
+}
+
+StringRef FlatCmml::Ref::getVarName() const {
+    assert(isVar());
+
+    const Attribute* name = _tree->_getAttribute(_id, VAR_NAME_ATTR_ID);
+    if (name == nullptr) {
+        return getTextContent();
+    }
+
+    return StringRef(_tree->_chars.data() + name->valueOffset,
+                     name->valueSize);
+}
+
+pair<double, double> FlatCmml::Ref::getRangeBounds() const {
+    assert(isRange());
+
+    pair<double, double> bounds(numeric_limits<double>::min(),
+                                numeric_limits<double>::max());
+
+    const Attribute* low = _tree->_getAttribute(_id, RANGE_LOW_ATTR_ID);
+    if (low != nullptr) {
+        try {
+            bounds.first = std::stod(
+                string(_tree->_chars.data() + low->valueOffset,
+                       low->valueSize));
+        }
+        catch (std::exception & e) {
+            UNUSED(e);
+            PRINT_WARN("Invalid low bound for range.");
+        }
+    }
+
+    const Attribute* high = _tree->_getAttribute(_id, RANGE_HIGH_ATTR_ID);
+    if (high != nullptr) {
+        try {
+            bounds.second = std::stod(
+                string(_tree->_chars.data() + high->valueOffset,
+                       high->valueSize));
+        }
+        catch (std::exception & e) {
+            UNUSED(e);
+            PRINT_WARN("Invalid upper bound for range.");
+        }
+    }
+
+    return bounds;
+}
+
+void FlatCmml::Ref::getMeaning(string* meaning) const {
+    assert(getType() == CmmlToken::CONSTANT);
+
+    if (getTagId() == MTEXT_TAG_ID) {  // mtext content is discarded
+        meaning->assign("mtext#");
+        return;
+    }
+
+    StringRef text = getTextContent();
+    meaning->assign(getTag());
+    meaning->push_back('#');
+    meaning->append(text.data, text.size);
+}
+
+string FlatCmml::Ref::getMeaning() const {
+    string meaning;
+    getMeaning(&meaning);
+
+    return meaning;
+}
+
+string FlatCmml::Ref::getXpath() const {
+    return ROOT_XPATH_SELECTOR + getXpathRelative();
+}
+
+string FlatCmml::Ref::getXpathRelative() const {
+    vector<uint32_t> positions;
+    for (NodeId id = _id; _tree->_nodes[id].parent != NO_NODE;
+         id = _tree->_nodes[id].parent) {
+        positions.push_back(_tree->_nodes[id].position);
+    }
+
+    string xpath;
+    for (auto it = positions.rbegin(); it != positions.rend(); ++it) {
+        xpath += "/*[" + std::to_string(*it) + "]";
+    }
+
+    return xpath;
+}
+
+uint32_t FlatCmml::Ref::getExprDepth() const {
+    uint32_t maxDepth = 0;
+    const NodeId end = _node().end;
+
+    for (NodeId id = _id + 1; id < end; id++) {
+        if (_tree->_nodes[id].arity != 0) continue;
+        uint32_t depth = 0;
+        for (NodeId curr = id; curr != _id; curr = _tree->_nodes[curr].parent) {
+            depth++;
+        }
+        if (depth > maxDepth) maxDepth = depth;
+    }
+
+    return maxDepth;
+}
+
+}  // namespace types
+}  // namespace mws
@@ -0,0 +1,247 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_TYPES_FLATCMML_HPP
+#define _MWS_TYPES_FLATCMML_HPP
+
+/**
+  * @brief  Flat, arena allocated Content MathML expression
+  * @file   FlatCmml.hpp
+  * @date   19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  * Nodes are stored in preorder in a single vector. The subtree of node i
+  * occupies the range [i, end(i)), so its first child is i + 1 and the next
+  * sibling of a child c is end(c). Tags and attribute names are interned,
+  * text and attribute values live in one character arena and xpaths are
+  * only computed on request. clear() keeps all storage, so a tree reused
+  * for consecutive expressions stops allocating once it has warmed up.
+  */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/types/CmmlToken.hpp"
+
+namespace mws {
+namespace types {
+
+typedef uint32_t TagId;
+
+/**
+ * @brief Non-owning reference to a character range
+ */
+struct StringRef {
+    const char* data;
+    size_t size;
+
+    StringRef() : data(""), size(0) {}
+    StringRef(const char* aData, size_t aSize) : data(aData), size(aSize) {}
+
+    bool empty() const { return size == 0; }
+    bool equals(const char* str) const;
+    std::string str() const { return std::string(data, size); }
+};
+
+/**
+ * @brief Maps strings to dense ids. Lookups do not allocate.
+ */
+class StringInterner {
+ public:
+    StringInterner();
+
+    TagId intern(const char* str, size_t size);
+    TagId intern(const std::string& str) {
+        return intern(str.data(), str.size());
+    }
+    /// @return the id of str or NOT_FOUND
+    TagId find(const char* str, size_t size) const;
+    const std::string& get(TagId id) const { return _strings[id]; }
+    size_t size() const { return _strings.size(); }
+
+    static const TagId NOT_FOUND = UINT32_MAX;
+
+ private:
+    void _grow();
+
+    std::vector<std::string> _strings;
+    std::vector<uint32_t> _hashes;
+    std::vector<TagId> _slots;  // NOT_FOUND marks an empty slot
+};
+
+class FlatCmml {
+ public:
+    typedef uint32_t NodeId;
+    class Ref;
+
+    static const NodeId NO_NODE = UINT32_MAX;
+
+    /// Ids of names interned by every tree
+    enum : TagId {
+        QVAR_TAG_ID,
+        RANGE_TAG_ID,
+        APPLY_TAG_ID,
+        CI_TAG_ID,
+        MTEXT_TAG_ID,
+        VAR_NAME_ATTR_ID,
+        RANGE_LOW_ATTR_ID,
+        RANGE_HIGH_ATTR_ID
+    };
+
+    FlatCmml();
+
+    /// Remove all nodes, keeping allocated storage and interned names
+    void clear();
+
+    // Building (SAX order)
+    NodeId beginNode(const char* tag, size_t tagSize);
+    NodeId beginNode(const std::string& tag) {
+        return beginNode(tag.data(), tag.size());
+    }
+    /// Attributes belong to the last begun node and precede its children
+    void addAttribute(const char* name, const char* value);
+    void addAttribute(const std::string& name, const std::string& value);
+    void appendTextContent(const char* text, size_t nBytes);
+    void endNode();
+    /// @return number of nodes begun but not ended
+    size_t openNodes() const { return _openStack.size(); }
+
+    /// Replace the contents with a copy of the token tree rooted at token
+    void assign(const CmmlToken* token);
+    /**
+     * @brief Append a copy of token as a new root, so that several
+     * expressions can share one arena
+     * @return id of the new root
+     */
+    NodeId append(const CmmlToken* token);
+
+    // Access
+    size_t size() const { return _nodes.size(); }
+    bool empty() const { return _nodes.empty(); }
+    Ref root() const;
+    Ref node(NodeId id) const;
+    const std::string& getTagName(TagId id) const { return _names.get(id); }
+
+ private:
+    struct Attribute {
+        TagId name;
+        uint32_t valueOffset;
+        uint32_t valueSize;
+    };
+    static const uint32_t INLINE_ATTRIBUTES = 2;
+
+    struct Node {
+        TagId tag;
+        NodeId parent;
+        NodeId end;
+        uint32_t arity;
+        uint32_t position;  // 1-based index among siblings
+        uint32_t textOffset;
+        uint32_t textSize;
+        uint32_t numAttributes;
+        uint32_t extraAttributes;  // offset in _extraAttributes
+        Attribute attributes[INLINE_ATTRIBUTES];
+    };
+
+    uint32_t _appendChars(const char* data, size_t size);
+    const Attribute* _getAttribute(NodeId id, TagId name) const;
+
+    std::vector<Node> _nodes;
+    std::vector<char> _chars;
+    std::vector<Attribute> _extraAttributes;
+    std::vector<NodeId> _openStack;
+    /// Text of open nodes, committed to _chars when the node ends
+    std::vector<std::string> _pendingText;
+    StringInterner _names;
+
+    friend class Ref;
+    DISALLOW_COPY_AND_ASSIGN(FlatCmml);
+};
+
+/**
+ * @brief Cursor to a node of a FlatCmml tree. It mirrors the read-only part
+ * of the CmmlToken interface so that consumers can be written once for both.
+ */
+class FlatCmml::Ref {
+ public:
+    Ref() : _tree(nullptr), _id(NO_NODE) {}
+    Ref(const FlatCmml* tree, NodeId id) : _tree(tree), _id(id) {}
+
+    bool isValid() const { return _tree != nullptr && _id != NO_NODE; }
+    NodeId getId() const { return _id; }
+    const FlatCmml* getTree() const { return _tree; }
+    bool operator==(const Ref& other) const {
+        return _tree == other._tree && _id == other._id;
+    }
+    bool operator!=(const Ref& other) const { return !(*this == other); }
+
+    bool isRoot() const { return _node().parent == NO_NODE; }
+    bool isVar() const { return _node().tag == QVAR_TAG_ID; }
+    bool isRange() const { return _node().tag == RANGE_TAG_ID; }
+    CmmlToken::Type getType() const;
+    TagId getTagId() const { return _node().tag; }
+    const std::string& getTag() const { return _tree->getTagName(getTagId()); }
+    uint32_t getArity() const { return _node().arity; }
+    StringRef getTextContent() const;
+    StringRef getAttribute(const char* attr) const;
+
+    /// @return the parent, or an invalid Ref for the root
+    Ref getParentNode() const { return Ref(_tree, _node().parent); }
+    /// @return the first child, or an invalid Ref for leaves
+    Ref getFirstChild() const;
+    /// @return the next sibling, or an invalid Ref for the last child
+    Ref getNextSibling() const;
+    /// @return one past the last node of this subtree
+    NodeId getSubtreeEnd() const { return _node().end; }
+
+    // VAR specific methods
+    StringRef getVarName() const;
+    // RANGE specific methods
+    std::pair<double, double> getRangeBounds() const;
+    // CONSTANT specific
+    void getMeaning(std::string* meaning) const;
+    std::string getMeaning() const;
+
+    std::string getXpath() const;
+    std::string getXpathRelative() const;
+    uint32_t getExprDepth() const;
+    uint32_t getExprSize() const { return _node().end - _id; }
+
+ private:
+    const Node& _node() const { return _tree->_nodes[_id]; }
+
+    const FlatCmml* _tree;
+    NodeId _id;
+};
+
+inline FlatCmml::Ref FlatCmml::root() const { return Ref(this, 0); }
+
+inline FlatCmml::Ref FlatCmml::node(NodeId id) const { return Ref(this, id); }
+
+}  // namespace types
+}  // namespace mws
+
+#endif  // _MWS_TYPES_FLATCMML_HPP
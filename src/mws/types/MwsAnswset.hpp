@@ -30,13 +30,17 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   */
 
 #include <cstdio>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <set>
+#include <string>
 #include <ctime>
 
 #include "mws/types/Answer.hpp"
 #include "GenericAnswer.hpp"
 #include "mws/types/FormulaPath.hpp"
+#include "mws/types/QueryProfile.hpp"
 
 namespace mws {
 
@@ -49,16 +53,61 @@ struct MwsAnswset : GenericAnswer {
     std::vector<mws::types::Answer*> answers;
     /// Total number of solutions in the index
     int total;
+    /// True if total is an estimate, which lies in [totalLow, totalHigh]
+    /// with 95% confidence
+    bool estimated;
+    int totalLow;
+    int totalHigh;
+    /// True if the search stopped at its deadline or node budget: answers
+    /// and total only cover the solutions found until then
+    bool partial;
+    /// Continuation token of the next page, empty if there is none
+    std::string cursor;
     /// Vector containing the qvar names
     std::vector<std::string> qvarNames;
     /// Vector containing the qvar relative xpaths
     std::vector<std::string> qvarXpaths;
+    /// Decodes the substitutions of the answers to CMML when they are
+    /// written, set if the query requested them
+    std::function<std::string(const std::vector<encoded_token_t>&)>
+        substitutionDecoder;
+    /// Decodes the formula of an id to CMML when the ids are written, set if
+    /// the query requested them
+    std::function<std::string(mws::types::FormulaId)> formulaDecoder;
     /// Set with the FormulaIds
     std::set<mws::types::FormulaId> ids;
     /// Duration for retrieng results (in ms)
     time_t time;
+    /// Timings and counters of the query, if it was explained
+    std::unique_ptr<mws::types::QueryProfile> profile;
 
-    MwsAnswset() : total(0) {}
+    MwsAnswset()
+        : total(0), estimated(false), totalLow(0), totalHigh(0),
+          partial(false) {}
+
+    /// @return a deep copy of the answer set, owned by the caller
+    MwsAnswset* clone() const {
+        MwsAnswset* copy = new MwsAnswset();
+        for (auto answer : answers) {
+            copy->answers.push_back(new mws::types::Answer(*answer));
+        }
+        copy->total = total;
+        copy->estimated = estimated;
+        copy->totalLow = totalLow;
+        copy->totalHigh = totalHigh;
+        copy->partial = partial;
+        copy->cursor = cursor;
+        copy->qvarNames = qvarNames;
+        copy->qvarXpaths = qvarXpaths;
+        copy->substitutionDecoder = substitutionDecoder;
+        copy->formulaDecoder = formulaDecoder;
+        copy->ids = ids;
+        copy->time = time;
+        if (profile != nullptr) {
+            copy->profile.reset(new mws::types::QueryProfile(*profile));
+        }
+        return copy;
+    }
 
     ~MwsAnswset() {
         for (auto answer : answers) {
@@ -67,6 +116,21 @@ struct MwsAnswset : GenericAnswer {
     }
 };
 
+/**
+  * @brief <mws:batch> Answer Sets of the queries of a batch request
+  *
+  */
+struct MwsBatchAnswset : GenericAnswer {
+    /// Answer sets of the queries, in request order
+    std::vector<MwsAnswset*> answsets;
+
+    ~MwsBatchAnswset() {
+        for (auto answset : answsets) {
+            delete answset;
+        }
+    }
+};
+
 }  // namespace mws
 
 #endif  // _MWSANSWSET_HPP
@@ -29,13 +29,15 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
   * @date   19 Apr 2011
   */
 
+#include <cstdint>
 #include <cstdio>
 #include <string>
 #include <vector>
 
 #include "common/utils/compiler_defs.h"
-#include "mws/types/CmmlToken.hpp"
+#include "mws/types/FlatCmml.hpp"
 #include "mws/types/GenericAnswer.hpp"
+#include "mws/types/QueryProfile.hpp"
 
 #include "build-gen/config.h"
 
@@ -56,14 +58,63 @@ struct Query {
     struct Options {
         bool includeHits;
         bool includeMwsIds;
-
-        Options() : includeHits(true), includeMwsIds(true) {}
+        /// Order the results by score instead of index order
+        bool ranked;
+        /// Report the subterm matched by each qvar in every answer
+        bool includeSubstitutions;
+        /// Report the formula of every id in ids-only answers, if the index
+        /// has a formula store
+        bool includeFormulae;
+        /// Count the solutions only up to the end of the page and estimate
+        /// the total by sampling the index
+        bool estimateTotal;
+        /// Return one answer per document, listing its hits, and count the
+        /// documents instead of the solutions
+        bool groupByDocument;
+        /// Stop the search after this many milliseconds (0 for no deadline)
+        unsigned int timeout;
+        /// Stop the search after visiting this many index nodes (0 for no
+        /// budget)
+        uint64_t maxNodes;
+        /// Bit c is set if collection c of the index is searched (all bits
+        /// set to search every document)
+        uint64_t collections;
+        /// CrawlIds of the documents searched, including both bounds
+        uint32_t minCrawlId;
+        uint32_t maxCrawlId;
+        /// Profile collecting the timings and counters of the query, if
+        /// explained (not owned)
+        QueryProfile* profile;
+
+        Options()
+            : includeHits(true),
+              includeMwsIds(true),
+              ranked(false),
+              includeSubstitutions(false),
+              includeFormulae(false),
+              estimateTotal(false),
+              groupByDocument(false),
+              timeout(DEFAULT_QUERY_TIMEOUT),
+              maxNodes(DEFAULT_QUERY_MAX_NODES),
+              collections(UINT64_MAX),
+              minCrawlId(0),
+              maxCrawlId(UINT32_MAX),
+              profile(nullptr) {}
+
+        /// @return true if only the occurrences in some documents are
+        /// searched. Occurrences without a document are then skipped.
+        bool isFiltered() const {
+            return collections != UINT64_MAX || minCrawlId > 0 ||
+                   maxCrawlId < UINT32_MAX;
+        }
     };
 
     /// Variable used to show the number of warnings (-1 for critical error)
     int warnings;
-    /// Vector containing pointers to the CMML tokens which have been read
-    std::vector<types::CmmlToken*> tokens;
+    /// Expressions which have been read, all sharing one flat arena
+    types::FlatCmml exprs;
+    /// Roots of the expressions in exprs, in reading order
+    std::vector<types::FlatCmml::Ref> tokens;
     /// Value showing the maximum number of results to be returned
     size_t attrResultMaxSize;
     /// Value showing the index from which to return results
@@ -73,6 +124,17 @@ struct Query {
     /// Value showing the maxmum number of result to be counted (returned or
     /// not)
     int attrResultTotalReqNr;
+    /// Value showing the number of parallel search tasks (0 for the server
+    /// default)
+    size_t attrParallelism;
+    /// Continuation token of the previous page, or any other value to
+    /// request one for the next page (empty for no pagination)
+    std::string attrCursor;
+    /// BoolValue showing if the answer reports the timings and counters of
+    /// the query
+    bool attrExplain;
+    /// Timings and counters of the query, collected if attrExplain is set
+    QueryProfile profile;
     const ResponseFormatter* responseFormatter;
     Options options;
     /// Boolean value showing if the query needed restrictions
@@ -81,6 +143,9 @@ struct Query {
     uint8_t max_depth;
     /// Cutoff mode used for schema-queries; ignored for regular mws-queries
     char cutoff_mode;
+    /// Queries of a mws:batch request, answered together (empty for a
+    /// single query)
+    std::vector<Query*> batch;
 
     /// Default Constructor of the MwsQuery class
     Query()
@@ -89,13 +154,14 @@ struct Query {
           attrResultLimitMin(0),
           attrResultTotalReq(DEFAULT_QUERY_TOTALREQ),
           attrResultTotalReqNr(DEFAULT_QUERY_RESULT_TOTAL),
+          attrParallelism(DEFAULT_QUERY_PARALLELISM),
+          attrExplain(false),
           restricted(false),
           max_depth(DEFAULT_SCHEMA_DEPTH) {}
 
     /// Destructor of the MwsQuery class
     ~Query() {
-        std::vector<types::CmmlToken*>::iterator it;
-        for (it = tokens.begin(); it != tokens.end(); it++) delete (*it);
+        for (Query* query : batch) delete query;
     }
 
     void applyRestrictions() {
@@ -111,6 +177,25 @@ struct Query {
             restricted = true;
             attrResultTotalReqNr = MAX_QUERY_RESULT_TOTAL;
         }
+        if (attrParallelism > MAX_QUERY_PARALLELISM) {
+            restricted = true;
+            attrParallelism = MAX_QUERY_PARALLELISM;
+        }
+        if (options.timeout > MAX_QUERY_TIMEOUT) {
+            restricted = true;
+            options.timeout = MAX_QUERY_TIMEOUT;
+        }
+        if (batch.size() > MAX_QUERY_BATCH_SIZE) {
+            restricted = true;
+            for (size_t i = MAX_QUERY_BATCH_SIZE; i < batch.size(); i++) {
+                delete batch[i];
+            }
+            batch.resize(MAX_QUERY_BATCH_SIZE);
+        }
+        for (Query* query : batch) {
+            query->applyRestrictions();
+            restricted |= query->restricted;
+        }
     }
 };
 
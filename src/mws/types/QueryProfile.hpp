@@ -0,0 +1,115 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef _MWS_TYPES_QUERYPROFILE_HPP
+#define _MWS_TYPES_QUERYPROFILE_HPP
+
+/**
+  * @brief  Timings and counters of a query run in explain mode
+  * @file   QueryProfile.hpp
+  * @date   19 Oct 2026
+  */
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mws/index/encoded_token.h"
+
+namespace mws {
+namespace types {
+
+/**
+  * @brief Where the time of a query went and how much work its search did.
+  * Durations are in microseconds. The search time excludes the database
+  * lookups, which have their own.
+  */
+struct QueryProfile {
+    typedef std::chrono::high_resolution_clock Time;
+
+    /// Parsing of the request by readMwsQuery
+    uint64_t parseTime;
+    /// Encoding of the expressions of the query
+    uint64_t encodeTime;
+    /// Search of the index
+    uint64_t searchTime;
+    /// Lookups of DbQueryManager
+    uint64_t dbTime;
+    /// Formatting of the answers, up to the profile
+    uint64_t formatTime;
+
+    /// Index nodes visited by the search
+    uint64_t nodesVisited;
+    /// Children of index nodes looked up by token
+    uint64_t childLookups;
+    /// Index numbers tried and rejected by a range of the query
+    uint64_t rangeRejects;
+    /// Backtracks of each query variable, by var id
+    std::vector<uint64_t> backtracks;
+    /// Seeks of the formula and crawl databases
+    uint64_t dbSeeks;
+    /// Bytes of crawl data fetched
+    uint64_t crawlBytes;
+
+    /// Backtracks of the named qvars, by name in query order, set once the
+    /// query is answered
+    std::vector<std::pair<std::string, uint64_t>> qvarBacktracks;
+
+    QueryProfile()
+        : parseTime(0),
+          encodeTime(0),
+          searchTime(0),
+          dbTime(0),
+          formatTime(0),
+          nodesVisited(0),
+          childLookups(0),
+          rangeRejects(0),
+          backtracks(VAR_ID_MAX + 1, 0),
+          dbSeeks(0),
+          crawlBytes(0) {}
+
+    /// @return the timings and counters by name, in report order
+    std::vector<std::pair<const char*, uint64_t>> report() const {
+        return {{"parsetime", parseTime},
+                {"encodetime", encodeTime},
+                {"searchtime", searchTime},
+                {"dbtime", dbTime},
+                {"formattime", formatTime},
+                {"nodes", nodesVisited},
+                {"childlookups", childLookups},
+                {"rangerejects", rangeRejects},
+                {"dbseeks", dbSeeks},
+                {"crawlbytes", crawlBytes}};
+    }
+
+    /// @return microseconds elapsed since start
+    static uint64_t microsSince(Time::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   Time::now() - start).count();
+    }
+};
+
+}  // namespace types
+}  // namespace mws
+
+#endif  // _MWS_TYPES_QUERYPROFILE_HPP
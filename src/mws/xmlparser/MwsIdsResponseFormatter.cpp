@@ -55,9 +55,8 @@ const char* MwsIdsResponseFormatter::getContentType() const {
     return "application/json";
 }
 
-int MwsIdsResponseFormatter::writeData(const GenericAnswer* ans,
-                                       FILE* output) const {
-    const MwsAnswset& answerSet = *((const MwsAnswset*)ans);
+/// @return the JSON object of an answer set
+static json_object* answsetToJson(const MwsAnswset& answerSet) {
     json_object* json_doc = json_object_new_object();
 
     // Creating qvars field
@@ -82,12 +81,58 @@ int MwsIdsResponseFormatter::writeData(const GenericAnswer* ans,
     }
     json_object_object_add(json_doc, "ids", json_ids);
 
+    // Create formulae field, in the order of the ids
+    if (answerSet.formulaDecoder) {
+        json_object* json_formulae = json_object_new_array();
+        for (FormulaId formulaId : answerSet.ids) {
+            json_object_array_add(
+                json_formulae,
+                json_object_new_string(
+                    answerSet.formulaDecoder(formulaId).c_str()));
+        }
+        json_object_object_add(json_doc, "formulae", json_formulae);
+    }
+
     /* Total number of formulae considered
      * (some schemata might have been dropped) */
     json_object_object_add(json_doc, "total",
                            json_object_new_int(answerSet.total));
+    json_object_object_add(json_doc, "estimated",
+                           json_object_new_boolean(answerSet.estimated));
+    if (answerSet.estimated) {
+        json_object_object_add(json_doc, "totallow",
+                               json_object_new_int(answerSet.totalLow));
+        json_object_object_add(json_doc, "totalhigh",
+                               json_object_new_int(answerSet.totalHigh));
+    }
     json_object_object_add(json_doc, "size",
                            json_object_new_int(answerSet.ids.size()));
+    json_object_object_add(json_doc, "partial",
+                           json_object_new_boolean(answerSet.partial));
+    if (!answerSet.cursor.empty()) {
+        json_object_object_add(
+            json_doc, "cursor",
+            json_object_new_string(answerSet.cursor.c_str()));
+    }
+
+    return json_doc;
+}
+
+int MwsIdsResponseFormatter::writeData(const GenericAnswer* ans,
+                                       FILE* output) const {
+    const MwsBatchAnswset* batch = dynamic_cast<const MwsBatchAnswset*>(ans);
+    json_object* json_doc;
+
+    if (batch == nullptr) {
+        json_doc = answsetToJson(*((const MwsAnswset*)ans));
+    } else {
+        json_object* answsets = json_object_new_array();
+        for (const MwsAnswset* answerSet : batch->answsets) {
+            json_object_array_add(answsets, answsetToJson(*answerSet));
+        }
+        json_doc = json_object_new_object();
+        json_object_object_add(json_doc, "answsets", answsets);
+    }
 
     string json_string = json_object_to_json_string(json_doc);
     fwrite(json_string.c_str(), json_string.size(), 1, output);
@@ -60,9 +60,31 @@ const char* MwsJsonResponseFormatter::getContentType() const {
     return HTTP_ENCODING;
 }
 
-int MwsJsonResponseFormatter::writeData(const GenericAnswer* ans,
-                                        FILE* output) const {
-    const MwsAnswset& answerSet = *((const MwsAnswset*)ans);
+/// @return the JSON object of the profile of an answer set
+static json_object* profileToJson(const types::QueryProfile& profile) {
+    json_object* explain = json_object_new_object();
+    json_object* backtracks = json_object_new_array();
+
+    for (const auto& field : profile.report()) {
+        json_object_object_add(explain, field.first,
+                               json_object_new_int64(field.second));
+    }
+    for (const auto& qvar : profile.qvarBacktracks) {
+        json_object* backtrack = json_object_new_object();
+        json_object_object_add(backtrack, "name",
+                               json_object_new_string(qvar.first.c_str()));
+        json_object_object_add(backtrack, "backtracks",
+                               json_object_new_int64(qvar.second));
+        json_object_array_add(backtracks, backtrack);
+    }
+    json_object_object_add(explain, "qvars", backtracks);
+
+    return explain;
+}
+
+/// @return the JSON object of an answer set
+static json_object* answsetToJson(const MwsAnswset& answerSet) {
+    auto startTime = types::QueryProfile::Time::now();
     json_object* json_doc, *qvars, *hits;
 
     json_doc = json_object_new_object();
@@ -71,10 +93,26 @@ int MwsJsonResponseFormatter::writeData(const GenericAnswer* ans,
 
     json_object_object_add(json_doc, "total",
                            json_object_new_int(answerSet.total));
+    json_object_object_add(json_doc, "estimated",
+                           json_object_new_boolean(answerSet.estimated));
+    if (answerSet.estimated) {
+        json_object_object_add(json_doc, "totallow",
+                               json_object_new_int(answerSet.totalLow));
+        json_object_object_add(json_doc, "totalhigh",
+                               json_object_new_int(answerSet.totalHigh));
+    }
 
     json_object_object_add(json_doc, "time",
                            json_object_new_int(answerSet.time));
 
+    json_object_object_add(json_doc, "partial",
+                           json_object_new_boolean(answerSet.partial));
+    if (!answerSet.cursor.empty()) {
+        json_object_object_add(
+            json_doc, "cursor",
+            json_object_new_string(answerSet.cursor.c_str()));
+    }
+
     // Creating qvars field
     for (int i = 0; i < (int)answerSet.qvarNames.size(); i++) {
         json_object* qvar = json_object_new_object();
@@ -93,20 +131,76 @@ int MwsJsonResponseFormatter::writeData(const GenericAnswer* ans,
     for (auto answerPtr : answerSet.answers) {
         json_object* hit = json_object_new_object();
         json_object* math_ids = json_object_new_array();
-        json_object* math_id = json_object_new_object();
-        json_object_object_add(math_id, "url",
-                               json_object_new_string(answerPtr->uri.c_str()));
-        json_object_object_add(
-            math_id, "xpath", json_object_new_string(answerPtr->xpath.c_str()));
-        json_object_array_add(math_ids, math_id);
+        // answers grouped by document list all of its hits
+        vector<types::FormulaPath> paths = answerPtr->hits;
+        if (paths.empty()) {
+            paths.push_back(types::FormulaPath(answerPtr->uri,
+                                               answerPtr->xpath));
+        }
+        for (const types::FormulaPath& path : paths) {
+            json_object* math_id = json_object_new_object();
+            json_object_object_add(math_id, "url",
+                                   json_object_new_string(path.xmlId.c_str()));
+            json_object_object_add(math_id, "xpath",
+                                   json_object_new_string(path.xpath.c_str()));
+            json_object_array_add(math_ids, math_id);
+        }
         json_object_object_add(hit, "math_ids", math_ids);
         json_object_object_add(hit, "xhtml",
                                json_object_new_string(answerPtr->data.c_str()));
+        if (answerSet.substitutionDecoder) {
+            json_object* substs = json_object_new_array();
+            for (size_t i = 0; i < answerPtr->substitutions.size() &&
+                                   i < answerSet.qvarNames.size();
+                 i++) {
+                json_object* subst = json_object_new_object();
+                json_object_object_add(
+                    subst, "qvar",
+                    json_object_new_string(answerSet.qvarNames[i].c_str()));
+                json_object_object_add(
+                    subst, "xpath",
+                    json_object_new_string(
+                        (answerPtr->xpath + answerSet.qvarXpaths[i]).c_str()));
+                json_object_object_add(
+                    subst, "cmml",
+                    json_object_new_string(
+                        answerSet.substitutionDecoder(
+                                      answerPtr->substitutions[i]).c_str()));
+                json_object_array_add(substs, subst);
+            }
+            json_object_object_add(hit, "subst", substs);
+        }
         json_object_array_add(hits, hit);
     }
 
     json_object_object_add(json_doc, "hits", hits);
 
+    // the profile is reported last, to time the formatting of the hits
+    if (answerSet.profile != nullptr) {
+        types::QueryProfile profile = *answerSet.profile;
+        profile.formatTime = types::QueryProfile::microsSince(startTime);
+        json_object_object_add(json_doc, "explain", profileToJson(profile));
+    }
+
+    return json_doc;
+}
+
+int MwsJsonResponseFormatter::writeData(const GenericAnswer* ans,
+                                        FILE* output) const {
+    const MwsBatchAnswset* batch = dynamic_cast<const MwsBatchAnswset*>(ans);
+    json_object* json_doc;
+
+    if (batch == nullptr) {
+        json_doc = answsetToJson(*((const MwsAnswset*)ans));
+    } else {
+        json_object* answsets = json_object_new_array();
+        for (const MwsAnswset* answerSet : batch->answsets) {
+            json_object_array_add(answsets, answsetToJson(*answerSet));
+        }
+        json_doc = json_object_new_object();
+        json_object_object_add(json_doc, "answsets", answsets);
+    }
+
     string json_string = json_object_to_json_string(json_doc);
     fwrite(json_string.c_str(), json_string.size(), 1, output);
 
@@ -49,11 +49,15 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include "build-gen/config.h"
 
 #define MWSANSWSET_MAIN_NAME "mws:answset"
+#define MWSANSWSET_BATCH_NAME "mws:batch"
 #define MWSANSWSET_ANSW_NAME "mws:answ"
 #define MWSANSWSET_SUBST_NAME "subst"
 #define MWSANSWSET_URI_NAME "uri"
 #define MWSANSWSET_XPATH_NAME "xpath"
 #define MWSANSWSET_SUBSTPAIR_NAME "mws:substpair"
+#define MWSANSWSET_HIT_NAME "mws:hit"
+#define MWSANSWSET_EXPLAIN_NAME "mws:explain"
+#define MWSANSWSET_QVAR_NAME "mws:qvar"
 
 using namespace std;
 using namespace mws;
@@ -88,51 +92,72 @@ const char* MwsXmlResponseFormatter::getContentType() const {
     return HTTP_ENCODING;
 }
 
-int MwsXmlResponseFormatter::writeData(const GenericAnswer* ans,
-                                       FILE* output) const {
-    const MwsAnswset& answerSet = *((const MwsAnswset*)ans);
-    xmlOutputBuffer* outPtr;
-    xmlTextWriter* writerPtr;
-    size_t qvarNr;
+/**
+  * @brief Write the profile of an answer set as a mws:explain element
+  * @return -1 on error
+  */
+static int writeProfile(xmlTextWriter* writerPtr,
+                        const types::QueryProfile& profile) {
     int ret;
-    unsigned int i;
-    LocalContext ctxt;
 
-    // Initializing values
-    outPtr = nullptr;
-    writerPtr = nullptr;
-    ret = -1;
-    qvarNr = answerSet.qvarNames.size();
-    ctxt.file = output;
-    ctxt.total_bytes_written = 0;
+    if ((ret = xmlTextWriterStartElement(
+             writerPtr, BAD_CAST MWSANSWSET_EXPLAIN_NAME)) == -1) {
+        PRINT_WARN("Error at xmlTextWriterStartElement\n");
+        return ret;
+    }
+    for (const auto& field : profile.report()) {
+        if ((ret = xmlTextWriterWriteAttribute(
+                 writerPtr, BAD_CAST field.first,
+                 BAD_CAST std::to_string(field.second).c_str())) == -1) {
+            PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+            return ret;
+        }
+    }
+    for (const auto& qvar : profile.qvarBacktracks) {
+        if ((ret = xmlTextWriterStartElement(
+                 writerPtr, BAD_CAST MWSANSWSET_QVAR_NAME)) == -1) {
+            PRINT_WARN("Error at xmlTextWriterStartElement\n");
+        } else if ((ret = xmlTextWriterWriteAttribute(
+                        writerPtr, BAD_CAST "name",
+                        BAD_CAST qvar.first.c_str())) == -1) {
+            PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+        } else if ((ret = xmlTextWriterWriteAttribute(
+                        writerPtr, BAD_CAST "backtracks",
+                        BAD_CAST std::to_string(qvar.second).c_str())) ==
+                   -1) {
+            PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+        } else if ((ret = xmlTextWriterEndElement(writerPtr)) == -1) {
+            PRINT_WARN("Error at xmlTextWriterEndElement\n");
+        }
+        if (ret == -1) return ret;
+    }
+    if ((ret = xmlTextWriterEndElement(writerPtr)) == -1) {
+        PRINT_WARN("Error at xmlTextWriterEndElement\n");
+    }
 
-    if ((outPtr = xmlOutputBufferCreateIO(fileXmlOutputWriteCallback, nullptr,
-                                          &ctxt, nullptr)) ==
-        nullptr) {
-        PRINT_WARN("Error while creating the OutputBuffer\n");
-    } else if ((writerPtr = xmlNewTextWriter(outPtr)) == nullptr) {
-        PRINT_WARN("Error while creating the TextWriter\n");
-    } else if ((ret =
-                    xmlTextWriterStartDocument(writerPtr,  // xmlTextWriter
-                                               nullptr,   // XML version ("1.0")
-                                               nullptr,   // Encoding ("UTF-8")
-                                               nullptr))  // Standalone ("yes")
-               ==
-               -1) {
-        PRINT_WARN("Error at xmlTextWriterStartDocument\n");
-    } else if ((ret = xmlTextWriterWriteComment(
-                    writerPtr,
-                    BAD_CAST "MwsAnswset generated by " MWS_BUILD)) ==
-               -1) {
-        PRINT_WARN("Error at xmlTextWriterStartDocument\n");
-    } else if ((ret = xmlTextWriterStartElement(
-                    writerPtr, BAD_CAST MWSANSWSET_MAIN_NAME)) ==
-               -1) {
+    return ret;
+}
+
+/**
+  * @brief Write an answer set as a mws:answset element
+  * @param withNamespace if true, the element declares the mws namespace
+  * @return -1 on error
+  */
+static int writeAnswset(xmlTextWriter* writerPtr, const MwsAnswset& answerSet,
+                        bool withNamespace) {
+    auto startTime = types::QueryProfile::Time::now();
+    size_t qvarNr = answerSet.qvarNames.size();
+    int ret;
+    unsigned int i;
+
+    if ((ret = xmlTextWriterStartElement(
+             writerPtr, BAD_CAST MWSANSWSET_MAIN_NAME)) ==
+        -1) {
         PRINT_WARN("Error at xmlTextWriterStartElement\n");
-    } else if ((ret = xmlTextWriterWriteAttribute(
+    } else if (withNamespace &&
+               (ret = xmlTextWriterWriteAttribute(
                     writerPtr, BAD_CAST "xmlns:mws",
-                    BAD_CAST "http://www.mathweb.org/mws/ns")) ==
-               -1) {
+                    BAD_CAST "http://www.mathweb.org/mws/ns")) == -1) {
         PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
     } else if ((ret = xmlTextWriterWriteAttribute(
                     writerPtr, BAD_CAST "size",
@@ -145,6 +170,29 @@ int MwsXmlResponseFormatter::writeData(const GenericAnswer* ans,
                     BAD_CAST std::to_string(answerSet.total).c_str())) ==
                -1) {
         PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+    } else if (answerSet.estimated &&
+               ((ret = xmlTextWriterWriteAttribute(writerPtr,
+                                                   BAD_CAST "estimated",
+                                                   BAD_CAST "true")) == -1 ||
+                (ret = xmlTextWriterWriteAttribute(
+                     writerPtr, BAD_CAST "totallow",
+                     BAD_CAST std::to_string(answerSet.totalLow).c_str())) ==
+                    -1 ||
+                (ret = xmlTextWriterWriteAttribute(
+                     writerPtr, BAD_CAST "totalhigh",
+                     BAD_CAST std::to_string(answerSet.totalHigh).c_str())) ==
+                    -1)) {
+        PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+    } else if (answerSet.partial &&
+               (ret = xmlTextWriterWriteAttribute(writerPtr,
+                                                  BAD_CAST "partial",
+                                                  BAD_CAST "true")) == -1) {
+        PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+    } else if (!answerSet.cursor.empty() &&
+               (ret = xmlTextWriterWriteAttribute(
+                    writerPtr, BAD_CAST "cursor",
+                    BAD_CAST answerSet.cursor.c_str())) == -1) {
+        PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
     } else {
         for (auto& answer : answerSet.answers) {
             if ((ret = xmlTextWriterStartElement(
@@ -185,12 +233,41 @@ int MwsXmlResponseFormatter::writeData(const GenericAnswer* ans,
                                -1) {
                         PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
                         break;
+                    } else if (answerSet.substitutionDecoder &&
+                               i < answer->substitutions.size() &&
+                               (ret = xmlTextWriterWriteRaw(
+                                    writerPtr,
+                                    BAD_CAST answerSet.substitutionDecoder(
+                                        answer->substitutions[i]).c_str())) ==
+                                   -1) {
+                        PRINT_WARN("Error at xmlTextWriterWriteRaw\n");
+                        break;
                     } else if ((ret = xmlTextWriterEndElement(writerPtr)) ==
                                -1) {
                         PRINT_WARN("Error at xmlTextWriterEndElement\n");
                         break;
                     }
                 }
+                // the hits of a document
+                for (const auto& hit : answer->hits) {
+                    if (ret == -1) break;
+                    if ((ret = xmlTextWriterStartElement(
+                             writerPtr, BAD_CAST MWSANSWSET_HIT_NAME)) ==
+                        -1) {
+                        PRINT_WARN("Error at xmlTextWriterStartElement\n");
+                    } else if ((ret = xmlTextWriterWriteAttribute(
+                                    writerPtr, BAD_CAST MWSANSWSET_URI_NAME,
+                                    BAD_CAST hit.xmlId.c_str())) == -1) {
+                        PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+                    } else if ((ret = xmlTextWriterWriteAttribute(
+                                    writerPtr, BAD_CAST MWSANSWSET_XPATH_NAME,
+                                    BAD_CAST hit.xpath.c_str())) == -1) {
+                        PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+                    } else if ((ret = xmlTextWriterEndElement(writerPtr)) ==
+                               -1) {
+                        PRINT_WARN("Error at xmlTextWriterEndElement\n");
+                    }
+                }
                 // <data> ... </data>
                 xmlTextWriterWriteElement(writerPtr, BAD_CAST "data",
                                           BAD_CAST answer->data.c_str());
@@ -204,10 +281,78 @@ int MwsXmlResponseFormatter::writeData(const GenericAnswer* ans,
             }
         }
     }
+    if (ret != -1 && answerSet.profile != nullptr) {
+        // the profile is written last, to time the formatting of the answers
+        types::QueryProfile profile = *answerSet.profile;
+        profile.formatTime = types::QueryProfile::microsSince(startTime);
+        ret = writeProfile(writerPtr, profile);
+    }
     if (ret == -1) {
         PRINT_WARN("Error while writing xml answers\n");
     } else if ((ret = xmlTextWriterEndElement(writerPtr)) == -1) {
         PRINT_WARN("Error at xmlTextWriterEndElement\n");
+    }
+
+    return ret;
+}
+
+int MwsXmlResponseFormatter::writeData(const GenericAnswer* ans,
+                                       FILE* output) const {
+    const MwsBatchAnswset* batch = dynamic_cast<const MwsBatchAnswset*>(ans);
+    xmlOutputBuffer* outPtr;
+    xmlTextWriter* writerPtr;
+    int ret;
+    LocalContext ctxt;
+
+    // Initializing values
+    outPtr = nullptr;
+    writerPtr = nullptr;
+    ret = -1;
+    ctxt.file = output;
+    ctxt.total_bytes_written = 0;
+
+    if ((outPtr = xmlOutputBufferCreateIO(fileXmlOutputWriteCallback, nullptr,
+                                          &ctxt, nullptr)) ==
+        nullptr) {
+        PRINT_WARN("Error while creating the OutputBuffer\n");
+    } else if ((writerPtr = xmlNewTextWriter(outPtr)) == nullptr) {
+        PRINT_WARN("Error while creating the TextWriter\n");
+    } else if ((ret =
+                    xmlTextWriterStartDocument(writerPtr,  // xmlTextWriter
+                                               nullptr,   // XML version ("1.0")
+                                               nullptr,   // Encoding ("UTF-8")
+                                               nullptr))  // Standalone ("yes")
+               ==
+               -1) {
+        PRINT_WARN("Error at xmlTextWriterStartDocument\n");
+    } else if ((ret = xmlTextWriterWriteComment(
+                    writerPtr,
+                    BAD_CAST "MwsAnswset generated by " MWS_BUILD)) ==
+               -1) {
+        PRINT_WARN("Error at xmlTextWriterStartDocument\n");
+    } else if (batch == nullptr) {
+        ret = writeAnswset(writerPtr, *((const MwsAnswset*)ans), true);
+    } else if ((ret = xmlTextWriterStartElement(
+                    writerPtr, BAD_CAST MWSANSWSET_BATCH_NAME)) ==
+               -1) {
+        PRINT_WARN("Error at xmlTextWriterStartElement\n");
+    } else if ((ret = xmlTextWriterWriteAttribute(
+                    writerPtr, BAD_CAST "xmlns:mws",
+                    BAD_CAST "http://www.mathweb.org/mws/ns")) ==
+               -1) {
+        PRINT_WARN("Error at xmlTextWriterWriteAttribute\n");
+    } else {
+        for (const MwsAnswset* answerSet : batch->answsets) {
+            if ((ret = writeAnswset(writerPtr, *answerSet, false)) == -1) {
+                break;
+            }
+        }
+        if (ret != -1 && (ret = xmlTextWriterEndElement(writerPtr)) == -1) {
+            PRINT_WARN("Error at xmlTextWriterEndElement\n");
+        }
+    }
+    if (ret == -1) {
+        PRINT_WARN("Error while writing xml answer sets\n");
     } else if ((ret = xmlTextWriterEndDocument(writerPtr)) == -1) {
         PRINT_WARN("Error at xmlTextWriterEndDocument\n");
     } else if ((ret = xmlTextWriterFlush(writerPtr)) == -1) {
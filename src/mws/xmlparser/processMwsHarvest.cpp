@@ -59,6 +59,7 @@ using std::map;
 
 #include "common/utils/compiler_defs.h"
 #include "mws/types/CmmlToken.hpp"
+#include "mws/types/FlatCmml.hpp"
 #include "mws/xmlparser/processMwsHarvest.hpp"
 
 // Macros
@@ -94,6 +95,10 @@ struct MwsHarvest_SaxUserData {
     types::CmmlToken* currentToken;
     /// The root of the token being currently parsed
     types::CmmlToken* currentTokenRoot;
+    /// True if expressions are parsed into flatExpression
+    bool useFlatExpressions;
+    /// Reusable arena for the expression being parsed (flat mode)
+    types::FlatCmml flatExpression;
     /// State of the parsing before going into an unknown state
     MwsHarvestState prevState;
     /// True if an XML structural error is detected
@@ -120,6 +125,7 @@ struct MwsHarvest_SaxUserData {
           unknownDepth(0),
           currentToken(nullptr),
           currentTokenRoot(nullptr),
+          useFlatExpressions(false),
           prevState(MWSHARVESTSTATE_DEFAULT),
           errorDetected(false),
           parsedExpr(0),
@@ -295,6 +301,18 @@ static void my_startElement(void* user_data, const xmlChar* name,
         break;
 
     case MWSHARVESTSTATE_IN_MWS_EXPR:
+        if (data->useFlatExpressions) {
+            data->flatExpression.beginNode(
+                reinterpret_cast<const char*>(name),
+                strlen(reinterpret_cast<const char*>(name)));
+            while (nullptr != attrs && nullptr != attrs[0]) {
+                data->flatExpression.addAttribute(
+                    reinterpret_cast<const char*>(attrs[0]),
+                    reinterpret_cast<const char*>(attrs[1]));
+                attrs = &attrs[2];
+            }
+            break;
+        }
         if (data->currentToken != nullptr) {
             data->currentToken = data->currentToken->newChildNode();
         } else {
@@ -349,7 +367,28 @@ static void my_endElement(void* user_data, const xmlChar* name) {
         break;
 
     case MWSHARVESTSTATE_IN_MWS_EXPR:
-        if (data->currentToken == nullptr) {
+        if (data->useFlatExpressions) {
+            FlatCmml& expression = data->flatExpression;
+            if (expression.openNodes() == 0) {
+                data->state = MWSHARVESTSTATE_IN_MWS_HARVEST;
+                break;
+            }
+            expression.endNode();
+            if (expression.openNodes() == 0) {
+                CrawlId crawlId = CRAWLID_NULL;
+                auto it = data->localIdToCrawlIds.find(data->localId);
+                if (data->shouldProcessData &&
+                    it != data->localIdToCrawlIds.end()) {
+                    crawlId = it->second;
+                }
+                int ret = data->harvestProcessor->processFlatExpression(
+                    expression.root(), data->exprUri, crawlId);
+                if (ret != -1) {
+                    data->parsedExpr += ret;
+                }
+                expression.clear();
+            }
+        } else if (data->currentToken == nullptr) {
             data->state = MWSHARVESTSTATE_IN_MWS_HARVEST;
         } else if (data->currentToken->isRoot()) {
             int ret;
@@ -402,9 +441,12 @@ static void my_endElement(void* user_data, const xmlChar* name) {
 static void my_characters(void* user_data, const xmlChar* ch, int len) {
     MwsHarvest_SaxUserData* data = (MwsHarvest_SaxUserData*)user_data;
 
-    if (data->state == MWSHARVESTSTATE_IN_MWS_EXPR &&  // Valid state
-        data->currentToken != nullptr) {               // Valid token
-        data->currentToken->appendTextContent((char*)ch, len);
+    if (data->state == MWSHARVESTSTATE_IN_MWS_EXPR) {  // Valid state
+        if (data->currentToken != nullptr) {            // Valid token
+            data->currentToken->appendTextContent((char*)ch, len);
+        } else if (data->flatExpression.openNodes() > 0) {
+            data->flatExpression.appendTextContent((const char*)ch, len);
+        }
     }
 
     if (data->state == MWSHARVESTSTATE_IN_MWS_DATA) {
@@ -439,6 +481,7 @@ static void my_error(void* user_data, const char* msg, ...) {
         data->currentTokenRoot = nullptr;
         data->currentToken = nullptr;
     }
+    data->flatExpression.clear();
     va_start(args, msg);
     vfprintf(stderr, msg, args);
     va_end(args);
@@ -467,6 +510,7 @@ HarvestResult processHarvestFromFd(int fd, HarvestProcessor* harvestProcessor,
 
     user_data.harvestProcessor = harvestProcessor;
     user_data.shouldProcessData = shouldProcessData;
+    user_data.useFlatExpressions = harvestProcessor->wantsFlatExpressions();
     memset(&saxHandler, 0, sizeof(xmlSAXHandler));
 
     // Registering Sax callbacks
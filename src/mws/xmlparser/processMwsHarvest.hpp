@@ -40,6 +40,7 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include <utility>
 
 #include "mws/types/CmmlToken.hpp"
+#include "mws/types/FlatCmml.hpp"
 #include "mws/dbc/CrawlDb.hpp"
 #include "common/utils/Path.hpp"
 
@@ -68,6 +69,30 @@ class HarvestProcessor {
      */
     virtual dbc::CrawlId processData(const std::string& data) = 0;
 
+    /**
+     * Processors which do not need a CmmlToken tree can return true to
+     * receive expressions through processFlatExpression() instead. The
+     * parser then reuses one flat arena for all expressions, without any
+     * per-node heap allocation.
+     */
+    virtual bool wantsFlatExpressions() const { return false; }
+    /**
+     * @brief called when an expr element has been parsed, if
+     * wantsFlatExpressions() returns true
+     * @param expression root of the parsed expr, valid during the call only
+     * @param exprUri
+     * @param crawlId of data associated with this expression
+     * @return 0 if expr was processed successfully, different otherwise
+     */
+    virtual int processFlatExpression(const types::FlatCmml::Ref& expression,
+                                      const std::string& exprUri,
+                                      const uint32_t& crawlId) {
+        UNUSED(expression);
+        UNUSED(exprUri);
+        UNUSED(crawlId);
+        return -1;
+    }
+
     virtual ~HarvestProcessor() {}
 };
 
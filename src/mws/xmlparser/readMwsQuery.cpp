@@ -49,6 +49,8 @@ along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
 #include "common/utils/getBoolType.hpp"
 using common::utils::BoolType;
 using common::utils::getBoolType;
+using common::utils::BOOL_DEFAULT;
+using common::utils::BOOL_YES;
 #include "mws/xmlparser/MwsJsonResponseFormatter.hpp"
 using mws::parser::RESPONSE_FORMATTER_MWS_JSON;
 #include "mws/xmlparser/MwsXmlResponseFormatter.hpp"
@@ -61,10 +63,24 @@ using mws::parser::RESPONSE_FORMATTER_SCHEMA_XML;
 using mws::parser::RESPONSE_FORMATTER_SCHEMA_JSON;
 
 #define MWSQUERY_MAIN_NAME "mws:query"
+#define MWSQUERY_BATCH_NAME "mws:batch"
 #define MWSQUERY_ATTR_ANSWSET_MAXSIZE "answsize"
 #define MWSQUERY_ATTR_ANSWSET_LIMITMIN "limitmin"
 #define MWSQUERY_ATTR_ANSWSET_TOTALREQ "totalreq"
 #define MWSQUERY_ATTR_OUTPUTFORMAT "output"
+#define MWSQUERY_ATTR_PARALLELISM "parallelism"
+#define MWSQUERY_ATTR_RANK "rank"
+#define MWSQUERY_ATTR_TIMEOUT "timeout"
+#define MWSQUERY_ATTR_MAXNODES "maxnodes"
+#define MWSQUERY_ATTR_CURSOR "cursor"
+#define MWSQUERY_ATTR_SUBSTITUTIONS "substitutions"
+#define MWSQUERY_ATTR_FORMULAE "formulae"
+#define MWSQUERY_ATTR_ESTIMATETOTAL "estimatetotal"
+#define MWSQUERY_ATTR_GROUPBY "groupby"
+#define MWSQUERY_ATTR_COLLECTIONS "collections"
+#define MWSQUERY_ATTR_CRAWLMIN "crawlmin"
+#define MWSQUERY_ATTR_CRAWLMAX "crawlmax"
+#define MWSQUERY_ATTR_EXPLAIN "explain"
 #define SCHQUERY_ATTR_DEPTH "schema_depth"
 #define SCHQUERY_ATTR_CUTOFFMODE "cutoff_mode"
 #define MWSQUERY_EXPR_NAME "mws:expr"
@@ -77,6 +93,7 @@ using namespace mws::types;
   */
 enum MwsQueryState {
     MWSQUERYSTATE_DEFAULT,
+    MWSQUERYSTATE_IN_MWS_BATCH,
     MWSQUERYSTATE_IN_MWS_QUERY,
     MWSQUERYSTATE_IN_MWS_EXPR,
     MWSQUERYSTATE_UNKNOWN,
@@ -89,10 +106,8 @@ enum MwsQueryState {
 struct MwsQuery_SaxUserData {
     /// Depth of the parse tree in unknown state
     int unknownDepth;
-    /// The token which is currently being parsed
-    types::CmmlToken* currentToken;
-    /// The root of the token being currently parsed
-    types::CmmlToken* currentTokenRoot;
+    /// Root of the expression being currently parsed
+    types::FlatCmml::NodeId currentRoot;
     /// State of the parsing
     MwsQueryState state;
     /// State of the parsing before going into an unknown state
@@ -101,6 +116,8 @@ struct MwsQuery_SaxUserData {
     bool errorDetected;
     /// Result of the parsing
     mws::types::Query* result;
+    /// Query being parsed: the result or a query of its batch
+    mws::types::Query* currentQuery;
     /// Type of query that we are parsing
     mws::xmlparser::QueryMode qMode;
 
@@ -108,8 +125,8 @@ struct MwsQuery_SaxUserData {
         result = nullptr;
         result = new Query;
         result->responseFormatter = RESPONSE_FORMATTER_MWS_XML;
-        currentToken = nullptr;
-        currentTokenRoot = nullptr;
+        currentQuery = result;
+        currentRoot = FlatCmml::NO_NODE;
         state = MWSQUERYSTATE_DEFAULT;
         errorDetected = false;
         result->warnings = 0;
@@ -134,6 +151,140 @@ static void my_endDocument(void* user_data) {
     }
 }
 
+/**
+  * @brief Read a list of collection indices separated by commas or spaces
+  *
+  * @return the mask of the collections. Indices past the last collection
+  * an index can hold are ignored.
+  */
+static uint64_t readCollections(const char* value) {
+    uint64_t collections = 0;
+    char* end;
+
+    while (*value != '\0') {
+        unsigned long collection = strtoul(value, &end, 10);
+        if (end == value) {
+            value++;
+            continue;
+        }
+        if (collection < 64) collections |= (uint64_t)1 << collection;
+        value = end;
+    }
+
+    return collections;
+}
+
+/**
+  * @return the CrawlId value, clamped to the CrawlIds
+  */
+static uint32_t readCrawlId(const char* value) {
+    long long crawlId = strtoll(value, nullptr, 10);
+    if (crawlId < 0) return 0;
+    return (crawlId > UINT32_MAX) ? UINT32_MAX : (uint32_t)crawlId;
+}
+
+/**
+  * @brief Read the attributes of a mws:query or mws:batch element
+  *
+  * @param data is a structure which holds the state of the parser.
+  * @param query is the query to configure.
+  * @param attrs is an array of attributes and values, alternatively placed.
+  */
+static void readQueryAttributes(MwsQuery_SaxUserData* data, Query* query,
+                                const xmlChar** attrs) {
+    int numValue;
+    BoolType boolValue;
+
+    while (nullptr != attrs && nullptr != attrs[0]) {
+        if (strncmp((char*)attrs[0], "xmlns:", 6) == 0) {
+            /* ignore namespaces */
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_ANSWSET_MAXSIZE) ==
+                   0) {
+            numValue = (int)strtol((char*)attrs[1], nullptr, 10);
+            query->attrResultMaxSize = numValue;
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_ANSWSET_LIMITMIN) ==
+                   0) {
+            numValue = (int)strtol((char*)attrs[1], nullptr, 10);
+            query->attrResultLimitMin = numValue;
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_ANSWSET_TOTALREQ) ==
+                   0) {
+            boolValue = getBoolType((char*)attrs[1]);
+            if (boolValue != BOOL_DEFAULT) {
+                query->attrResultTotalReq = (boolValue == BOOL_YES);
+            }
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_PARALLELISM) == 0) {
+            numValue = (int)strtol((char*)attrs[1], nullptr, 10);
+            query->attrParallelism = (numValue > 0) ? numValue : 0;
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_RANK) == 0) {
+            boolValue = getBoolType((char*)attrs[1]);
+            query->options.ranked = (boolValue == BOOL_YES);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_TIMEOUT) == 0) {
+            numValue = (int)strtol((char*)attrs[1], nullptr, 10);
+            query->options.timeout = (numValue > 0) ? numValue : 0;
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_MAXNODES) == 0) {
+            long long maxNodes = strtoll((char*)attrs[1], nullptr, 10);
+            query->options.maxNodes = (maxNodes > 0) ? maxNodes : 0;
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_CURSOR) == 0) {
+            query->attrCursor = (char*)attrs[1];
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_SUBSTITUTIONS) ==
+                   0) {
+            boolValue = getBoolType((char*)attrs[1]);
+            query->options.includeSubstitutions = (boolValue == BOOL_YES);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_FORMULAE) == 0) {
+            boolValue = getBoolType((char*)attrs[1]);
+            query->options.includeFormulae = (boolValue == BOOL_YES);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_ESTIMATETOTAL) ==
+                   0) {
+            boolValue = getBoolType((char*)attrs[1]);
+            query->options.estimateTotal = (boolValue == BOOL_YES);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_GROUPBY) == 0) {
+            query->options.groupByDocument =
+                (strcmp((char*)attrs[1], "document") == 0);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_COLLECTIONS) == 0) {
+            query->options.collections = readCollections((char*)attrs[1]);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_CRAWLMIN) == 0) {
+            query->options.minCrawlId = readCrawlId((char*)attrs[1]);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_CRAWLMAX) == 0) {
+            query->options.maxCrawlId = readCrawlId((char*)attrs[1]);
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_EXPLAIN) == 0) {
+            boolValue = getBoolType((char*)attrs[1]);
+            query->attrExplain = (boolValue == BOOL_YES);
+        } else if (strcmp((char*)attrs[0], SCHQUERY_ATTR_DEPTH) == 0) {
+            numValue = (int)strtol((char*)attrs[1], nullptr, 10);
+            query->max_depth = numValue;
+        } else if (strcmp((char*)attrs[0], SCHQUERY_ATTR_CUTOFFMODE) == 0) {
+            query->cutoff_mode = ((char*)attrs[1])[0];
+        } else if (strcmp((char*)attrs[0], MWSQUERY_ATTR_OUTPUTFORMAT) == 0) {
+            bool schemaMode = data->qMode == mws::xmlparser::QUERY_SCHEMA;
+            if (strcmp((char*)attrs[1], "xml") == 0) {
+                if (schemaMode) {
+                    query->responseFormatter = RESPONSE_FORMATTER_SCHEMA_XML;
+                } else {
+                    query->responseFormatter = RESPONSE_FORMATTER_MWS_XML;
+                }
+            } else if (strcmp((char*)attrs[1], "json") == 0) {
+                if (schemaMode) {
+                    query->responseFormatter = RESPONSE_FORMATTER_SCHEMA_JSON;
+                } else {
+                    query->responseFormatter = RESPONSE_FORMATTER_MWS_JSON;
+                }
+            } else if (strcmp((char*)attrs[1], "mws-ids") == 0) {
+                query->responseFormatter = RESPONSE_FORMATTER_MWS_IDS;
+                query->options.includeHits = false;
+                query->options.includeMwsIds = true;
+            } else {
+                PRINT_WARN("Invalid output format \"%s\"\n", attrs[1]);
+            }
+        } else {
+            // Invalid attributes
+            data->result->warnings++;
+            PRINT_WARN("Invalid attribute: \"%s\"\n", attrs[0]);
+        }
+
+        attrs = &attrs[2];
+    }
+}
+
 /**
   * @brief This function is called when the SAX handler encounters the
   * beginning of an element.
@@ -146,77 +297,44 @@ static void my_endDocument(void* user_data) {
   */
 static void my_startElement(void* user_data, const xmlChar* name,
                             const xmlChar** attrs) {
-    int numValue;
-    BoolType boolValue;
     MwsQuery_SaxUserData* data = (MwsQuery_SaxUserData*)user_data;
 
     switch (data->state) {
     case MWSQUERYSTATE_DEFAULT:
         if (strcmp((char*)name, MWSQUERY_MAIN_NAME) == 0) {
             data->state = MWSQUERYSTATE_IN_MWS_QUERY;
-            // Parsing the attributes
-            while (nullptr != attrs && nullptr != attrs[0]) {
-                if (strncmp((char*)attrs[0], "xmlns:", 6) == 0) {
-                    /* ignore namespaces */
-                } else if (strcmp((char*)attrs[0],
-                                  MWSQUERY_ATTR_ANSWSET_MAXSIZE) ==
-                           0) {
-                    numValue = (int)strtol((char*)attrs[1], nullptr, 10);
-                    data->result->attrResultMaxSize = numValue;
-                } else if (strcmp((char*)attrs[0],
-                                  MWSQUERY_ATTR_ANSWSET_LIMITMIN) ==
-                           0) {
-                    numValue = (int)strtol((char*)attrs[1], nullptr, 10);
-                    data->result->attrResultLimitMin = numValue;
-                } else if (strcmp((char*)attrs[0],
-                                  MWSQUERY_ATTR_ANSWSET_TOTALREQ) ==
-                           0) {
-                    boolValue = getBoolType((char*)attrs[1]);
-                    data->result->attrResultTotalReq = boolValue;
-                } else if (strcmp((char*)attrs[0], SCHQUERY_ATTR_DEPTH) ==
-                           0) {
-                    numValue = (int)strtol((char*)attrs[1], nullptr, 10);
-                    data->result->max_depth = numValue;
-                } else if (strcmp((char*)attrs[0], SCHQUERY_ATTR_CUTOFFMODE) ==
-                           0) {
-                    data->result->cutoff_mode = ((char*)attrs[1])[0];
-                } else if (strcmp((char*)attrs[0],
-                                  MWSQUERY_ATTR_OUTPUTFORMAT) ==
-                           0) {
-                    bool schemaMode =
-                        data->qMode == mws::xmlparser::QUERY_SCHEMA;
-                    if (strcmp((char*)attrs[1], "xml") == 0) {
-                        if (schemaMode) {
-                            data->result->responseFormatter =
-                                RESPONSE_FORMATTER_SCHEMA_XML;
-                        } else {
-                            data->result->responseFormatter =
-                                RESPONSE_FORMATTER_MWS_XML;
-                        }
-                    } else if (strcmp((char*)attrs[1], "json") == 0) {
-                        if (schemaMode) {
-                            data->result->responseFormatter =
-                                RESPONSE_FORMATTER_SCHEMA_JSON;
-                        } else {
-                            data->result->responseFormatter =
-                                RESPONSE_FORMATTER_MWS_JSON;
-                        }
-                    } else if (strcmp((char*)attrs[1], "mws-ids") == 0) {
-                        data->result->responseFormatter =
-                            RESPONSE_FORMATTER_MWS_IDS;
-                        data->result->options.includeHits = false;
-                        data->result->options.includeMwsIds = true;
-                    } else {
-                        PRINT_WARN("Invalid output format \"%s\"\n", attrs[1]);
-                    }
-                } else {
-                    // Invalid attributes
-                    data->result->warnings++;
-                    PRINT_WARN("Invalid attribute: \"%s\"\n", attrs[0]);
-                }
+            readQueryAttributes(data, data->result, attrs);
+        } else if (strcmp((char*)name, MWSQUERY_BATCH_NAME) == 0 &&
+                   data->qMode == mws::xmlparser::QUERY_MWS) {
+            // the attributes of the batch are defaults of its queries
+            data->state = MWSQUERYSTATE_IN_MWS_BATCH;
+            readQueryAttributes(data, data->result, attrs);
+        } else {
+            data->result->warnings++;
+            // Saving the state
+            data->prevState = data->state;
+            // Going to an unkown state
+            data->state = MWSQUERYSTATE_UNKNOWN;
+            data->unknownDepth = 1;
+        }
+        break;
 
-                attrs = &attrs[2];
-            }
+    case MWSQUERYSTATE_IN_MWS_BATCH:
+        if (strcmp((char*)name, MWSQUERY_MAIN_NAME) == 0) {
+            const Query* batch = data->result;
+            Query* query = new Query();
+            query->attrResultMaxSize = batch->attrResultMaxSize;
+            query->attrResultLimitMin = batch->attrResultLimitMin;
+            query->attrResultTotalReq = batch->attrResultTotalReq;
+            query->attrResultTotalReqNr = batch->attrResultTotalReqNr;
+            query->attrParallelism = batch->attrParallelism;
+            query->attrExplain = batch->attrExplain;
+            query->responseFormatter = batch->responseFormatter;
+            query->options = batch->options;
+            readQueryAttributes(data, query, attrs);
+            data->result->batch.push_back(query);
+            data->currentQuery = query;
+            data->state = MWSQUERYSTATE_IN_MWS_QUERY;
         } else {
             data->result->warnings++;
             // Saving the state
@@ -241,18 +359,16 @@ static void my_startElement(void* user_data, const xmlChar* name,
         break;
 
     case MWSQUERYSTATE_IN_MWS_EXPR:
-        // Building the token
-        if (data->currentToken != nullptr) {
-            data->currentToken = data->currentToken->newChildNode();
-        } else {
-            data->currentTokenRoot = CmmlToken::newRoot();
-            data->currentToken = data->currentTokenRoot;
+        // Building the expression in the arena of the query
+        if (data->currentQuery->exprs.openNodes() == 0) {
+            data->currentRoot = data->currentQuery->exprs.size();
         }
-        // Adding the tag name
-        data->currentToken->setTag((char*)name);
+        data->currentQuery->exprs.beginNode((char*)name,
+                                            strlen((char*)name));
         // Adding the attributes
         while (nullptr != attrs && nullptr != attrs[0]) {
-            data->currentToken->addAttribute((char*)attrs[0], (char*)attrs[1]);
+            data->currentQuery->exprs.addAttribute((char*)attrs[0],
+                                                   (char*)attrs[1]);
             attrs = &attrs[2];
         }
         break;
@@ -280,19 +396,29 @@ static void my_endElement(void* user_data, const xmlChar* name) {
         // Shouldn't happen
         break;
 
-    case MWSQUERYSTATE_IN_MWS_QUERY:
+    case MWSQUERYSTATE_IN_MWS_BATCH:
         data->state = MWSQUERYSTATE_DEFAULT;
         break;
 
+    case MWSQUERYSTATE_IN_MWS_QUERY:
+        if (data->currentQuery != data->result) {
+            data->currentQuery = data->result;
+            data->state = MWSQUERYSTATE_IN_MWS_BATCH;
+        } else {
+            data->state = MWSQUERYSTATE_DEFAULT;
+        }
+        break;
+
     case MWSQUERYSTATE_IN_MWS_EXPR:
-        if (data->currentToken == nullptr) {
+        if (data->currentQuery->exprs.openNodes() == 0) {
             data->state = MWSQUERYSTATE_IN_MWS_QUERY;
-        } else if (data->currentToken->isRoot()) {
-            data->result->tokens.push_back(data->currentToken);
-            data->currentToken = nullptr;
-            data->currentTokenRoot = nullptr;
         } else {
-            data->currentToken = data->currentToken->getParentNode();
+            data->currentQuery->exprs.endNode();
+            if (data->currentQuery->exprs.openNodes() == 0) {
+                data->currentQuery->tokens.push_back(
+                    data->currentQuery->exprs.node(data->currentRoot));
+                data->currentRoot = FlatCmml::NO_NODE;
+            }
         }
         break;
 
@@ -309,8 +435,8 @@ static void my_characters(void* user_data, const xmlChar* ch, int len) {
     MwsQuery_SaxUserData* data = (MwsQuery_SaxUserData*)user_data;
 
     if (data->state == MWSQUERYSTATE_IN_MWS_EXPR &&
-        data->currentToken != nullptr) {
-        data->currentToken->appendTextContent((char*)ch, len);
+        data->currentQuery->exprs.openNodes() > 0) {
+        data->currentQuery->exprs.appendTextContent((char*)ch, len);
     }
 }
 
@@ -334,12 +460,8 @@ static void my_error(void* user_data, const char* msg, ...) {
     va_list args;
     MwsQuery_SaxUserData* data = (MwsQuery_SaxUserData*)user_data;
 
+    // the partial expression is dropped with the result in my_endDocument
     data->errorDetected = true;
-    if (data->currentTokenRoot != nullptr) {
-        delete data->currentTokenRoot;
-        data->currentTokenRoot = nullptr;
-        data->currentToken = nullptr;
-    }
     va_start(args, msg);
     vfprintf(stderr, msg, args);
     va_end(args);
@@ -0,0 +1,143 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of ids-only queries on an index with a formula store
+ * @file formula_store_queries.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/memstream.h"
+#include "mws/daemon/IndexQueryHandler.hpp"
+#include "mws/index/IndexLoader.hpp"
+#include "mws/index/IndexWriter.hpp"
+#include "mws/query/SchemaEngine.hpp"
+#include "mws/types/MwsAnswset.hpp"
+#include "mws/types/Query.hpp"
+#include "mws/types/SchemaAnswset.hpp"
+#include "mws/xmlparser/readMwsQuery.hpp"
+#include "mws/xmlparser/xmlparser.hpp"
+
+#include "build-gen/config.h"
+
+using namespace mws;
+using namespace std;
+using mws::daemon::IndexQueryHandler;
+using mws::index::IndexLoader;
+using mws::parser::initxmlparser;
+using mws::query::RETRIEVE_ALL;
+using mws::query::SchemaEngine;
+using mws::types::FormulaId;
+using mws::types::Query;
+
+/*
+
+index: test harvests, with a formula store
+query: ?x with formulae -> every formula, each decodable from its id
+query: decoded formula  -> its own id
+query: ?x               -> no formulae
+schemata of the ids     -> one per formula at full depth
+
+*/
+
+static const char INDEX_PATH[] = "/tmp/test_formula_store_queries";
+static const size_t MAX_CHECKED_IDS = 20;
+
+static MwsAnswset* answer(IndexQueryHandler* handler, const string& attributes,
+                          const string& math) {
+    string xml = "<mws:query xmlns:mws=\"http://search.mathweb.org/ns\" "
+                 "xmlns:m=\"http://www.w3.org/1998/Math/MathML\" "
+                 "output=\"mws-ids\" answsize=\"1000\" " +
+                 attributes + "><mws:expr>" + math +
+                 "</mws:expr></mws:query>";
+    FILE* file = fmemopen((void*)xml.data(), xml.size(), "r");
+    if (file == nullptr) return nullptr;
+    unique_ptr<Query> query(xmlparser::readMwsQuery(file));
+    fclose(file);
+    if (query == nullptr) return nullptr;
+    return dynamic_cast<MwsAnswset*>(handler->handleQuery(query.get()));
+}
+
+int main() {
+    index::IndexConfiguration config;
+    vector<FormulaId> ids;
+
+    config.harvester.paths.push_back(MWS_TESTDATA_PATH);
+    config.harvester.fileExtension = "harvest";
+    config.harvester.recursive = false;
+    config.dataPath = INDEX_PATH;
+    config.deleteOldData = true;
+    config.writeFormulaStore = true;
+
+    FAIL_ON(initxmlparser() != 0);
+    FAIL_ON(index::createCompressedIndex(config) != 0);
+
+    {
+        IndexQueryHandler handler(INDEX_PATH);
+        const string anything = "<mws:qvar name=\"x\"/>";
+
+        unique_ptr<MwsAnswset> result(
+            answer(&handler, "formulae=\"yes\"", anything));
+        FAIL_ON(result == nullptr || result->ids.size() < 2);
+        FAIL_ON(!result->formulaDecoder);
+        ids.assign(result->ids.begin(), result->ids.end());
+
+        // the formula of an id is the one indexed under it
+        for (size_t i = 0; i < ids.size() && i < MAX_CHECKED_IDS; i++) {
+            string formula = result->formulaDecoder(ids[i]);
+            FAIL_ON(formula.empty());
+            unique_ptr<MwsAnswset> exact(answer(&handler, "", formula));
+            FAIL_ON(exact == nullptr || exact->ids.count(ids[i]) != 1);
+        }
+
+        result.reset(answer(&handler, "", anything));
+        FAIL_ON(result == nullptr || result->formulaDecoder);
+    }
+
+    {
+        IndexLoader loader(INDEX_PATH);
+        FAIL_ON(loader.getFormulaStore() == nullptr);
+        SchemaEngine schemaEngine(*loader.getMeaningDictionary());
+
+        unique_ptr<SchemaAnswset> schemata(schemaEngine.getSchemataOfIds(
+            loader.getFormulaStore(), ids, RETRIEVE_ALL, UINT8_MAX));
+        FAIL_ON(schemata->total != (int)ids.size());
+        schemata.reset(schemaEngine.getSchemataOfIds(
+            loader.getFormulaStore(), ids, RETRIEVE_ALL, 1));
+        FAIL_ON(schemata->total >= (int)ids.size());
+        size_t coverage = 0;
+        for (const types::ExprSchema& schema : schemata->schemata) {
+            coverage += schema.coverage;
+        }
+        FAIL_ON(coverage != ids.size());
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
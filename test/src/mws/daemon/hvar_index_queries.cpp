@@ -0,0 +1,125 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of IndexQueryHandler on an index with hvars
+ * @file hvar_index_queries.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "common/utils/compiler_defs.h"
+#include "common/utils/memstream.h"
+#include "mws/daemon/IndexQueryHandler.hpp"
+#include "mws/index/IndexWriter.hpp"
+#include "mws/types/MwsAnswset.hpp"
+#include "mws/types/Query.hpp"
+#include "mws/xmlparser/readMwsQuery.hpp"
+#include "mws/xmlparser/xmlparser.hpp"
+
+#include "build-gen/config.h"
+
+using namespace mws;
+using namespace std;
+using mws::daemon::IndexQueryHandler;
+using mws::parser::initxmlparser;
+using mws::types::Query;
+
+/*
+
+index: f(?x) in document 1, g(a) in document 2, and their subterms
+query: f(a)             -> f(?x), ?x
+query: f(?y)            -> f(?x), ?x
+query: g(a)             -> g(a), ?x
+query: f(a) by document -> document 1
+query: f(a) and g(a)    -> document 1
+
+Queries without qvars are not answered from the exact match table, which
+does not unify the query with the hvars of the index.
+
+*/
+
+static const char INDEX_PATH[] = "/tmp/test_hvar_index_queries";
+
+static const char F_A[] =
+    "<m:apply><m:ci>f</m:ci><m:ci>a</m:ci></m:apply>";
+static const char F_Y[] =
+    "<m:apply><m:ci>f</m:ci><mws:qvar name=\"y\"/></m:apply>";
+static const char G_A[] =
+    "<m:apply><m:ci>g</m:ci><m:ci>a</m:ci></m:apply>";
+
+static Query* readQuery(const string& attributes, const string& exprs) {
+    string xml = "<mws:query xmlns:mws=\"http://search.mathweb.org/ns\" "
+                 "xmlns:m=\"http://www.w3.org/1998/Math/MathML\" " +
+                 attributes + ">" + exprs + "</mws:query>";
+    FILE* file = fmemopen((void*)xml.data(), xml.size(), "r");
+    if (file == nullptr) return nullptr;
+    Query* query = xmlparser::readMwsQuery(file);
+    fclose(file);
+    return query;
+}
+
+/// @return the total of the answer of the query, -1 on failure
+static int queryTotal(IndexQueryHandler* handler, const string& attributes,
+                      const string& exprs) {
+    unique_ptr<Query> query(readQuery(attributes, exprs));
+    if (query == nullptr) return -1;
+    unique_ptr<MwsAnswset> result(
+        dynamic_cast<MwsAnswset*>(handler->handleQuery(query.get())));
+    if (result == nullptr) return -1;
+    return result->total;
+}
+
+static string expr(const char* math) {
+    return string("<mws:expr>") + math + "</mws:expr>";
+}
+
+int main() {
+    index::IndexConfiguration config;
+
+    config.harvester.paths.push_back((string)MWS_TESTDATA_PATH + "/hvars");
+    config.harvester.fileExtension = "harvest";
+    config.harvester.recursive = false;
+    config.dataPath = INDEX_PATH;
+    config.deleteOldData = true;
+
+    FAIL_ON(initxmlparser() != 0);
+    FAIL_ON(index::createCompressedIndex(config) != 0);
+
+    {
+        IndexQueryHandler handler(INDEX_PATH);
+
+        FAIL_ON(queryTotal(&handler, "", expr(F_A)) != 2);
+        FAIL_ON(queryTotal(&handler, "", expr(F_Y)) != 2);
+        FAIL_ON(queryTotal(&handler, "", expr(G_A)) != 2);
+        FAIL_ON(queryTotal(&handler, "groupby=\"document\"",
+                           expr(F_A)) != 1);
+        FAIL_ON(queryTotal(&handler, "", expr(F_A) + expr(G_A)) != 1);
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -60,6 +60,49 @@ using namespace mws;
 struct Tester {
     static const memsector_header_t* ms;
 
+    /// hvars after and between constants of arity 0 in token order
+    static void insertHvarFormulae(TmpIndex* data) {
+        const encoded_token_t f = encoded_token(CONSTANT_ID_MIN + 1, 2);
+        const encoded_token_t c = encoded_token(3 * 256, 0);
+        const encoded_token_t d = encoded_token(3 * 256 + HVAR_ID_MIN + 4, 0);
+        const encoded_token_t x = encoded_token(HVAR_ID_MIN + 4, 0);
+        const encoded_token_t y = encoded_token(HVAR_ID_MIN + 5, 0);
+
+        data->insertData({f, c, x})->solutions++;
+        data->insertData({f, x, x})->solutions++;
+        data->insertData({f, d, y})->solutions++;
+        data->insertData({f, y, c})->solutions++;
+    }
+
+    static bool hasHvars(const TmpIndexNode* tmp_node) {
+        for (auto& kv : tmp_node->children) {
+            if (encoded_token_is_var(kv.first) || hasHvars(kv.second)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// check the var directory of inode against the var children
+    static bool varsConsistent(const TmpIndexNode* tmp_node,
+                               const inode_t* inode) {
+        uint32_t num_vars = 0, begin = 0, end = 0, i = 0;
+        for (auto& kv : tmp_node->children) {
+            if (encoded_token_is_var(kv.first)) {
+                if (num_vars++ == 0) begin = i;
+                end = i + 1;
+            }
+            i++;
+        }
+        if (inode_get_num_vars(inode) != num_vars) return false;
+        if (inode_has_hvars(inode) != hasHvars(tmp_node)) return false;
+        if (num_vars > 0) {
+            inode_vars_t vars = inode_get_vars(inode);
+            if (vars.begin != begin || vars.end != end) return false;
+        }
+        return true;
+    }
+
     static inline bool memsector_inode_consistent(
         const TmpIndexNode* tmp_node, memsector_long_off_t baseOff) {
         if (tmp_node->children.size() > 0) {  // child
@@ -71,6 +114,7 @@ struct Tester {
                 return false;
             }
             if (tmp_node->children.size() != inode->size) return false;
+            if (!varsConsistent(tmp_node, inode)) return false;
 
             int i = 0;
             for (auto& kv : tmp_node->children) {
@@ -185,6 +229,7 @@ int main(int argc, char* argv[]) {
     FAIL_ON(unlink(tmp_memsector_path.c_str()) != 0 && errno != ENOENT);
 
     FAIL_ON(loadHarvests(indexBuilder, config) <= 0);
+    Tester::insertHvarFormulae(&data);
     FAIL_ON(memsector_create(&mswr, tmp_memsector_path.c_str()) != 0);
     data.exportToMemsector(&mswr);
     printf("Index exported to memsector %s (%" PRIu64 "b)\n",
@@ -0,0 +1,247 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test the exact match table against the memsector it indexes
+ * @file exact_index.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/exact_index.h"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexLoader.hpp"
+using mws::index::IndexLoader;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+using mws::index::IndexConfiguration;
+using mws::index::createCompressedIndex;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+
+#include "build-gen/config.h"
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_exact.memsector";
+static const char EXACT_INDEX_PATH[] = "/tmp/test_exact.dat";
+static const char INDEX_PATH[] = "/tmp/test_exact_index";
+
+using namespace mws;
+
+/// Every leaf of the memsector must be found at its own offset
+static bool allLeavesFound(const index_handle_t* index,
+                           const exact_index_handle_t* exactIndex) {
+    IndexIterator<IndexAccessor> it(index);
+    const inode_t* node;
+    uint64_t numLeaves = 0;
+
+    while ((node = it.next()) != nullptr) {
+        const leaf_t* leaf = (const leaf_t*)node;
+        vector<encoded_token_t> formula;
+        for (const auto& elem : it.getPath()) {
+            formula.push_back(IndexAccessor::getToken(elem));
+        }
+
+        const exact_index_entry_t* entry =
+            exact_index_lookup(exactIndex, formula.data(), formula.size());
+        if (entry == nullptr || entry->formula_id != leaf->formula_id ||
+            memsector_off2addr(index->ms, entry->leaf_off) != (char*)leaf) {
+            return false;
+        }
+
+        // a formula which is not indexed
+        formula[0].id = (1 << 24) - 1;
+        if (exact_index_lookup(exactIndex, formula.data(), formula.size()) !=
+            nullptr) {
+            return false;
+        }
+        numLeaves++;
+    }
+
+    return numLeaves == exactIndex->header->num_entries;
+}
+
+/// Formulae sharing a key must not be confused
+static int testAmbiguousKeys() {
+    encoded_token_t formula[2] = {encoded_token(CONSTANT_ID_MIN, 1),
+                                  encoded_token(CONSTANT_ID_MIN + 1, 0)};
+    exact_index_entry_t entries[2];
+    exact_index_handle_t exactIndex;
+    const exact_index_entry_t* entry;
+
+    entries[0] = entries[1] = exact_index_key(formula, 2);
+    entries[0].formula_id = 1;
+    entries[0].leaf_off = 42;
+    entries[1].formula_id = 2;
+    entries[1].leaf_off = 84;
+
+    FAIL_ON(exact_index_write(EXACT_INDEX_PATH, entries, 2) != 0);
+    FAIL_ON(exact_index_load(&exactIndex, EXACT_INDEX_PATH) != 0);
+    entry = exact_index_lookup(&exactIndex, formula, 2);
+    FAIL_ON(entry == nullptr);
+    FAIL_ON(entry->leaf_off != MEMSECTOR_OFF_NULL);
+    FAIL_ON(exact_index_lookup(&exactIndex, formula, 1) != nullptr);
+    FAIL_ON(exact_index_unload(&exactIndex) != 0);
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+/// A formula colliding with the key of an indexed one must not be found
+static int testCollidingKey() {
+    IndexConfiguration config;
+    const string exactPath = (string)INDEX_PATH + "/" + EXACT_INDEX_FILE;
+    const string storePath = (string)INDEX_PATH + "/" + FORMULA_STORE_FILE;
+    exact_index_handle_t exactIndex;
+    formula_store_handle_t formulaStore;
+    exact_index_entry_t entries[2];
+    vector<encoded_token_t> indexed, colliding;
+    uint64_t pos = 0;
+
+    config.harvester.paths.push_back(MWS_TESTDATA_PATH);
+    config.harvester.fileExtension = "harvest";
+    config.harvester.recursive = false;
+    config.dataPath = INDEX_PATH;
+    config.deleteOldData = true;
+    config.writeFormulaStore = true;
+    FAIL_ON(createCompressedIndex(config) != 0);
+
+    // keep an indexed formula, and map a formula which is not indexed to
+    // its leaf as if their keys collided
+    FAIL_ON(exact_index_load(&exactIndex, exactPath.c_str()) != 0);
+    while (exactIndex.slots[pos].size == 0 ||
+           exactIndex.slots[pos].leaf_off == MEMSECTOR_OFF_NULL) {
+        pos++;
+    }
+    entries[0] = exactIndex.slots[pos];
+    FAIL_ON(exact_index_unload(&exactIndex) != 0);
+    FAIL_ON(formula_store_load(&formulaStore, storePath.c_str()) != 0);
+    {
+        encoded_formula_t formula =
+            formula_store_get(&formulaStore, entries[0].formula_id);
+        indexed.assign(formula.data, formula.data + formula.size);
+    }
+    FAIL_ON(formula_store_unload(&formulaStore) != 0);
+    colliding = indexed;
+    colliding[0].id = (1 << 24) - 1;
+    entries[1] = exact_index_key(colliding.data(), colliding.size());
+    entries[1].formula_id = entries[0].formula_id;
+    entries[1].leaf_off = entries[0].leaf_off;
+    FAIL_ON(exact_index_write(exactPath.c_str(), entries, 2) != 0);
+
+    {
+        IndexLoader loader(INDEX_PATH);
+        const leaf_t* leaf = loader.lookupFormula(indexed);
+        FAIL_ON(leaf == nullptr);
+        FAIL_ON(leaf->formula_id != entries[0].formula_id);
+        FAIL_ON(loader.lookupFormula(colliding) != nullptr);
+    }
+
+    // without a formula store the index settles the match
+    FAIL_ON(unlink(storePath.c_str()) != 0);
+    {
+        IndexLoader loader(INDEX_PATH);
+        FAIL_ON(loader.hasFormulaStore());
+        const leaf_t* leaf = loader.lookupFormula(indexed);
+        FAIL_ON(leaf == nullptr);
+        FAIL_ON(leaf->formula_id != entries[0].formula_id);
+        FAIL_ON(loader.lookupFormula(colliding) != nullptr);
+    }
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    exact_index_handle_t exactIndex;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    MeaningDictionary meaningDictionary;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<exact_index_entry_t> exactEntries;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr, [&](const vector<encoded_token_t>& formula,
+                                      types::FormulaId formulaId,
+                                      memsector_long_off_t leafOff) {
+        exact_index_entry_t entry =
+            exact_index_key(formula.data(), formula.size());
+        entry.formula_id = formulaId;
+        entry.leaf_off = leafOff;
+        exactEntries.push_back(entry);
+    });
+    FAIL_ON(exact_index_write(EXACT_INDEX_PATH, exactEntries.data(),
+                              exactEntries.size()) != 0);
+
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    FAIL_ON(exact_index_load(&exactIndex, EXACT_INDEX_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    FAIL_ON(exactIndex.header->num_entries != exactEntries.size());
+    FAIL_ON(!allLeavesFound(&index, &exactIndex));
+
+    FAIL_ON(exact_index_unload(&exactIndex) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    FAIL_ON(testAmbiguousKeys() != 0);
+    FAIL_ON(unlink(EXACT_INDEX_PATH) != 0);
+    FAIL_ON(testCollidingKey() != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief Test that FlatCmml expressions encode like their CmmlToken
+  * counterparts
+  *
+  * @file flat_cmml_encoding.cpp
+  * @date 19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/ExpressionEncoder.hpp"
+using mws::index::ExpressionEncoder;
+using mws::index::ExpressionInfo;
+using mws::index::HarvestEncoder;
+using mws::index::QueryEncoder;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/types/CmmlToken.hpp"
+using mws::types::CmmlToken;
+#include "mws/types/FlatCmml.hpp"
+using mws::types::FlatCmml;
+
+static CmmlToken* addChild(CmmlToken* parent, const string& tag,
+                           const string& text = "") {
+    CmmlToken* child = parent->newChildNode();
+    child->setTag(tag);
+    child->appendTextContent(text);
+    return child;
+}
+
+/* <apply><plus/><ci>x</ci><apply><times/><mws:qvar name="y"/><cn>2</cn>
+ * </apply><mws:qvar name="y"/><mws:range low="1" high="3"/></apply> */
+static CmmlToken* buildExpression() {
+    CmmlToken* root = CmmlToken::newRoot();
+    root->setTag("m:apply");
+    addChild(root, "plus");
+    addChild(root, "ci", " x ");
+    CmmlToken* times = addChild(root, "apply");
+    addChild(times, "times");
+    addChild(times, "mws:qvar")->addAttribute("name", "y");
+    addChild(times, "cn", "2");
+    addChild(root, "mws:qvar")->addAttribute("name", "y");
+    CmmlToken* range = addChild(root, "mws:range");
+    range->addAttribute("low", "1");
+    range->addAttribute("high", "3");
+    range->addAttribute("extra", "attribute");
+
+    return root;
+}
+
+int main() {
+    CmmlToken* token = buildExpression();
+    FlatCmml flat;
+    MeaningDictionary dictionary;
+    HarvestEncoder encoder(&dictionary);
+    ExpressionEncoder::Config config;
+    vector<CmmlToken*> subexpressions;
+    uint32_t i = 0;
+
+    flat.assign(token);
+    FAIL_ON(flat.size() != token->getExprSize());
+    FAIL_ON(flat.root().getExprDepth() != token->getExprDepth());
+    FAIL_ON(flat.node(8).getRangeBounds() != std::make_pair(1.0, 3.0));
+    FAIL_ON(flat.node(8).getAttribute("extra").str() != "attribute");
+    FAIL_ON(flat.node(2).getTextContent().str() != "x");
+
+    // subexpressions are visited in preorder by both representations
+    token->foreachSubexpression([&](const CmmlToken* sub) {
+        subexpressions.push_back(const_cast<CmmlToken*>(sub));
+    });
+    for (i = 0; i < subexpressions.size(); i++) {
+        const CmmlToken* sub = subexpressions[i];
+        FlatCmml::Ref ref = flat.node(i);
+        vector<encoded_token_t> tokenEncoding, flatEncoding;
+        ExpressionInfo tokenInfo, flatInfo;
+
+        FAIL_ON(ref.getTag() != sub->getTag());
+        FAIL_ON(ref.getArity() != sub->getArity());
+        FAIL_ON(ref.getXpath() != sub->getXpath());
+        FAIL_ON(encoder.encode(config, sub, &tokenEncoding, &tokenInfo) != 0);
+        FAIL_ON(encoder.encode(config, ref, &flatEncoding, &flatInfo) != 0);
+        FAIL_ON(tokenEncoding.size() != flatEncoding.size());
+        FAIL_ON(memcmp(tokenEncoding.data(), flatEncoding.data(),
+                       tokenEncoding.size() * sizeof(encoded_token_t)) != 0);
+        FAIL_ON(tokenInfo.qvarNames != flatInfo.qvarNames);
+        FAIL_ON(tokenInfo.qvarXpaths != flatInfo.qvarXpaths);
+        FAIL_ON(tokenInfo.rangeBounds != flatInfo.rangeBounds);
+    }
+
+    // vars and ranges are leaves, named vars are hvars in harvests and
+    // qvars in queries
+    {
+        QueryEncoder queryEncoder(&dictionary);
+        vector<encoded_token_t> harvestEncoding, queryEncoding;
+        FAIL_ON(encoder.encode(config, flat.root(), &harvestEncoding,
+                               nullptr) != 0);
+        FAIL_ON(queryEncoder.encode(config, flat.root(), &queryEncoding,
+                                    nullptr) != 0);
+        FAIL_ON(harvestEncoding.size() != 9 || queryEncoding.size() != 9);
+        for (uint32_t var : {5, 7}) {
+            FAIL_ON(harvestEncoding[var].arity != 0);
+            FAIL_ON(harvestEncoding[var].id != HVAR_ID_MIN + 1);
+            FAIL_ON(queryEncoding[var].arity != 0);
+            FAIL_ON(queryEncoding[var].id != QVAR_ID_MIN + 1);
+        }
+        FAIL_ON(queryEncoding[8].arity != 0);
+        FAIL_ON(!encoded_token_is_range(queryEncoding[8]));
+    }
+
+    // text interleaved with children is concatenated as in CmmlToken
+    flat.clear();
+    flat.beginNode("apply", 5);
+    flat.appendTextContent(" a", 2);
+    flat.beginNode("ci", 2);
+    flat.appendTextContent("z", 1);
+    flat.endNode();
+    flat.appendTextContent("b ", 2);
+    flat.endNode();
+    FAIL_ON(flat.openNodes() != 0);
+    FAIL_ON(flat.root().getTextContent().str() != "ab");
+    FAIL_ON(flat.node(1).getTextContent().str() != "z");
+    FAIL_ON(flat.node(1).getXpathRelative() != "/*[1]");
+    FAIL_ON(flat.node(1).getNextSibling().isValid());
+
+    delete token;
+    return EXIT_SUCCESS;
+
+fail:
+    delete token;
+    return EXIT_FAILURE;
+}
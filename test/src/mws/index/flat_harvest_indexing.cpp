@@ -0,0 +1,210 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief Test that indexing through flat expressions builds the same index
+  * as indexing CmmlToken trees
+  *
+  * @file flat_harvest_indexing.cpp
+  * @date 19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  */
+
+#include <sys/types.h>      // Primitive System datatypes
+#include <sys/stat.h>       // POSIX File characteristics
+#include <fcntl.h>          // File control operations
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/MemCrawlDb.hpp"
+using mws::dbc::MemCrawlDb;
+using mws::dbc::CrawlId;
+#include "mws/dbc/MemFormulaDb.hpp"
+using mws::dbc::MemFormulaDb;
+#include "mws/index/ExpressionEncoder.hpp"
+using mws::index::ExpressionEncoder;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+using mws::index::TmpIndexNode;
+using mws::index::TmpLeafNode;
+#include "mws/types/CmmlToken.hpp"
+using mws::types::CmmlToken;
+#include "mws/xmlparser/processMwsHarvest.hpp"
+using mws::parser::HarvestProcessor;
+using mws::parser::HarvestResult;
+using mws::parser::processHarvestFromFd;
+#include "mws/xmlparser/xmlparser.hpp"
+using mws::parser::initxmlparser;
+
+#include "build-gen/config.h"
+
+/// Indexes CmmlToken trees, as loadHarvestFromFd used to
+class TreeIndexer : public HarvestProcessor {
+ public:
+    explicit TreeIndexer(IndexBuilder* indexBuilder)
+        : _indexBuilder(indexBuilder) {}
+    int processExpression(const CmmlToken* token, const string& exprUri,
+                          const uint32_t& crawlId) {
+        return _indexBuilder->indexContentMath(token, exprUri, crawlId);
+    }
+    CrawlId processData(const string& data) {
+        return _indexBuilder->indexCrawlData(data);
+    }
+
+ private:
+    IndexBuilder* _indexBuilder;
+};
+
+struct Tester {
+    static bool sameIndex(const TmpIndexNode* node1,
+                          const TmpIndexNode* node2) {
+        if (node1->children.size() != node2->children.size()) return false;
+        if (node1->children.size() == 0) {
+            return static_cast<const TmpLeafNode*>(node1)->solutions ==
+                   static_cast<const TmpLeafNode*>(node2)->solutions;
+        }
+
+        auto it1 = node1->children.begin();
+        auto it2 = node2->children.begin();
+        for (; it1 != node1->children.end(); ++it1, ++it2) {
+            if (memcmp(&it1->first, &it2->first, sizeof(encoded_token_t))) {
+                return false;
+            }
+            if (!sameIndex(it1->second, it2->second)) return false;
+        }
+
+        return true;
+    }
+
+    static bool sameIndex(const TmpIndex& index1, const TmpIndex& index2) {
+        return sameIndex(index1.mRoot, index2.mRoot);
+    }
+};
+
+/// Harvest with named and anonymous hvars, which the test data lacks
+static const char HVARS_HARVEST[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<mws:harvest xmlns:mws=\"http://search.mathweb.org/ns\" xmlns:m=\"http://www.w3.org/1998/Math/MathML\">\n"
+    "  <mws:expr url=\"named\">\n"
+    "      <m:apply>\n"
+    "          <m:plus/>\n"
+    "          <m:apply>\n"
+    "              <m:times/>\n"
+    "              <mws:qvar name=\"x\"/>\n"
+    "              <mws:qvar name=\"y\"/>\n"
+    "          </m:apply>\n"
+    "          <m:apply>\n"
+    "              <m:times/>\n"
+    "              <mws:qvar name=\"y\"/>\n"
+    "              <mws:qvar name=\"x\"/>\n"
+    "          </m:apply>\n"
+    "      </m:apply>\n"
+    "  </mws:expr>\n"
+    "\n"
+    "  <mws:expr url=\"anonymous\">\n"
+    "      <m:apply>\n"
+    "          <m:eq/>\n"
+    "          <m:apply>\n"
+    "              <m:sin/>\n"
+    "              <mws:qvar/>\n"
+    "          </m:apply>\n"
+    "          <m:apply>\n"
+    "              <m:cos/>\n"
+    "              <mws:qvar/>\n"
+    "              <mws:qvar name=\"z\"/>\n"
+    "          </m:apply>\n"
+    "      </m:apply>\n"
+    "  </mws:expr>\n"
+    "</mws:harvest>\n";
+static const char HVARS_HARVEST_PATH[] = "/tmp/flat_harvest_indexing.harvest";
+
+static bool indexHarvest(const string& path, bool renameCi) {
+    ExpressionEncoder::Config config;
+    config.renameCi = renameCi;
+
+    MemCrawlDb flatCrawlDb, treeCrawlDb;
+    MemFormulaDb flatFormulaDb, treeFormulaDb;
+    TmpIndex flatIndex, treeIndex;
+    MeaningDictionary flatDictionary, treeDictionary;
+    IndexBuilder flatBuilder(&flatFormulaDb, &flatCrawlDb, &flatIndex,
+                             &flatDictionary, config);
+    IndexBuilder treeBuilder(&treeFormulaDb, &treeCrawlDb, &treeIndex,
+                             &treeDictionary, config);
+    TreeIndexer treeIndexer(&treeBuilder);
+    HarvestResult flatResult, treeResult;
+    int fd;
+
+    FAIL_ON((fd = open(path.c_str(), O_RDONLY)) < 0);
+    flatResult = loadHarvestFromFd(&flatBuilder, fd);
+    close(fd);
+
+    FAIL_ON((fd = open(path.c_str(), O_RDONLY)) < 0);
+    treeResult = processHarvestFromFd(fd, &treeIndexer);
+    close(fd);
+
+    FAIL_ON(flatResult.status != treeResult.status);
+    FAIL_ON(flatResult.numExpressions != treeResult.numExpressions);
+    FAIL_ON(!Tester::sameIndex(flatIndex, treeIndex));
+
+    return true;
+
+fail:
+    return false;
+}
+
+int main() {
+    const string dataPath = (string)MWS_TESTDATA_PATH + "/";
+    const vector<string> harvests = {
+        dataPath + "eq_ambiguity.harvest", dataPath + "data1.harvest",
+        dataPath + "data2.harvest",        dataPath + "data3.harvest",
+        dataPath + "data4.harvest",        dataPath + "ci_renaming.harvest",
+        HVARS_HARVEST_PATH};
+    FILE* file;
+
+    FAIL_ON((file = fopen(HVARS_HARVEST_PATH, "w")) == nullptr);
+    fputs(HVARS_HARVEST, file);
+    fclose(file);
+
+    FAIL_ON(initxmlparser() != 0);
+    for (const string& harvest : harvests) {
+        FAIL_ON(!indexHarvest(harvest, /* renameCi = */ false));
+        FAIL_ON(!indexHarvest(harvest, /* renameCi = */ true));
+    }
+    unlink(HVARS_HARVEST_PATH);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,164 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test the formula store against the memsector of the same index
+ * @file formula_store.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <memory>
+using std::unique_ptr;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/formula_store.h"
+#include "mws/index/index.h"
+#include "mws/index/ExpressionEncoder.hpp"
+using mws::index::ExpressionDecoder;
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/types/CmmlToken.hpp"
+using mws::types::CmmlToken;
+
+#include "build-gen/config.h"
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_formula_store.memsector";
+static const char FORMULA_STORE_PATH[] = "/tmp/test_formula_store.dat";
+
+using namespace mws;
+
+/// Every leaf of the memsector must decode to the path leading to it
+static bool allFormulaeStored(const index_handle_t* index,
+                              const formula_store_handle_t* store,
+                              const ExpressionDecoder& decoder) {
+    IndexIterator<IndexAccessor> it(index);
+    const inode_t* node;
+
+    while ((node = it.next()) != nullptr) {
+        const leaf_t* leaf = (const leaf_t*)node;
+        vector<encoded_token_t> path;
+        for (const auto& elem : it.getPath()) {
+            path.push_back(IndexAccessor::getToken(elem));
+        }
+
+        encoded_formula_t formula = formula_store_get(store, leaf->formula_id);
+        if (formula.size != path.size()) return false;
+        for (uint32_t i = 0; i < formula.size; i++) {
+            if (formula.data[i].id != path[i].id ||
+                formula.data[i].arity != path[i].arity) {
+                return false;
+            }
+        }
+
+        unique_ptr<CmmlToken> expr(decoder.decode(formula.data, formula.size));
+        if (expr == nullptr || expr->getExprSize() != formula.size) {
+            return false;
+        }
+        if (formula.size > 1 &&
+            decoder.decode(formula.data, formula.size - 1) != nullptr) {
+            return false;
+        }
+        if (decoder.toCmml(formula.data, formula.size).empty()) return false;
+        if (formula.size > 1 &&
+            !decoder.toCmml(formula.data, formula.size - 1).empty()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    formula_store_handle_t store;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    MeaningDictionary meaningDictionary;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<formula_store_record_t> records;
+    vector<encoded_token_t> tokens;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr, [&](const vector<encoded_token_t>& formula,
+                                      types::FormulaId formulaId,
+                                      memsector_long_off_t leafOff) {
+        UNUSED(leafOff);
+        formula_store_record_t record;
+        record.formula_id = formulaId;
+        record.size = formula.size();
+        record.begin = tokens.size();
+        records.push_back(record);
+        tokens.insert(tokens.end(), formula.begin(), formula.end());
+    });
+    FAIL_ON(formula_store_write(FORMULA_STORE_PATH, records.data(),
+                                records.size(), tokens.data()) != 0);
+
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    FAIL_ON(formula_store_load(&store, FORMULA_STORE_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    FAIL_ON(store.header->num_tokens != tokens.size());
+    FAIL_ON(formula_store_get(&store, 0).size != 0);
+    FAIL_ON(formula_store_get(&store, store.header->num_ids).size != 0);
+    FAIL_ON(!allFormulaeStored(&index, &store,
+                               ExpressionDecoder(meaningDictionary)));
+
+    FAIL_ON(formula_store_unload(&store) != 0);
+    FAIL_ON(unlink(FORMULA_STORE_PATH) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,80 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+  * @brief Test MeaningIndex lookups against the MeaningDictionary
+  *
+  * @file meaning_index.cpp
+  * @date 19 Oct 2026
+  *
+  * License: GPL v3
+  *
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+using std::string;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/MeaningIndex.hpp"
+using mws::index::MeaningIndex;
+
+int main() {
+    MeaningDictionary dictionary;
+    for (int i = 0; i < 1000; i++) {
+        dictionary.put("ci#x" + std::to_string(i));
+    }
+    dictionary.put("mtext#");
+    dictionary.put("apply#");
+
+    MeaningIndex meaningIndex(dictionary);
+    FAIL_ON(meaningIndex.size() != 1002);
+
+    for (int i = 0; i < 1000; i++) {
+        string meaning = "ci#x" + std::to_string(i);
+        FAIL_ON(meaningIndex.get(meaning) != dictionary.get(meaning));
+    }
+    FAIL_ON(meaningIndex.get("apply#") != dictionary.get("apply#"));
+
+    // lookups with non-terminated keys
+    {
+        const char buffer[] = "mtext#garbage";
+        FAIL_ON(meaningIndex.get(buffer, strlen("mtext#")) !=
+                dictionary.get("mtext#"));
+    }
+
+    FAIL_ON(meaningIndex.get("ci#y") != MeaningDictionary::KEY_NOT_FOUND);
+    FAIL_ON(meaningIndex.get("") != MeaningDictionary::KEY_NOT_FOUND);
+
+    {
+        MeaningDictionary emptyDictionary;
+        MeaningIndex emptyIndex(emptyDictionary);
+        FAIL_ON(emptyIndex.get("apply#") != MeaningDictionary::KEY_NOT_FOUND);
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,144 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test the subtree bounds against the leaves of the same index
+ * @file subtree_bounds.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+using std::map;
+#include <utility>
+using std::pair;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/subtree_bounds.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+
+#include "build-gen/config.h"
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_subtree_bounds.memsector";
+static const char SUBTREE_BOUNDS_PATH[] = "/tmp/test_subtree_bounds.dat";
+
+using namespace mws;
+
+/// max hits and min size of the leaves below every internal node
+typedef map<const inode_t*, pair<uint32_t, uint32_t>> Bounds;
+
+static Bounds computeBounds(const index_handle_t* index) {
+    IndexIterator<IndexAccessor> it(index);
+    const inode_t* node;
+    Bounds bounds;
+
+    while ((node = it.next()) != nullptr) {
+        const leaf_t* leaf = (const leaf_t*)node;
+        vector<encoded_token_t> path;
+        for (const auto& elem : it.getPath()) {
+            path.push_back(IndexAccessor::getToken(elem));
+        }
+
+        // every internal node on the path to the leaf
+        const inode_t* inode = IndexAccessor::getRootNode(index);
+        for (const encoded_token_t& token : path) {
+            auto entry = bounds.insert({inode, {0, UINT32_MAX}}).first;
+            entry->second.first =
+                std::max(entry->second.first, (uint32_t)leaf->num_hits);
+            entry->second.second =
+                std::min(entry->second.second, (uint32_t)path.size());
+            inode = IndexAccessor::getChild(index, inode, token);
+        }
+    }
+
+    return bounds;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    subtree_bounds_handle_t handle;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    MeaningDictionary meaningDictionary;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    FAIL_ON(subtree_bounds_write(SUBTREE_BOUNDS_PATH, &index) != 0);
+    FAIL_ON(subtree_bounds_load(&handle, SUBTREE_BOUNDS_PATH) != 0);
+
+    {
+        Bounds expected = computeBounds(&index);
+        FAIL_ON(expected.size() < 2);
+        FAIL_ON(handle.header->num_entries != expected.size());
+        for (const auto& entry : expected) {
+            const subtree_bounds_entry_t* bounds =
+                subtree_bounds_lookup(&handle, &index, entry.first);
+            FAIL_ON(bounds == nullptr);
+            FAIL_ON(bounds->max_hits != entry.second.first);
+            FAIL_ON(bounds->min_size != entry.second.second);
+        }
+    }
+
+    FAIL_ON(subtree_bounds_unload(&handle) != 0);
+    FAIL_ON(unlink(SUBTREE_BOUNDS_PATH) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
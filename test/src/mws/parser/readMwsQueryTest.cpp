@@ -63,6 +63,41 @@ int main() {
     FAIL_ON(result->attrResultMaxSize != 24);
     FAIL_ON(result->attrResultLimitMin != 1);
     FAIL_ON(result->tokens.size() != (size_t)1);
+    // expressions are read into the flat arena of the query
+    FAIL_ON(!result->tokens[0].isRoot());
+    FAIL_ON(result->tokens[0].getTag() != "apply");
+    FAIL_ON(result->tokens[0].getArity() != 3);
+    FAIL_ON(result->tokens[0].getFirstChild().getTag() != "eq");
+    FAIL_ON(result->tokens[0].getExprSize() != result->exprs.size());
+
+    delete result;
+
+    fclose(file);
+
+    // the attributes of a batch are defaults of its queries
+    xml_path = (string)MWS_TESTDATA_PATH + "/MwsBatchQuery.xml";
+    file = fopen(xml_path.c_str(), "r");
+    FAIL_ON(file == nullptr);
+
+    result = xmlparser::readMwsQuery(file);
+
+    FAIL_ON(result == nullptr);
+    FAIL_ON(result->warnings != 0);
+    FAIL_ON(!result->tokens.empty());
+    FAIL_ON(result->batch.size() != (size_t)2);
+    for (const types::Query* query : result->batch) {
+        FAIL_ON(query->tokens.size() != (size_t)1);
+        FAIL_ON(query->tokens[0].getTree() != &query->exprs);
+        FAIL_ON(query->responseFormatter != result->responseFormatter);
+    }
+    FAIL_ON(result->batch[0]->attrResultMaxSize != 5);
+    FAIL_ON(result->batch[0]->attrResultLimitMin != 0);
+    FAIL_ON(!result->batch[0]->attrResultTotalReq);
+    FAIL_ON(result->batch[1]->attrResultMaxSize != 10);
+    FAIL_ON(result->batch[1]->attrResultLimitMin != 2);
+    FAIL_ON(result->batch[1]->attrResultTotalReq);
+    FAIL_ON(!result->batch[1]->tokens[0].getFirstChild().getNextSibling()
+                 .getNextSibling().isVar());
 
     delete result;
 
@@ -0,0 +1,176 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of batches of queries against EngineContext
+ * @file batch_query.cpp
+ * @date 19 Oct 2026
+ *
+ * Queries are derived from the formulae of the test harvests by replacing
+ * a subterm with a qvar. Each query of a batch must get the answer set it
+ * gets alone, while the batch looks up its shared prefixes once.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <memory>
+using std::unique_ptr;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/BatchContext.hpp"
+using mws::query::BatchContext;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+#include "differential_tester.hpp"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_batch_query.memsector";
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    const encoded_token_t unknown = encoded_token(CONSTANT_ID_MIN + 100000, 1);
+    vector<vector<encoded_token_t>> queries = {{x}, {unknown, x}};
+    unique_ptr<BatchContext> batch;
+    uint64_t separateLookups = 0;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    batch.reset(new BatchContext(numbers.get()));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> formula;
+            for (const auto& elem : it.getPath()) {
+                formula.push_back(IndexAccessor::getToken(elem));
+            }
+            for (size_t i = 0; i < formula.size(); i++) {
+                queries.push_back(replace(formula, i, x));
+            }
+        }
+    }
+
+    for (const vector<encoded_token_t>& query : queries) {
+        for (bool includeHits : {true, false}) {
+            Query::Options options;
+            options.includeHits = includeHits;
+            for (const Pagination& p : PAGINATIONS) {
+                BatchContext single(numbers.get());
+                single.addQuery(query, options, EngineContext::RangeBounds(),
+                                p.offset, p.size, p.maxTotal);
+                for (MwsAnswset* result :
+                     single.getResults(&index, &dbQueryManager)) {
+                    delete result;
+                }
+                separateLookups += single.getLookups();
+                batch->addQuery(query, options, EngineContext::RangeBounds(),
+                                p.offset, p.size, p.maxTotal);
+            }
+        }
+    }
+
+    {
+        vector<MwsAnswset*> results =
+            batch->getResults(&index, &dbQueryManager);
+        size_t i = 0;
+        bool same = (results.size() == batch->size());
+        for (const vector<encoded_token_t>& query : queries) {
+            for (bool includeHits : {true, false}) {
+                Query::Options options;
+                options.includeHits = includeHits;
+                for (const Pagination& p : PAGINATIONS) {
+                    EngineContext ctxt(query, options);
+                    unique_ptr<MwsAnswset> expected(ctxt.getResult(
+                        &index, &dbQueryManager, p.offset, p.size,
+                        p.maxTotal));
+                    if (same && !sameAnswers(expected.get(), results[i])) {
+                        fprintf(stderr, "Mismatch of query %zu\n", i);
+                        same = false;
+                    }
+                    i++;
+                }
+            }
+        }
+        for (MwsAnswset* result : results) delete result;
+        FAIL_ON(!same);
+    }
+
+    // the prefixes shared by several queries are looked up once
+    FAIL_ON(batch->getLookups() == 0);
+    FAIL_ON(batch->getLookups() >= separateLookups);
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,197 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of conjunctive queries with ConjunctiveContext
+ * @file conjunctive_query.cpp
+ * @date 19 Oct 2026
+ *
+ * Each expression is given by the formulae matching it. The answer must
+ * contain the documents holding a formula of every expression, in CrawlId
+ * order, each with the first occurrence of the first expression.
+ */
+
+#include <memory>
+using std::unique_ptr;
+#include <set>
+using std::set;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/CrawlDb.hpp"
+using mws::dbc::CrawlId;
+using mws::dbc::CRAWLID_NULL;
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+using mws::dbc::MemCrawlDb;
+#include "mws/dbc/MemFormulaDb.hpp"
+using mws::dbc::MemFormulaDb;
+#include "mws/query/ConjunctiveContext.hpp"
+using mws::query::ConjunctiveContext;
+#include "mws/types/FormulaPath.hpp"
+using mws::types::FormulaId;
+using mws::types::FormulaPath;
+#include "mws/types/MwsAnswset.hpp"
+using mws::MwsAnswset;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+/*
+
+formula 10: doc1 (a1), doc3 (a3), doc5 (a5)
+formula 11: doc3 (a3'), doc4 (a4)
+formula 20: no document, doc5 (b5), doc3 (b3)
+formula 21: doc2 (b2)
+formula 30: doc3, doc5, doc4, doc1
+formula 40: no document
+
+{10, 11} and {20, 21} and {30} -> doc3, doc5
+
+*/
+
+static const int NUM_CRAWLS = 1000;
+
+static int checkAnswer(const MwsAnswset* answset, size_t i, const string& uri,
+                       const string& data) {
+    FAIL_ON(i >= answset->answers.size());
+    FAIL_ON(answset->answers[i]->uri != uri);
+    FAIL_ON(answset->answers[i]->data != data);
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+int main() {
+    MemCrawlDb crawlDb;
+    MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    vector<CrawlId> docs;
+    Query::Options options;
+    Query::Options idsOptions;
+
+    idsOptions.includeHits = false;
+    for (const char* data : {"doc1", "doc2", "doc3", "doc4", "doc5"}) {
+        docs.push_back(crawlDb.putData(data));
+    }
+    formulaDb.insertFormula(10, docs[0], FormulaPath("a1", "0"));
+    formulaDb.insertFormula(10, docs[2], FormulaPath("a3", "0"));
+    formulaDb.insertFormula(10, docs[4], FormulaPath("a5", "0"));
+    formulaDb.insertFormula(11, docs[2], FormulaPath("a3'", "1"));
+    formulaDb.insertFormula(11, docs[3], FormulaPath("a4", "0"));
+    formulaDb.insertFormula(20, CRAWLID_NULL, FormulaPath("b", "0"));
+    formulaDb.insertFormula(20, docs[4], FormulaPath("b5", "0"));
+    formulaDb.insertFormula(20, docs[2], FormulaPath("b3", "0"));
+    formulaDb.insertFormula(21, docs[1], FormulaPath("b2", "0"));
+    for (int doc : {2, 4, 3, 0}) {
+        formulaDb.insertFormula(30, docs[doc], FormulaPath("c", "0"));
+    }
+    formulaDb.insertFormula(40, CRAWLID_NULL, FormulaPath("d", "0"));
+
+    {
+        ConjunctiveContext ctxt(options, &dbQueryManager);
+        ctxt.addExpression({10, 11}, false);
+        ctxt.addExpression({20, 21}, false);
+        ctxt.addExpression({30}, false);
+
+        unique_ptr<MwsAnswset> answset(ctxt.getResult(0, 10, 100));
+        FAIL_ON(answset->total != 2);
+        FAIL_ON(answset->answers.size() != 2);
+        FAIL_ON(checkAnswer(answset.get(), 0, "a3", "doc3") != 0);
+        FAIL_ON(checkAnswer(answset.get(), 1, "a5", "doc5") != 0);
+        FAIL_ON(answset->ids != set<FormulaId>({10, 20, 30}));
+        FAIL_ON(answset->partial);
+
+        // pages of the documents
+        answset.reset(ctxt.getResult(1, 1, 100));
+        FAIL_ON(answset->total != 2);
+        FAIL_ON(answset->answers.size() != 1);
+        FAIL_ON(checkAnswer(answset.get(), 0, "a5", "doc5") != 0);
+        answset.reset(ctxt.getResult(0, 10, 1));
+        FAIL_ON(answset->total != 1);
+        FAIL_ON(answset->answers.size() != 1);
+        FAIL_ON(checkAnswer(answset.get(), 0, "a3", "doc3") != 0);
+        answset.reset(ctxt.getResult(5, 10, 100));
+        FAIL_ON(answset->total != 2);
+        FAIL_ON(!answset->answers.empty() || !answset->ids.empty());
+
+        // a partial expression makes the answer partial
+        ctxt.addExpression({10}, true);
+        answset.reset(ctxt.getResult(0, 10, 100));
+        FAIL_ON(answset->total != 2);
+        FAIL_ON(!answset->partial);
+    }
+
+    // disjoint and empty expressions, formulae without documents
+    {
+        ConjunctiveContext ctxt(options, &dbQueryManager);
+        ctxt.addExpression({10, 11}, false);
+        ctxt.addExpression({21}, false);
+        unique_ptr<MwsAnswset> answset(ctxt.getResult(0, 10, 100));
+        FAIL_ON(answset->total != 0 || !answset->answers.empty());
+    }
+    {
+        ConjunctiveContext ctxt(options, &dbQueryManager);
+        ctxt.addExpression({40}, false);
+        unique_ptr<MwsAnswset> answset(ctxt.getResult(0, 10, 100));
+        FAIL_ON(answset->total != 0 || !answset->answers.empty());
+    }
+    {
+        ConjunctiveContext ctxt(options, &dbQueryManager);
+        ctxt.addExpression({21}, false);
+        ctxt.addExpression({}, false);
+        unique_ptr<MwsAnswset> answset(ctxt.getResult(0, 10, 100));
+        FAIL_ON(answset->total != 0 || !answset->answers.empty());
+    }
+
+    // long lists of documents: formula 1000 + c in crawl c
+    {
+        ConjunctiveContext ctxt(idsOptions, &dbQueryManager);
+        set<FormulaId> all, multiplesOf3, multiplesOf7;
+        set<FormulaId> expected;
+
+        for (int c = 1; c <= NUM_CRAWLS; c++) {
+            formulaDb.insertFormula(1000 + c, c, FormulaPath("f", "0"));
+            all.insert(1000 + c);
+            if (c % 3 == 0) multiplesOf3.insert(1000 + c);
+            if (c % 7 == 0) multiplesOf7.insert(1000 + c);
+            if (c % 21 == 0) expected.insert(1000 + c);
+        }
+        ctxt.addExpression(all, false);
+        ctxt.addExpression(multiplesOf7, false);
+        ctxt.addExpression(multiplesOf3, false);
+
+        unique_ptr<MwsAnswset> answset(
+            ctxt.getResult(0, NUM_CRAWLS, NUM_CRAWLS));
+        FAIL_ON(answset->total != (int)expected.size());
+        FAIL_ON(answset->ids != expected);
+        FAIL_ON(!answset->answers.empty());
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,102 @@
+/*
+
+Copyright (C) 2010-2013 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief   Helpers shared by the differential query tests
+ * @file    differential_tester.hpp
+ * @date    19 Oct 2026
+ *
+ * License: GPLv3
+ */
+
+#ifndef __MWS_QUERY_DIFFERENTIAL_TESTER_H
+#define __MWS_QUERY_DIFFERENTIAL_TESTER_H
+
+/*--------------------------------------------------------------------------*/
+/* Includes                                                                 */
+/*--------------------------------------------------------------------------*/
+
+#include <cstddef>
+#include <vector>
+
+#include "mws/index/encoded_token.h"
+#include "mws/types/Answer.hpp"
+#include "mws/types/MwsAnswset.hpp"
+
+/*--------------------------------------------------------------------------*/
+/* Constants                                                                */
+/*--------------------------------------------------------------------------*/
+
+struct Pagination {
+    unsigned offset;
+    unsigned size;
+    unsigned maxTotal;
+};
+
+static const Pagination PAGINATIONS[] = {
+    {0, 30, 100000}, {0, 1, 1}, {1, 2, 3}, {3, 5, 100}, {2, 0, 5}, {0, 5, 0},
+};
+
+/*--------------------------------------------------------------------------*/
+/* Methods                                                                  */
+/*--------------------------------------------------------------------------*/
+
+/// @return index after the subterm starting at begin
+static inline size_t subtermEnd(const std::vector<encoded_token_t>& formula,
+                                size_t begin) {
+    int arity = 1;
+    size_t end = begin;
+    while (arity > 0) {
+        arity += formula[end].arity - 1;
+        end++;
+    }
+    return end;
+}
+
+/// @return formula with the subterm starting at begin replaced by token
+static inline std::vector<encoded_token_t> replace(
+    const std::vector<encoded_token_t>& formula, size_t begin,
+    encoded_token_t token) {
+    std::vector<encoded_token_t> result(formula.begin(),
+                                        formula.begin() + begin);
+    result.push_back(token);
+    result.insert(result.end(), formula.begin() + subtermEnd(formula, begin),
+                  formula.end());
+    return result;
+}
+
+/// @return true if both answer sets have the same totals, ids and answers
+static inline bool sameAnswers(const mws::MwsAnswset* expected,
+                               const mws::MwsAnswset* actual) {
+    if (expected->total != actual->total) return false;
+    if (expected->partial != actual->partial) return false;
+    if (expected->ids != actual->ids) return false;
+    if (expected->answers.size() != actual->answers.size()) return false;
+    for (size_t i = 0; i < expected->answers.size(); i++) {
+        const mws::types::Answer* e = expected->answers[i];
+        const mws::types::Answer* a = actual->answers[i];
+        if (e->uri != a->uri || e->xpath != a->xpath || e->data != a->data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // __MWS_QUERY_DIFFERENTIAL_TESTER_H
@@ -0,0 +1,428 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of queries filtered by collection and CrawlId range
+ * @file document_filter.cpp
+ * @date 19 Oct 2026
+ *
+ * Each generated harvest is a collection; the second one has no documents.
+ * The results of filtered queries, with and without collection masks, must
+ * match the unfiltered occurrences filtered one by one, for totals, pages,
+ * paused searches and parallel searches.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <set>
+using std::set;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/thread/WorkerPool.hpp"
+using common::thread::WorkerPool;
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/CrawlDb.hpp"
+using mws::dbc::CrawlId;
+using mws::dbc::CRAWLID_NULL;
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/collection_masks.h"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvestFromFd;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/DocumentFilter.hpp"
+using mws::query::DocumentFilter;
+#include "mws/query/engine.h"
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+using mws::query::PagedSearch;
+#include "mws/query/LeafScorer.hpp"
+using mws::query::LeafScorer;
+#include "mws/types/FormulaPath.hpp"
+using mws::types::FormulaPath;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_document_filter.memsector";
+static const char MASKS_PATH[] = "/tmp/test_document_filter.dat";
+static const char HARVEST_PATH[] = "/tmp/test_document_filter.harvest";
+
+static const int NUM_COLLECTIONS = 4;
+static const int NUM_DOCUMENTS = 5;
+static const unsigned MAX_TOTAL = 100000;
+
+struct Pagination {
+    unsigned offset;
+    unsigned size;
+    unsigned maxTotal;
+};
+
+static const Pagination PAGINATIONS[] = {
+    {0, 1000, MAX_TOTAL}, {0, 1, 1}, {1, 2, 3}, {3, 5, 100}, {2, 0, 5},
+};
+
+struct Filter {
+    uint64_t collections;
+    uint32_t minCrawlId;
+    uint32_t maxCrawlId;
+};
+
+static const Filter FILTERS[] = {
+    {1 << 0, 0, UINT32_MAX},
+    {1 << 1, 0, UINT32_MAX},
+    {1 << 2, 0, UINT32_MAX},
+    {(1 << 0) | (1 << 3), 0, UINT32_MAX},
+    {UINT64_MAX, 3, 8},
+    {(1 << 2) | (1 << 3), 9, 13},
+    {UINT64_MAX, 1, UINT32_MAX},
+};
+
+/// Occurrence of a formula
+struct Occurrence {
+    uint32_t formulaId;
+    string uri;
+    string xpath;
+    string data;
+};
+
+static string ci(const string& name) { return "<m:ci>" + name + "</m:ci>"; }
+
+static string apply(const string& head, const string& arg1,
+                    const string& arg2 = "") {
+    return "<m:apply>" + ci(head) + arg1 + arg2 + "</m:apply>";
+}
+
+/**
+ * Documents of collection c hold f(a_d, b_(c+d)%3), g(a_c) and h(h(x)),
+ * collection 1 only holds occurrences without a document.
+ */
+static string harvest(int c) {
+    string xml =
+        "<?xml version=\"1.0\"?>\n<mws:harvest "
+        "xmlns:mws=\"http://search.mathweb.org/ns\" "
+        "xmlns:m=\"http://www.w3.org/1998/Math/MathML\">\n";
+    for (int d = 0; d < NUM_DOCUMENTS; d++) {
+        const string id = std::to_string(c) + "_" + std::to_string(d);
+        const string dataId =
+            (c == 1) ? "" : " mws:data_id=\"" + id + "\"";
+        if (c != 1) {
+            xml += "<mws:data mws:data_id=\"" + id + "\"><doc collection=\"" +
+                   std::to_string(c) + "\"/></mws:data>\n";
+        }
+        const string exprs[] = {
+            apply("f", ci("a" + std::to_string(d)),
+                  ci("b" + std::to_string((c + d) % 3))),
+            apply("g", ci("a" + std::to_string(c))),
+            apply("h", apply("h", ci("x"))),
+        };
+        for (int e = 0; e < 3; e++) {
+            xml += "<mws:expr" + dataId + " url=\"" + id +
+                   "_" + std::to_string(e) + "\">" + exprs[e] +
+                   "</mws:expr>\n";
+        }
+    }
+    xml += "</mws:harvest>\n";
+    return xml;
+}
+
+static int loadCollection(IndexBuilder* indexBuilder, int c) {
+    FILE* file = fopen(HARVEST_PATH, "w");
+    if (file == nullptr) return -1;
+    string xml = harvest(c);
+    fwrite(xml.data(), 1, xml.size(), file);
+    fclose(file);
+
+    int fd = open(HARVEST_PATH, O_RDONLY);
+    if (fd < 0) return -1;
+    indexBuilder->beginCollection();
+    auto ret = loadHarvestFromFd(indexBuilder, fd);
+    close(fd);
+    unlink(HARVEST_PATH);
+
+    return (ret.status == 0 && ret.numExpressions > 0) ? 0 : -1;
+}
+
+/// @return true if the document crawlId passes filter, reading its
+/// collection from its data
+static bool passes(DbQueryManager* dbQueryManager, const Filter& filter,
+                   CrawlId crawlId) {
+    int collection = -1;
+    if (crawlId == CRAWLID_NULL) return false;
+    if (crawlId < filter.minCrawlId || crawlId > filter.maxCrawlId) {
+        return false;
+    }
+    sscanf(dbQueryManager->getCrawlData(crawlId).c_str(),
+           "<doc collection=\"%d\"", &collection);
+    return collection >= 0 && ((filter.collections >> collection) & 1);
+}
+
+/// Occurrences of the solutions of a query passing filter, in index order
+static vector<Occurrence> filteredOccurrences(
+    index_handle_t* index, DbQueryManager* dbQueryManager,
+    const Filter& filter, vector<encoded_token_t> query) {
+    encoded_formula_t formula = {query.data(), (uint32_t)query.size()};
+    query_cursor_t* cursor = query_cursor_create(index, &formula, NULL, NULL);
+    vector<Occurrence> occurrences;
+    const leaf_t* leaf;
+
+    while (query_cursor_next(cursor, &leaf) == QUERY_CONTINUE) {
+        const uint32_t formulaId = leaf->formula_id;
+        dbQueryManager->queryCrawlIds(
+            formulaId, [&](const CrawlId& crawlId, const FormulaPath& path) {
+                if (passes(dbQueryManager, filter, crawlId)) {
+                    occurrences.push_back(
+                        {formulaId, path.xmlId, path.xpath,
+                         dbQueryManager->getCrawlData(crawlId)});
+                }
+                return 0;
+            });
+    }
+    query_cursor_destroy(cursor);
+
+    return occurrences;
+}
+
+/// @return true if answers are the occurrences [begin, end)
+static bool sameOccurrences(const vector<Occurrence>& occurrences,
+                            size_t begin, size_t end,
+                            const vector<types::Answer*>& answers) {
+    if (answers.size() != end - begin) return false;
+    for (size_t i = begin; i < end; i++) {
+        const types::Answer* answer = answers[i - begin];
+        if (answer->uri != occurrences[i].uri ||
+            answer->xpath != occurrences[i].xpath ||
+            answer->data != occurrences[i].data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int checkQuery(index_handle_t* index, DbQueryManager* dbQueryManager,
+                      const collection_masks_handle_t* masks,
+                      WorkerPool* pool, const Filter& filter,
+                      const vector<encoded_token_t>& query) {
+    const vector<Occurrence> occurrences =
+        filteredOccurrences(index, dbQueryManager, filter, query);
+    // formulae with an occurrence passing, in index order
+    vector<uint32_t> formulae;
+    for (const Occurrence& occurrence : occurrences) {
+        if (formulae.empty() || formulae.back() != occurrence.formulaId) {
+            formulae.push_back(occurrence.formulaId);
+        }
+    }
+
+    Query::Options options;
+    options.collections = filter.collections;
+    options.minCrawlId = filter.minCrawlId;
+    options.maxCrawlId = filter.maxCrawlId;
+    options.estimateTotal = true;
+    const DocumentFilter documentFilter(options, masks, index);
+
+    for (bool includeHits : {true, false}) {
+        options.includeHits = includeHits;
+        const size_t numSolutions =
+            includeHits ? occurrences.size() : formulae.size();
+        for (const Pagination& p : PAGINATIONS) {
+            const size_t total = std::min<size_t>(numSolutions, p.maxTotal);
+            const size_t begin = std::min<size_t>(p.offset, total);
+            const size_t end = std::min<size_t>(p.offset + p.size, total);
+            EngineContext ctxt(query, options);
+            ctxt.setFilter(documentFilter);
+
+            unique_ptr<MwsAnswset> result(ctxt.getResult(
+                index, dbQueryManager, p.offset, p.size, p.maxTotal));
+            if (result->total != (int)total || result->estimated) return -1;
+            if (includeHits &&
+                !sameOccurrences(occurrences, begin, end, result->answers)) {
+                return -1;
+            }
+            if (!includeHits) {
+                set<types::FormulaId> ids(formulae.begin() + begin,
+                                          formulae.begin() + end);
+                if (result->ids != ids) return -1;
+            }
+
+            unique_ptr<MwsAnswset> parallel(ctxt.getResult(
+                index, dbQueryManager, p.offset, p.size, p.maxTotal, pool, 3));
+            if (parallel->total != result->total ||
+                parallel->ids != result->ids ||
+                parallel->answers.size() != result->answers.size()) {
+                return -1;
+            }
+        }
+
+        // paused searches resume at the next occurrence passing
+        if (includeHits) {
+            EngineContext ctxt(query, options);
+            ctxt.setFilter(documentFilter);
+            unique_ptr<PagedSearch> search;
+            unique_ptr<MwsAnswset> page(ctxt.getFirstPage(
+                index, dbQueryManager, 1, 2, MAX_TOTAL, true, &search));
+            size_t position = std::min<size_t>(3, occurrences.size());
+            if (page->total != (int)occurrences.size()) return -1;
+            if (!sameOccurrences(occurrences, std::min<size_t>(
+                                                  1, occurrences.size()),
+                                 position, page->answers)) {
+                return -1;
+            }
+            while (search != nullptr) {
+                page.reset(ctxt.getNextPage(&search, dbQueryManager, 2));
+                size_t next = std::min(position + 2, occurrences.size());
+                if (!sameOccurrences(occurrences, position, next,
+                                     page->answers)) {
+                    return -1;
+                }
+                position = next;
+            }
+            if (position != occurrences.size()) return -1;
+        }
+
+        // ranked queries count the same solutions
+        options.ranked = true;
+        EngineContext rankedCtxt(query, options);
+        rankedCtxt.setFilter(documentFilter);
+        unique_ptr<MwsAnswset> ranked(rankedCtxt.getRankedResult(
+            index, dbQueryManager, LeafScorer(), nullptr, 0, 3, MAX_TOTAL));
+        if (ranked->total != (int)numSolutions) return -1;
+        if (includeHits &&
+            ranked->answers.size() != std::min<size_t>(3, numSolutions)) {
+            return -1;
+        }
+        options.ranked = false;
+    }
+
+    return 0;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    collection_masks_handle_t masks;
+    index_handle_t index;
+    const inode_t* root;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    vector<uint32_t> firstCrawls;
+    vector<vector<encoded_token_t>> queries;
+    WorkerPool pool(2);
+    Query::Options allCollections;
+    Query::Options noDocuments;
+    Query::Options crawlRange;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    for (int c = 0; c < NUM_COLLECTIONS; c++) {
+        FAIL_ON(loadCollection(&indexBuilder, c) != 0);
+    }
+    for (CrawlId crawlId : indexBuilder.getCollectionFirstCrawls()) {
+        firstCrawls.push_back(crawlId == CRAWLID_NULL ? UINT32_MAX : crawlId);
+    }
+    // the collection without documents starts with the next one
+    FAIL_ON(firstCrawls.size() != NUM_COLLECTIONS);
+    FAIL_ON(firstCrawls[1] != firstCrawls[2]);
+
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+    root = reinterpret_cast<const inode_t*>(index.root);
+    FAIL_ON(collection_masks_write(
+                MASKS_PATH, &index, firstCrawls.data(), firstCrawls.size(),
+                indexBuilder.getFormulaMasks().data(),
+                indexBuilder.getFormulaMasks().size()) != 0);
+    FAIL_ON(collection_masks_load(&masks, MASKS_PATH) != 0);
+
+    // whole subtrees are pruned by their masks
+    noDocuments.collections = 1 << 1;
+    crawlRange.minCrawlId = 1000;
+    FAIL_ON(collection_masks_lookup_node(&masks, &index, root) ==
+            nullptr);
+    FAIL_ON(DocumentFilter(allCollections, &masks, &index).prune(root));
+    FAIL_ON(!DocumentFilter(noDocuments, &masks, &index).prune(root));
+    FAIL_ON(!DocumentFilter(crawlRange, &masks, &index).prune(root));
+    FAIL_ON(DocumentFilter(noDocuments, nullptr, &index).prune(root));
+    FAIL_ON(DocumentFilter(noDocuments, nullptr, &index).accepts(1));
+
+    queries.push_back({encoded_token(QVAR_ID_MIN, 0)});
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> formula;
+            for (const auto& elem : it.getPath()) {
+                formula.push_back(IndexAccessor::getToken(elem));
+            }
+            queries.push_back(formula);
+            if (formula.size() > 1 && formula.back().arity == 0) {
+                formula.back() = encoded_token(QVAR_ID_MIN, 0);
+                queries.push_back(formula);
+            }
+        }
+    }
+
+    for (const Filter& filter : FILTERS) {
+        for (const vector<encoded_token_t>& query : queries) {
+            FAIL_ON(checkQuery(&index, &dbQueryManager, &masks, &pool, filter,
+                               query) != 0);
+            // without masks, only CrawlId ranges can be searched
+            if (filter.collections == UINT64_MAX) {
+                FAIL_ON(checkQuery(&index, &dbQueryManager, nullptr, &pool,
+                                   filter, query) != 0);
+            }
+        }
+    }
+
+    FAIL_ON(collection_masks_unload(&masks) != 0);
+    FAIL_ON(unlink(MASKS_PATH) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,221 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of document-grouped queries with DocumentContext
+ * @file document_grouping.cpp
+ * @date 19 Oct 2026
+ *
+ * The occurrences of the formulae are grouped by document, in CrawlId
+ * order. The data of each returned document is read once. Beyond the exact
+ * maximum, the documents are counted by a HyperLogLog sketch.
+ */
+
+#include <cmath>
+#include <memory>
+using std::unique_ptr;
+#include <set>
+using std::set;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/CrawlDb.hpp"
+using mws::dbc::CrawlData;
+using mws::dbc::CrawlId;
+using mws::dbc::CRAWLID_NULL;
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+using mws::dbc::MemCrawlDb;
+#include "mws/dbc/MemFormulaDb.hpp"
+using mws::dbc::MemFormulaDb;
+#include "mws/query/DistinctCounter.hpp"
+using mws::query::DistinctCounter;
+#include "mws/query/DocumentContext.hpp"
+using mws::query::DocumentContext;
+#include "mws/types/FormulaPath.hpp"
+using mws::types::FormulaId;
+using mws::types::FormulaPath;
+#include "mws/types/MwsAnswset.hpp"
+using mws::MwsAnswset;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+/*
+
+formula 10: doc1 (a1), doc3 (a3), doc3 (a3')
+formula 11: doc3 (b3), no document
+formula 12: doc2 (c2), doc1 (c1)
+
+{10, 11, 12} -> doc1 (a1, c1), doc2 (c2), doc3 (a3, a3', b3)
+
+*/
+
+static const int NUM_CRAWLS = 20000;
+static const size_t EXACT_MAX = 1000;
+
+/// Crawl database counting its reads
+struct CountingCrawlDb : public MemCrawlDb {
+    int reads = 0;
+
+    virtual const CrawlData getData(const CrawlId& crawlId) {
+        reads++;
+        return MemCrawlDb::getData(crawlId);
+    }
+};
+
+static int checkAnswer(const MwsAnswset* answset, size_t i,
+                       const string& data, const vector<string>& uris) {
+    const mws::types::Answer* answer;
+
+    FAIL_ON(i >= answset->answers.size());
+    answer = answset->answers[i];
+    FAIL_ON(answer->data != data);
+    FAIL_ON(answer->uri != uris[0]);
+    FAIL_ON(answer->hits.size() != uris.size());
+    for (size_t j = 0; j < uris.size(); j++) {
+        FAIL_ON(answer->hits[j].xmlId != uris[j]);
+    }
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+int main() {
+    CountingCrawlDb crawlDb;
+    MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    vector<CrawlId> docs;
+    Query::Options options;
+    Query::Options idsOptions;
+    set<FormulaId> formulae = {10, 11, 12};
+
+    idsOptions.includeHits = false;
+    for (const char* data : {"doc1", "doc2", "doc3"}) {
+        docs.push_back(crawlDb.putData(data));
+    }
+    formulaDb.insertFormula(10, docs[0], FormulaPath("a1", "0"));
+    formulaDb.insertFormula(10, docs[2], FormulaPath("a3", "0"));
+    formulaDb.insertFormula(10, docs[2], FormulaPath("a3'", "1"));
+    formulaDb.insertFormula(11, docs[2], FormulaPath("b3", "0"));
+    formulaDb.insertFormula(11, CRAWLID_NULL, FormulaPath("b", "0"));
+    formulaDb.insertFormula(12, docs[1], FormulaPath("c2", "0"));
+    formulaDb.insertFormula(12, docs[0], FormulaPath("c1", "0"));
+
+    {
+        DocumentContext ctxt(options, &dbQueryManager);
+        unique_ptr<MwsAnswset> answset(ctxt.getResult(formulae, 0, 10, 100));
+
+        FAIL_ON(answset->total != 3);
+        FAIL_ON(answset->estimated);
+        FAIL_ON(answset->answers.size() != 3);
+        FAIL_ON(checkAnswer(answset.get(), 0, "doc1", {"a1", "c1"}) != 0);
+        FAIL_ON(checkAnswer(answset.get(), 1, "doc2", {"c2"}) != 0);
+        FAIL_ON(checkAnswer(answset.get(), 2, "doc3", {"a3", "a3'", "b3"}) !=
+                0);
+        FAIL_ON(answset->ids != formulae);
+        // the data of each document is read once
+        FAIL_ON(crawlDb.reads != 3);
+
+        // pages of the documents
+        crawlDb.reads = 0;
+        answset.reset(ctxt.getResult(formulae, 1, 1, 100));
+        FAIL_ON(answset->total != 3);
+        FAIL_ON(answset->answers.size() != 1);
+        FAIL_ON(checkAnswer(answset.get(), 0, "doc2", {"c2"}) != 0);
+        FAIL_ON(answset->ids != set<FormulaId>({12}));
+        FAIL_ON(crawlDb.reads != 1);
+        answset.reset(ctxt.getResult(formulae, 0, 10, 2));
+        FAIL_ON(answset->total != 2);
+        FAIL_ON(answset->answers.size() != 2);
+        answset.reset(ctxt.getResult(formulae, 5, 10, 100));
+        FAIL_ON(answset->total != 3);
+        FAIL_ON(!answset->answers.empty() || !answset->ids.empty());
+        answset.reset(ctxt.getResult({}, 0, 10, 100));
+        FAIL_ON(answset->total != 0 || !answset->answers.empty());
+    }
+
+    // many documents: formula 1000 + c in crawl c and c / 2 + 1
+    {
+        DocumentContext exactCtxt(idsOptions, &dbQueryManager, NUM_CRAWLS);
+        DocumentContext ctxt(idsOptions, &dbQueryManager, EXACT_MAX);
+        set<FormulaId> all;
+
+        for (int c = 1; c <= NUM_CRAWLS; c++) {
+            formulaDb.insertFormula(1000 + c, c, FormulaPath("f", "0"));
+            formulaDb.insertFormula(1000 + c, c / 2 + 1, FormulaPath("f", "1"));
+            all.insert(1000 + c);
+        }
+        crawlDb.reads = 0;
+
+        unique_ptr<MwsAnswset> answset(
+            exactCtxt.getResult(all, 0, 2, NUM_CRAWLS));
+        FAIL_ON(answset->total != NUM_CRAWLS);
+        FAIL_ON(answset->estimated);
+        // crawl 1 holds formulae 1001, crawl 2 holds 1001, 1002 and 1003
+        FAIL_ON(answset->ids != set<FormulaId>({1001, 1002, 1003}));
+
+        answset.reset(ctxt.getResult(all, 0, 2, NUM_CRAWLS * 2));
+        FAIL_ON(!answset->estimated);
+        FAIL_ON(std::abs(answset->total - NUM_CRAWLS) > NUM_CRAWLS / 20);
+        FAIL_ON(answset->totalLow > NUM_CRAWLS);
+        FAIL_ON(answset->totalHigh < NUM_CRAWLS);
+        // the page is exact
+        FAIL_ON(answset->ids != set<FormulaId>({1001, 1002, 1003}));
+        FAIL_ON(crawlDb.reads != 0);
+
+        // the estimate is bounded by maxTotal
+        answset.reset(ctxt.getResult(all, 0, 2, 5000));
+        FAIL_ON(answset->total != 5000);
+        FAIL_ON(answset->estimated);
+    }
+
+    // distinct counts
+    {
+        DistinctCounter counter(EXACT_MAX);
+        for (int i = 0; i < 3; i++) {
+            for (uint32_t value = 0; value < EXACT_MAX; value++) {
+                counter.insert(value * 7919);
+            }
+        }
+        FAIL_ON(counter.isEstimate());
+        FAIL_ON(counter.count() != EXACT_MAX);
+        FAIL_ON(counter.relativeError() != 0);
+
+        for (uint32_t value = 0; value < 100 * EXACT_MAX; value++) {
+            counter.insert(value);
+            counter.insert(value);
+        }
+        FAIL_ON(!counter.isEstimate());
+        FAIL_ON(std::abs((double)counter.count() - 100 * EXACT_MAX) >
+                5 * EXACT_MAX);
+        FAIL_ON(counter.relativeError() <= 0);
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,211 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the query_cursor_t pull API and of deep formulae
+ * @file engine_cursor.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/encoded_token.h"
+#include "mws/index/index.h"
+#include "mws/index/TmpIndex.hpp"
+#include "mws/query/engine.h"
+
+using namespace mws;
+using namespace std;
+
+/*
+
+index: f, h, f(h,h,t), g^DEPTH(h)
+query: P        -> all 4 leaves
+query: g(P)     -> g^DEPTH(h)
+query: g^DEPTH(P) -> g^DEPTH(h)
+
+Cursors splitting the branches of the first branching node report the same
+leaves as a single cursor, once merged by branch.
+
+*/
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_engine_cursor.memsector";
+static const int DEPTH = 4096;
+
+static const encoded_token_t apply4_tok = encoded_token(CONSTANT_ID_MIN, 4);
+static const encoded_token_t f_tok = encoded_token(CONSTANT_ID_MIN + 1, 0);
+static const encoded_token_t h_tok = encoded_token(CONSTANT_ID_MIN + 2, 0);
+static const encoded_token_t t_tok = encoded_token(CONSTANT_ID_MIN + 3, 0);
+static const encoded_token_t g_tok = encoded_token(CONSTANT_ID_MIN + 4, 1);
+static const encoded_token_t P_tok = encoded_token(QVAR_ID_MIN, 0);
+static const encoded_token_t Q_tok = encoded_token(QVAR_ID_MIN + 1, 0);
+
+struct Tester {
+    static void insert(index::TmpIndex* data,
+                       const vector<encoded_token_t>& formula) {
+        data->insertData(formula)->solutions++;
+    }
+};
+
+static vector<const leaf_t*> allLeaves(index_handle_t* index,
+                                       vector<encoded_token_t> query) {
+    encoded_formula_t formula = {query.data(), (uint32_t)query.size()};
+    vector<const leaf_t*> leaves;
+    query_cursor_t* cursor = query_cursor_create(index, &formula, NULL, NULL);
+    const leaf_t* leaf;
+    int ret;
+
+    while ((ret = query_cursor_next(cursor, &leaf)) == QUERY_CONTINUE) {
+        leaves.push_back(leaf);
+    }
+    if (ret != QUERY_STOP) leaves.clear();
+    query_cursor_destroy(cursor);
+
+    return leaves;
+}
+
+struct Split {
+    uint32_t part;
+    uint32_t numParts;
+};
+
+static bool splitCallback(void* handle, uint32_t branch) {
+    const Split* split = reinterpret_cast<const Split*>(handle);
+    return branch % split->numParts == split->part;
+}
+
+static vector<const leaf_t*> splitLeaves(index_handle_t* index,
+                                         vector<encoded_token_t> query,
+                                         uint32_t numParts) {
+    encoded_formula_t formula = {query.data(), (uint32_t)query.size()};
+    vector<pair<uint32_t, const leaf_t*>> branchLeaves;
+    vector<const leaf_t*> leaves;
+
+    for (uint32_t part = 0; part < numParts; part++) {
+        Split split = {part, numParts};
+        query_cursor_t* cursor =
+            query_cursor_create(index, &formula, NULL, NULL);
+        const leaf_t* leaf;
+        query_cursor_set_split(cursor, splitCallback, &split);
+        while (query_cursor_next(cursor, &leaf) == QUERY_CONTINUE) {
+            branchLeaves.push_back({query_cursor_get_branch(cursor), leaf});
+        }
+        query_cursor_destroy(cursor);
+    }
+    std::stable_sort(branchLeaves.begin(), branchLeaves.end(),
+                     [](const pair<uint32_t, const leaf_t*>& l1,
+                        const pair<uint32_t, const leaf_t*>& l2) {
+        return l1.first < l2.first;
+    });
+    for (const auto& branchLeaf : branchLeaves) {
+        leaves.push_back(branchLeaf.second);
+    }
+
+    return leaves;
+}
+
+static result_cb_return_t countCallback(void* handle, const leaf_t* leaf) {
+    UNUSED(leaf);
+    (*reinterpret_cast<int*>(handle))++;
+
+    return QUERY_CONTINUE;
+}
+
+int main() {
+    index::TmpIndex data;
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    vector<encoded_token_t> deep(DEPTH, g_tok);
+    vector<encoded_token_t> deepQuery(DEPTH, g_tok);
+    vector<encoded_token_t> qvarQuery = {P_tok};
+    encoded_formula_t formula;
+    query_cursor_t* cursors[2];
+    const leaf_t* leaf;
+    int numHits = 0;
+
+    deep.push_back(h_tok);
+    deepQuery.push_back(P_tok);
+    Tester::insert(&data, {f_tok});
+    Tester::insert(&data, {h_tok});
+    Tester::insert(&data, {apply4_tok, f_tok, h_tok, h_tok, t_tok});
+    Tester::insert(&data, deep);
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    {
+        vector<const leaf_t*> leaves = allLeaves(&index, qvarQuery);
+        FAIL_ON(leaves.size() != 4);
+
+        // deep formulae are matched without recursion
+        FAIL_ON(allLeaves(&index, {g_tok, P_tok}).size() != 1);
+        FAIL_ON(allLeaves(&index, deepQuery).size() != 1);
+        FAIL_ON(allLeaves(&index, deepQuery) !=
+                allLeaves(&index, {g_tok, P_tok}));
+
+        // cursors of the same query are independent
+        formula = {qvarQuery.data(), (uint32_t)qvarQuery.size()};
+        cursors[0] = query_cursor_create(&index, &formula, NULL, NULL);
+        cursors[1] = query_cursor_create(&index, &formula, NULL, NULL);
+        FAIL_ON(cursors[0] == NULL || cursors[1] == NULL);
+        for (const leaf_t* expected : leaves) {
+            for (query_cursor_t* cursor : cursors) {
+                FAIL_ON(query_cursor_next(cursor, &leaf) != QUERY_CONTINUE);
+                FAIL_ON(leaf != expected);
+            }
+        }
+        FAIL_ON(query_cursor_next(cursors[0], &leaf) != QUERY_STOP);
+        FAIL_ON(query_cursor_next(cursors[0], &leaf) != QUERY_STOP);
+        query_cursor_destroy(cursors[0]);
+        query_cursor_destroy(cursors[1]);
+
+        // split cursors report each leaf once, in branch order
+        for (uint32_t numParts : {1, 2, 3}) {
+            FAIL_ON(splitLeaves(&index, qvarQuery, numParts) != leaves);
+            FAIL_ON(splitLeaves(&index, {g_tok, P_tok}, numParts) !=
+                    allLeaves(&index, {g_tok, P_tok}));
+            FAIL_ON(splitLeaves(&index, {apply4_tok, P_tok, Q_tok, h_tok,
+                                         t_tok}, numParts).size() != 1);
+        }
+
+        // the callback API reports the same leaves
+        FAIL_ON(query_engine_run(&index, &formula, countCallback, &numHits) !=
+                QUERY_CONTINUE);
+        FAIL_ON(numHits != 4);
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
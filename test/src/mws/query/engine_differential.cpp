@@ -0,0 +1,230 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Differential test of EngineContext against SearchContext
+ * @file engine_differential.cpp
+ * @date 19 Oct 2026
+ *
+ * Queries are derived from the formulae of the test harvests by replacing
+ * subterms with qvars and number constants with ranges. Both engines must
+ * return the same totals, ids and answers for several pagination settings,
+ * also when EngineContext splits the search across a worker pool.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <set>
+using std::set;
+#include <vector>
+using std::vector;
+
+#include "common/thread/WorkerPool.hpp"
+using common::thread::WorkerPool;
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+#include "differential_tester.hpp"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_engine_differential.memsector";
+
+static const unsigned PARALLELISMS[] = {2, 3, 8};
+
+static const SearchContext::RangeBounds RANGE_BOUNDS = {
+    {RANGE_ID_MIN, {-1e300, 1e300}},
+    {RANGE_ID_MIN + 1, {0, 1}},
+    {RANGE_ID_MIN + 2, {2, 10}},
+};
+
+struct FormulaLess {
+    bool operator()(const vector<encoded_token_t>& f1,
+                    const vector<encoded_token_t>& f2) const {
+        return std::lexicographical_compare(
+            f1.begin(), f1.end(), f2.begin(), f2.end(),
+            [](const encoded_token_t& t1, const encoded_token_t& t2) {
+                return ((t1.arity < t2.arity) ||
+                        (t1.arity == t2.arity && t1.id < t2.id));
+            });
+    }
+};
+typedef set<vector<encoded_token_t>, FormulaLess> QuerySet;
+
+static void addQueries(const vector<encoded_token_t>& formula,
+                       QuerySet* queries) {
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    const encoded_token_t y = encoded_token(QVAR_ID_MIN + 1, 0);
+
+    queries->insert(formula);
+    for (size_t i = 0; i < formula.size(); i++) {
+        vector<encoded_token_t> query = replace(formula, i, x);
+        queries->insert(query);
+
+        // a second qvar, distinct or repeated, after the first one
+        for (size_t j = i + 1; j < query.size() && j < i + 4; j++) {
+            queries->insert(replace(query, j, x));
+            queries->insert(replace(query, j, y));
+        }
+
+        // a range, alone or followed by a qvar
+        if (formula[i].arity == 0) {
+            for (uint32_t r = 0; r < RANGE_BOUNDS.size(); r++) {
+                vector<encoded_token_t> rangeQuery =
+                    replace(formula, i, encoded_token(RANGE_ID_MIN + r, 0));
+                queries->insert(rangeQuery);
+                for (size_t j = i + 1; j < rangeQuery.size() && j < i + 4;
+                     j++) {
+                    queries->insert(replace(rangeQuery, j, x));
+                }
+            }
+        }
+    }
+}
+
+static int compare(index_handle_t* index, DbQueryManager* dbQueryManager,
+                   const NumericConstants* numbers,
+                   WorkerPool* pool, const vector<encoded_token_t>& query) {
+    for (bool includeHits : {true, false}) {
+        Query::Options options;
+        options.includeHits = includeHits;
+        for (const Pagination& p : PAGINATIONS) {
+            SearchContext searchContext(query, options, RANGE_BOUNDS,
+                                        numbers);
+            EngineContext engineContext(query, options, RANGE_BOUNDS,
+                                        numbers);
+            unique_ptr<MwsAnswset> expected(
+                searchContext.getResult<IndexAccessor>(
+                    index, dbQueryManager, p.offset, p.size, p.maxTotal));
+            unique_ptr<MwsAnswset> actual(engineContext.getResult(
+                index, dbQueryManager, p.offset, p.size, p.maxTotal));
+            if (!sameAnswers(expected.get(), actual.get())) {
+                fprintf(stderr, "Mismatch (hits=%d offset=%u size=%u "
+                                "max=%u): total %d vs %d\n",
+                        includeHits, p.offset, p.size, p.maxTotal,
+                        expected->total, actual->total);
+                return -1;
+            }
+            for (unsigned parallelism : PARALLELISMS) {
+                unique_ptr<MwsAnswset> parallel(engineContext.getResult(
+                    index, dbQueryManager, p.offset, p.size, p.maxTotal, pool,
+                    parallelism));
+                if (!sameAnswers(expected.get(), parallel.get())) {
+                    fprintf(stderr, "Mismatch (hits=%d offset=%u size=%u "
+                                    "max=%u parallelism=%u): total %d vs "
+                                    "%d\n",
+                            includeHits, p.offset, p.size, p.maxTotal,
+                            parallelism, expected->total, parallel->total);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    QuerySet queries;
+    WorkerPool pool(3);
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> formula;
+            for (const auto& elem : it.getPath()) {
+                formula.push_back(IndexAccessor::getToken(elem));
+            }
+            addQueries(formula, &queries);
+        }
+    }
+    FAIL_ON(queries.empty());
+    queries.insert({encoded_token(QVAR_ID_MIN, 0)});
+    queries.insert({encoded_token(RANGE_ID_MIN, 0)});
+    printf("Comparing %zu queries\n", queries.size());
+
+    for (const vector<encoded_token_t>& query : queries) {
+        FAIL_ON(compare(&index, &dbQueryManager, numbers.get(), &pool,
+                        query) != 0);
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,147 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of query cursors on an index with hvars
+ * @file engine_hvars.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/encoded_token.h"
+#include "mws/index/index.h"
+#include "mws/index/TmpIndex.hpp"
+#include "mws/query/engine.h"
+
+using namespace mws;
+using namespace std;
+
+/*
+
+index: 1 f(c,X), 2 f(X,X), 3 f(d,Y), 4 f(Y,c), 5 f(c,c), 6 f(X,d)
+hvars: X,Y
+
+The children of f are sorted as c, X, d, Y, so the hvars are interleaved
+with the constants.
+
+query: f(c,c) -> 1, 2, 4, 5
+query: f(d,c) -> 3, 4
+query: f(P,P) -> all, with P = c, X, d, c, c, d
+query: f(e,P) -> 2, 4, 6, with P = e, c, d
+query: f(c,e) -> 1
+
+*/
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_engine_hvars.memsector";
+
+static const encoded_token_t f_tok = encoded_token(CONSTANT_ID_MIN + 1, 2);
+static const encoded_token_t e_tok = encoded_token(CONSTANT_ID_MIN + 2, 0);
+static const encoded_token_t c_tok = encoded_token(0x300, 0);
+static const encoded_token_t d_tok = encoded_token(0x305, 0);
+static const encoded_token_t X_tok = encoded_token(HVAR_ID_MIN + 4, 0);
+static const encoded_token_t Y_tok = encoded_token(HVAR_ID_MIN + 5, 0);
+static const encoded_token_t P_tok = encoded_token(QVAR_ID_MIN, 0);
+
+typedef vector<encoded_token_t> Tokens;
+/// Instantiation of P by formula id of the reported leaves
+typedef map<uint32_t, Tokens> Results;
+
+struct Tester {
+    static uint32_t insert(index::TmpIndex* data, const Tokens& formula) {
+        index::TmpLeafNode* leaf = data->insertData(formula);
+        leaf->solutions++;
+        return leaf->id;
+    }
+};
+
+static bool operator==(const encoded_token_t& t1, const encoded_token_t& t2) {
+    return encoded_token_get_id(t1) == encoded_token_get_id(t2) &&
+           encoded_token_get_arity(t1) == encoded_token_get_arity(t2);
+}
+
+static Results query(index_handle_t* index, Tokens tokens,
+                     uint32_t firstId) {
+    encoded_formula_t formula = {tokens.data(), (uint32_t)tokens.size()};
+    query_cursor_t* cursor = query_cursor_create(index, &formula, NULL, NULL);
+    Results results;
+    const leaf_t* leaf;
+    int ret;
+
+    while ((ret = query_cursor_next(cursor, &leaf)) == QUERY_CONTINUE) {
+        const encoded_token_t* instantiation = NULL;
+        uint32_t size = query_cursor_get_instantiation(
+            cursor, encoded_token_get_id(P_tok), &instantiation);
+        results[leaf->formula_id - firstId + 1] =
+            Tokens(instantiation, instantiation + size);
+    }
+    if (ret != QUERY_STOP) results.clear();
+    query_cursor_destroy(cursor);
+
+    return results;
+}
+
+int main() {
+    index::TmpIndex data;
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    uint32_t firstId;
+
+    firstId = Tester::insert(&data, {f_tok, c_tok, X_tok});
+    Tester::insert(&data, {f_tok, X_tok, X_tok});
+    Tester::insert(&data, {f_tok, d_tok, Y_tok});
+    Tester::insert(&data, {f_tok, Y_tok, c_tok});
+    Tester::insert(&data, {f_tok, c_tok, c_tok});
+    Tester::insert(&data, {f_tok, X_tok, d_tok});
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    FAIL_ON(!inode_has_hvars((const inode_t*)index.root));
+    FAIL_ON(query(&index, {f_tok, c_tok, c_tok}, firstId) !=
+            Results({{1, {}}, {2, {}}, {4, {}}, {5, {}}}));
+    FAIL_ON(query(&index, {f_tok, d_tok, c_tok}, firstId) !=
+            Results({{3, {}}, {4, {}}}));
+    // P is X in 2 since the hvar is matched by nothing else
+    FAIL_ON(query(&index, {f_tok, P_tok, P_tok}, firstId) !=
+            Results({{1, {c_tok}}, {2, {X_tok}}, {3, {d_tok}},
+                     {4, {c_tok}}, {5, {c_tok}}, {6, {d_tok}}}));
+    FAIL_ON(query(&index, {f_tok, e_tok, P_tok}, firstId) !=
+            Results({{2, {e_tok}}, {4, {c_tok}}, {6, {d_tok}}}));
+    FAIL_ON(query(&index, {f_tok, c_tok, e_tok}, firstId) !=
+            Results({{1, {}}}));
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
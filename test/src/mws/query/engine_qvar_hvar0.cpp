@@ -75,11 +75,11 @@ static encoded_formula_t create_test_query() {
 }
 
 static result_cb_return_t result_callback(void* handle, const leaf_t* leaf) {
-    UNUSED(handle);
     UNUSED(leaf);
 
     printf("Result found!\n");
     fflush(stdout);
+    (*reinterpret_cast<int*>(handle))++;
 
     return QUERY_CONTINUE;
 }
@@ -87,7 +87,16 @@ static result_cb_return_t result_callback(void* handle, const leaf_t* leaf) {
 int main() {
     mws::index::TmpIndex* index = Tester::create_test_MwsIndexNode();
     encoded_formula_t query = create_test_query();
+    int numResults = 0;
 
-    return 0;  // TODO remove after test is running
-    return query_engine_tester(index, &query, result_callback, nullptr);
+    // F(H,H,H) with P = F = H = h, Q = H, and the formulae F and H which
+    // unify with the whole query
+    FAIL_ON(query_engine_tester(index, &query, result_callback,
+                                &numResults) != EXIT_SUCCESS);
+    FAIL_ON(numResults != 3);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
 }
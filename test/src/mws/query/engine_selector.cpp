@@ -0,0 +1,134 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the choice of the search engine by query shape
+ * @file engine_selector.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/encoded_token.h"
+#include "mws/query/EngineSelector.hpp"
+using mws::query::EngineSelector;
+
+static const encoded_token_t f_tok = encoded_token(CONSTANT_ID_MIN, 2);
+static const encoded_token_t g_tok = encoded_token(CONSTANT_ID_MIN + 1, 1);
+static const encoded_token_t h_tok = encoded_token(CONSTANT_ID_MIN + 2, 0);
+// the encoder gives vars and ranges arity 1, they are leaves nonetheless
+static const encoded_token_t x_tok = encoded_token(QVAR_ID_MIN, 1);
+static const encoded_token_t y_tok = encoded_token(QVAR_ID_MIN + 1, 1);
+static const encoded_token_t anon_tok = encoded_token(ANON_QVAR_ID_MIN, 1);
+static const encoded_token_t range_tok = encoded_token(RANGE_ID_MIN, 1);
+
+static unsigned depthShape(unsigned depth) {
+    return depth << EngineSelector::SHAPE_DEPTH_SHIFT;
+}
+
+/// Run n queries of shape, recording the given latency for each engine
+static void run(EngineSelector* selector, unsigned shape, unsigned n,
+                uint64_t searchMicros, uint64_t engineMicros,
+                unsigned* numSearch) {
+    *numSearch = 0;
+    for (unsigned i = 0; i < n; i++) {
+        EngineSelector::Engine engine = selector->choose(shape);
+        if (engine == EngineSelector::SEARCH_CONTEXT) {
+            (*numSearch)++;
+            selector->record(shape, engine, searchMicros);
+        } else {
+            selector->record(shape, engine, engineMicros);
+        }
+    }
+}
+
+int main() {
+    const unsigned shape = depthShape(1);
+    unsigned numSearch;
+
+    // shapes
+    FAIL_ON(EngineSelector::getShape({x_tok}) != depthShape(0));
+    FAIL_ON(EngineSelector::getShape({f_tok, x_tok, h_tok}) != depthShape(1));
+    FAIL_ON(EngineSelector::getShape({f_tok, h_tok, x_tok}) != depthShape(1));
+    FAIL_ON(EngineSelector::getShape({f_tok, g_tok, x_tok, y_tok}) !=
+            depthShape(2));
+    FAIL_ON(EngineSelector::getShape({f_tok, x_tok, g_tok, x_tok}) !=
+            (depthShape(1) | EngineSelector::SHAPE_REPEATED_QVARS));
+    FAIL_ON(EngineSelector::getShape({f_tok, anon_tok, anon_tok}) !=
+            depthShape(1));
+    FAIL_ON(EngineSelector::getShape({f_tok, h_tok, range_tok}) !=
+            (depthShape(1) | EngineSelector::SHAPE_RANGES));
+    FAIL_ON(EngineSelector::getShape({g_tok, g_tok, g_tok, g_tok, g_tok,
+                                      x_tok}) !=
+            depthShape(EngineSelector::MAX_DEPTH));
+    for (unsigned s = 0; s < EngineSelector::NUM_SHAPES; s++) {
+        FAIL_ON(EngineSelector::describeShape(s).empty());
+    }
+
+    // without SearchContext support, the query engine runs everything
+    {
+        EngineSelector selector(false);
+        run(&selector, shape, 100, 1, 1000, &numSearch);
+        FAIL_ON(numSearch != 0);
+    }
+
+    {
+        EngineSelector selector;
+        FAIL_ON(!selector.getStats().empty());
+
+        // both engines are sampled first
+        run(&selector, shape, 2 * EngineSelector::MIN_SAMPLES, 100, 1000,
+            &numSearch);
+        FAIL_ON(numSearch != EngineSelector::MIN_SAMPLES);
+
+        // then the faster one runs all but the exploring queries
+        run(&selector, shape, 10 * EngineSelector::EXPLORE_PERIOD, 100, 1000,
+            &numSearch);
+        FAIL_ON(numSearch != 10 * (EngineSelector::EXPLORE_PERIOD - 1));
+
+        // the choice follows a change of the latencies
+        run(&selector, shape, 20 * EngineSelector::EXPLORE_PERIOD, 1000, 100,
+            &numSearch);
+        FAIL_ON(numSearch > 2 * EngineSelector::EXPLORE_PERIOD);
+        run(&selector, shape, EngineSelector::EXPLORE_PERIOD, 1000, 100,
+            &numSearch);
+        FAIL_ON(numSearch != 1);
+
+        // shapes are independent
+        run(&selector, depthShape(2), 2 * EngineSelector::MIN_SAMPLES, 1000,
+            100, &numSearch);
+        FAIL_ON(numSearch != EngineSelector::MIN_SAMPLES);
+
+        vector<EngineSelector::ShapeStats> stats = selector.getStats();
+        FAIL_ON(stats.size() != 2);
+        FAIL_ON(stats[0].shape != shape || stats[1].shape != depthShape(2));
+        FAIL_ON(stats[1].engines[EngineSelector::SEARCH_CONTEXT].queries !=
+                EngineSelector::MIN_SAMPLES);
+        FAIL_ON(stats[1].engines[EngineSelector::QUERY_ENGINE].meanMicros !=
+                100);
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,231 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the totals estimated by sampling the index
+ * @file estimated_total.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <memory>
+using std::unique_ptr;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/index/encoded_token.h"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/index/TmpIndexAccessor.hpp"
+using mws::index::TmpIndexAccessor;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+using namespace mws;
+
+/*
+
+index: f(c_i, c_j)  for i, j < N   (N * N formulae)
+       g(c_i, c_j)  for j <= i < N (triangle)
+query: f(x, y)  -> the fan-out is uniform, the estimate is exact
+query: f(x, x)  -> N
+query: g(x, y)  -> the estimate is close to the total
+query: h(x)     -> not indexed, exact total 0
+
+The samples do not unify the query with hvars, so the query engine counts
+the totals of indexes with hvars:
+
+index: f(c_i, c_j)  for i, j < N, and f(X, c_0)
+query: f(x, y)  -> N * N + 1
+
+*/
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_estimated_total.memsector";
+static const char HVARS_MEMSECTOR_PATH[] =
+    "/tmp/test_estimated_total_hvars.memsector";
+static const uint32_t N = 40;
+static const unsigned PAGE_SIZE = 10;
+
+static const encoded_token_t f_tok = encoded_token(CONSTANT_ID_MIN, 2);
+static const encoded_token_t g_tok = encoded_token(CONSTANT_ID_MIN + 1, 2);
+static const encoded_token_t h_tok = encoded_token(CONSTANT_ID_MIN + 2, 1);
+static const encoded_token_t x_tok = encoded_token(QVAR_ID_MIN, 0);
+static const encoded_token_t y_tok = encoded_token(QVAR_ID_MIN + 1, 0);
+static const encoded_token_t X_tok = encoded_token(HVAR_ID_MIN + 1, 0);
+
+static encoded_token_t c_tok(uint32_t i) {
+    return encoded_token(CONSTANT_ID_MIN + 3 + i, 0);
+}
+
+struct Tester {
+    static void insert(TmpIndex* data, const vector<encoded_token_t>& formula) {
+        data->insertData(formula)->solutions++;
+    }
+};
+
+static Query::Options estimateOptions() {
+    Query::Options options;
+    options.includeHits = false;
+    options.estimateTotal = true;
+    return options;
+}
+
+/// @return the total estimated by SearchContext on the temporary index
+static MwsAnswset* searchTotal(TmpIndex* data,
+                               const vector<encoded_token_t>& query,
+                               unsigned maxTotal = 100000) {
+    SearchContext ctxt(query, estimateOptions());
+    return ctxt.getResult<TmpIndexAccessor>(data, nullptr, 0, PAGE_SIZE,
+                                            maxTotal);
+}
+
+int main() {
+    TmpIndex data;
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    const int triangle = N * (N + 1) / 2;
+
+    for (uint32_t i = 0; i < N; i++) {
+        for (uint32_t j = 0; j < N; j++) {
+            Tester::insert(&data, {f_tok, c_tok(i), c_tok(j)});
+            if (j <= i) Tester::insert(&data, {g_tok, c_tok(i), c_tok(j)});
+        }
+    }
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    {
+        // a uniform fan-out gives the exact total
+        unique_ptr<MwsAnswset> result(searchTotal(&data, {f_tok, x_tok,
+                                                          y_tok}));
+        FAIL_ON(!result->estimated);
+        FAIL_ON(result->total != (int)(N * N));
+        FAIL_ON(result->totalLow != result->total);
+        FAIL_ON(result->totalHigh != result->total);
+        FAIL_ON(result->ids.size() != PAGE_SIZE);
+
+        // the page is the same as without estimate
+        Query::Options options = estimateOptions();
+        options.estimateTotal = false;
+        SearchContext ctxt({f_tok, x_tok, y_tok}, options);
+        unique_ptr<MwsAnswset> counted(ctxt.getResult<TmpIndexAccessor>(
+            &data, nullptr, 0, PAGE_SIZE, 100000));
+        FAIL_ON(counted->estimated);
+        FAIL_ON(counted->total != (int)(N * N));
+        FAIL_ON(counted->ids != result->ids);
+
+        // the query engine gives the same estimate
+        EngineContext engineContext({f_tok, x_tok, y_tok}, estimateOptions());
+        unique_ptr<MwsAnswset> engine(
+            engineContext.getResult(&index, nullptr, 0, PAGE_SIZE, 100000));
+        FAIL_ON(!engine->estimated);
+        FAIL_ON(engine->total != (int)(N * N));
+        FAIL_ON(engine->ids != result->ids);
+    }
+
+    {
+        // repeated qvars
+        unique_ptr<MwsAnswset> result(searchTotal(&data, {f_tok, x_tok,
+                                                          x_tok}));
+        FAIL_ON(!result->estimated);
+        FAIL_ON(result->total != (int)N);
+    }
+
+    {
+        // an uneven fan-out gives an estimate close to the total
+        for (bool engine : {false, true}) {
+            unique_ptr<MwsAnswset> result;
+            if (engine) {
+                EngineContext ctxt({g_tok, x_tok, y_tok}, estimateOptions());
+                result.reset(ctxt.getResult(&index, nullptr, 0, PAGE_SIZE,
+                                            100000));
+            } else {
+                result.reset(searchTotal(&data, {g_tok, x_tok, y_tok}));
+            }
+            FAIL_ON(!result->estimated);
+            FAIL_ON(std::abs(result->total - triangle) > triangle / 10);
+            FAIL_ON(result->totalLow > triangle);
+            FAIL_ON(result->totalHigh < triangle);
+            FAIL_ON(result->totalLow > result->total);
+            FAIL_ON(result->totalHigh < result->total);
+        }
+    }
+
+    {
+        // totals which fit the page are counted
+        unique_ptr<MwsAnswset> result(searchTotal(&data, {h_tok, x_tok}));
+        FAIL_ON(result->estimated);
+        FAIL_ON(result->total != 0);
+        result.reset(searchTotal(&data, {f_tok, c_tok(0), x_tok}, 5));
+        FAIL_ON(result->estimated);
+        FAIL_ON(result->total != 5);
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    {
+        // indexes with hvars are counted
+        TmpIndex hvarData;
+        for (uint32_t i = 0; i < N; i++) {
+            for (uint32_t j = 0; j < N; j++) {
+                Tester::insert(&hvarData, {f_tok, c_tok(i), c_tok(j)});
+            }
+        }
+        Tester::insert(&hvarData, {f_tok, X_tok, c_tok(0)});
+        FAIL_ON(unlink(HVARS_MEMSECTOR_PATH) != 0 && errno != ENOENT);
+        FAIL_ON(memsector_create(&mswr, HVARS_MEMSECTOR_PATH) != 0);
+        hvarData.exportToMemsector(&mswr);
+        FAIL_ON(memsector_load(&ms, HVARS_MEMSECTOR_PATH) != 0);
+        index.ms = ms.ms;
+        index.root = memsector_get_root(&ms);
+
+        EngineContext ctxt({f_tok, x_tok, y_tok}, estimateOptions());
+        unique_ptr<MwsAnswset> result(
+            ctxt.getResult(&index, nullptr, 0, PAGE_SIZE, 100000));
+        FAIL_ON(result->estimated);
+        FAIL_ON(result->total != (int)(N * N + 1));
+
+        FAIL_ON(memsector_remove(&ms) != 0);
+        FAIL_ON(memsector_unload(&ms) != 0);
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
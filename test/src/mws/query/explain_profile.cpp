@@ -0,0 +1,289 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the timings and counters of explained queries
+ * @file explain_profile.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+using std::unique_ptr;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+using mws::query::PagedSearch;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+#include "mws/types/QueryProfile.hpp"
+using mws::types::QueryProfile;
+#include "mws/xmlparser/MwsXmlResponseFormatter.hpp"
+using mws::parser::RESPONSE_FORMATTER_MWS_XML;
+#include "mws/xmlparser/readMwsQuery.hpp"
+
+#include "build-gen/config.h"
+
+using namespace mws;
+
+/*
+
+index: formulae of the test harvests
+query: x                 -> every formula, x backtracks once per formula
+query: R[2,10]           -> the numbers of the index outside the range are
+                            rejected
+query: formula with its last token replaced by x
+                         -> the constants are looked up
+
+SearchContext and the query engine both collect the counters, and profiling
+does not change their answers.
+
+*/
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_explain_profile.memsector";
+
+static const encoded_token_t x_tok = encoded_token(QVAR_ID_MIN, 0);
+static const encoded_token_t range_tok = encoded_token(RANGE_ID_MIN, 0);
+
+static const SearchContext::RangeBounds RANGE_BOUNDS = {
+    {RANGE_ID_MIN, {2, 10}},
+};
+
+static const char EXPLAIN_QUERY[] =
+    "<mws:query xmlns:mws=\"http://www.mathweb.org/mws/ns\" "
+    "explain=\"true\"><mws:expr><mws:qvar>x</mws:qvar></mws:expr>"
+    "</mws:query>";
+
+struct Run {
+    unique_ptr<MwsAnswset> result;
+    QueryProfile profile;
+};
+
+static void runQuery(bool engine, index_handle_t* index,
+                     DbQueryManager* dbQueryManager,
+                     const NumericConstants* numbers,
+                     const vector<encoded_token_t>& query, bool profiled,
+                     Run* run) {
+    Query::Options options;
+    if (profiled) options.profile = &run->profile;
+    if (engine) {
+        EngineContext ctxt(query, options, RANGE_BOUNDS, numbers);
+        run->result.reset(ctxt.getResult(index, dbQueryManager, 0, 1000,
+                                         100000));
+    } else {
+        SearchContext ctxt(query, options, RANGE_BOUNDS, numbers);
+        run->result.reset(ctxt.getResult<IndexAccessor>(
+            index, dbQueryManager, 0, 1000, 100000));
+    }
+}
+
+static bool sameAnswers(const MwsAnswset* expected, const MwsAnswset* actual) {
+    if (expected->total != actual->total) return false;
+    if (expected->ids != actual->ids) return false;
+    if (expected->answers.size() != actual->answers.size()) return false;
+    for (size_t i = 0; i < expected->answers.size(); i++) {
+        if (expected->answers[i]->data != actual->answers[i]->data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @return the output of a formatter for answset
+static string format(const Query::ResponseFormatter* formatter,
+                     const MwsAnswset& answset) {
+    char* buffer = nullptr;
+    size_t size = 0;
+    FILE* file = open_memstream(&buffer, &size);
+    if (file == nullptr) return "";
+    formatter->writeData(&answset, file);
+    fclose(file);
+    string output(buffer, size);
+    free(buffer);
+    return output;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<encoded_token_t> constQuery;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    {
+        // a formula of several tokens, its last one replaced by x
+        IndexIterator<IndexAccessor> it(&index);
+        while (constQuery.size() < 3 && it.next() != nullptr) {
+            constQuery.clear();
+            for (const auto& elem : it.getPath()) {
+                constQuery.push_back(IndexAccessor::getToken(elem));
+            }
+        }
+    }
+    FAIL_ON(constQuery.size() < 3);
+    FAIL_ON(constQuery.back().arity != 0);
+    constQuery.back() = x_tok;
+
+    for (bool engine : {false, true}) {
+        Run plain, profiled;
+
+        // a qvar matches every formula
+        runQuery(engine, &index, &dbQueryManager, numbers.get(),
+                 {x_tok}, false, &plain);
+        runQuery(engine, &index, &dbQueryManager, numbers.get(),
+                 {x_tok}, true, &profiled);
+        FAIL_ON(!sameAnswers(plain.result.get(), profiled.result.get()));
+        FAIL_ON(plain.result->total <= 0);
+        FAIL_ON(profiled.profile.nodesVisited == 0);
+        FAIL_ON(profiled.profile.backtracks[QVAR_ID_MIN] <
+                profiled.result->ids.size());
+        FAIL_ON(profiled.profile.rangeRejects != 0);
+        // a seek per formula, and one per answer with crawled data
+        FAIL_ON(profiled.profile.dbSeeks < profiled.result->ids.size());
+        FAIL_ON(profiled.profile.crawlBytes == 0);
+        FAIL_ON(profiled.profile.searchTime != 0);
+
+        // numbers outside the range are rejected
+        runQuery(engine, &index, &dbQueryManager, numbers.get(),
+                 {range_tok}, false, &plain);
+        runQuery(engine, &index, &dbQueryManager, numbers.get(),
+                 {range_tok}, true, &profiled);
+        FAIL_ON(!sameAnswers(plain.result.get(), profiled.result.get()));
+        FAIL_ON(profiled.profile.rangeRejects == 0);
+
+        // constants are looked up among the children
+        runQuery(engine, &index, &dbQueryManager, numbers.get(),
+                 constQuery, false, &plain);
+        runQuery(engine, &index, &dbQueryManager, numbers.get(),
+                 constQuery, true, &profiled);
+        FAIL_ON(!sameAnswers(plain.result.get(), profiled.result.get()));
+        FAIL_ON(plain.result->total <= 0);
+        FAIL_ON(profiled.profile.childLookups < constQuery.size() - 1);
+    }
+
+    {
+        // each page reports the work of its own search
+        QueryProfile firstProfile, nextProfile;
+        Query::Options options;
+        unique_ptr<PagedSearch> search;
+        options.profile = &firstProfile;
+        EngineContext first({x_tok}, options, RANGE_BOUNDS, numbers.get());
+        unique_ptr<MwsAnswset> page(first.getFirstPage(
+            &index, &dbQueryManager, 0, 1, 100000, false, &search));
+        FAIL_ON(search == nullptr);
+        const uint64_t firstNodes = firstProfile.nodesVisited;
+        FAIL_ON(firstNodes == 0);
+
+        options.profile = &nextProfile;
+        EngineContext next({x_tok}, options, RANGE_BOUNDS, numbers.get());
+        page.reset(next.getNextPage(&search, &dbQueryManager, 1));
+        FAIL_ON(page->answers.size() != 1);
+        FAIL_ON(firstProfile.nodesVisited != firstNodes);
+        FAIL_ON(nextProfile.nodesVisited == 0);
+        FAIL_ON(nextProfile.dbSeeks == 0);
+    }
+
+    {
+        // explain="true" is parsed, and the profile formatted with the answers
+        FILE* file = fmemopen(const_cast<char*>(EXPLAIN_QUERY),
+                              strlen(EXPLAIN_QUERY), "r");
+        FAIL_ON(file == nullptr);
+        unique_ptr<Query> query(xmlparser::readMwsQuery(file));
+        fclose(file);
+        FAIL_ON(query == nullptr);
+        FAIL_ON(!query->attrExplain);
+
+        MwsAnswset answset;
+        answset.profile.reset(new QueryProfile());
+        answset.profile->nodesVisited = 42;
+        answset.profile->qvarBacktracks.push_back({"x", 7});
+        string xml = format(RESPONSE_FORMATTER_MWS_XML, answset);
+        FAIL_ON(xml.find("<mws:explain") == string::npos);
+        FAIL_ON(xml.find("nodes=\"42\"") == string::npos);
+        FAIL_ON(xml.find("<mws:qvar name=\"x\" backtracks=\"7\"/>") ==
+                string::npos);
+        unique_ptr<MwsAnswset> copy(answset.clone());
+        FAIL_ON(copy->profile == nullptr);
+        FAIL_ON(copy->profile->nodesVisited != 42);
+        answset.profile.reset();
+        FAIL_ON(format(RESPONSE_FORMATTER_MWS_XML, answset)
+                    .find("mws:explain") != string::npos);
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,232 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the mirror index
+ * @file mirror_query.cpp
+ * @date 19 Oct 2026
+ *
+ * Mirroring reverses the arguments of every token. Searching the mirror
+ * index with the mirrored query must find the same solutions as searching
+ * the index with the query, in the mirror's index order.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <string>
+using std::string;
+#include <utility>
+using std::pair;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/ExpressionEncoder.hpp"
+using mws::index::mirrorEncoding;
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+#include "differential_tester.hpp"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_mirror_query.memsector";
+static const char MIRROR_PATH[] = "/tmp/test_mirror_query.mirror";
+static const unsigned MAX_TOTAL = 100000;
+
+static const EngineContext::RangeBounds RANGE_BOUNDS = {
+    {RANGE_ID_MIN, {-1e300, 1e300}}, {RANGE_ID_MIN + 1, {0, 1}},
+};
+
+static bool sameFormula(const vector<encoded_token_t>& f1,
+                        const vector<encoded_token_t>& f2) {
+    return f1.size() == f2.size() &&
+           std::equal(f1.begin(), f1.end(), f2.begin(),
+                      [](const encoded_token_t& t1, const encoded_token_t& t2) {
+               return t1.id == t2.id && t1.arity == t2.arity;
+           });
+}
+
+static void addQueries(const vector<encoded_token_t>& formula,
+                       vector<vector<encoded_token_t>>* queries) {
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    const encoded_token_t y = encoded_token(QVAR_ID_MIN + 1, 0);
+
+    for (size_t i = 0; i < formula.size(); i++) {
+        vector<encoded_token_t> query = replace(formula, i, x);
+        queries->push_back(query);
+        for (size_t j = i + 1; j < query.size() && j < i + 4; j++) {
+            queries->push_back(replace(query, j, x));
+            queries->push_back(replace(query, j, y));
+        }
+        if (formula[i].arity == 0) {
+            queries->push_back(
+                replace(formula, i, encoded_token(RANGE_ID_MIN + 1, 0)));
+        }
+    }
+}
+
+/// @return the answers of a result, in a canonical order
+static vector<pair<string, string>> sortedAnswers(const MwsAnswset* result) {
+    vector<pair<string, string>> answers;
+    for (const types::Answer* answer : result->answers) {
+        answers.push_back({answer->uri, answer->xpath});
+    }
+    std::sort(answers.begin(), answers.end());
+    return answers;
+}
+
+static int compare(index_handle_t* index, index_handle_t* mirror,
+                   DbQueryManager* dbQueryManager,
+                   const NumericConstants* numbers,
+                   const vector<encoded_token_t>& query) {
+    for (bool includeHits : {true, false}) {
+        Query::Options options;
+        options.includeHits = includeHits;
+        EngineContext context(query, options, RANGE_BOUNDS, numbers);
+        EngineContext mirrorContext(mirrorEncoding(query), options,
+                                    RANGE_BOUNDS, numbers);
+        unique_ptr<MwsAnswset> expected(context.getResult(
+            index, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        unique_ptr<MwsAnswset> actual(mirrorContext.getResult(
+            mirror, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        if (expected->total != actual->total) return -1;
+        if (expected->ids != actual->ids) return -1;
+        if (sortedAnswers(expected.get()) != sortedAnswers(actual.get())) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int exportIndex(const TmpIndex& data, const char* path,
+                       memsector_handle_t* ms, index_handle_t* index) {
+    memsector_writer_t mswr;
+
+    FAIL_ON(unlink(path) != 0 && errno != ENOENT);
+    FAIL_ON(memsector_create(&mswr, path) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(ms, path) != 0);
+    index->ms = ms->ms;
+    index->root = memsector_get_root(ms);
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+int main() {
+    memsector_handle_t ms, mirrorMs;
+    index_handle_t index, mirror;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data, mirrorData;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<vector<encoded_token_t>> queries;
+
+    // f(a, g(b, c)) -> f(g(c, b), a)
+    {
+        const encoded_token_t f = encoded_token(CONSTANT_ID_MIN, 2);
+        const encoded_token_t g = encoded_token(CONSTANT_ID_MIN + 1, 2);
+        const encoded_token_t a = encoded_token(CONSTANT_ID_MIN + 2, 0);
+        const encoded_token_t b = encoded_token(CONSTANT_ID_MIN + 3, 0);
+        const encoded_token_t c = encoded_token(CONSTANT_ID_MIN + 4, 0);
+        vector<encoded_token_t> deep(4096, encoded_token(CONSTANT_ID_MIN, 1));
+        deep.push_back(a);
+
+        FAIL_ON(!sameFormula(mirrorEncoding({f, a, g, b, c}),
+                             {f, g, c, b, a}));
+        FAIL_ON(!sameFormula(mirrorEncoding({a}), {a}));
+        FAIL_ON(!sameFormula(mirrorEncoding(deep), deep));
+    }
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    data.buildMirror(&mirrorData);
+    FAIL_ON(exportIndex(data, MEMSECTOR_PATH, &ms, &index) != 0);
+    FAIL_ON(exportIndex(mirrorData, MIRROR_PATH, &mirrorMs, &mirror) != 0);
+
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> formula;
+            for (const auto& elem : it.getPath()) {
+                formula.push_back(IndexAccessor::getToken(elem));
+            }
+            FAIL_ON(!sameFormula(mirrorEncoding(mirrorEncoding(formula)),
+                                 formula));
+            addQueries(formula, &queries);
+        }
+    }
+    FAIL_ON(queries.empty());
+
+    for (const vector<encoded_token_t>& query : queries) {
+        FAIL_ON(compare(&index, &mirror, &dbQueryManager, numbers.get(),
+                        query) != 0);
+    }
+
+    FAIL_ON(memsector_remove(&mirrorMs) != 0);
+    FAIL_ON(memsector_unload(&mirrorMs) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,257 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of paginated queries resumed from paused searches
+ * @file paged_query.cpp
+ * @date 19 Oct 2026
+ *
+ * Each page of a paused search must equal the page getResult returns for
+ * the same offset. Paused searches are stored in a CursorCache until they
+ * expire.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+using std::unique_ptr;
+#include <string>
+using std::string;
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/CursorCache.hpp"
+using mws::query::CursorCache;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+using mws::query::PagedSearch;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_paged_query.memsector";
+static const unsigned MAX_TOTAL = 100000;
+static const unsigned PAGE_SIZES[] = {1, 2, 5};
+static const unsigned MAX_TOTALS[] = {MAX_TOTAL, 7};
+
+static bool sameAnswers(const MwsAnswset* expected, const MwsAnswset* actual) {
+    if (expected->total != actual->total) return false;
+    if (expected->ids != actual->ids) return false;
+    if (expected->answers.size() != actual->answers.size()) return false;
+    for (size_t i = 0; i < expected->answers.size(); i++) {
+        const types::Answer* e = expected->answers[i];
+        const types::Answer* a = actual->answers[i];
+        if (e->uri != a->uri || e->xpath != a->xpath || e->data != a->data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int comparePages(index_handle_t* index, DbQueryManager* dbQueryManager,
+                        const EngineContext& constContext, unsigned pageSize,
+                        unsigned maxTotal) {
+    EngineContext& context = const_cast<EngineContext&>(constContext);
+    unique_ptr<PagedSearch> search;
+    unsigned offset = 0;
+    unique_ptr<MwsAnswset> page(context.getFirstPage(
+        index, dbQueryManager, 0, pageSize, maxTotal, true, &search));
+
+    for (;;) {
+        unique_ptr<MwsAnswset> expected(context.getResult(
+            index, dbQueryManager, offset, pageSize, maxTotal));
+        FAIL_ON(!sameAnswers(expected.get(), page.get()));
+        offset += pageSize;
+        if (search == nullptr) {
+            FAIL_ON(offset < (unsigned)expected->total);
+            break;
+        }
+        FAIL_ON(search->position() != offset);
+        page.reset(context.getNextPage(&search, dbQueryManager, pageSize));
+    }
+
+    // the first page may start at any offset
+    page.reset(context.getFirstPage(index, dbQueryManager, 3, pageSize,
+                                    maxTotal, true, &search));
+    {
+        unique_ptr<MwsAnswset> expected(
+            context.getResult(index, dbQueryManager, 3, pageSize, maxTotal));
+        FAIL_ON(!sameAnswers(expected.get(), page.get()));
+    }
+
+    // without counting, the total stops at the end of the page
+    page.reset(context.getFirstPage(index, dbQueryManager, 0, pageSize,
+                                    maxTotal, false, &search));
+    if (search != nullptr) {
+        FAIL_ON((unsigned)page->total != pageSize);
+        page.reset(context.getNextPage(&search, dbQueryManager, pageSize));
+        FAIL_ON(search != nullptr && (unsigned)page->total != 2 * pageSize);
+    }
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    vector<vector<encoded_token_t>> queries = {{x}};
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    // queries with a qvar at the root or as the last argument
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> query;
+            for (const auto& elem : it.getPath()) {
+                query.push_back(IndexAccessor::getToken(elem));
+            }
+            if (query.size() > 1 && query.back().arity == 0) {
+                query.back() = x;
+                queries.push_back(query);
+            }
+        }
+    }
+
+    for (const vector<encoded_token_t>& query : queries) {
+        for (bool includeHits : {true, false}) {
+            Query::Options options;
+            options.includeHits = includeHits;
+            EngineContext context(query, options, EngineContext::RangeBounds(),
+                                  numbers.get());
+            for (unsigned pageSize : PAGE_SIZES) {
+                for (unsigned maxTotal : MAX_TOTALS) {
+                    FAIL_ON(comparePages(&index, &dbQueryManager, context,
+                                         pageSize, maxTotal) != 0);
+                }
+            }
+        }
+    }
+
+    // estimated totals are reported with their bounds on every page
+    {
+        Query::Options options;
+        options.estimateTotal = true;
+        EngineContext context({x}, options);
+        unique_ptr<PagedSearch> search;
+        unique_ptr<MwsAnswset> expected(
+            context.getResult(&index, &dbQueryManager, 0, 0, MAX_TOTAL));
+        FAIL_ON(!expected->estimated);
+        unique_ptr<MwsAnswset> page(context.getFirstPage(
+            &index, &dbQueryManager, 0, 1, MAX_TOTAL, true, &search));
+        for (int i = 0; i < 2; i++) {
+            FAIL_ON(search == nullptr);
+            FAIL_ON(!page->estimated);
+            FAIL_ON(page->total != expected->total);
+            FAIL_ON(page->totalLow != expected->totalLow);
+            FAIL_ON(page->totalHigh != expected->totalHigh);
+            page.reset(context.getNextPage(&search, &dbQueryManager, 1));
+        }
+    }
+
+    // paused searches by continuation token
+    {
+        Query::Options options;
+        EngineContext context({x}, options);
+        CursorCache cursors(std::chrono::milliseconds(50), 2);
+        unique_ptr<PagedSearch> search;
+        vector<string> tokens;
+
+        for (int i = 0; i < 3; i++) {
+            delete context.getFirstPage(&index, &dbQueryManager, 0, 1,
+                                        MAX_TOTAL, false, &search);
+            FAIL_ON(search == nullptr);
+            tokens.push_back(cursors.put("key", std::move(search)));
+        }
+        FAIL_ON(tokens[1] == tokens[2]);
+        // the oldest search was dropped
+        FAIL_ON(cursors.size() != 2);
+        FAIL_ON(cursors.take(tokens[0], "key") != nullptr);
+        // searches belong to their query
+        FAIL_ON(cursors.take(tokens[1], "other") != nullptr);
+        search = cursors.take(tokens[1], "key");
+        FAIL_ON(search == nullptr || search->position() != 1);
+        FAIL_ON(cursors.take(tokens[1], "key") != nullptr);
+        // searches expire
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        FAIL_ON(cursors.take(tokens[2], "key") != nullptr);
+        FAIL_ON(cursors.size() != 0);
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
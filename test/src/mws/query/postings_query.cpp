@@ -0,0 +1,228 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Differential test of token postings queries against the engine
+ * @file postings_query.cpp
+ * @date 19 Oct 2026
+ *
+ * Queries are derived from the formulae of the test harvests by replacing
+ * subterms with qvars and number constants with ranges. Answering them
+ * from the token postings must give the same totals, ids and answers as
+ * the trie search, for several pagination settings.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/formula_store.h"
+#include "mws/index/index.h"
+#include "mws/index/token_postings.h"
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+#include "differential_tester.hpp"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_postings_query.memsector";
+static const char FORMULA_STORE_PATH[] = "/tmp/test_postings_query.formulae";
+static const char TOKEN_POSTINGS_PATH[] = "/tmp/test_postings_query.postings";
+
+static const EngineContext::RangeBounds RANGE_BOUNDS = {
+    {RANGE_ID_MIN, {-1e300, 1e300}}, {RANGE_ID_MIN + 1, {0, 1}},
+};
+
+static void addQueries(const vector<encoded_token_t>& formula,
+                       vector<vector<encoded_token_t>>* queries) {
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    const encoded_token_t y = encoded_token(QVAR_ID_MIN + 1, 0);
+
+    for (size_t i = 0; i < formula.size(); i++) {
+        vector<encoded_token_t> query = replace(formula, i, x);
+        queries->push_back(query);
+        for (size_t j = i + 1; j < query.size() && j < i + 4; j++) {
+            queries->push_back(replace(query, j, x));
+            queries->push_back(replace(query, j, y));
+        }
+        if (formula[i].arity == 0) {
+            for (uint32_t r = 0; r < RANGE_BOUNDS.size(); r++) {
+                queries->push_back(
+                    replace(formula, i, encoded_token(RANGE_ID_MIN + r, 0)));
+            }
+        }
+    }
+}
+
+static int compare(index_handle_t* index, DbQueryManager* dbQueryManager,
+                   const NumericConstants* numbers,
+                   const token_postings_handle_t* postings,
+                   const formula_store_handle_t* formulaStore,
+                   const vector<encoded_token_t>& query) {
+    for (bool includeHits : {true, false}) {
+        Query::Options options;
+        options.includeHits = includeHits;
+        for (const Pagination& p : PAGINATIONS) {
+            EngineContext context(query, options, RANGE_BOUNDS,
+                                  numbers);
+            unique_ptr<MwsAnswset> expected(context.getResult(
+                index, dbQueryManager, p.offset, p.size, p.maxTotal));
+            unique_ptr<MwsAnswset> actual(context.getPostingsResult(
+                index, dbQueryManager, postings, formulaStore, p.offset,
+                p.size, p.maxTotal));
+            if (!sameAnswers(expected.get(), actual.get())) {
+                fprintf(stderr, "Mismatch (hits=%d offset=%u size=%u "
+                                "max=%u): total %d vs %d\n",
+                        includeHits, p.offset, p.size, p.maxTotal,
+                        expected->total, actual->total);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    formula_store_handle_t formulaStore;
+    token_postings_handle_t postings;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<formula_store_record_t> records;
+    vector<encoded_token_t> tokens;
+    vector<token_postings_pair_t> pairs;
+    vector<vector<encoded_token_t>> queries;
+    uint64_t numLeaves = 0;
+
+    // keys of f(g(a, ?x), b)
+    {
+        const encoded_token_t f = encoded_token(CONSTANT_ID_MIN, 2);
+        const encoded_token_t g = encoded_token(CONSTANT_ID_MIN + 1, 2);
+        const encoded_token_t a = encoded_token(CONSTANT_ID_MIN + 2, 0);
+        const encoded_token_t b = encoded_token(CONSTANT_ID_MIN + 3, 0);
+        const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+        vector<encoded_token_t> formula = {f, g, a, x, b};
+        vector<uint64_t> keys(2 * formula.size() + 1);
+        vector<uint64_t> expected = {
+            token_postings_key(TOKEN_POSTINGS_PARENT_ROOT, f),
+            token_postings_key(TOKEN_POSTINGS_PARENT_ANY, f),
+            token_postings_key(TOKEN_POSTINGS_PARENT_ANY, g),
+            token_postings_key(TOKEN_POSTINGS_PARENT_ANY, a),
+            token_postings_key(TOKEN_POSTINGS_PARENT_ANY, b),
+            token_postings_key(token_postings_parent(f), g),
+            token_postings_key(token_postings_parent(g), a),
+            token_postings_key(token_postings_parent(f), b),
+        };
+        std::sort(expected.begin(), expected.end());
+        int numKeys = token_postings_formula_keys(formula.data(),
+                                                  formula.size(), keys.data());
+        FAIL_ON(numKeys != (int)expected.size());
+        keys.resize(numKeys);
+        FAIL_ON(keys != expected);
+    }
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr, [&](const vector<encoded_token_t>& formula,
+                                      types::FormulaId formulaId,
+                                      memsector_long_off_t leafOff) {
+        vector<uint64_t> keys(2 * formula.size() + 1);
+        int numKeys = token_postings_formula_keys(formula.data(),
+                                                  formula.size(), keys.data());
+        for (int i = 0; i < numKeys; i++) {
+            pairs.push_back({keys[i], leafOff});
+        }
+        records.push_back({formulaId, (uint32_t)formula.size(),
+                           (uint64_t)tokens.size()});
+        tokens.insert(tokens.end(), formula.begin(), formula.end());
+        numLeaves++;
+        addQueries(formula, &queries);
+    });
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    FAIL_ON(formula_store_write(FORMULA_STORE_PATH, records.data(),
+                                records.size(), tokens.data()) != 0);
+    FAIL_ON(formula_store_load(&formulaStore, FORMULA_STORE_PATH) != 0);
+    FAIL_ON(token_postings_write(TOKEN_POSTINGS_PATH, pairs.data(),
+                                 pairs.size(), numLeaves, 0) != 0);
+    FAIL_ON(token_postings_load(&postings, TOKEN_POSTINGS_PATH) != 0);
+    FAIL_ON(postings.header->num_leaves != numLeaves);
+
+    printf("Comparing %zu queries\n", queries.size());
+    for (const vector<encoded_token_t>& query : queries) {
+        FAIL_ON(compare(&index, &dbQueryManager, numbers.get(),
+                        &postings, &formulaStore, query) != 0);
+    }
+
+    FAIL_ON(token_postings_unload(&postings) != 0);
+    FAIL_ON(formula_store_unload(&formulaStore) != 0);
+    FAIL_ON(unlink(TOKEN_POSTINGS_PATH) != 0);
+    FAIL_ON(unlink(FORMULA_STORE_PATH) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
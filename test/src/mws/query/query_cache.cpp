@@ -0,0 +1,172 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the segmented LRU query result cache
+ * @file query_cache.cpp
+ * @date 19 Oct 2026
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+using std::unique_ptr;
+#include <string>
+using std::string;
+using std::to_string;
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/query/QueryCache.hpp"
+using mws::query::QueryCache;
+#include "mws/types/MwsAnswset.hpp"
+
+using namespace mws;
+
+static const int NUM_ANSWERS = 4;
+static const int NUM_THREADS = 8;
+
+static MwsAnswset* makeAnswset(int total, bool partial = false) {
+    MwsAnswset* answset = new MwsAnswset();
+    for (int i = 0; i < NUM_ANSWERS; i++) {
+        types::Answer* answer = new types::Answer();
+        answer->uri = "uri" + to_string(i);
+        answer->data = string(100, 'x');
+        answset->answers.push_back(answer);
+        answset->ids.insert(i);
+    }
+    answset->total = total;
+    answset->partial = partial;
+    return answset;
+}
+
+int main() {
+    int computed = 0;
+    auto compute = [&computed](int total) {
+        return [&computed, total]() {
+            computed++;
+            return makeAnswset(total);
+        };
+    };
+    unique_ptr<MwsAnswset> sample(makeAnswset(0));
+    // room for about 10 entries
+    QueryCache cache(10 * (QueryCache::sizeOf(*sample) + 200));
+
+    // misses compute, hits return equal copies
+    {
+        unique_ptr<MwsAnswset> first(cache.get("a", compute(1)));
+        unique_ptr<MwsAnswset> second(cache.get("a", compute(2)));
+        FAIL_ON(computed != 1);
+        FAIL_ON(first->total != 1 || second->total != 1);
+        FAIL_ON(first->answers.size() != NUM_ANSWERS);
+        FAIL_ON(first->answers[0] == second->answers[0]);
+        FAIL_ON(first->answers[0]->data != second->answers[0]->data);
+        FAIL_ON(second->ids != first->ids);
+        QueryCache::Stats stats = cache.getStats();
+        FAIL_ON(stats.hits != 1 || stats.misses != 1 || stats.entries != 1);
+    }
+
+    // a scan of one-off queries does not evict a protected entry
+    delete cache.get("a", compute(1));
+    for (int i = 0; i < 100; i++) {
+        delete cache.get("scan" + to_string(i), compute(i));
+    }
+    {
+        QueryCache::Stats stats = cache.getStats();
+        FAIL_ON(stats.evictions == 0);
+        FAIL_ON(stats.entries > 10);
+        FAIL_ON(stats.bytes > 10 * (QueryCache::sizeOf(*sample) + 200));
+        computed = 0;
+        delete cache.get("a", compute(1));
+        FAIL_ON(computed != 0);
+        delete cache.get("scan0", compute(0));
+        FAIL_ON(computed != 1);
+    }
+
+    // hits of grouped answers are accounted
+    {
+        unique_ptr<MwsAnswset> grouped(makeAnswset(0));
+        grouped->answers[0]->hits.emplace_back("id", string(100, 'x'));
+        FAIL_ON(QueryCache::sizeOf(*grouped) <
+                QueryCache::sizeOf(*sample) + 100);
+    }
+
+    // partial answer sets are not cached
+    computed = 0;
+    for (int i = 0; i < 2; i++) {
+        unique_ptr<MwsAnswset> partial(cache.get("partial", [&computed]() {
+            computed++;
+            return makeAnswset(0, true);
+        }));
+        FAIL_ON(!partial->partial);
+    }
+    FAIL_ON(computed != 2);
+
+    // lookups without computation
+    {
+        FAIL_ON(cache.find("put") != nullptr);
+        unique_ptr<MwsAnswset> answset(makeAnswset(3));
+        cache.put("put", *answset);
+        answset.reset(cache.find("put"));
+        FAIL_ON(answset == nullptr || answset->total != 3);
+        answset.reset(makeAnswset(4));
+        cache.put("put", *answset);
+        answset.reset(cache.find("put"));
+        FAIL_ON(answset == nullptr || answset->total != 3);
+        answset.reset(makeAnswset(0, true));
+        cache.put("put partial", *answset);
+        FAIL_ON(cache.find("put partial") != nullptr);
+    }
+
+    // invalidation
+    cache.clear();
+    FAIL_ON(cache.getStats().entries != 0 || cache.getStats().bytes != 0);
+    computed = 0;
+    delete cache.get("a", compute(1));
+    FAIL_ON(computed != 1);
+
+    // concurrent lookups of a missing key share one computation
+    {
+        std::atomic<int> computations(0);
+        vector<std::thread> threads;
+        vector<int> totals(NUM_THREADS, 0);
+        for (int t = 0; t < NUM_THREADS; t++) {
+            threads.emplace_back([&cache, &computations, &totals, t]() {
+                unique_ptr<MwsAnswset> answset(cache.get("shared", [&]() {
+                    computations++;
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds(50));
+                    return makeAnswset(7);
+                }));
+                totals[t] = answset->total;
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        FAIL_ON(computations != 1);
+        for (int total : totals) FAIL_ON(total != 7);
+    }
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,369 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the qvar substitutions reported per hit
+ * @file qvar_substitutions.cpp
+ * @date 19 Oct 2026
+ *
+ * Queries are derived from the formulae of the test harvests by replacing
+ * subterms with qvars. Each answer of both engines must carry one
+ * substitution per named qvar occurrence, which put back into the query
+ * give the formula of the hit. All ways of running the query must report
+ * the same substitutions, and none unless they are requested.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <set>
+using std::set;
+#include <vector>
+using std::vector;
+
+#include "common/thread/WorkerPool.hpp"
+using common::thread::WorkerPool;
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/ExpressionEncoder.hpp"
+using mws::index::ExpressionDecoder;
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/index/TmpIndexAccessor.hpp"
+using mws::index::TmpIndexAccessor;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+using mws::query::PagedSearch;
+#include "mws/query/LeafScorer.hpp"
+using mws::query::LeafScorer;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+#include "differential_tester.hpp"
+
+using namespace mws;
+
+typedef vector<vector<encoded_token_t>> Substitutions;
+
+struct FormulaLess {
+    bool operator()(const vector<encoded_token_t>& f1,
+                    const vector<encoded_token_t>& f2) const {
+        return std::lexicographical_compare(
+            f1.begin(), f1.end(), f2.begin(), f2.end(),
+            [](const encoded_token_t& t1, const encoded_token_t& t2) {
+                return ((t1.arity < t2.arity) ||
+                        (t1.arity == t2.arity && t1.id < t2.id));
+            });
+    }
+};
+typedef set<vector<encoded_token_t>, FormulaLess> FormulaSet;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_qvar_substitutions.memsector";
+static const unsigned MAX_TOTAL = 100000;
+static const unsigned PAGE_SIZE = 3;
+
+/// @return whether formula is pattern with any subterm at its anonymous qvars
+static bool matches(const vector<encoded_token_t>& pattern,
+                    const vector<encoded_token_t>& formula) {
+    size_t pos = 0;
+    for (const encoded_token_t& token : pattern) {
+        if (pos == formula.size()) return false;
+        if (encoded_token_is_anon_var(token)) {
+            pos = subtermEnd(formula, pos);
+        } else if (token.id == formula[pos].id &&
+                   token.arity == formula[pos].arity) {
+            pos++;
+        } else {
+            return false;
+        }
+    }
+    return pos == formula.size();
+}
+
+/// @return the query with its named qvars replaced by their substitutions
+static vector<encoded_token_t> instantiate(
+    const vector<encoded_token_t>& query,
+    const Substitutions& substitutions) {
+    vector<encoded_token_t> formula;
+    size_t next = 0;
+    for (const encoded_token_t& token : query) {
+        if (token.id >= QVAR_ID_MIN && token.id < ANON_QVAR_ID_MIN) {
+            if (next < substitutions.size()) {
+                const vector<encoded_token_t>& s = substitutions[next];
+                formula.insert(formula.end(), s.begin(), s.end());
+            }
+            next++;
+        } else {
+            formula.push_back(token);
+        }
+    }
+    return formula;
+}
+
+/// @return the formulae of the index
+static FormulaSet loadFormulae(index_handle_t* index) {
+    FormulaSet formulae;
+    IndexIterator<IndexAccessor> it(index);
+    while (it.next() != nullptr) {
+        vector<encoded_token_t> formula;
+        for (const auto& elem : it.getPath()) {
+            formula.push_back(IndexAccessor::getToken(elem));
+        }
+        formulae.insert(formula);
+    }
+    return formulae;
+}
+
+/**
+ * @return the substitutions of the answers, or an empty list if some answer
+ * does not carry one valid substitution per named qvar
+ */
+static vector<Substitutions> check(
+    const FormulaSet& formulae,
+    const vector<encoded_token_t>& query, size_t numQvars,
+    const ExpressionDecoder& decoder, const MwsAnswset* result) {
+    vector<Substitutions> substitutions;
+    for (const types::Answer* answer : result->answers) {
+        const Substitutions& s = answer->substitutions;
+        if (s.size() != numQvars) return {};
+        vector<encoded_token_t> pattern = instantiate(query, s);
+        if (std::none_of(formulae.begin(), formulae.end(),
+                         [&pattern](const vector<encoded_token_t>& formula) {
+                return matches(pattern, formula);
+            })) {
+            return {};
+        }
+        for (const vector<encoded_token_t>& tokens : s) {
+            if (decoder.toCmml(tokens.data(), tokens.size()).empty()) {
+                return {};
+            }
+        }
+        substitutions.push_back(s);
+    }
+    return substitutions;
+}
+
+static bool sameSubstitutions(const vector<Substitutions>& s1,
+                              const vector<Substitutions>& s2) {
+    auto sameToken = [](const encoded_token_t& t1, const encoded_token_t& t2) {
+        return t1.id == t2.id && t1.arity == t2.arity;
+    };
+    if (s1.size() != s2.size()) return false;
+    for (size_t i = 0; i < s1.size(); i++) {
+        if (s1[i].size() != s2[i].size()) return false;
+        for (size_t j = 0; j < s1[i].size(); j++) {
+            if (s1[i][j].size() != s2[i][j].size() ||
+                !std::equal(s1[i][j].begin(), s1[i][j].end(),
+                            s2[i][j].begin(), sameToken)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool noSubstitutions(const MwsAnswset* result) {
+    for (const types::Answer* answer : result->answers) {
+        if (!answer->substitutions.empty()) return false;
+    }
+    return true;
+}
+
+static int checkQuery(index_handle_t* index, TmpIndex* data,
+                      DbQueryManager* dbQueryManager,
+                      const NumericConstants* numbers,
+                      const ExpressionDecoder& decoder, WorkerPool* pool,
+                      const FormulaSet& formulae,
+                      const vector<encoded_token_t>& query) {
+    Query::Options options;
+    size_t numQvars = std::count_if(query.begin(), query.end(),
+                                    [](const encoded_token_t& token) {
+        return token.id >= QVAR_ID_MIN && token.id < ANON_QVAR_ID_MIN;
+    });
+    vector<Substitutions> expected;
+
+    options.includeSubstitutions = true;
+    SearchContext searchContext(query, options, {}, numbers);
+    EngineContext engineContext(query, options, {}, numbers);
+    {
+        unique_ptr<MwsAnswset> result(searchContext.getResult<IndexAccessor>(
+            index, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        expected = check(formulae, query, numQvars, decoder, result.get());
+        FAIL_ON(expected.size() != result->answers.size());
+    }
+    {
+        unique_ptr<MwsAnswset> result(
+            searchContext.getResult<TmpIndexAccessor>(
+                data, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        FAIL_ON(!sameSubstitutions(
+            check(formulae, query, numQvars, decoder, result.get()), expected));
+    }
+    {
+        unique_ptr<MwsAnswset> result(engineContext.getResult(
+            index, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        FAIL_ON(!sameSubstitutions(
+            check(formulae, query, numQvars, decoder, result.get()), expected));
+    }
+    for (unsigned parallelism : {2, 3}) {
+        unique_ptr<MwsAnswset> result(engineContext.getResult(
+            index, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL, pool,
+            parallelism));
+        FAIL_ON(!sameSubstitutions(
+            check(formulae, query, numQvars, decoder, result.get()), expected));
+    }
+
+    // paused search, page by page
+    {
+        unique_ptr<PagedSearch> search;
+        unique_ptr<MwsAnswset> page(engineContext.getFirstPage(
+            index, dbQueryManager, 0, PAGE_SIZE, MAX_TOTAL, true, &search));
+        vector<Substitutions> pages;
+        for (;;) {
+            vector<Substitutions> s =
+                check(formulae, query, numQvars, decoder, page.get());
+            FAIL_ON(s.empty() && !page->answers.empty());
+            pages.insert(pages.end(), s.begin(), s.end());
+            if (search == nullptr) break;
+            page.reset(engineContext.getNextPage(&search, dbQueryManager,
+                                                 PAGE_SIZE));
+        }
+        FAIL_ON(!sameSubstitutions(pages, expected));
+    }
+
+    // ranked order differs, each answer is still checked against its formula
+    {
+        unique_ptr<MwsAnswset> result(engineContext.getRankedResult(
+            index, dbQueryManager, LeafScorer(), nullptr, 0, MAX_TOTAL,
+            MAX_TOTAL));
+        vector<Substitutions> ranked =
+            check(formulae, query, numQvars, decoder, result.get());
+        FAIL_ON(ranked.size() != expected.size());
+    }
+
+    // not requested
+    {
+        Query::Options defaultOptions;
+        SearchContext plainSearch(query, defaultOptions, {},
+                                  numbers);
+        EngineContext plainEngine(query, defaultOptions, {},
+                                  numbers);
+        unique_ptr<MwsAnswset> searched(plainSearch.getResult<IndexAccessor>(
+            index, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        unique_ptr<MwsAnswset> engine(plainEngine.getResult(
+            index, dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+        FAIL_ON(!noSubstitutions(searched.get()));
+        FAIL_ON(!noSubstitutions(engine.get()));
+    }
+
+    return 0;
+
+fail:
+    return -1;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    const encoded_token_t y = encoded_token(QVAR_ID_MIN + 1, 0);
+    const encoded_token_t anon = encoded_token(ANON_QVAR_ID_MIN, 0);
+    FormulaSet formulae;
+    vector<vector<encoded_token_t>> queries;
+    WorkerPool pool(2);
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    formulae = loadFormulae(&index);
+    FAIL_ON(formulae.empty());
+
+    // named qvars, repeated or distinct, and anonymous qvars
+    queries.push_back({x});
+    for (const vector<encoded_token_t>& formula : formulae) {
+        for (size_t i = 1; i < formula.size() && i < 4; i++) {
+            vector<encoded_token_t> query = replace(formula, i, x);
+            queries.push_back(query);
+            for (size_t j = i + 1; j < query.size() && j < i + 3; j++) {
+                queries.push_back(replace(query, j, x));
+                queries.push_back(replace(query, j, y));
+                queries.push_back(replace(query, j, anon));
+            }
+        }
+    }
+
+    {
+        ExpressionDecoder decoder(meaningDictionary);
+        for (const vector<encoded_token_t>& query : queries) {
+            FAIL_ON(checkQuery(&index, &data, &dbQueryManager, numbers.get(),
+                               decoder, &pool, formulae, query) != 0);
+        }
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -37,6 +37,8 @@ using mws::index::MeaningDictionary;
 using mws::types::Query;
 #include "mws/types/MwsAnswset.hpp"
 using mws::MwsAnswset;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
 #include "mws/query/SearchContext.hpp"
 using mws::query::SearchContext;
 
@@ -139,7 +141,9 @@ int main() {
     Query defaultQuery;
     defaultQuery.options.includeHits = false;
 
-    SearchContext ctxt(encodedQuery, defaultQuery.options, rangeBounds, &dict);
+    NumericConstants numbers(&dict);
+    SearchContext ctxt(encodedQuery, defaultQuery.options, rangeBounds,
+                       &numbers);
     MwsAnswset* answ = ctxt.getResult<TmpIndexAccessor>(
         index, nullptr, defaultQuery.attrResultLimitMin,
         defaultQuery.attrResultMaxSize, defaultQuery.attrResultTotalReqNr);
@@ -0,0 +1,235 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test ranked queries against a full sort of all solutions
+ * @file ranked_query.cpp
+ * @date 19 Oct 2026
+ *
+ * The pages of EngineContext::getRankedResult must be the same with and
+ * without subtree bounds, and match the leaves of the query sorted by
+ * decreasing score.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <set>
+using std::set;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/subtree_bounds.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/query/engine.h"
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/LeafScorer.hpp"
+using mws::query::LeafScorer;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_ranked_query.memsector";
+static const char SUBTREE_BOUNDS_PATH[] = "/tmp/test_ranked_query.dat";
+
+static const unsigned PAGES[][2] = {{0, 1}, {0, 5}, {2, 3}, {0, 100}, {7, 0}};
+static const unsigned MAX_TOTAL = 100000;
+
+/// Formula ids of the leaves of a query, by decreasing score
+static vector<uint32_t> rankedIds(index_handle_t* index,
+                                  vector<encoded_token_t> query,
+                                  const LeafScorer& scorer) {
+    encoded_formula_t formula = {query.data(), (uint32_t)query.size()};
+    query_cursor_t* cursor = query_cursor_create(index, &formula, NULL, NULL);
+    vector<std::pair<double, uint32_t>> leaves;
+    vector<uint32_t> ids;
+    const leaf_t* leaf;
+
+    while (query_cursor_next(cursor, &leaf) == QUERY_CONTINUE) {
+        leaves.push_back({scorer.score(leaf, query_cursor_get_depth(cursor)),
+                          leaf->formula_id});
+    }
+    query_cursor_destroy(cursor);
+
+    std::stable_sort(leaves.begin(), leaves.end(),
+                     [](const std::pair<double, uint32_t>& l1,
+                        const std::pair<double, uint32_t>& l2) {
+        return l1.first > l2.first;
+    });
+    for (const auto& rankedLeaf : leaves) {
+        ids.push_back(rankedLeaf.second);
+    }
+
+    return ids;
+}
+
+static bool sameAnswers(const MwsAnswset* expected, const MwsAnswset* actual) {
+    if (expected->ids != actual->ids) return false;
+    if (expected->answers.size() != actual->answers.size()) return false;
+    for (size_t i = 0; i < expected->answers.size(); i++) {
+        const types::Answer* e = expected->answers[i];
+        const types::Answer* a = actual->answers[i];
+        if (e->uri != a->uri || e->xpath != a->xpath) return false;
+    }
+    return true;
+}
+
+static int checkQuery(index_handle_t* index, DbQueryManager* dbQueryManager,
+                      const subtree_bounds_handle_t* bounds,
+                      const LeafScorer& scorer,
+                      const vector<encoded_token_t>& query) {
+    vector<uint32_t> expectedIds = rankedIds(index, query, scorer);
+
+    for (const unsigned* page : PAGES) {
+        const unsigned offset = page[0];
+        const unsigned size = page[1];
+
+        // page of formula ids
+        Query::Options options;
+        options.includeHits = false;
+        options.ranked = true;
+        EngineContext idsContext(query, options);
+        unique_ptr<MwsAnswset> ids(idsContext.getRankedResult(
+            index, dbQueryManager, scorer, nullptr, offset, size, MAX_TOTAL));
+        if (ids->total != (int)expectedIds.size()) return -1;
+        set<types::FormulaId> pageIds;
+        for (unsigned i = offset; i < offset + size && i < expectedIds.size();
+             i++) {
+            pageIds.insert(expectedIds[i]);
+        }
+        if (ids->ids != pageIds) return -1;
+
+        // pruning does not change the page
+        for (bool includeHits : {true, false}) {
+            options.includeHits = includeHits;
+            EngineContext context(query, options);
+            unique_ptr<MwsAnswset> expected(context.getRankedResult(
+                index, dbQueryManager, scorer, nullptr, offset, size,
+                MAX_TOTAL));
+            unique_ptr<MwsAnswset> pruned(context.getRankedResult(
+                index, dbQueryManager, scorer, bounds, offset, size,
+                MAX_TOTAL));
+            if (!sameAnswers(expected.get(), pruned.get())) return -1;
+            if (pruned->total > expected->total) return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    subtree_bounds_handle_t bounds;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<float> staticScores;
+    vector<vector<encoded_token_t>> queries;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+    FAIL_ON(subtree_bounds_write(SUBTREE_BOUNDS_PATH, &index) != 0);
+    FAIL_ON(subtree_bounds_load(&bounds, SUBTREE_BOUNDS_PATH) != 0);
+
+    // every formula with its first or last token replaced by a qvar
+    queries.push_back({encoded_token(QVAR_ID_MIN, 0)});
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> formula;
+            for (const auto& elem : it.getPath()) {
+                formula.push_back(IndexAccessor::getToken(elem));
+            }
+            if (formula.size() > 1 && formula.back().arity == 0) {
+                vector<encoded_token_t> query = formula;
+                query.back() = encoded_token(QVAR_ID_MIN, 0);
+                queries.push_back(query);
+                query.resize(2);
+                query.back() = encoded_token(QVAR_ID_MIN, 0);
+                if (query[0].arity == 1) queries.push_back(query);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        staticScores.push_back((i * 7919) % 13 / 4.0);
+    }
+
+    for (const vector<encoded_token_t>& query : queries) {
+        FAIL_ON(checkQuery(&index, &dbQueryManager, &bounds, LeafScorer(),
+                           query) != 0);
+        FAIL_ON(checkQuery(&index, &dbQueryManager, &bounds,
+                           LeafScorer(LeafScorer::Weights(),
+                                      staticScores.data(),
+                                      staticScores.size()),
+                           query) != 0);
+    }
+
+    FAIL_ON(subtree_bounds_unload(&bounds) != 0);
+    FAIL_ON(unlink(SUBTREE_BOUNDS_PATH) != 0);
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,213 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Test of the deadline and node budget of queries
+ * @file search_budget.cpp
+ * @date 19 Oct 2026
+ *
+ * index: f(c_i) and g(c_i, c_i) for NUM_CONSTANTS constants c_i
+ *
+ * A limited cursor reports a prefix of the leaves of an unlimited one, then
+ * only QUERY_LIMIT. A node budget equal to the visits of the full search
+ * does not limit it. Both search contexts return partial answer sets, whose
+ * ids are among the complete ones.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/encoded_token.h"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/TmpIndex.hpp"
+#include "mws/query/engine.h"
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] = "/tmp/test_search_budget.memsector";
+static const uint32_t NUM_CONSTANTS = 3000;
+static const unsigned MAX_TOTAL = 100000;
+
+static const encoded_token_t f_tok = encoded_token(CONSTANT_ID_MIN, 1);
+static const encoded_token_t g_tok = encoded_token(CONSTANT_ID_MIN + 1, 2);
+static const encoded_token_t P_tok = encoded_token(QVAR_ID_MIN, 0);
+
+static encoded_token_t constant(uint32_t i) {
+    return encoded_token(CONSTANT_ID_MIN + 2 + i, 0);
+}
+
+struct Tester {
+    static void insert(index::TmpIndex* data,
+                       const vector<encoded_token_t>& formula) {
+        data->insertData(formula)->solutions++;
+    }
+};
+
+/// Leaves of the query, until the cursor stops with *ret
+static vector<const leaf_t*> leaves(index_handle_t* index,
+                                    vector<encoded_token_t> query,
+                                    uint64_t maxNodes, stop_callback_t stopCb,
+                                    int* ret, uint64_t* visited) {
+    encoded_formula_t formula = {query.data(), (uint32_t)query.size()};
+    vector<const leaf_t*> result;
+    query_cursor_t* cursor = query_cursor_create(index, &formula, NULL, NULL);
+    const leaf_t* leaf;
+
+    query_cursor_set_limits(cursor, maxNodes, stopCb, NULL);
+    while ((*ret = query_cursor_next(cursor, &leaf)) == QUERY_CONTINUE) {
+        result.push_back(leaf);
+    }
+    *visited = query_cursor_get_visited(cursor);
+    query_cursor_destroy(cursor);
+
+    return result;
+}
+
+static bool stopNow(void* handle) {
+    UNUSED(handle);
+    return true;
+}
+
+static bool isPrefix(const vector<const leaf_t*>& prefix,
+                     const vector<const leaf_t*>& all) {
+    return prefix.size() <= all.size() &&
+           std::equal(prefix.begin(), prefix.end(), all.begin());
+}
+
+static bool isSubset(const MwsAnswset* partial, const MwsAnswset* complete) {
+    return std::includes(complete->ids.begin(), complete->ids.end(),
+                         partial->ids.begin(), partial->ids.end());
+}
+
+int main() {
+    index::TmpIndex data;
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    Query::Options options;
+    int ret;
+    uint64_t visited;
+
+    for (uint32_t i = 0; i < NUM_CONSTANTS; i++) {
+        Tester::insert(&data, {f_tok, constant(i)});
+        Tester::insert(&data, {g_tok, constant(i), constant(i)});
+    }
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    options.includeHits = false;
+
+    for (const vector<encoded_token_t>& query :
+         vector<vector<encoded_token_t>>{{P_tok}, {g_tok, P_tok, P_tok}}) {
+        vector<const leaf_t*> all =
+            leaves(&index, query, 0, NULL, &ret, &visited);
+        uint64_t fullVisits = visited;
+        FAIL_ON(ret != QUERY_STOP);
+        FAIL_ON(all.size() != (query.size() == 1 ? 2 : 1) * NUM_CONSTANTS);
+
+        // a budget of the full search does not limit it
+        FAIL_ON(leaves(&index, query, fullVisits, NULL, &ret, &visited) !=
+                all);
+        FAIL_ON(ret != QUERY_STOP || visited != fullVisits);
+
+        // smaller budgets stop at a prefix, after at most one more visit
+        for (uint64_t maxNodes : {fullVisits - 1, fullVisits / 2,
+                                  (uint64_t)3, (uint64_t)1}) {
+            vector<const leaf_t*> prefix =
+                leaves(&index, query, maxNodes, NULL, &ret, &visited);
+            FAIL_ON(ret != QUERY_LIMIT);
+            FAIL_ON(visited > maxNodes + 1);
+            FAIL_ON(!isPrefix(prefix, all));
+            FAIL_ON(prefix.size() == all.size());
+        }
+
+        // the stop callback limits the search too
+        FAIL_ON(!isPrefix(leaves(&index, query, 0, stopNow, &ret, &visited),
+                          all));
+        FAIL_ON(ret != QUERY_LIMIT || visited >= fullVisits);
+
+        // search contexts return partial answer sets
+        for (uint64_t maxNodes : {(uint64_t)0, (uint64_t)50}) {
+            options.maxNodes = maxNodes;
+            EngineContext engineContext(query, options);
+            SearchContext searchContext(query, options);
+            unique_ptr<MwsAnswset> engineResult(engineContext.getResult(
+                &index, &dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+            unique_ptr<MwsAnswset> searchResult(
+                searchContext.getResult<IndexAccessor>(
+                    &index, &dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+            for (const MwsAnswset* result :
+                 {engineResult.get(), searchResult.get()}) {
+                FAIL_ON(result->partial != (maxNodes > 0));
+                FAIL_ON(result->total != (int)result->ids.size());
+                if (maxNodes == 0) {
+                    FAIL_ON(result->total != (int)all.size());
+                } else {
+                    FAIL_ON(result->total >= (int)all.size());
+                }
+            }
+            if (maxNodes == 0) {
+                FAIL_ON(engineResult->ids != searchResult->ids);
+            } else {
+                options.maxNodes = 0;
+                EngineContext complete(query, options);
+                unique_ptr<MwsAnswset> completeResult(complete.getResult(
+                    &index, &dbQueryManager, 0, MAX_TOTAL, MAX_TOTAL));
+                FAIL_ON(!isSubset(engineResult.get(), completeResult.get()));
+                FAIL_ON(!isSubset(searchResult.get(), completeResult.get()));
+            }
+        }
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,260 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @brief Differential test of the compiled SearchContext program
+ * @file search_context_program.cpp
+ * @date 19 Oct 2026
+ *
+ * Queries with repeated qvars and ranges, derived from the formulae of the
+ * test harvests and of program/program.harvest, which repeats subterms
+ * around numbers, run as compiled programs on the TmpIndex and on the
+ * compressed index. Both must return what the cursors of the query engine
+ * return. Under a node budget, both programs must stop at the same
+ * solutions, a subset of the complete ones.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+using std::unique_ptr;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "common/utils/compiler_defs.h"
+#include "mws/dbc/DbQueryManager.hpp"
+using mws::dbc::DbQueryManager;
+#include "mws/dbc/MemCrawlDb.hpp"
+#include "mws/dbc/MemFormulaDb.hpp"
+#include "mws/index/index.h"
+#include "mws/index/IndexAccessor.hpp"
+using mws::index::IndexAccessor;
+#include "mws/index/IndexBuilder.hpp"
+using mws::index::IndexBuilder;
+using mws::index::loadHarvests;
+#include "mws/index/IndexIterator.hpp"
+using mws::index::IndexIterator;
+#include "mws/index/IndexWriter.hpp"
+using mws::index::HarvesterConfiguration;
+#include "mws/index/MeaningDictionary.hpp"
+using mws::index::MeaningDictionary;
+#include "mws/index/TmpIndex.hpp"
+using mws::index::TmpIndex;
+#include "mws/index/TmpIndexAccessor.hpp"
+using mws::index::TmpIndexAccessor;
+#include "mws/query/EngineContext.hpp"
+using mws::query::EngineContext;
+#include "mws/query/NumericConstants.hpp"
+using mws::query::NumericConstants;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+
+#include "build-gen/config.h"
+#include "differential_tester.hpp"
+
+using namespace mws;
+
+static const char MEMSECTOR_PATH[] =
+    "/tmp/test_search_context_program.memsector";
+
+static const SearchContext::RangeBounds RANGE_BOUNDS = {
+    {RANGE_ID_MIN, {-1e300, 1e300}}, {RANGE_ID_MIN + 1, {2, 10}},
+};
+
+static const uint64_t MAX_NODES[] = {1, 5, 50};
+
+static bool sameSubterm(const vector<encoded_token_t>& formula, size_t i,
+                        size_t j) {
+    size_t end = subtermEnd(formula, i);
+    if (end - i != subtermEnd(formula, j) - j) return false;
+    for (size_t k = 0; i + k < end; k++) {
+        if (formula[i + k].id != formula[j + k].id ||
+            formula[i + k].arity != formula[j + k].arity) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void addQueries(const vector<encoded_token_t>& formula,
+                       vector<vector<encoded_token_t>>* queries) {
+    const encoded_token_t x = encoded_token(QVAR_ID_MIN, 0);
+    const encoded_token_t y = encoded_token(QVAR_ID_MIN + 1, 0);
+    const encoded_token_t range = encoded_token(RANGE_ID_MIN + 1, 0);
+
+    for (size_t i = 0; i < formula.size(); i++) {
+        queries->push_back(replace(formula, i, x));
+
+        // x repeated at a later subterm, equal to the first one or not,
+        // and x followed by a distinct qvar
+        size_t distinct = 0;
+        for (size_t j = subtermEnd(formula, i); j < formula.size(); j++) {
+            bool same = sameSubterm(formula, i, j);
+            if (!same && distinct++ >= 2) continue;
+            queries->push_back(replace(replace(formula, j, x), i, x));
+            queries->push_back(replace(replace(formula, j, y), i, x));
+            // a range between both occurrences
+            for (size_t k = subtermEnd(formula, i); same && k < j; k++) {
+                if (formula[k].arity == 0) {
+                    queries->push_back(replace(
+                        replace(replace(formula, j, x), k, range), i, x));
+                }
+            }
+        }
+
+        if (formula[i].arity == 0) {
+            for (uint32_t r = 0; r < RANGE_BOUNDS.size(); r++) {
+                queries->push_back(
+                    replace(formula, i, encoded_token(RANGE_ID_MIN + r, 0)));
+            }
+        }
+    }
+}
+
+static bool isSubset(const MwsAnswset* part, const MwsAnswset* all) {
+    return std::includes(all->ids.begin(), all->ids.end(), part->ids.begin(),
+                         part->ids.end());
+}
+
+static int compare(index_handle_t* index, TmpIndex* data,
+                   DbQueryManager* dbQueryManager,
+                   const NumericConstants* numbers,
+                   const vector<encoded_token_t>& query) {
+    for (bool includeHits : {true, false}) {
+        Query::Options options;
+        options.includeHits = includeHits;
+        options.includeMwsIds = true;
+        for (const Pagination& p : PAGINATIONS) {
+            EngineContext engineContext(query, options, RANGE_BOUNDS,
+                                        numbers);
+            SearchContext searchContext(query, options, RANGE_BOUNDS,
+                                        numbers);
+            unique_ptr<MwsAnswset> expected(engineContext.getResult(
+                index, dbQueryManager, p.offset, p.size, p.maxTotal));
+            unique_ptr<MwsAnswset> compiled(
+                searchContext.getResult<IndexAccessor>(
+                    index, dbQueryManager, p.offset, p.size, p.maxTotal));
+            unique_ptr<MwsAnswset> tmpCompiled(
+                searchContext.getResult<TmpIndexAccessor>(
+                    data, dbQueryManager, p.offset, p.size, p.maxTotal));
+            if (!sameAnswers(expected.get(), compiled.get()) ||
+                !sameAnswers(expected.get(), tmpCompiled.get())) {
+                fprintf(stderr, "Mismatch (hits=%d offset=%u size=%u "
+                                "max=%u): total %d vs %d and %d\n",
+                        includeHits, p.offset, p.size, p.maxTotal,
+                        expected->total, compiled->total, tmpCompiled->total);
+                return -1;
+            }
+        }
+
+        // the budget stops both programs at the same solutions
+        Query::Options complete = options;
+        unique_ptr<MwsAnswset> all(
+            SearchContext(query, complete, RANGE_BOUNDS, numbers)
+                .getResult<IndexAccessor>(index, dbQueryManager, 0, 100000,
+                                          100000));
+        for (uint64_t maxNodes : MAX_NODES) {
+            options.maxNodes = maxNodes;
+            SearchContext searchContext(query, options, RANGE_BOUNDS,
+                                        numbers);
+            unique_ptr<MwsAnswset> compiled(
+                searchContext.getResult<IndexAccessor>(
+                    index, dbQueryManager, 0, 100000, 100000));
+            unique_ptr<MwsAnswset> tmpCompiled(
+                searchContext.getResult<TmpIndexAccessor>(
+                    data, dbQueryManager, 0, 100000, 100000));
+            if (!sameAnswers(compiled.get(), tmpCompiled.get()) ||
+                !isSubset(compiled.get(), all.get()) ||
+                (!compiled->partial && compiled->total != all->total)) {
+                fprintf(stderr, "Mismatch (hits=%d maxNodes=%lu): total %d "
+                                "vs %d of %d\n",
+                        includeHits, (unsigned long)maxNodes, compiled->total,
+                        tmpCompiled->total, all->total);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    memsector_writer_t mswr;
+    memsector_handle_t ms;
+    index_handle_t index;
+    dbc::MemCrawlDb crawlDb;
+    dbc::MemFormulaDb formulaDb;
+    DbQueryManager dbQueryManager(&crawlDb, &formulaDb);
+    MeaningDictionary meaningDictionary;
+    unique_ptr<NumericConstants> numbers;
+    TmpIndex data;
+    IndexBuilder indexBuilder(&formulaDb, &crawlDb, &data, &meaningDictionary,
+                              index::ExpressionEncoder::Config());
+    HarvesterConfiguration config;
+    vector<vector<encoded_token_t>> queries;
+
+    config.paths.push_back(MWS_TESTDATA_PATH);
+    config.paths.push_back((string)MWS_TESTDATA_PATH + "/program");
+    config.fileExtension = "harvest";
+    config.recursive = false;
+
+    FAIL_ON(unlink(MEMSECTOR_PATH) != 0 && errno != ENOENT);
+    FAIL_ON(loadHarvests(&indexBuilder, config) <= 0);
+    numbers.reset(new NumericConstants(&meaningDictionary));
+    FAIL_ON(memsector_create(&mswr, MEMSECTOR_PATH) != 0);
+    data.exportToMemsector(&mswr);
+    FAIL_ON(memsector_load(&ms, MEMSECTOR_PATH) != 0);
+    index.ms = ms.ms;
+    index.root = memsector_get_root(&ms);
+
+    {
+        IndexIterator<IndexAccessor> it(&index);
+        while (it.next() != nullptr) {
+            vector<encoded_token_t> formula;
+            for (const auto& elem : it.getPath()) {
+                formula.push_back(IndexAccessor::getToken(elem));
+            }
+            addQueries(formula, &queries);
+        }
+    }
+    FAIL_ON(queries.empty());
+    queries.push_back({encoded_token(QVAR_ID_MIN, 0)});
+    queries.push_back({encoded_token(RANGE_ID_MIN + 1, 0)});
+    printf("Comparing %zu queries\n", queries.size());
+
+    for (const vector<encoded_token_t>& query : queries) {
+        FAIL_ON(compare(&index, &data, &dbQueryManager, numbers.get(),
+                        query) != 0);
+    }
+
+    FAIL_ON(memsector_remove(&ms) != 0);
+    FAIL_ON(memsector_unload(&ms) != 0);
+
+    return EXIT_SUCCESS;
+
+fail:
+    return EXIT_FAILURE;
+}
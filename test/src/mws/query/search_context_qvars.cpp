@@ -0,0 +1,140 @@
+/*
+
+Copyright (C) 2010-2014 KWARC Group <kwarc.info>
+
+This file is part of MathWebSearch.
+
+MathWebSearch is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MathWebSearch is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MathWebSearch.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+ * @file search_context_qvars.cpp
+ *
+ */
+
+#include <set>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include "mws/index/TmpIndexAccessor.hpp"
+using mws::index::TmpIndexAccessor;
+#include "mws/types/Query.hpp"
+using mws::types::Query;
+#include "mws/types/MwsAnswset.hpp"
+using mws::MwsAnswset;
+using mws::types::FormulaId;
+#include "mws/query/SearchContext.hpp"
+using mws::query::SearchContext;
+
+using namespace mws;
+using namespace std;
+
+/*
+
+index: f(a,a) f(a,b) f(b,b) f(g(a),g(a)) f(g(a),b)
+query: f(?x,?x) -> f(a,a) f(b,b) f(g(a),g(a))
+query: f(?x,?y) -> all 5
+
+*/
+
+static const encoded_token_t f_tok = encoded_token(CONSTANT_ID_MIN, 2);
+static const encoded_token_t g_tok = encoded_token(CONSTANT_ID_MIN + 1, 1);
+static const encoded_token_t a_tok = encoded_token(CONSTANT_ID_MIN + 2, 0);
+static const encoded_token_t b_tok = encoded_token(CONSTANT_ID_MIN + 3, 0);
+static const encoded_token_t x_tok = encoded_token(QVAR_ID_MIN, 0);
+static const encoded_token_t y_tok = encoded_token(QVAR_ID_MIN + 1, 0);
+
+struct Tester {
+    static FormulaId insert(index::TmpIndex* index,
+                            const vector<encoded_token_t>& formula) {
+        index::TmpLeafNode* leaf = index->insertData(formula);
+        leaf->solutions++;
+        return leaf->id;
+    }
+};
+
+static set<FormulaId> search(index::TmpIndex* index,
+                             const vector<encoded_token_t>& encodedQuery) {
+    Query defaultQuery;
+    defaultQuery.options.includeHits = false;
+    SearchContext ctxt(encodedQuery, defaultQuery.options, {}, nullptr);
+    MwsAnswset* answ = ctxt.getResult<TmpIndexAccessor>(
+        index, nullptr, defaultQuery.attrResultLimitMin,
+        defaultQuery.attrResultMaxSize, defaultQuery.attrResultTotalReqNr);
+    set<FormulaId> ids(answ->ids.begin(), answ->ids.end());
+    if (answ->total != (int)ids.size()) ids.clear();
+    delete answ;
+    return ids;
+}
+
+int main() {
+    index::TmpIndex index;
+    FormulaId aa = Tester::insert(&index, {f_tok, a_tok, a_tok});
+    FormulaId ab = Tester::insert(&index, {f_tok, a_tok, b_tok});
+    FormulaId bb = Tester::insert(&index, {f_tok, b_tok, b_tok});
+    FormulaId gg = Tester::insert(&index, {f_tok, g_tok, a_tok, g_tok, a_tok});
+    FormulaId gb = Tester::insert(&index, {f_tok, g_tok, a_tok, b_tok});
+    const set<FormulaId> same = {aa, bb, gg};
+    const set<FormulaId> all = {aa, ab, bb, gg, gb};
+
+    FAIL_ON(search(&index, {f_tok, x_tok, x_tok}) != same);
+    FAIL_ON(search(&index, {f_tok, x_tok, y_tok}) != all);
+    // state of the previous searches is reused
+    FAIL_ON(search(&index, {f_tok, x_tok, x_tok}) != same);
+
+    {
+        // an outer context keeps its state while another one searches
+        Query defaultQuery;
+        defaultQuery.options.includeHits = false;
+        SearchContext outer({f_tok, x_tok, x_tok}, defaultQuery.options, {},
+                            nullptr);
+        FAIL_ON(search(&index, {f_tok, x_tok, y_tok}) != all);
+        MwsAnswset* answ = outer.getResult<TmpIndexAccessor>(
+            &index, nullptr, 0, defaultQuery.attrResultMaxSize,
+            defaultQuery.attrResultTotalReqNr);
+        set<FormulaId> ids(answ->ids.begin(), answ->ids.end());
+        delete answ;
+        FAIL_ON(ids != same);
+    }
+
+    {
+        // a context built on one thread searches on others, while the
+        // thread building it searches too
+        Query defaultQuery;
+        defaultQuery.options.includeHits = false;
+        SearchContext ctxt({f_tok, x_tok, x_tok}, defaultQuery.options, {},
+                           nullptr);
+        vector<set<FormulaId>> results(4);
+        vector<std::thread> threads;
+        for (size_t t = 0; t < results.size(); t++) {
+            threads.emplace_back([&index, &ctxt, &defaultQuery, &results, t]() {
+                MwsAnswset* answ = ctxt.getResult<TmpIndexAccessor>(
+                    &index, nullptr, 0, defaultQuery.attrResultMaxSize,
+                    defaultQuery.attrResultTotalReqNr);
+                results[t].insert(answ->ids.begin(), answ->ids.end());
+                delete answ;
+            });
+        }
+        bool sameHere = (search(&index, {f_tok, x_tok, y_tok}) == all);
+        for (auto& thread : threads) thread.join();
+        FAIL_ON(!sameHere);
+        for (const set<FormulaId>& ids : results) FAIL_ON(ids != same);
+    }
+
+    return EXIT_SUCCESS;
+fail:
+    return EXIT_FAILURE;
+}